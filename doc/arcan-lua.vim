@@ -347,6 +347,7 @@ hi def link luaLabel		Label
 
 
 syn keyword luaFunc benchmark_data
+syn keyword luaFunc benchmark_histogram
 syn keyword luaFunc define_nulltarget
 syn keyword luaFunc net_listen
 syn keyword luaFunc text_dimensions
@@ -417,6 +418,7 @@ syn keyword luaFunc set_image_as_frame
 syn keyword luaFunc fill_surface
 syn keyword luaFunc add_3dmesh
 syn keyword luaFunc audio_buffer_size
+syn keyword luaFunc audio_buffer_state
 syn keyword luaFunc audio_gain
 syn keyword luaFunc map_video_display
 syn keyword luaFunc pacify_target
@@ -15,7 +15,7 @@
 -- current value.
 -- @group: audio
 -- @cfunction: abufsz
--- @related:
+-- @related: audio_buffer_state
 function main()
 #ifdef MAIN
 #endif
@@ -0,0 +1,35 @@
+-- audio_buffer_state
+-- @short: Retrieve the negotiated audio buffering of a frameserver
+-- @inargs: vid:fsrv
+-- @outargs: tbl
+-- @longdescr: Frameservers get their audio buffer size and count negotiated
+-- whenever they perform a resize operation. The size is based on the period
+-- of the audio output device and grows if the frameserver keeps on running
+-- out of audio (underruns). Clients that ask for large buffers, or keep more
+-- audio queued than can be played (overruns) are treated as bulk producers
+-- and get fewer, larger buffers. This function returns a table with the
+-- currently negotiated values and counters: buffer_size (bytes),
+-- buffer_count, samplerate, underruns, overruns, bulk (boolean),
+-- output_period (samples per channel, 0 if unknown) and output_rate.
+-- @note: The underrun and overrun counters are only tracked for sources
+-- that are serviced by the audio thread, and are 0 otherwise.
+-- @note: The default size set through ref:audio_buffer_size acts as a
+-- lower bound for the negotiated size.
+-- @group: audio
+-- @cfunction: abufstate
+-- @related: audio_buffer_size
+function main()
+#ifdef MAIN
+	local vid = launch_avfeed("", "avfeed",
+	function(source, status)
+		print(status.kind)
+		for k,v in pairs(audio_buffer_state(source)) do
+			print(k, v)
+		end
+	end)
+#endif
+
+#ifdef ERROR1
+	audio_buffer_state(BADID)
+#endif
+end
@@ -1,7 +1,31 @@
 -- benchmark_data
 -- @short: Retrieve gathered benchmarking values.
--- @outargs: nticks, tickcosttbl, framecount, frametimetbl, costcount, framecosttbl
+-- @outargs: nticks, tickcosttbl, framecount, frametimetbl, costcount, framecosttbl, countertbl
+-- @longdescr: The first six values are the number of samples and the
+-- corresponding ringbuffer of timings (in milliseconds) for logic ticks,
+-- frame intervals and frame costs respectively. *countertbl* contains named
+-- counters that have accumulated since the last call to ref:benchmark_enable.
+-- The damage_ prefixed counters track the rendertarget updates, where
+-- damage_full is the number of updates that redrew the entire target,
+-- damage_partial the number of updates limited to the damaged regions,
+-- damage_skip the number of dirty updates that turned out not to change
+-- anything, damage_rects the number of regions drawn, damage_px the number
+-- of pixels covered by the updates and damage_total_px the number of pixels
+-- a full redraw of the same targets would have covered.
+-- The gc_ prefixed counters track garbage collection of the scripting VM when
+-- it is scheduled by the engine (ARCAN_CONDUCTOR_GCSLACK set in the
+-- environment), where gc_us is the total time spent in microseconds,
+-- gc_frames the number of frames where collection was performed, gc_max_us
+-- the most time spent during a single frame and gc_full the number of forced
+-- full collections due to memory pressure.
+-- The draw_ prefixed counters track 2D drawing, where draw_calls is the number
+-- of draw calls issued, draw_objects the number of objects drawn and
+-- draw_batched how many of those objects that were merged into batches.
+-- Consecutive objects that use the default shaders, the same texture and the
+-- same blend state and that are not stencil clipped are drawn as one batch.
+-- @note: With benchmarking enabled, all rendertargets are redrawn in full every
+-- frame unless the *forceredraw* argument to ref:benchmark_enable is false,
+-- so the damage counters are only interesting in that mode.
 -- @group: system
 -- @cfunction: getbenchvals
--- @related: benchmark_enable, benchmark_timestamp
-
+-- @related: benchmark_enable, benchmark_timestamp, benchmark_histogram
@@ -1,8 +1,10 @@
 -- benchmark_enable
 -- @short: Toggle the gathering of benchmark data on / off.
--- @inargs: *opttoggle*
--- @group: system
+-- @inargs: *opttoggle*, *forceredraw*
+-- @longdescr: By default, enabling benchmarking also disables the dirty
+-- tracking so that all rendertargets are redrawn every frame. Set
+-- *forceredraw* to false in order to measure the normal (damage limited)
+-- update behavior.
 -- @note: All calls to this function will reset all timestamp buffers.
 -- @cfunction: togglebench
 -- @related: benchmark_data, benchmark_timestamp
-
@@ -0,0 +1,34 @@
+-- benchmark_histogram
+-- @short: Retrieve per-stage timing distributions.
+-- @outargs: stagetbl
+-- @longdescr: While benchmarking is enabled (see ref:benchmark_enable), the
+-- time spent in each stage of the main loop is added to a histogram with
+-- microsecond resolution. *stagetbl* is indexed by stage name:
+-- event (scripting event handlers), lua_tick (scripting clock_pulse),
+-- video_tick, rendertarget (one sample per rendertarget refresh), synch
+-- (platform synchronization including waiting for the display), readback
+-- and frame (frame to frame interval). Each entry is a table with the fields
+-- count, min, max, mean, p50, p90, p99 and p999, all but count in
+-- microseconds. The percentiles have a relative error of about 3%.
+-- The histograms are reset whenever ref:benchmark_enable is called.
+-- @note: If ARCAN_BENCH_DUMP is set to a path in the environment, sending
+-- SIGRTMIN+2 to the process will write the same summary as text to that
+-- path, one line per stage.
+-- @group: system
+-- @cfunction: getbenchhist
+-- @related: benchmark_enable, benchmark_data
+function main()
+#ifdef MAIN
+	benchmark_enable(true)
+	local counter = 0
+	clock_pulse = function()
+		counter = counter + 1
+		if counter == 500 then
+			for k,v in pairs(benchmark_histogram()) do
+				print(k, v.count, v.p50, v.p99, v.p999)
+			end
+			return shutdown()
+		end
+	end
+#endif
+end
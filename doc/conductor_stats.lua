@@ -0,0 +1,46 @@
+-- conductor_stats
+-- @short: Retrieve scheduling statistics from the main loop.
+-- @outargs: statstbl
+-- @longdescr: The engine main loop (the conductor) runs in a number of
+-- stages for each frame that is produced: *feed* (polling external sources
+-- and uploading new buffers), *event* (event processing, logic ticks and the
+-- related script callbacks), *frame* (the preframe_pulse and postframe_pulse
+-- script hooks), *synch* (composition and waiting for the display) and *idle*
+-- (readbacks and other work deferred until the frame has been handed off).
+-- *statstbl* has one subtable per stage with the fields *last*, *avg* and
+-- *max*, all in microseconds. *max* covers the time since the last call to
+-- this function.
+-- The other fields are *frames* (number of passes), *frameservers* (active
+-- external sources), *uploads* and *deferred* (buffer uploads performed and
+-- postponed in the last pass), *deferred_total*, *upload_budget* (in
+-- microseconds, 0 means no limit), *synch_period* (estimated milliseconds
+-- between display synchs), *slack* (estimated microseconds left before the
+-- next frame has to start, measured when entering the idle stage) and *gc*
+-- (microseconds of that spent on scripting VM garbage collection).
+-- @note: Buffer uploads are processed with the target set through
+-- ref:target_flags with TARGET_PRIORITY first, followed by the ones that have
+-- been waiting the longest. When the time spent uploading exceeds the upload
+-- budget (set with the ARCAN_CONDUCTOR_UPLOAD_BUDGET environment variable)
+-- the remaining uploads are postponed to the next frame, though never more
+-- than a few frames in a row. Uploads are not held back on GPU fences, the
+-- budget is the only throttle.
+-- @note: With ARCAN_CONDUCTOR_GCSLACK set in the environment, the automatic
+-- garbage collector of the scripting VM is disabled and incremental steps are
+-- instead run in the idle stage for as long as there is slack, with a full
+-- collection only forced if memory use grows well beyond what remained after
+-- the last completed cycle.
+-- @group: system
+-- @cfunction: getconductorstats
+-- @related: benchmark_data, target_flags
+function main()
+#ifdef MAIN
+	local stats = conductor_stats();
+	for k,v in pairs(stats) do
+		if type(v) == "table" then
+			print(k, v.last, v.avg, v.max);
+		else
+			print(k, v);
+		end
+	end
+#endif
+end
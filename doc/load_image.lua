@@ -15,6 +15,10 @@
 -- push / pop or launch_target(external).
 -- @note: supported file formats vary with platform and engine build, only
 -- ones that are guaranteed to work are PNG and JPEG.
+-- @note: Loading the same unmodified file with the same options will share
+-- the already decoded storage (as with ref:image_sharestorage) rather than
+-- decoding it again. Operations that alter the storage of one such VID (e.g.
+-- ref:image_texfilter, ref:image_mipmap) first give it a private copy.
 -- @group: image
 -- @cfunction: loadimage
 -- @related: load_image_asynch
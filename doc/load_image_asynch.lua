@@ -14,6 +14,9 @@
 -- @note: The operation can be forced asynchronous by either doing an operation which requires
 -- a stable state for the current context (e.g. push/pop_video_context) or by explicitly calling
 -- image_pushasynch.
+-- @note: Decoding is performed by a fixed pool of worker threads. Jobs for
+-- objects that have been made visible are picked before those that have not,
+-- and deleting the VID before the image has been decoded cancels the job.
 -- @group: image
 -- @cfunction: loadimageasynch
 -- @related: image_pushasynch load_image
@@ -0,0 +1,27 @@
+-- memory_stats
+-- @short: Retrieve engine memory allocation counters.
+-- @outargs: statstbl
+-- @longdescr: The engine tags its own allocations with a usage type, and
+-- keeps counters for each type. *statstbl* has one subtable per type, keyed
+-- by the names *vbuffer*, *vstruct*, *extstruct*, *abuffer*, *stringbuf*,
+-- *vtag*, *atag*, *binding*, *modeldata* and *threadctx*. Each subtable has
+-- the fields *allocs* and *frees* (number of allocations and deallocations),
+-- *in_use* (bytes currently allocated), *peak* (the highest value that
+-- *in_use* has had) and *pool* (bytes reserved in pools for the type).
+-- @note: The small structure and string types are served from pools, for
+-- these *in_use* is counted in pool block sizes rather than the exact
+-- requested size. Setting ARCAN_MEM_NOPOOL in the environment disables the
+-- pools, for use with external memory debugging tools.
+-- @note: Memory allocated by libraries and by the scripting VM itself is
+-- not included.
+-- @group: system
+-- @cfunction: getmemstats
+-- @related: benchmark_data, conductor_stats
+function main()
+#ifdef MAIN
+	local stats = memory_stats();
+	for k,v in pairs(stats) do
+		print(k, v.allocs, v.frees, v.in_use, v.peak, v.pool);
+	end
+#endif
+end
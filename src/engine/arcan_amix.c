@@ -0,0 +1,128 @@
+/*
+ * Copyright 2018, Björn Ståhl
+ * License: 3-Clause BSD, see COPYING file in arcan source repository.
+ * Reference: http://arcan-fe.com
+ * Description: Planar stereo mixing kernels, see arcan_amix.h.
+ * SSE2 and NEON versions work on four frames at a time, the scalar loop
+ * takes the remainder (and everything on other targets).
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "arcan_amix.h"
+
+static inline int16_t clip_s16(float val)
+{
+	val *= 32767.0f;
+	return val >= 32767.0f ? 32767 : (val <= -32768.0f ? -32768 : val);
+}
+
+void arcan_amix_deinterleave(const int16_t* in, size_t n,
+	float l_gain, float r_gain, float* left, float* right)
+{
+	size_t i = 0;
+	l_gain /= 32767.0f;
+	r_gain /= 32767.0f;
+
+#if defined(__SSE2__)
+	const __m128 lg = _mm_set1_ps(l_gain);
+	const __m128 rg = _mm_set1_ps(r_gain);
+
+/* each 32-bit lane holds one L/R pair, shift to sign extend either half */
+	for (; i + 4 <= n; i += 4){
+		__m128i v = _mm_loadu_si128((const __m128i*) &in[i * 2]);
+		__m128i l = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+		__m128i r = _mm_srai_epi32(v, 16);
+		_mm_storeu_ps(&left[i], _mm_mul_ps(_mm_cvtepi32_ps(l), lg));
+		_mm_storeu_ps(&right[i], _mm_mul_ps(_mm_cvtepi32_ps(r), rg));
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	const float32x4_t lg = vdupq_n_f32(l_gain);
+	const float32x4_t rg = vdupq_n_f32(r_gain);
+
+	for (; i + 4 <= n; i += 4){
+		int16x4x2_t v = vld2_s16(&in[i * 2]);
+		vst1q_f32(&left[i], vmulq_f32(vcvtq_f32_s32(vmovl_s16(v.val[0])), lg));
+		vst1q_f32(&right[i], vmulq_f32(vcvtq_f32_s32(vmovl_s16(v.val[1])), rg));
+	}
+#endif
+
+	for (; i < n; i++){
+		left[i] = (float) in[i * 2 + 0] * l_gain;
+		right[i] = (float) in[i * 2 + 1] * r_gain;
+	}
+}
+
+void arcan_amix_planar(float** left, float** right,
+	size_t n_src, size_t n, int16_t* out)
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128 scale = _mm_set1_ps(32767.0f);
+	const __m128 hi = _mm_set1_ps(32767.0f);
+	const __m128 lo = _mm_set1_ps(-32768.0f);
+
+	for (; i + 4 <= n; i += 4){
+		__m128 l = _mm_setzero_ps();
+		__m128 r = _mm_setzero_ps();
+
+		for (size_t j = 0; j < n_src; j++){
+			__m128 a = _mm_loadu_ps(&left[j][i]);
+			__m128 b = _mm_loadu_ps(&right[j][i]);
+			l = _mm_sub_ps(_mm_add_ps(l, a), _mm_mul_ps(l, a));
+			r = _mm_sub_ps(_mm_add_ps(r, b), _mm_mul_ps(r, b));
+		}
+
+		l = _mm_max_ps(_mm_min_ps(_mm_mul_ps(l, scale), hi), lo);
+		r = _mm_max_ps(_mm_min_ps(_mm_mul_ps(r, scale), hi), lo);
+		__m128i li = _mm_cvttps_epi32(l);
+		__m128i ri = _mm_cvttps_epi32(r);
+
+/* L0 R0 L1 R1 | L2 R2 L3 R3 -> interleaved s16 */
+		__m128i res = _mm_packs_epi32(
+			_mm_unpacklo_epi32(li, ri), _mm_unpackhi_epi32(li, ri));
+		_mm_storeu_si128((__m128i*) &out[i * 2], res);
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	const float32x4_t scale = vdupq_n_f32(32767.0f);
+
+	for (; i + 4 <= n; i += 4){
+		float32x4_t l = vdupq_n_f32(0);
+		float32x4_t r = vdupq_n_f32(0);
+
+		for (size_t j = 0; j < n_src; j++){
+			float32x4_t a = vld1q_f32(&left[j][i]);
+			float32x4_t b = vld1q_f32(&right[j][i]);
+			l = vmlsq_f32(vaddq_f32(l, a), l, a);
+			r = vmlsq_f32(vaddq_f32(r, b), r, b);
+		}
+
+/* the narrowing saturates, the float to int conversion does as well */
+		int16x4x2_t res = {{
+			vqmovn_s32(vcvtq_s32_f32(vmulq_f32(l, scale))),
+			vqmovn_s32(vcvtq_s32_f32(vmulq_f32(r, scale)))
+		}};
+		vst2_s16(&out[i * 2], res);
+	}
+#endif
+
+	for (; i < n; i++){
+		float l = 0;
+		float r = 0;
+
+		for (size_t j = 0; j < n_src; j++){
+			l += left[j][i] - l * left[j][i];
+			r += right[j][i] - r * right[j][i];
+		}
+
+		out[i * 2 + 0] = clip_s16(l);
+		out[i * 2 + 1] = clip_s16(r);
+	}
+}
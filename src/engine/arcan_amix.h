@@ -0,0 +1,31 @@
+/*
+ * Copyright 2018, Björn Ståhl
+ * License: 3-Clause BSD, see COPYING file in arcan source repository.
+ * Reference: http://arcan-fe.com
+ * Description: Mixing kernels for the frameserver recording path
+ * (arcan_frameserver_avfeed_mixer). Sources are kept as planar float and
+ * the kernels have no dependencies on the rest of the engine, so they can
+ * be built separately (see tests/core/amixbench).
+ */
+
+#ifndef HAVE_ARCAN_AMIX
+#define HAVE_ARCAN_AMIX
+
+/*
+ * convert [n] interleaved stereo signed 16-bit frames from [in] into the
+ * [left] and [right] float planes, normalized to -1..1 and scaled by the
+ * respective gain.
+ */
+void arcan_amix_deinterleave(const int16_t* in, size_t n,
+	float l_gain, float r_gain, float* left, float* right);
+
+/*
+ * mix [n] frames from [n_src] sources, where left[i] and right[i] are the
+ * planes of the i:th source, with Z = A + B - A * B. The result is clipped
+ * and written as interleaved stereo signed 16-bit to [out]. The planes and
+ * [out] need no alignment beyond that of their types.
+ */
+void arcan_amix_planar(float** left, float** right,
+	size_t n_src, size_t n, int16_t* out);
+
+#endif
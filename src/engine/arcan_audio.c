@@ -19,6 +19,7 @@
 #include <limits.h>
 #include <inttypes.h>
 #include <pthread.h>
+#include <stdatomic.h>
 
 #include <al.h>
 #include <alc.h>
@@ -47,6 +48,26 @@ struct arcan_acontext {
 
 	arcan_monafunc_cb globalhook;
 	void* global_hooktag;
+
+/* the audio thread refills the OpenAL queues of streaming sources, [lock]
+ * covers the source list and the OpenAL state of those sources */
+	pthread_mutex_t lock;
+	pthread_t thread;
+	_Atomic bool thread_alive;
+	bool threaded;
+
+/* gain updates for proxied objects, collected under [lock] in the tick and
+ * forwarded after it has been released */
+	struct proxy_gain {
+		arcan_again_cb cb;
+		void* tag;
+		float gain;
+	}* proxy_gains;
+	size_t proxy_gains_cap;
+
+/* mixing period of the output device, samples per channel at out_rate */
+	size_t out_period;
+	unsigned out_rate;
 };
 
 static bool _wrap_alError(arcan_aobj*, char*);
@@ -60,12 +81,14 @@ static ssize_t find_bufferind(arcan_aobj* cur, unsigned bufnum);
  * openAL volatility alongside hardware buffering problems etc. make it too
  * much of a hazzle */
 static struct arcan_acontext _current_acontext = {
-	.first = NULL, .context = NULL, .def_gain = 1.0
+	.first = NULL, .context = NULL, .def_gain = 1.0,
+	.lock = PTHREAD_MUTEX_INITIALIZER
 };
 static struct arcan_acontext* current_acontext = &_current_acontext;
 
 static arcan_aobj* arcan_audio_getobj(arcan_aobj_id);
 static arcan_errc audio_free(arcan_aobj_id);
+static void* audio_thread(void*);
 
 static ALuint load_wave(const char* fname){
 	ALuint rv = 0;
@@ -230,6 +253,7 @@ static arcan_aobj_id arcan_audio_alloc(arcan_aobj** dst, bool defer)
 	if (dst)
 		*dst = newcell;
 
+	pthread_mutex_lock(&current_acontext->lock);
 	if (current_acontext->first){
 		arcan_aobj* current = current_acontext->first;
 		while(current && current->next)
@@ -239,6 +263,7 @@ static arcan_aobj_id arcan_audio_alloc(arcan_aobj** dst, bool defer)
 	}
 	else
 		current_acontext->first = newcell;
+	pthread_mutex_unlock(&current_acontext->lock);
 
 	return newcell->id;
 }
@@ -280,6 +305,7 @@ static arcan_errc audio_free(arcan_aobj_id id)
 	arcan_aobj* current = current_acontext->first;
 	arcan_aobj** owner = &(current_acontext->first);
 
+	pthread_mutex_lock(&current_acontext->lock);
  /* find */
 	while(current && current->id != id){
 		owner = &(current->next);
@@ -302,10 +328,12 @@ static arcan_errc audio_free(arcan_aobj_id id)
 		current->next = (void*) 0xdeadbeef;
 		current->tag = (void*) 0xdeadbeef;
 		current->feed = NULL;
+		arcan_mem_free(current->ring.buf);
 		arcan_mem_free(current);
 
 		rv = ARCAN_OK;
 	}
+	pthread_mutex_unlock(&current_acontext->lock);
 
 	return rv;
 }
@@ -331,6 +359,18 @@ arcan_errc arcan_audio_setup(bool nosound)
 #endif
 		alcMakeContextCurrent(current_acontext->context);
 
+/* the device may not honor the requested attributes, so ask for what we got */
+		ALCdevice* dev = alcGetContextsDevice(current_acontext->context);
+		ALCint freq = 0, refresh = 0;
+		if (dev){
+			alcGetIntegerv(dev, ALC_FREQUENCY, 1, &freq);
+			alcGetIntegerv(dev, ALC_REFRESH, 1, &refresh);
+		}
+		if (freq > 0 && refresh > 0){
+			current_acontext->out_rate = freq;
+			current_acontext->out_period = freq / refresh;
+		}
+
 		if (nosound){
 			arcan_warning("arcan_audio_init(nosound)\n");
 			alListenerf(AL_GAIN, 0.0);
@@ -339,6 +379,16 @@ arcan_errc arcan_audio_setup(bool nosound)
 		current_acontext->al_active = true;
 		rv = ARCAN_OK;
 
+		atomic_store(&current_acontext->thread_alive, true);
+		if (0 == pthread_create(
+			&current_acontext->thread, NULL, audio_thread, NULL))
+			current_acontext->threaded = true;
+		else{
+			arcan_warning("arcan_audio_init(), couldn't spawn audio thread, "
+				"streams will be refilled from the main loop\n");
+			atomic_store(&current_acontext->thread_alive, false);
+		}
+
 		/* just give a slightly "random" base so that
 		 * user scripts don't get locked into hard-coded ids .. */
 		current_acontext->lastid = rand() % 32768;
@@ -367,6 +417,16 @@ arcan_errc arcan_audio_shutdown()
 	arcan_errc rv = ARCAN_OK;
 	ALCcontext* ctx = current_acontext->context;
 
+	if (current_acontext->threaded){
+		atomic_store(&current_acontext->thread_alive, false);
+		pthread_join(current_acontext->thread, NULL);
+		current_acontext->threaded = false;
+	}
+
+	arcan_mem_free(current_acontext->proxy_gains);
+	current_acontext->proxy_gains = NULL;
+	current_acontext->proxy_gains_cap = 0;
+
 	if (ctx) {
 		/* fixme, free callback buffers etc. */
 		alcDestroyContext(ctx);
@@ -400,10 +460,14 @@ arcan_errc arcan_audio_play(arcan_aobj_id id, bool gain_override, float gain)
 			}
 	}
 /* some kind of streaming source, can't play if it is already active */
-	else if (aobj->active == false && aobj->alid != AL_NONE){
-		alSourcePlay(aobj->alid);
-		_wrap_alError(aobj, "play(alSourcePlay)");
-		aobj->active = true;
+	else {
+		pthread_mutex_lock(&current_acontext->lock);
+		if (aobj->active == false && aobj->alid != AL_NONE){
+			alSourcePlay(aobj->alid);
+			_wrap_alError(aobj, "play(alSourcePlay)");
+			aobj->active = true;
+		}
+		pthread_mutex_unlock(&current_acontext->lock);
 	}
 
 	return ARCAN_OK;
@@ -476,6 +540,10 @@ arcan_aobj_id arcan_audio_feed(arcan_afunc_cb feed, void* tag, arcan_errc* errc)
 	aobj->gain = 1.0;
 	aobj->kind = AOBJ_STREAM;
 
+	if (current_acontext->threaded)
+		aobj->ring.buf = arcan_alloc_mem(ARCAN_ASTREAM_RING,
+			ARCAN_MEM_ABUFFER, 0, ARCAN_MEMALIGN_PAGE);
+
 	if (errc) *errc = ARCAN_OK;
 	return rid;
 }
@@ -488,6 +556,7 @@ arcan_errc arcan_audio_rebuild(arcan_aobj_id id)
 	if (!aobj || aobj->alid == AL_NONE)
 		return ARCAN_ERRC_NO_SUCH_OBJECT;
 
+	pthread_mutex_lock(&current_acontext->lock);
 	alSourceStop(aobj->alid);
 	_wrap_alError(NULL, "audio_rebuild(stop)");
 
@@ -507,6 +576,34 @@ arcan_errc arcan_audio_rebuild(arcan_aobj_id id)
 	alSourcef(aobj->alid, AL_GAIN, aobj->gain);
 
 	_wrap_alError(NULL, "audio_rebuild(recreate)");
+	pthread_mutex_unlock(&current_acontext->lock);
+
+	return ARCAN_OK;
+}
+
+size_t arcan_audio_output_period(unsigned* samplerate)
+{
+	if (samplerate)
+		*samplerate = current_acontext->out_rate;
+
+	return current_acontext->out_period;
+}
+
+arcan_errc arcan_audio_bufferstats(arcan_aobj_id id,
+	unsigned* underruns, unsigned* overruns)
+{
+	arcan_aobj* aobj = arcan_audio_getobj(id);
+	if (!aobj)
+		return ARCAN_ERRC_NO_SUCH_OBJECT;
+
+	if (!aobj->ring.buf)
+		return ARCAN_ERRC_UNACCEPTED_STATE;
+
+	if (underruns)
+		*underruns = atomic_load(&aobj->ring.underruns);
+
+	if (overruns)
+		*overruns = aobj->ring.overruns;
 
 	return ARCAN_OK;
 }
@@ -530,7 +627,9 @@ arcan_errc arcan_audio_suspend()
 		current = current->next;
 	}
 
+	pthread_mutex_lock(&current_acontext->lock);
 	current_acontext->al_active = false;
+	pthread_mutex_unlock(&current_acontext->lock);
 	rv = ARCAN_OK;
 
 	return rv;
@@ -547,7 +646,9 @@ arcan_errc arcan_audio_resume()
 		current = current->next;
 	}
 
+	pthread_mutex_lock(&current_acontext->lock);
 	current_acontext->al_active = true;
+	pthread_mutex_unlock(&current_acontext->lock);
 
 	rv = ARCAN_OK;
 
@@ -566,9 +667,12 @@ arcan_errc arcan_audio_pause(arcan_aobj_id id)
  * alSourceUnqueueBuffers(dobj->alid, 1, (unsigned int*) &processed);
  * dobj->used -= processed;
  */
+		pthread_mutex_lock(&current_acontext->lock);
 		alSourceStop(dobj->alid);
 		_wrap_alError(dobj, "audio_pause(get/unqueue/stop)");
 		dobj->active = false;
+		dobj->ring.playing = false;
+		pthread_mutex_unlock(&current_acontext->lock);
 		rv = ARCAN_OK;
 	}
 
@@ -648,12 +752,14 @@ arcan_errc arcan_audio_setgain(arcan_aobj_id id, float gain, uint16_t time)
 
 		if (dobj->gproxy)
 			dobj->gproxy(dobj->gain, dobj->tag);
-		else if (dobj->alid){
-			alSourcef(dobj->alid, AL_GAIN, gain);
-			_wrap_alError(dobj, "audio_setgain(getSource/source)");
+		else{
+			pthread_mutex_lock(&current_acontext->lock);
+			if (dobj->alid){
+				alSourcef(dobj->alid, AL_GAIN, gain);
+				_wrap_alError(dobj, "audio_setgain(getSource/source)");
+			}
+			pthread_mutex_unlock(&current_acontext->lock);
 		}
-		else
-			;
 	}
 	else{
 		struct arcan_achain** dptr = &dobj->transform;
@@ -697,6 +803,46 @@ static ssize_t find_freebufferind(arcan_aobj* cur, bool tag){
 	return -1;
 }
 
+/*
+ * producer side of the stream ring (main thread), the ingest rules in
+ * astream_ingest guarantee that there is room for the whole buffer
+ */
+static void ring_write(arcan_aobj* aobj, const uint8_t* buf,
+	size_t nb, unsigned channels, unsigned samplerate)
+{
+	const size_t mask = ARCAN_ASTREAM_RING - 1;
+	size_t wpos = atomic_load_explicit(&aobj->ring.wpos, memory_order_relaxed);
+	size_t rpos = atomic_load_explicit(&aobj->ring.rpos, memory_order_acquire);
+	size_t space = ARCAN_ASTREAM_RING - (wpos - rpos);
+
+	if (nb > aobj->ring.peak)
+		aobj->ring.peak = nb;
+
+	if (nb > space){
+		nb = space;
+		nb -= nb % (channels * sizeof(int16_t));
+	}
+
+	size_t ofs = wpos & mask;
+	size_t first = ARCAN_ASTREAM_RING - ofs;
+	if (first > nb)
+		first = nb;
+
+	memcpy(&aobj->ring.buf[ofs], buf, first);
+	memcpy(aobj->ring.buf, &buf[first], nb - first);
+
+	atomic_store_explicit(&aobj->ring.channels, channels, memory_order_relaxed);
+	atomic_store_explicit(&aobj->ring.samplerate,
+		samplerate, memory_order_relaxed);
+	atomic_store_explicit(&aobj->ring.wpos, wpos + nb, memory_order_release);
+}
+
+static size_t ring_fill(arcan_aobj* aobj)
+{
+	return atomic_load_explicit(&aobj->ring.wpos, memory_order_acquire) -
+		atomic_load_explicit(&aobj->ring.rpos, memory_order_acquire);
+}
+
 void arcan_audio_buffer(arcan_aobj* aobj, ssize_t buffer, void* audbuf,
 	size_t abufs, unsigned int channels, unsigned int samplerate, void* tag)
 {
@@ -712,6 +858,13 @@ void arcan_audio_buffer(arcan_aobj* aobj, ssize_t buffer, void* audbuf,
 		current_acontext->globalhook(aobj->id, audbuf, abufs, channels,
 			samplerate, current_acontext->global_hooktag);
 
+/* with the audio thread running, OpenAL is left to it */
+	if (aobj->ring.buf){
+		if (!aobj->gproxy)
+			ring_write(aobj, audbuf, abufs, channels, samplerate);
+		return;
+	}
+
 /*
  * the audio system can bounce back in the case of many allocations
  * exceeding what can be mixed internally, through the _tick mechanism
@@ -841,10 +994,163 @@ cleanup:
 	arcan_event_enqueue(arcan_event_defaultctx(), &newevent);
 }
 
+/*
+ * main thread half of a threaded stream: pull from the feed into the ring.
+ * Feeding stops at ARCAN_ASTREAM_HIGHWATER so that the client gets blocked
+ * like it would with a full OpenAL queue, and the last pull before that is
+ * done with !cont so the feed gets to release the client.
+ */
+static void astream_ingest(arcan_aobj* current)
+{
+	if (!current->feed)
+		return;
+
+	size_t fill = ring_fill(current);
+	if (fill >= ARCAN_ASTREAM_HIGHWATER){
+		if (!current->ring.blocked)
+			current->ring.overruns++;
+		current->ring.blocked = true;
+		return;
+	}
+	current->ring.blocked = false;
+
+	for(;;){
+		bool cont = fill + current->ring.peak < ARCAN_ASTREAM_HIGHWATER;
+		arcan_errc rv = current->feed(current,
+			current->alid, 0, cont, current->tag);
+
+		if (rv == ARCAN_ERRC_NOTREADY)
+			return;
+
+		if (rv != ARCAN_OK){
+			arcan_event_enqueue(arcan_event_defaultctx(), &(arcan_event){
+				.category = EVENT_AUDIO,
+				.aud.kind = EVENT_AUDIO_PLAYBACK_FINISHED,
+				.aud.source = current->id
+			});
+			return;
+		}
+
+		if (!cont)
+			return;
+
+		fill = ring_fill(current);
+	}
+}
+
+/*
+ * audio thread half of a threaded stream: recycle processed buffers, queue
+ * up to ARCAN_ASTREAM_QUEUED new ones from the ring and (re)start playback,
+ * a source that stopped on its own while it was supposed to be playing has
+ * run dry and is counted as an underrun.
+ */
+static void astream_drain(arcan_aobj* current)
+{
+	const size_t mask = ARCAN_ASTREAM_RING - 1;
+	size_t wpos = atomic_load_explicit(&current->ring.wpos, memory_order_acquire);
+	size_t rpos = atomic_load_explicit(&current->ring.rpos, memory_order_relaxed);
+
+	if (current->alid == AL_NONE){
+		if (wpos == rpos)
+			return;
+
+		alGenSources(1, &current->alid);
+		alGenBuffers(current->n_streambuf, current->streambuf);
+		alSourcef(current->alid, AL_GAIN, current->gain);
+		_wrap_alError(current, "audio_thread(genBuffers)");
+	}
+
+	ALint processed = 0;
+	alGetSourcei(current->alid, AL_BUFFERS_PROCESSED, &processed);
+	while (processed-- > 0){
+		unsigned buffer = 0;
+		alSourceUnqueueBuffers(current->alid, 1, &buffer);
+		ssize_t bufferind = find_bufferind(current, buffer);
+		if (-1 != bufferind){
+			current->streambufmask[bufferind] = false;
+			current->used--;
+		}
+	}
+
+	unsigned channels = atomic_load_explicit(
+		&current->ring.channels, memory_order_relaxed);
+	unsigned samplerate = atomic_load_explicit(
+		&current->ring.samplerate, memory_order_relaxed);
+	size_t fsz = (channels == 2 ? 2 : 1) * sizeof(int16_t);
+	uint8_t chunk[ARCAN_ASTREAM_CHUNK];
+
+	while (current->used < ARCAN_ASTREAM_QUEUED && wpos - rpos >= fsz){
+		ssize_t ind = find_freebufferind(current, false);
+		if (-1 == ind)
+			break;
+
+		size_t nb = wpos - rpos;
+		if (nb > ARCAN_ASTREAM_CHUNK)
+			nb = ARCAN_ASTREAM_CHUNK;
+		nb -= nb % fsz;
+
+/* only copy when the chunk wraps around the end of the ring */
+		size_t ofs = rpos & mask;
+		const uint8_t* src = &current->ring.buf[ofs];
+		if (ARCAN_ASTREAM_RING - ofs < nb){
+			size_t first = ARCAN_ASTREAM_RING - ofs;
+			memcpy(chunk, src, first);
+			memcpy(&chunk[first], current->ring.buf, nb - first);
+			src = chunk;
+		}
+
+		alBufferData(current->streambuf[ind], channels == 2 ?
+			AL_FORMAT_STEREO16 : AL_FORMAT_MONO16, src, nb, samplerate);
+		alSourceQueueBuffers(current->alid, 1, &current->streambuf[ind]);
+		_wrap_alError(current, "audio_thread(queue)");
+		current->streambufmask[ind] = true;
+		current->used++;
+
+		rpos += nb;
+		atomic_store_explicit(&current->ring.rpos, rpos, memory_order_release);
+	}
+
+	ALenum state = 0;
+	alGetSourcei(current->alid, AL_SOURCE_STATE, &state);
+	if (state != AL_PLAYING){
+		if (current->ring.playing)
+			atomic_fetch_add(&current->ring.underruns, 1);
+
+		current->ring.playing = current->used > 0;
+		if (current->used){
+			alSourcePlay(current->alid);
+			_wrap_alError(current, "audio_thread(play)");
+		}
+	}
+}
+
+static void* audio_thread(void* tag)
+{
+	while (atomic_load(&current_acontext->thread_alive)){
+		pthread_mutex_lock(&current_acontext->lock);
+
+		if (current_acontext->al_active){
+			for (arcan_aobj* cur = current_acontext->first; cur; cur = cur->next)
+				if (cur->ring.buf && cur->kind != AOBJ_INVALID)
+					astream_drain(cur);
+		}
+
+		pthread_mutex_unlock(&current_acontext->lock);
+		arcan_timesleep(ARCAN_AUDIO_THREAD_PERIOD);
+	}
+
+	return NULL;
+}
+
 void arcan_aid_refresh(arcan_aobj_id aid)
 {
 	struct arcan_aobj* obj = arcan_audio_getobj(aid);
-	if (obj)
+	if (!obj)
+		return;
+
+	if (obj->ring.buf)
+		astream_ingest(obj);
+	else
 		astream_refill(obj);
 }
 
@@ -986,6 +1292,28 @@ size_t arcan_audio_refresh()
 	size_t rv = 0;
 
 	while(current){
+/* threaded streams: only move data and forward underruns, the audio thread
+ * takes care of the OpenAL side */
+		if (current->ring.buf){
+			astream_ingest(current);
+
+			unsigned underruns = atomic_load(&current->ring.underruns);
+			if (underruns != current->ring.reported){
+				current->ring.reported = underruns;
+				arcan_event_enqueue(arcan_event_defaultctx(), &(arcan_event){
+					.category = EVENT_AUDIO,
+					.aud.kind = EVENT_AUDIO_BUFFER_UNDERRUN,
+					.aud.source = current->id
+				});
+			}
+
+			if (ring_fill(current))
+				rv++;
+
+			current = current->next;
+			continue;
+		}
+
 		if (
 			current->kind == AOBJ_STREAM      ||
 			current->kind == AOBJ_FRAMESTREAM ||
@@ -1017,7 +1345,7 @@ static inline bool step_transform(arcan_aobj* obj)
 		obj->gain = obj->transform->d_gain;
 		struct arcan_achain* ct = obj->transform;
 		obj->transform = obj->transform->next;
-		free(ct);
+		arcan_mem_free(ct);
 	}
 
 	return true;
@@ -1038,25 +1366,55 @@ void arcan_audio_tick(uint8_t ntt)
 
 	arcan_audio_refresh();
 
-/* update time-dependent transformations */
-	while (ntt-- > 0) {
-		arcan_aobj* current = current_acontext->first;
+/* update time-dependent transformations, only the final gain of each object
+ * is forwarded, proxies are invoked once the lock has been released */
+	size_t n_proxy = 0;
+	pthread_mutex_lock(&current_acontext->lock);
+	for (arcan_aobj* current = current_acontext->first;
+		current; current = current->next){
+		bool changed = false;
+		for (size_t i = 0; i < ntt; i++)
+			if (step_transform(current))
+				changed = true;
+
+		if (!changed)
+			continue;
 
-		while (current){
-			if (step_transform(current)){
-				if (current->gproxy)
-					current->gproxy(current->gain, current->tag);
-				else if (current->alid){
-					alSourcef(current->alid, AL_GAIN, current->gain);
-					_wrap_alError(current, "audio_tick(source/gain)");
-				}
+		if (current->gproxy){
+			if (n_proxy == current_acontext->proxy_gains_cap){
+				size_t cap = n_proxy ? n_proxy * 2 : 16;
+				struct proxy_gain* gains = arcan_alloc_mem(
+					sizeof(struct proxy_gain) * cap, ARCAN_MEM_ATAG,
+					ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_NATURAL
+				);
+				if (!gains)
+					continue;
+
+				if (n_proxy)
+					memcpy(gains,
+						current_acontext->proxy_gains, sizeof(struct proxy_gain) * n_proxy);
+				arcan_mem_free(current_acontext->proxy_gains);
+				current_acontext->proxy_gains = gains;
+				current_acontext->proxy_gains_cap = cap;
 			}
 
-			current = current->next;
+			current_acontext->proxy_gains[n_proxy++] = (struct proxy_gain){
+				.cb = current->gproxy,
+				.tag = current->tag,
+				.gain = current->gain
+			};
+		}
+		else if (current->alid){
+			alSourcef(current->alid, AL_GAIN, current->gain);
+			_wrap_alError(current, "audio_tick(source/gain)");
 		}
-
-		current_acontext->atick_counter++;
 	}
+	current_acontext->atick_counter += ntt;
+	pthread_mutex_unlock(&current_acontext->lock);
+
+	for (size_t i = 0; i < n_proxy; i++)
+		current_acontext->proxy_gains[i].cb(
+			current_acontext->proxy_gains[i].gain, current_acontext->proxy_gains[i].tag);
 /* scan all streaming buffers and free up those no-longer needed */
 	for (size_t i = 0; i < ARCAN_AUDIO_SLIMIT; i++)
 	if ( current_acontext->sample_sources[i] > 0) {
@@ -1077,6 +1435,7 @@ void arcan_audio_purge(arcan_aobj_id* ids, size_t nids)
 	arcan_aobj* current = _current_acontext.first;
 	arcan_aobj** previous = &_current_acontext.first;
 
+	pthread_mutex_lock(&current_acontext->lock);
 	while(current){
 		bool match = false;
 
@@ -1103,6 +1462,7 @@ void arcan_audio_purge(arcan_aobj_id* ids, size_t nids)
 					alDeleteBuffers(current->n_streambuf, current->streambuf);
 			}
 
+			arcan_mem_free(current->ring.buf);
 			arcan_mem_free(current);
 		}
 		else {
@@ -1111,6 +1471,7 @@ void arcan_audio_purge(arcan_aobj_id* ids, size_t nids)
 
 		current = next;
 	}
+	pthread_mutex_unlock(&current_acontext->lock);
 }
 
 static bool _wrap_alError(arcan_aobj* obj, char* prefix)
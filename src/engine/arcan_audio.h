@@ -113,6 +113,21 @@ arcan_errc arcan_audio_alterfeed(arcan_aobj_id id, arcan_afunc_cb feed);
 arcan_aobj_id arcan_audio_feed(arcan_afunc_cb feed,
 	void* tag, arcan_errc* errc);
 
+/*
+ * Retrieve the mixing period of the output device as the number of samples
+ * per channel at [*samplerate] (if !NULL), 0 if it couldn't be determined.
+ */
+size_t arcan_audio_output_period(unsigned* samplerate);
+
+/*
+ * Retrieve the number of times a streaming source has run dry (underruns)
+ * and the number of times its producer has been held back because enough
+ * was already queued (overruns). Only streams serviced by the audio thread
+ * keep track of this, others return ARCAN_ERRC_UNACCEPTED_STATE.
+ */
+arcan_errc arcan_audio_bufferstats(arcan_aobj_id,
+	unsigned* underruns, unsigned* overruns);
+
 /*
  * Get the underlying type associated with an audio object.
  */
@@ -13,6 +13,36 @@
 
 #define ARCAN_ASTREAMBUF_LIMIT ARCAN_SHMIF_ABUFC_LIM
 
+/*
+ * Streaming sources are handed from the main thread (that owns the shmif
+ * connections) to the audio thread (that owns the OpenAL queues) through a
+ * single-producer, single-consumer ring per source. The producer stops
+ * draining the client once HIGHWATER bytes are pending (so that back-pressure
+ * still works) and the RING is large enough to always fit one more maximum
+ * sized shmif buffer on top of that. The audio thread keeps at most QUEUED
+ * buffers of at most CHUNK bytes each queued with OpenAL.
+ */
+#ifndef ARCAN_ASTREAM_RING
+#define ARCAN_ASTREAM_RING 262144
+#endif
+
+#ifndef ARCAN_ASTREAM_HIGHWATER
+#define ARCAN_ASTREAM_HIGHWATER 16384
+#endif
+
+#ifndef ARCAN_ASTREAM_CHUNK
+#define ARCAN_ASTREAM_CHUNK 2048
+#endif
+
+#ifndef ARCAN_ASTREAM_QUEUED
+#define ARCAN_ASTREAM_QUEUED 4
+#endif
+
+/* milliseconds between audio thread passes */
+#ifndef ARCAN_AUDIO_THREAD_PERIOD
+#define ARCAN_AUDIO_THREAD_PERIOD 4
+#endif
+
 struct arcan_aobj_cell;
 
 struct arcan_achain {
@@ -49,6 +79,23 @@ typedef struct arcan_aobj {
 	bool streambufmask[ARCAN_ASTREAMBUF_LIMIT];
 	short used;
 
+/* AOBJ_STREAM with the audio thread running, see ARCAN_ASTREAM_RING */
+	struct {
+		uint8_t* buf;
+		_Atomic size_t rpos, wpos;
+		_Atomic unsigned channels, samplerate;
+		size_t peak;
+
+/* written by the audio thread, forwarded as events by the main thread */
+		_Atomic unsigned underruns;
+		unsigned reported;
+		bool playing;
+
+/* times the producer has been blocked on HIGHWATER, main thread only */
+		unsigned overruns;
+		bool blocked;
+	} ring;
+
 /* global hooks */
 	arcan_afunc_cb feed;
 	arcan_monafunc_cb monitor;
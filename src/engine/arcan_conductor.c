@@ -9,6 +9,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <limits.h>
 
 #include "arcan_math.h"
 #include "arcan_general.h"
@@ -25,6 +26,28 @@
 
 static uint64_t tick_count;
 
+/* measured display synch timing, used for deadline feedback to clients */
+static struct {
+	unsigned long long last;
+	unsigned period;
+} synchinf;
+
+static struct {
+/* registered (active) frameservers, and the one to favor */
+	struct arcan_frameserver** fsrv;
+	size_t fsrv_count, fsrv_limit;
+	struct arcan_frameserver* priority;
+
+	unsigned upload_budget;
+	bool gc_slack;
+	struct conductor_stats stats;
+} conductor;
+
+/* safety margin for composition and timing jitter when estimating slack */
+#ifndef CONDUCTOR_SLACK_MARGIN
+#define CONDUCTOR_SLACK_MARGIN 2000
+#endif
+
 /*
  * the main problems to address:
  *
@@ -69,9 +92,12 @@ void arcan_conductor_lock_gpu(
 	size_t gpu_id, int fence, arcan_gpu_lockhandler lockh)
 {
 /*
- * this interface needs some more thinking, but the callback chain will
- * be that video_synch -> lock_gpu[gpu_id, fence_fd] and a process callback
- * when there's data on the fence_fd (which might potentially call unlock)
+ * the callback chain will be that video_synch -> lock_gpu[gpu_id, fence_fd]
+ * and a process callback when there's data on the fence_fd (which might
+ * potentially call unlock). None of the video platforms export a fence for
+ * their synch yet, so there is nothing to track here and the scheduler
+ * throttles uploads on the time budget alone - fence awareness comes when a
+ * platform starts calling this.
  */
 }
 
@@ -82,6 +108,10 @@ void arcan_conductor_release_gpu(size_t gpu_id)
 void arcan_conductor_register_display(size_t gpu_id,
 		size_t disp_id, enum synch_method method, float rate, arcan_vobj_id obj)
 {
+/* until there are measurements, the advertised rate is the best guess */
+	if (!synchinf.period && rate > 0.0)
+		synchinf.period = 1000.0 / rate;
+
 /* need to know which display and which vobj is needed to be updated in order
  * to fulfill the requirement of the display synch so that we can schedule it
  * accordingly, later the full DAG- would also be calculated here to resolve
@@ -92,15 +122,131 @@ void arcan_conductor_register_display(size_t gpu_id,
 void arcan_conductor_register_frameserver(struct arcan_frameserver* fsrv)
 {
 /*
- * spawn a monitor thread that checks the resized- tag,
- * later we should consolidate all the aready/vready/resized into one
- * and use the same synch- mechanism on both sides and kill the semaphores
+ * the resized- tag and buffer transfers are still checked as part of feed
+ * polling, later we should consolidate all the aready/vready/resized into
+ * one and have this set drive the polling directly
  */
+	for (size_t i = 0; i < conductor.fsrv_count; i++)
+		if (conductor.fsrv[i] == fsrv)
+			return;
+
+	if (conductor.fsrv_count == conductor.fsrv_limit){
+		size_t nl = conductor.fsrv_limit + 16;
+		struct arcan_frameserver** ns =
+			realloc(conductor.fsrv, nl * sizeof(struct arcan_frameserver*));
+		if (!ns)
+			return;
+		conductor.fsrv = ns;
+		conductor.fsrv_limit = nl;
+	}
+
+	conductor.fsrv[conductor.fsrv_count++] = fsrv;
 }
 
 void arcan_conductor_deregister_frameserver(struct arcan_frameserver* fsrv)
 {
-/* just need to poke the bit used in the monitor thread */
+	if (conductor.priority == fsrv)
+		arcan_frameserver_priority(NULL);
+
+	for (size_t i = 0; i < conductor.fsrv_count; i++)
+		if (conductor.fsrv[i] == fsrv){
+			conductor.fsrv[i] = conductor.fsrv[--conductor.fsrv_count];
+			return;
+		}
+}
+
+void arcan_frameserver_priority(struct arcan_frameserver* fsrv)
+{
+	if (conductor.priority)
+		conductor.priority->flags.priority = false;
+
+	conductor.priority = fsrv;
+
+	if (fsrv)
+		fsrv->flags.priority = true;
+}
+
+void arcan_conductor_gc_slack(bool enable)
+{
+	conductor.gc_slack = enable;
+}
+
+/*
+ * Time (microseconds) until the next synch minus what the stages before it
+ * usually cost. The synch stage itself is excluded as it also covers waiting,
+ * the composition part of it has to fit in the margin.
+ */
+static unsigned synch_slack()
+{
+	if (!synchinf.last || !synchinf.period)
+		return 0;
+
+	struct conductor_stats* s = &conductor.stats;
+	unsigned long long now = arcan_timemicros();
+	unsigned long long next = (synchinf.last + synchinf.period) * 1000ull;
+	unsigned long long work = CONDUCTOR_SLACK_MARGIN +
+		s->stage[CONDUCTOR_STAGE_FEED].avg +
+		s->stage[CONDUCTOR_STAGE_EVENT].avg +
+		s->stage[CONDUCTOR_STAGE_FRAME].avg;
+
+	if (next <= now + work)
+		return 0;
+
+	unsigned long long slack = next - now - work;
+	return slack > UINT_MAX ? UINT_MAX : slack;
+}
+
+void arcan_conductor_upload_budget(unsigned budget)
+{
+	conductor.upload_budget = budget;
+}
+
+void arcan_conductor_stats(struct conductor_stats* out)
+{
+	*out = conductor.stats;
+	out->frameservers = conductor.fsrv_count;
+	out->upload_budget = conductor.upload_budget;
+	out->synch_period = synchinf.period;
+
+	for (size_t i = 0; i < CONDUCTOR_STAGE_LIMIT; i++)
+		conductor.stats.stage[i].max = 0;
+}
+
+static void stage_time(enum conductor_stage stage, unsigned long long dt)
+{
+	unsigned us = dt > UINT_MAX ? UINT_MAX : dt;
+	struct conductor_stats* s = &conductor.stats;
+
+	s->stage[stage].last = us;
+	s->stage[stage].avg = s->frames ?
+		(s->stage[stage].avg * 15 + us + 8) / 16 : us;
+	if (us > s->stage[stage].max)
+		s->stage[stage].max = us;
+}
+
+bool arcan_conductor_synchinfo(unsigned long long* last, unsigned* period)
+{
+	if (!synchinf.last || !synchinf.period)
+		return false;
+
+	*last = synchinf.last;
+	*period = synchinf.period;
+	return true;
+}
+
+/* smooth the period somewhat so a single late frame doesn't throw off client
+ * deadlines, and ignore long stalls (suspend, vt switch, ...) entirely */
+static void update_synchinf()
+{
+	unsigned long long now = arcan_timemillis();
+
+	if (synchinf.last && now > synchinf.last && now - synchinf.last < 1000){
+		unsigned delta = now - synchinf.last;
+		synchinf.period = synchinf.period ?
+			(synchinf.period * 7 + delta + 4) / 8 : delta;
+	}
+
+	synchinf.last = now;
 }
 
 extern struct arcan_luactx* main_lua_context;
@@ -119,20 +265,67 @@ int arcan_conductor_run(arcan_tick_cb tick)
 	outcb = tick;
 	int exit_code = EXIT_FAILURE;
 
+	const char* budget = getenv("ARCAN_CONDUCTOR_UPLOAD_BUDGET");
+	if (budget)
+		conductor.upload_budget = strtoul(budget, NULL, 10);
+
+	if (getenv("ARCAN_CONDUCTOR_GCSLACK"))
+		conductor.gc_slack = true;
+
 	for(;;){
-		arcan_video_pollfeed();
+		unsigned long long ts[6];
+		ts[0] = arcan_timemicros();
+
+		size_t nupl;
+		conductor.stats.deferred = arcan_video_pollfeed(
+			conductor.priority ? conductor.priority->vid : ARCAN_EID,
+			conductor.upload_budget, &nupl
+		);
+		conductor.stats.uploads = nupl;
+		conductor.stats.deferred_total += conductor.stats.deferred;
 		arcan_audio_refresh();
+		ts[1] = arcan_timemicros();
+
 		float frag = arcan_event_process(evctx, conductor_cycle);
+		unsigned long long bts = arcan_bench_timestamp();
 		if (!arcan_event_feed(evctx, process_event, &exit_code))
 			break;
+		arcan_bench_register_stage(ARCAN_BENCH_EVENT, bts);
+		ts[2] = arcan_timemicros();
 
 /* these should be replaced with a platform_video_displaysynch(dispid) that
  * assumes the underlying vobj-id has already been updated so the draw-call
  * isn't set from the platform layer, and the preframe/postframe pulse thus
  * needs to be altered to provide a display-id */
 		arcan_lua_callvoidfun(main_lua_context, "preframe_pulse", false, NULL);
+		ts[3] = arcan_timemicros();
+
+		bts = arcan_bench_timestamp();
 		platform_video_synch(tick_count, frag, NULL, NULL);
+		arcan_bench_register_stage(ARCAN_BENCH_SYNCH, bts);
+		update_synchinf();
+		ts[4] = arcan_timemicros();
+
 		arcan_lua_callvoidfun(main_lua_context, "postframe_pulse", false, NULL);
+		ts[5] = arcan_timemicros();
+
+/* the frame has been handed off, anything that can wait until we are
+ * blocked on the next synch anyhow goes here */
+		bts = arcan_bench_timestamp();
+		arcan_video_pollreadback();
+		arcan_bench_register_stage(ARCAN_BENCH_READBACK, bts);
+
+		conductor.stats.slack = synch_slack();
+		conductor.stats.gc = conductor.gc_slack ?
+			arcan_lua_gcslack(main_lua_context, conductor.stats.slack) : 0;
+
+		stage_time(CONDUCTOR_STAGE_FEED, ts[1] - ts[0]);
+		stage_time(CONDUCTOR_STAGE_EVENT, ts[2] - ts[1]);
+		stage_time(CONDUCTOR_STAGE_FRAME, (ts[3] - ts[2]) + (ts[5] - ts[4]));
+		stage_time(CONDUCTOR_STAGE_SYNCH, ts[4] - ts[3]);
+		stage_time(CONDUCTOR_STAGE_IDLE, arcan_timemicros() - ts[5]);
+		conductor.stats.frames++;
+
 		arcan_bench_register_frame();
 	}
 
@@ -146,7 +339,9 @@ void conductor_cycle(int nticks)
 /* priority is always in maintaining logical clock and event processing */
 	unsigned njobs;
 
+	unsigned long long bts = arcan_bench_timestamp();
 	arcan_video_tick(nticks, &njobs);
+	arcan_bench_register_stage(ARCAN_BENCH_VIDEO_TICK, bts);
 	arcan_audio_tick(nticks);
 
 /* the lua VM last after a/v pipe is to allow 1- tick schedulers, otherwise
@@ -156,7 +351,9 @@ void conductor_cycle(int nticks)
  *
  * and tag transforms handlers being one tick off
  */
+	bts = arcan_bench_timestamp();
 	arcan_lua_tick(main_lua_context, nticks, tick_count);
+	arcan_bench_register_stage(ARCAN_BENCH_LUA_TICK, bts);
 	outcb(nticks);
 
 	while(nticks--)
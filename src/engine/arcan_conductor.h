@@ -13,6 +13,57 @@ enum synch_method {
 	SYNCH_DYNAMIC = 2
 };
 
+/* the timed stages of one pass through the conductor main loop */
+enum conductor_stage {
+	CONDUCTOR_STAGE_FEED = 0, /* feed polling, buffer uploads, audio */
+	CONDUCTOR_STAGE_EVENT,    /* event processing, logic ticks and scripts */
+	CONDUCTOR_STAGE_FRAME,    /* pre- and postframe_pulse */
+	CONDUCTOR_STAGE_SYNCH,    /* composition and waiting for display synch */
+	CONDUCTOR_STAGE_IDLE,     /* readbacks and other work deferred to slack */
+	CONDUCTOR_STAGE_LIMIT
+};
+
+struct conductor_stats {
+	unsigned long long frames;
+
+/* microseconds, last pass, moving average and max since last retrieval */
+	struct {
+		unsigned last, avg, max;
+	} stage[CONDUCTOR_STAGE_LIMIT];
+
+/* feed uploads performed and deferred due to budget in the last pass,
+ * deferred_total accumulates over all passes */
+	size_t uploads, deferred;
+	unsigned long long deferred_total;
+
+	size_t frameservers;
+	unsigned upload_budget;
+	unsigned synch_period;
+
+/* microseconds estimated to be left until the next frame has to be started
+ * when the idle stage was entered, and how much of it went to script gc */
+	unsigned slack, gc;
+};
+
+/* Retrieve the current scheduler statistics, resets the max- counters */
+void arcan_conductor_stats(struct conductor_stats* out);
+
+/* Toggle budgeted scripting VM garbage collection, where incremental steps
+ * are only run in the idle stage for as long as there is slack until the
+ * next frame. Can also be enabled by setting ARCAN_CONDUCTOR_GCSLACK. */
+void arcan_conductor_gc_slack(bool enable);
+
+/* Set the time budget (microseconds, 0 for unlimited) for buffer uploads in
+ * each pass. When exceeded, uploads from other sources than the priority
+ * target are deferred to the next pass (for at most a few passes). Can also
+ * be set with the ARCAN_CONDUCTOR_UPLOAD_BUDGET environment variable. */
+void arcan_conductor_upload_budget(unsigned budget);
+
+/* Retrieve the time (arcan_timemillis) when the last display synch completed
+ * along with the estimated period (ms) between synchs. Returns false if there
+ * isn't enough data for an estimate yet. */
+bool arcan_conductor_synchinfo(unsigned long long* last, unsigned* period);
+
 /* Main processing loop, takes care of invoking the scripting VM, synching
  * display updates and so on. */
 int arcan_conductor_run(arcan_tick_cb cb);
@@ -25,7 +76,8 @@ void arcan_conductor_register_display(size_t gpu_id,
 
 /* [ called from platform ]
  * mark GPU as locked and add [fence] to pollset, when there's data on fence,
- * invoke the lockhandler callback which [may] release the gpu
+ * invoke the lockhandler callback which [may] release the gpu.
+ * Not implemented, no platform provides synch fences yet.
  */
 typedef void (*arcan_gpu_lockhandler)(size_t, int);
 void arcan_conductor_lock_gpu(size_t gpu_id, int fence, arcan_gpu_lockhandler);
@@ -39,7 +91,8 @@ void arcan_conductor_release_gpu(size_t gpu_id);
 /* Update the priority target to match the specified frameserver. This
  * means that heuristics driving synchronization will be biased towards
  * letting the specific fsrv align synchronization - if the synchronization
- * strategy so permits */
+ * strategy so permits. Buffer uploads from the priority target are always
+ * processed first and never deferred. NULL resets. */
 void arcan_frameserver_priority(struct arcan_frameserver* fsrv);
 
 /* add a frameserver to the set of external data sources that should be
@@ -22,6 +22,8 @@
 #include <math.h>
 #include <assert.h>
 #include <signal.h>
+#include <limits.h>
+#include <inttypes.h>
 
 /*
  * fixed limit of allowed events in queue before we need to do something more
@@ -623,11 +625,28 @@ void arcan_bench_register_cost(unsigned cost)
 		(sizeof(benchdata.framecost) / sizeof(benchdata.framecost[0]));
 }
 
+static volatile sig_atomic_t bench_dump_pending;
 void arcan_bench_register_frame()
 {
 	static long long int lastframe = -1;
-	if (benchdata.bench_enabled == false)
+	static unsigned long long lastframe_us;
+
+/* signal handler only flags, the actual dump is written from here */
+	if (bench_dump_pending){
+		bench_dump_pending = 0;
+		const char* path = getenv("ARCAN_BENCH_DUMP");
+		if (path && !arcan_bench_dump(path))
+			arcan_warning("benchmark: couldn't write dump to %s\n", path);
+	}
+
+	if (benchdata.bench_enabled == false){
+		lastframe_us = 0;
 		return;
+	}
+
+	if (lastframe_us)
+		arcan_bench_register_stage(ARCAN_BENCH_FRAME, lastframe_us);
+	lastframe_us = arcan_timemicros();
 
 	long long int ftime = arcan_timemillis();
 	if (lastframe > 0 && ftime > lastframe){
@@ -641,6 +660,159 @@ void arcan_bench_register_frame()
 	lastframe = ftime;
 }
 
+void arcan_bench_register_damage(bool full,
+	size_t n_rects, size_t pixels, size_t total_pixels)
+{
+	if (benchdata.bench_enabled == false)
+		return;
+
+	if (full)
+		benchdata.damage.full++;
+	else if (n_rects == 0)
+		benchdata.damage.skipped++;
+	else
+		benchdata.damage.partial++;
+
+	benchdata.damage.rects += n_rects;
+	benchdata.damage.pixels += pixels;
+	benchdata.damage.total_pixels += total_pixels;
+}
+
+void arcan_bench_register_gc(unsigned usecs, bool full)
+{
+	if (benchdata.bench_enabled == false)
+		return;
+
+	benchdata.gc.time += usecs;
+	benchdata.gc.frames++;
+	if (full)
+		benchdata.gc.full++;
+	if (usecs > benchdata.gc.max)
+		benchdata.gc.max = usecs;
+}
+
+void arcan_bench_register_draw(size_t n_objects, bool batched)
+{
+	if (benchdata.bench_enabled == false)
+		return;
+
+	benchdata.draw.calls++;
+	benchdata.draw.objects += n_objects;
+	if (batched)
+		benchdata.draw.batched += n_objects;
+}
+
+static inline size_t hist_index(unsigned v)
+{
+	if (v < (1 << ARCAN_BENCH_HIST_SUB))
+		return v;
+
+	unsigned msb = 31 - __builtin_clz(v);
+	unsigned shift = msb - ARCAN_BENCH_HIST_SUB;
+	return ((shift + 1) << ARCAN_BENCH_HIST_SUB) +
+		((v >> shift) - (1 << ARCAN_BENCH_HIST_SUB));
+}
+
+/* highest value that maps to bucket [i] */
+static inline unsigned hist_value(size_t i)
+{
+	size_t mag = i >> ARCAN_BENCH_HIST_SUB;
+	size_t sub = i & ((1 << ARCAN_BENCH_HIST_SUB) - 1);
+	if (!mag)
+		return sub;
+
+	uint64_t base = (uint64_t)((1 << ARCAN_BENCH_HIST_SUB) + sub) << (mag - 1);
+	return base + (((uint64_t)1 << (mag - 1)) - 1);
+}
+
+unsigned long long arcan_bench_timestamp()
+{
+	return benchdata.bench_enabled ? arcan_timemicros() : 0;
+}
+
+void arcan_bench_register_stage(
+	enum arcan_bench_stage stage, unsigned long long ts)
+{
+	if (benchdata.bench_enabled == false || !ts ||
+		stage >= ARCAN_BENCH_STAGE_LIMIT)
+		return;
+
+	unsigned long long now = arcan_timemicros();
+	unsigned v = now > ts ? (now - ts > UINT_MAX ? UINT_MAX : now - ts) : 0;
+	struct arcan_bench_hist* hist = &benchdata.stage[stage];
+
+	if (!hist->count || v < hist->min)
+		hist->min = v;
+	if (v > hist->max)
+		hist->max = v;
+
+	hist->count++;
+	hist->sum += v;
+	hist->bucket[hist_index(v)]++;
+}
+
+unsigned arcan_bench_percentile(enum arcan_bench_stage stage, double q)
+{
+	if (stage >= ARCAN_BENCH_STAGE_LIMIT || !benchdata.stage[stage].count)
+		return 0;
+
+	struct arcan_bench_hist* hist = &benchdata.stage[stage];
+	q = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+	uint64_t target = ceil(q * (double) hist->count);
+	if (!target)
+		target = 1;
+
+	uint64_t acc = 0;
+	for (size_t i = 0; i < COUNT_OF(hist->bucket); i++){
+		acc += hist->bucket[i];
+		if (acc >= target){
+			unsigned v = hist_value(i);
+			return v > hist->max ? hist->max : v;
+		}
+	}
+
+	return hist->max;
+}
+
+const char* arcan_bench_stagename(enum arcan_bench_stage stage)
+{
+	static const char* names[] = {
+		"event", "lua_tick", "video_tick", "rendertarget",
+		"synch", "readback", "frame"
+	};
+	_Static_assert(COUNT_OF(names) == ARCAN_BENCH_STAGE_LIMIT,
+		"bench: stage names out of synch");
+
+	return stage < ARCAN_BENCH_STAGE_LIMIT ? names[stage] : "unknown";
+}
+
+bool arcan_bench_dump(const char* path)
+{
+	FILE* fout = fopen(path, "w");
+	if (!fout)
+		return false;
+
+	fprintf(fout, "# stage count min mean p50 p90 p99 p999 max (usecs)\n");
+	for (size_t i = 0; i < ARCAN_BENCH_STAGE_LIMIT; i++){
+		struct arcan_bench_hist* hist = &benchdata.stage[i];
+		fprintf(fout, "%s %"PRIu64" %u %"PRIu64" %u %u %u %u %u\n",
+			arcan_bench_stagename(i), hist->count, hist->min,
+			hist->count ? hist->sum / hist->count : 0,
+			arcan_bench_percentile(i, 0.5), arcan_bench_percentile(i, 0.9),
+			arcan_bench_percentile(i, 0.99), arcan_bench_percentile(i, 0.999),
+			hist->max
+		);
+	}
+
+	fclose(fout);
+	return true;
+}
+
+static void sig_benchdump(int v)
+{
+	bench_dump_pending = 1;
+}
+
 void arcan_event_deinit(arcan_evctx* ctx)
 {
 	platform_event_deinit(ctx);
@@ -760,6 +932,10 @@ void arcan_event_init(arcan_evctx* ctx)
 	sigaction(SIGRTMIN+1, &(struct sigaction) {.sa_handler = sig_rtfuzz_b}, NULL);
 #endif
 
+	if (getenv("ARCAN_BENCH_DUMP"))
+		sigaction(SIGRTMIN+2,
+			&(struct sigaction){.sa_handler = sig_benchdump}, NULL);
+
 	const char* panicbutton = getenv("ARCAN_EVENT_SHUTDOWN");
 	char* cp;
 
@@ -36,6 +36,8 @@
 
 #include "arcan_event.h"
 #include "arcan_img.h"
+#include "arcan_amix.h"
+#include "speex_resampler.h"
 
 /*
  * implementation defined for out-of-order execution
@@ -52,6 +54,7 @@ static inline void emit_deliveredframe(arcan_frameserver* src,
 	unsigned long long pts, unsigned long long framecount);
 static inline void emit_droppedframe(arcan_frameserver* src,
 	unsigned long long pts, unsigned long long framecount);
+static void drop_amixer(arcan_frameserver* dst);
 
 static void autoclock_frame(arcan_frameserver* tgt)
 {
@@ -101,6 +104,7 @@ arcan_errc arcan_frameserver_free(arcan_frameserver* src)
 		base++;
 	}
 	src->alocks = NULL;
+	drop_amixer(src);
 
 	char msg[32];
 	if (!platform_fsrv_lastwords(src, msg, COUNT_OF(msg)))
@@ -179,8 +183,17 @@ static bool arcan_frameserver_control_chld(arcan_frameserver* src){
 	return true;
 }
 
+static bool valid_region(
+	struct agp_vstore* store, struct arcan_shmif_region* reg)
+{
+	return (reg->x2 > reg->x1 && reg->x2 - reg->x1 <= store->w) &&
+		(reg->y2 > reg->y1 && reg->y2 - reg->y1 <= store->h) &&
+		reg->x2 <= store->w && reg->y2 <= store->h;
+}
+
 static bool push_buffer(arcan_frameserver* src,
-	struct agp_vstore* store, struct arcan_shmif_region* dirty)
+	struct agp_vstore* store, struct arcan_shmif_region* dirty,
+	struct arcan_shmif_region* chain, size_t n_chain)
 {
 	struct stream_meta stream = {.buf = NULL};
 	bool explicit = src->flags.explicit;
@@ -234,6 +247,10 @@ static bool push_buffer(arcan_frameserver* src,
 
 		src->desc.rz_flag = false;
 		explicit = true;
+
+/* the new store has no previous contents to patch */
+		dirty = NULL;
+		n_chain = 0;
 	}
 
 	if (-1 != src->vstream.handle){
@@ -271,6 +288,33 @@ static bool push_buffer(arcan_frameserver* src,
 		goto commit_mask;
 	}
 
+	enum stream_type type = explicit ? STREAM_RAW_DIRECT_SYNCHRONOUS : (
+		src->flags.local_copy ? STREAM_RAW_DIRECT_COPY : STREAM_RAW_DIRECT);
+
+/* with a chain of regions, upload them one by one, but any bad region
+ * means falling back to the bounding box */
+	for (size_t i = 0; i < n_chain; i++)
+		if (!valid_region(store, &chain[i])){
+			n_chain = 0;
+			break;
+		}
+
+	if (n_chain){
+		for (size_t i = 0; i < n_chain; i++){
+			struct stream_meta cs = {
+				.buf = buf,
+				.dirty = true,
+				.x1 = chain[i].x1, .w = chain[i].x2 - chain[i].x1,
+				.y1 = chain[i].y1, .h = chain[i].y2 - chain[i].y1
+			};
+			cs = agp_stream_prepare(store, cs, type);
+			agp_stream_commit(store, cs);
+			arcan_vint_storedamage(store,
+				chain[i].x1, chain[i].y1, chain[i].x2, chain[i].y2);
+		}
+		goto commit_mask;
+	}
+
 	stream.buf = buf;
 /* validate, fallback to fullsynch if we get bad values */
 	if (dirty){
@@ -280,11 +324,16 @@ static bool push_buffer(arcan_frameserver* src,
 			(dirty->x2 - dirty->x1 > 0 && stream.w <= store->w) &&
 			(dirty->y2 - dirty->y1 > 0 && stream.h <= store->h);
 	}
-	stream = agp_stream_prepare(store, stream, explicit ?
-		STREAM_RAW_DIRECT_SYNCHRONOUS : (
-			src->flags.local_copy ? STREAM_RAW_DIRECT_COPY : STREAM_RAW_DIRECT));
-
+	stream = agp_stream_prepare(store, stream, type);
 	agp_stream_commit(store, stream);
+
+/* let the video layer limit the redraw to the part of the store that changed */
+	if (stream.dirty)
+		arcan_vint_storedamage(store, stream.x1, stream.y1,
+			stream.x1 + stream.w, stream.y1 + stream.h);
+	else
+		arcan_vint_storedamage(store, 0, 0, 0, 0);
+
 commit_mask:
 	atomic_fetch_and(&src->shm.ptr->vpending, vmask);
 	return true;
@@ -468,6 +517,32 @@ enum arcan_ffunc_rv arcan_frameserver_emptyframe FFUNC_HEAD
 	return FRV_NOFRAME;
 }
 
+/*
+ * Update the deadline feedback fields in the shared page. The buffer picked
+ * up during the previous frame has been through synch at this point, so the
+ * time between the two is the upload+compose cost for this segment.
+ */
+static void publish_deadline(struct arcan_frameserver* tgt)
+{
+	unsigned long long last;
+	unsigned period;
+
+	if (!arcan_conductor_synchinfo(&last, &period))
+		return;
+
+	if (tgt->desc.synch_pickup && last >= tgt->desc.synch_pickup){
+		unsigned cost = last - tgt->desc.synch_pickup;
+		tgt->desc.synch_cost = tgt->desc.synch_cost ?
+			(tgt->desc.synch_cost * 3 + cost + 2) / 4 : cost;
+		tgt->desc.synch_pickup = 0;
+	}
+
+	struct arcan_shmif_page* shmpage = tgt->shm.ptr;
+	atomic_store(&shmpage->vsynch.period, period);
+	atomic_store(&shmpage->vsynch.cost, tgt->desc.synch_cost);
+	atomic_store(&shmpage->vsynch.next, last + period);
+}
+
 enum arcan_ffunc_rv arcan_frameserver_vdirect FFUNC_HEAD
 {
 	int rv = FRV_NOFRAME;
@@ -506,6 +581,8 @@ enum arcan_ffunc_rv arcan_frameserver_vdirect FFUNC_HEAD
 		if (tgt->playstate != ARCAN_PLAYING)
 			goto no_out;
 
+		publish_deadline(tgt);
+
 /* use this opportunity to make sure that we treat audio as well,
  * when theres the one there is usually the other */
 			do_aud = (atomic_load(&tgt->shm.ptr->aready) > 0 &&
@@ -529,6 +606,9 @@ enum arcan_ffunc_rv arcan_frameserver_vdirect FFUNC_HEAD
 	break;
 
 	case FFUNC_RENDER:
+/* for tighter latency management, the deadline is derived from the
+ * time from here until the display synch, see publish_deadline */
+		tgt->desc.synch_pickup = arcan_timemillis();
 		arcan_event_queuetransfer(
 			arcan_event_defaultctx(), &tgt->inqueue, tgt->queue_mask, 0.5, tgt);
 
@@ -539,6 +619,18 @@ enum arcan_ffunc_rv arcan_frameserver_vdirect FFUNC_HEAD
 		struct agp_vstore* dst_store = vobj->frameset ?
 			vobj->frameset->frames[vobj->frameset->index].frame : vobj->vstore;
 		struct arcan_shmif_region dirty = atomic_load(&shmpage->dirty);
+		int hints = shmpage->hints;
+
+/* the chain is only written to by the client while vready is not set */
+		struct arcan_shmif_region chain[ARCAN_SHMIF_DIRTYCHAIN_LIM];
+		size_t n_chain = 0;
+		if (hints & SHMIF_RHINT_SUBREGION_CHAIN){
+			n_chain = atomic_load(&shmpage->dirty_chain.count);
+			if (n_chain > ARCAN_SHMIF_DIRTYCHAIN_LIM)
+				n_chain = 0;
+			memcpy(chain, shmpage->dirty_chain.regions,
+				sizeof(struct arcan_shmif_region) * n_chain);
+		}
 
 /* while we're here, check if audio should be processed as well */
 		do_aud = (atomic_load(&tgt->shm.ptr->aready) > 0 &&
@@ -549,13 +641,11 @@ enum arcan_ffunc_rv arcan_frameserver_vdirect FFUNC_HEAD
  * be used with the vpts- below, simply defer until the deadline has
  * passed */
 		if (!push_buffer(tgt, dst_store,
-				shmpage->hints & SHMIF_RHINT_SUBREGION ? &dirty : NULL)){
+				hints & (SHMIF_RHINT_SUBREGION | SHMIF_RHINT_SUBREGION_CHAIN) ?
+				&dirty : NULL, chain, n_chain)){
 			goto no_out;
 		}
 
-/* for tighter latency management, here is where the estimated next
- * synch deadline for any output it is used on could/should be set,
- * though it feeds back into the need of the conductor- refactor */
 		dst_store->vinf.text.vpts = shmpage->vpts;
 
 /* for some connections, we want additional statistics */
@@ -565,7 +655,7 @@ enum arcan_ffunc_rv arcan_frameserver_vdirect FFUNC_HEAD
 /* interactive frameserver blocks on vsemaphore only,
  * so set monitor flags and wake up */
 		atomic_store_explicit(&shmpage->vready, 0, memory_order_release);
-		arcan_sem_post( tgt->vsync );
+		platform_fsrv_release(tgt, false);
 		if (tgt->desc.hints & SHMIF_RHINT_VSIGNAL_EV){
 			platform_fsrv_pushevent(tgt, &(struct arcan_event){
 				.category = EVENT_TARGET,
@@ -729,74 +819,193 @@ no_out:
 	return FRV_NOFRAME;
 }
 
+/*
+ * Monitored feeds that don't run at ARCAN_SHMIF_SAMPLERATE get a resampler,
+ * returns true if [frequency] needs one (and it could be set up)
+ */
+static bool sync_resampler(
+	struct SpeexResamplerState_** st, unsigned* rate, unsigned frequency)
+{
+	if (frequency == ARCAN_SHMIF_SAMPLERATE || frequency == 0){
+		if (*st){
+			speex_resampler_destroy(*st);
+			*st = NULL;
+		}
+		*rate = 0;
+		return false;
+	}
+
+/* a failed retune leaves the resampler producing silence, start over */
+	if (*st && *rate != frequency &&
+		RESAMPLER_ERR_SUCCESS !=
+			speex_resampler_set_rate(*st, frequency, ARCAN_SHMIF_SAMPLERATE)){
+		speex_resampler_destroy(*st);
+		*st = NULL;
+	}
+
+	if (!*st){
+		int err;
+		*st = speex_resampler_init(ARCAN_SHMIF_ACHANNELS,
+			frequency, ARCAN_SHMIF_SAMPLERATE, SPEEX_RESAMPLER_QUALITY_DESKTOP, &err);
+	}
+
+	*rate = frequency;
+	return *st != NULL;
+}
+
+static void drop_resampler(struct SpeexResamplerState_** st, unsigned* rate)
+{
+	if (*st)
+		speex_resampler_destroy(*st);
+	*st = NULL;
+	*rate = 0;
+}
+
+static void drop_amixer(arcan_frameserver* dst)
+{
+	for (int i = 0; i < dst->amixer.n_aids; i++)
+		drop_resampler(
+			&dst->amixer.inaud[i].resampler, &dst->amixer.inaud[i].rate);
+	drop_resampler(&dst->amixer.resampler, &dst->amixer.rate);
+
+	if (dst->amixer.n_aids)
+		arcan_mem_free(dst->amixer.inaud);
+
+	dst->amixer.inaud = NULL;
+	dst->amixer.n_aids = 0;
+}
+
+/*
+ * convert [nf] interleaved frames to planar float (with gain) in chunks
+ * and let the resampler write straight into the ring of [cur]
+ */
+static void resample_amixer(
+	struct frameserver_audsrc* cur, int16_t* buf, size_t nf)
+{
+	const uint32_t mask = FSRV_AMIX_RING - 1;
+	float tl[1024], tr[1024];
+
+	while (nf){
+		spx_uint32_t chunk = nf > 1024 ? 1024 : nf;
+		arcan_amix_deinterleave(buf, chunk, cur->l_gain, cur->r_gain, tl, tr);
+		buf += chunk * 2;
+		nf -= chunk;
+
+		spx_uint32_t ofs = 0;
+		while (ofs < chunk){
+			size_t space = FSRV_AMIX_RING - (cur->wpos - cur->rpos);
+			size_t wofs = cur->wpos & mask;
+			if (!space)
+				return;
+
+			spx_uint32_t in_len = chunk - ofs;
+			spx_uint32_t out_len = FSRV_AMIX_RING - wofs;
+			if (out_len > space)
+				out_len = space;
+
+/* both channels are at the same position, so the lengths will match */
+			spx_uint32_t l_in = in_len, l_out = out_len;
+			speex_resampler_process_float(cur->resampler,
+				0, &tl[ofs], &l_in, &cur->left[wofs], &l_out);
+			speex_resampler_process_float(cur->resampler,
+				1, &tr[ofs], &in_len, &cur->right[wofs], &out_len);
+
+			if (!in_len && !out_len)
+				break;
+
+			ofs += in_len;
+			cur->wpos += out_len;
+		}
+	}
+}
+
 /* assumptions:
  * buf_sz doesn't contain partial samples (% (bytes per sample * channels))
  * dst->amixer inaud is allocated and allocation count matches n_aids */
 static void feed_amixer(arcan_frameserver* dst, arcan_aobj_id srcid,
-	int16_t* buf, int nsamples)
+	int16_t* buf, int nsamples, unsigned frequency)
 {
 /* formats; nsamples (samples in, 2 samples / frame)
- * cur->inbuf; samples converted to float with gain, 2 samples / frame)
+ * cur->left, right; frames converted to float with gain, ring buffered
  * dst->outbuf; SINT16, in bytes, ofset in bytes */
 	size_t minv = INT_MAX;
+	const uint32_t mask = FSRV_AMIX_RING - 1;
 
-/* 1. Convert to float and buffer. Find the lowest common number of samples
- * buffered. Truncate if needed. Assume source feeds L/R */
+/* 1. Convert to planar float and buffer. Find the lowest common number of
+ * frames buffered. Truncate if needed. Assume source feeds L/R */
 	for (int i = 0; i < dst->amixer.n_aids; i++){
 		struct frameserver_audsrc* cur = dst->amixer.inaud + i;
 
-		if (cur->src_aid == srcid){
-			int ulim = sizeof(cur->inbuf) / sizeof(float);
-			int count = 0;
-
-			while (nsamples-- && cur->inofs < ulim){
-				float val = *buf++;
-				cur->inbuf[cur->inofs++] =
-					(count++ % 2 ? cur->l_gain : cur->r_gain) * (val / 32767.0f);
+		if (cur->src_aid == srcid &&
+			sync_resampler(&cur->resampler, &cur->rate, frequency)){
+			resample_amixer(cur, buf, nsamples >> 1);
+		}
+		else if (cur->src_aid == srcid){
+			size_t nf = nsamples >> 1;
+			size_t space = FSRV_AMIX_RING - (cur->wpos - cur->rpos);
+			if (nf > space)
+				nf = space;
+
+/* at most two runs, up to the end of the ring and then from the start */
+			while (nf){
+				size_t ofs = cur->wpos & mask;
+				size_t run = FSRV_AMIX_RING - ofs;
+				if (run > nf)
+					run = nf;
+
+				arcan_amix_deinterleave(buf, run,
+					cur->l_gain, cur->r_gain, &cur->left[ofs], &cur->right[ofs]);
+				buf += run * 2;
+				cur->wpos += run;
+				nf -= run;
 			}
 		}
 
-		if (cur->inofs < minv)
-			minv = cur->inofs;
+		if (cur->wpos - cur->rpos < minv)
+			minv = cur->wpos - cur->rpos;
 	}
 
 /*
- * 2. If number of samples exceeds some threshold, mix (minv)
- * samples together and store in dst->outb Formulae used:
+ * 2. If number of frames exceeds some threshold, mix (minv) frames
+ * together and store in dst->outb Formulae used:
  * A = float(sampleA) * gainA.
  * B = float(sampleB) * gainB. Z = A + B - A * B
  */
-		if (minv != INT_MAX && minv > 512 && dst->sz_audb - dst->ofs_audb > 0){
+	if (minv == INT_MAX || minv <= 256 || dst->ofs_audb >= dst->sz_audb)
+		return;
+
 /* clamp */
-			if (dst->ofs_audb + minv * sizeof(uint16_t) > dst->sz_audb)
-				minv = (dst->sz_audb - dst->ofs_audb) / sizeof(uint16_t);
+	if (dst->ofs_audb + minv * 2 * sizeof(int16_t) > dst->sz_audb)
+		minv = (dst->sz_audb - dst->ofs_audb) / (2 * sizeof(int16_t));
+
+/* the sources wrap at different positions, so mix in runs that are
+ * contiguous in all of them */
+	size_t n_aids = dst->amixer.n_aids;
+	float* left[n_aids];
+	float* right[n_aids];
+
+	while (minv){
+		size_t run = minv;
+
+		for (size_t i = 0; i < n_aids; i++){
+			struct frameserver_audsrc* cur = dst->amixer.inaud + i;
+			size_t ofs = cur->rpos & mask;
+			if (FSRV_AMIX_RING - ofs < run)
+				run = FSRV_AMIX_RING - ofs;
+			left[i] = &cur->left[ofs];
+			right[i] = &cur->right[ofs];
+		}
 
-			for (int sc = 0; sc < minv; sc++){
-				float work_sample = 0;
+		arcan_amix_planar(left, right, n_aids, run,
+			(int16_t*) &dst->audb[dst->ofs_audb]);
+		dst->ofs_audb += run * 2 * sizeof(int16_t);
 
-			for (int i = 0; i < dst->amixer.n_aids; i++){
-				work_sample += dst->amixer.inaud[i].inbuf[sc] - (work_sample *
-					dst->amixer.inaud[i].inbuf[sc]);
-			}
-/* clip output */
-			int16_t sample_conv = work_sample >= 1.0 ? 32767.0 :
-				(work_sample < -1.0 ? -32768 : work_sample * 32767);
-			memcpy(&dst->audb[dst->ofs_audb], &sample_conv, sizeof(int16_t));
-			dst->ofs_audb += sizeof(int16_t);
-		}
-/* 2b. Reset intermediate buffers, slide if needed. */
-		for (int j = 0; j < dst->amixer.n_aids; j++){
-			struct frameserver_audsrc* cur = dst->amixer.inaud + j;
-			if (cur->inofs > minv){
-				memmove(cur->inbuf, &cur->inbuf[minv], (cur->inofs - minv) *
-					sizeof(float));
-				cur->inofs -= minv;
-			}
-			else
-				cur->inofs = 0;
-		}
-	}
+/* 2b. Consume, just step the read positions */
+		for (size_t i = 0; i < n_aids; i++)
+			dst->amixer.inaud[i].rpos += run;
 
+		minv -= run;
+	}
 }
 
 void arcan_frameserver_update_mixweight(arcan_frameserver* dst,
@@ -815,8 +1024,7 @@ void arcan_frameserver_avfeed_mixer(arcan_frameserver* dst, int n_sources,
 {
 	assert(sources != NULL && dst != NULL && n_sources > 0);
 
-	if (dst->amixer.n_aids)
-		arcan_mem_free(dst->amixer.inaud);
+	drop_amixer(dst);
 
 	dst->amixer.inaud = arcan_alloc_mem(
 		n_sources * sizeof(struct frameserver_audsrc),
@@ -825,7 +1033,6 @@ void arcan_frameserver_avfeed_mixer(arcan_frameserver* dst, int n_sources,
 	for (int i = 0; i < n_sources; i++){
 		dst->amixer.inaud[i].l_gain  = 1.0;
 		dst->amixer.inaud[i].r_gain  = 1.0;
-		dst->amixer.inaud[i].inofs   = 0;
 		dst->amixer.inaud[i].src_aid = *sources++;
 	}
 
@@ -838,29 +1045,26 @@ void arcan_frameserver_avfeedmon(arcan_aobj_id src, uint8_t* buf,
 	arcan_frameserver* dst = tag;
 	assert((intptr_t)(buf) % 4 == 0);
 
-/*
- * FIXME: This is a victim of a recent shmif refactor where we started to
- * allow negotating different samplerates. This should be complemented with
- * the speex- resampler that's in the codebase already
- */
-	if (frequency != ARCAN_SHMIF_SAMPLERATE){
-		static bool warn;
-		if (!warn){
-			arcan_warning("arcan_frameserver_avfeedmon(), monitoring an audio feed\n"
-				"with a non-native samplerate, this is >currently< supported for\n"
-				"playback but not for recording (TOFIX).\n");
-			warn = true;
-		}
-	}
-
 /*
  * with no mixing setup (lowest latency path), we just feed the sync buffer
  * shared with the frameserver. otherwise we forward to the amixer that is
  * responsible for pushing as much as has been generated by all the defined
- * sources
+ * sources. Feeds with a different samplerate are resampled on the way.
  */
 	if (dst->amixer.n_aids > 0){
-		feed_amixer(dst, src, (int16_t*) buf, buf_sz >> 1);
+		feed_amixer(dst, src, (int16_t*) buf, buf_sz >> 1, frequency);
+	}
+	else if (sync_resampler(&dst->amixer.resampler,
+		&dst->amixer.rate, frequency)){
+		size_t fsz = ARCAN_SHMIF_ACHANNELS * sizeof(int16_t);
+		if (dst->ofs_audb >= dst->sz_audb)
+			return;
+
+		spx_uint32_t in_len = buf_sz / fsz;
+		spx_uint32_t out_len = (dst->sz_audb - dst->ofs_audb) / fsz;
+		speex_resampler_process_interleaved_int(dst->amixer.resampler,
+			(int16_t*) buf, &in_len, (int16_t*) &dst->audb[dst->ofs_audb], &out_len);
+		dst->ofs_audb += out_len * fsz;
 	}
 	else if (dst->ofs_audb + buf_sz < dst->sz_audb){
 			memcpy(dst->audb + dst->ofs_audb, buf, buf_sz);
@@ -1043,8 +1247,8 @@ arcan_errc arcan_frameserver_audioframe_direct(arcan_aobj* aobj,
 
 	if (0 == amask || ((1<<ind)&amask) == 0){
 		atomic_store_explicit(&src->shm.ptr->aready, 0, memory_order_release);
+		platform_fsrv_release(src, true);
 		platform_fsrv_leave(src);
-		arcan_sem_post(src->async);
 		return ARCAN_ERRC_NOTREADY;
 	}
 
@@ -1069,13 +1273,46 @@ arcan_errc arcan_frameserver_audioframe_direct(arcan_aobj* aobj,
 /* check for cont and > 1, wait for signal.. else release */
 	if (!cont){
 		atomic_store_explicit(&src->shm.ptr->aready, 0, memory_order_release);
+		platform_fsrv_release(src, true);
 		platform_fsrv_leave(src);
-		arcan_sem_post(src->async);
 	}
 
 	return ARCAN_OK;
 }
 
+/*
+ * Update the audio buffering proposal that the next resynch will apply: the
+ * output device period, doubled for each resynch that follows new underruns
+ * and halved back for each one that doesn't, and flagged as bulk when the
+ * client keeps more queued than we can play.
+ */
+static void abuf_proposal(arcan_frameserver* src)
+{
+	unsigned rate;
+	size_t period = arcan_audio_output_period(&rate);
+	unsigned underruns, overruns;
+
+	if (!period || ARCAN_OK !=
+		arcan_audio_bufferstats(src->aid, &underruns, &overruns)){
+		src->aprop.frames = 0;
+		return;
+	}
+
+	if (underruns != src->aprop.underruns){
+		if (src->aprop.step < FSRV_ABUF_STEP_LIM)
+			src->aprop.step++;
+	}
+	else if (src->aprop.step)
+		src->aprop.step--;
+
+	src->aprop.bulk = overruns != src->aprop.overruns &&
+		underruns == src->aprop.underruns;
+	src->aprop.underruns = underruns;
+	src->aprop.overruns = overruns;
+	src->aprop.frames = period << src->aprop.step;
+	src->aprop.rate = rate;
+}
+
 bool arcan_frameserver_tick_control(
 	arcan_frameserver* src, bool tick, int dst_ffunc)
 {
@@ -1114,6 +1351,7 @@ bool arcan_frameserver_tick_control(
 	with switching buffer strategies (valid buffer in one size, failed because
 	size over reach with other strategy, so now there's a failure mechanism.
  */
+	abuf_proposal(src);
 	int rzc = platform_fsrv_resynch(src);
 	if (rzc <= 0)
 		goto leave;
@@ -10,6 +10,19 @@
 #define FSRV_MAX_VBUFC ARCAN_SHMIF_VBUFC_LIM
 #define FSRV_MAX_ABUFC ARCAN_SHMIF_ABUFC_LIM
 
+/*
+ * Audio buffer negotiation, the base size comes from the output device period
+ * and is doubled (up to STEP_LIM times) when a segment keeps on underrunning.
+ * Low-latency clients get at least LL_CNT buffers of the base size, bulk ones
+ * (asking for BULK_FACTOR times the base or more, or that keep on filling the
+ * queue) get at most BULK_CNT larger ones.
+ */
+#define FSRV_ABUF_MAX 65532
+#define FSRV_ABUF_STEP_LIM 3
+#define FSRV_ABUF_LL_CNT 4
+#define FSRV_ABUF_BULK_CNT 2
+#define FSRV_ABUF_BULK_FACTOR 4
+
 /*
  * The following functions are implemented in the platform layer;
  * arcan_frameserver_validchild,
@@ -69,11 +82,27 @@ struct arcan_frameserver_meta {
 	unsigned long long framecount;
 	unsigned long long dropcount;
 	unsigned long long lastpts;
+
+/* deadline feedback, time when the last frame was picked up and the
+ * smoothed cost from pick up to display synch */
+	unsigned long long synch_pickup;
+	unsigned synch_cost;
 };
 
+/* size (frames, power of two) of the per-source ring buffers in the mixer */
+#define FSRV_AMIX_RING 2048
+
 struct frameserver_audsrc {
-	float inbuf[4096];
-	off_t inofs;
+/* planar rings, [rpos, wpos) are pending, the positions only ever grow
+ * and are masked on access */
+	float left[FSRV_AMIX_RING];
+	float right[FSRV_AMIX_RING];
+	uint32_t rpos, wpos;
+
+/* set while the source runs at another samplerate than the mix */
+	struct SpeexResamplerState_* resampler;
+	unsigned rate;
+
 	arcan_aobj_id src_aid;
 	float l_gain;
 	float r_gain;
@@ -129,6 +158,7 @@ struct arcan_frameserver {
 		bool gpu_auth : 1;
 		bool no_dms_free : 1;
 		bool rz_ack : 1;
+		bool priority : 1;
 	} flags;
 
 /* if autoclock is set, track and use as metric for firing events */
@@ -153,6 +183,10 @@ struct arcan_frameserver {
 		unsigned n_aids;
 		size_t max_bufsz;
 		struct frameserver_audsrc* inaud;
+
+/* resampling for a single monitored feed (no mixing) */
+		struct SpeexResamplerState_* resampler;
+		unsigned rate;
 	} amixer;
 
 /* playstate control and statistics */
@@ -197,6 +231,16 @@ struct arcan_frameserver {
 	size_t abuf_sz;
 	size_t vbuf_cnt;
 
+/* audio buffering proposal for the next resynch, [frames] (0 = none) is in
+ * samples per channel at [rate], see abuf_proposal in arcan_frameserver.c */
+	struct {
+		size_t frames;
+		unsigned rate;
+		bool bulk;
+		unsigned step;
+		unsigned underruns, overruns;
+	} aprop;
+
 /* for use with rz_ack */
 	int rz_known;
 	shmif_pixel* vbufs[FSRV_MAX_VBUFC];
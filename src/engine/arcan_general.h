@@ -102,6 +102,31 @@ typedef struct {
 	uint8_t bpp;
 } img_cons;
 
+/*
+ * Per-stage timing histograms, log-linear buckets in microseconds: values
+ * below 1 << SUB are exact, above that each power of two is split in
+ * 1 << SUB buckets (~3% relative error), covering the full 32-bit range.
+ */
+#define ARCAN_BENCH_HIST_SUB 5
+#define ARCAN_BENCH_HIST_MAG 28
+
+enum arcan_bench_stage {
+	ARCAN_BENCH_EVENT = 0, /* scripting event handlers */
+	ARCAN_BENCH_LUA_TICK,  /* scripting clock_pulse */
+	ARCAN_BENCH_VIDEO_TICK,
+	ARCAN_BENCH_RTGT,      /* refresh of a single rendertarget */
+	ARCAN_BENCH_SYNCH,     /* platform synch, including waiting */
+	ARCAN_BENCH_READBACK,
+	ARCAN_BENCH_FRAME,     /* frame to frame */
+	ARCAN_BENCH_STAGE_LIMIT
+};
+
+struct arcan_bench_hist {
+	uint64_t count, sum;
+	unsigned min, max;
+	uint32_t bucket[ARCAN_BENCH_HIST_MAG << ARCAN_BENCH_HIST_SUB];
+};
+
 /*
  * found / implemented in arcan_event.c
  */
@@ -116,6 +141,25 @@ typedef struct {
 
 	unsigned framecost[64], costcount;
 	char costofs;
+
+/* rendertarget updates split on how much of them that had to be redrawn */
+	struct {
+		size_t full, partial, skipped, rects;
+		uint64_t pixels, total_pixels;
+	} damage;
+
+/* scripting VM garbage collection run by the conductor, in microseconds */
+	struct {
+		uint64_t time;
+		unsigned frames, full, max;
+	} gc;
+
+/* 2D draw calls issued and the number of objects drawn through batches */
+	struct {
+		uint64_t calls, objects, batched;
+	} draw;
+
+	struct arcan_bench_hist stage[ARCAN_BENCH_STAGE_LIMIT];
 } arcan_benchdata;
 
 /*
@@ -150,6 +194,39 @@ void arcan_state_dump(const char* prefix, const char* key, const char* src);
 void arcan_bench_register_tick(unsigned);
 void arcan_bench_register_cost(unsigned);
 void arcan_bench_register_frame();
+void arcan_bench_register_damage(bool full,
+	size_t n_rects, size_t pixels, size_t total_pixels);
+void arcan_bench_register_gc(unsigned usecs, bool full);
+void arcan_bench_register_draw(size_t n_objects, bool batched);
+
+/*
+ * add a [usecs] sample to the histogram of [stage], use the timestamp
+ * helper to avoid sampling the clock at all when benchmarking is off:
+ *
+ * unsigned long long ts = arcan_bench_timestamp();
+ * ... work ...
+ * arcan_bench_register_stage(STAGE, ts);
+ */
+void arcan_bench_register_stage(enum arcan_bench_stage, unsigned long long ts);
+unsigned long long arcan_bench_timestamp();
+
+/*
+ * retrieve the value (in microseconds) below which [q] (0..1) of the samples
+ * registered for [stage] fall, 0 if there are no samples
+ */
+unsigned arcan_bench_percentile(enum arcan_bench_stage, double q);
+
+/*
+ * name of [stage] as used in the Lua API and in dumps
+ */
+const char* arcan_bench_stagename(enum arcan_bench_stage);
+
+/*
+ * write a text summary of all stage histograms to [path], one line per stage,
+ * returns false if the file couldn't be written. If ARCAN_BENCH_DUMP is set
+ * to a path in the environment, this is also triggered by SIGRTMIN+2.
+ */
+bool arcan_bench_dump(const char* path);
 
 /*
  * LEGACY/REDESIGN
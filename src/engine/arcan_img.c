@@ -13,6 +13,12 @@
 #include <stdbool.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 #include "arcan_math.h"
 #include "arcan_general.h"
 #include "arcan_img.h"
@@ -21,8 +27,22 @@
 #define STBI_MALLOC(sz) (arcan_alloc_mem(sz, ARCAN_MEM_VBUFFER, \
 	ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_PAGE))
 
+/* stb_image grows its zlib and IDAT buffers in place, these are tracked
+ * VBUFFER blocks so a plain realloc would leave the accounting pointing at
+ * a block that no longer exists */
+static void* stbi_arcan_realloc(void* src, size_t oldsz, size_t newsz)
+{
+	if (!src)
+		return STBI_MALLOC(newsz);
+
+	if (newsz <= oldsz)
+		return src;
+
+	return arcan_mem_grow(src, oldsz, newsz - oldsz, ARCAN_MEM_NONFATAL);
+}
+
 #define STBI_FREE(ptr) (arcan_mem_free(ptr))
-#define STBI_REALLOC(p,sz) realloc(p,sz)
+#define STBI_REALLOC_SIZED(p,oldsz,newsz) stbi_arcan_realloc(p,oldsz,newsz)
 
 #define STBI_ONLY_PNG
 #define STBI_ONLY_JPEG
@@ -104,13 +124,70 @@ arcan_errc arcan_img_outpng(FILE* dst,
 	return ARCAN_OK;
 }
 
+/* swap the first and third byte of [n] 32-bit pixels, this covers the
+ * RGBA (decoder) to BGRA (desktop GL) case */
+static void swap_rb(uint32_t* buf, size_t n)
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128i ga = _mm_set1_epi32(0xff00ff00);
+	const __m128i lo = _mm_set1_epi32(0x000000ff);
+
+	for (; i + 4 <= n; i += 4){
+		__m128i v = _mm_loadu_si128((__m128i*) &buf[i]);
+		__m128i r = _mm_and_si128(v, lo);
+		__m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), lo);
+		v = _mm_or_si128(_mm_and_si128(v, ga),
+			_mm_or_si128(b, _mm_slli_epi32(r, 16)));
+		_mm_storeu_si128((__m128i*) &buf[i], v);
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	for (; i + 16 <= n; i += 16){
+		uint8x16x4_t px = vld4q_u8((uint8_t*) &buf[i]);
+		uint8x16_t tmp = px.val[0];
+		px.val[0] = px.val[2];
+		px.val[2] = tmp;
+		vst4q_u8((uint8_t*) &buf[i], px);
+	}
+#endif
+
+	for (; i < n; i++){
+		uint32_t v = buf[i];
+		buf[i] = (v & 0xff00ff00) | ((v >> 16) & 0xff) | ((v & 0xff) << 16);
+	}
+}
+
 av_pixel* arcan_img_repack(uint32_t* inbuf, size_t inw, size_t inh)
 {
 	if (sizeof(av_pixel) == 4 && RGBA(0x00, 0x00, 0xff, 0x00) == 0x00ff0000)
 		return (av_pixel*) inbuf;
 
+/* same pixel size, the decoder output buffer becomes the store buffer */
+	if (sizeof(av_pixel) == 4){
+		if (RGBA(0xff, 0x00, 0x00, 0x00) == 0x00ff0000 &&
+			RGBA(0x00, 0xff, 0x00, 0x00) == 0x0000ff00 &&
+			RGBA(0x00, 0x00, 0xff, 0x00) == 0x000000ff &&
+			RGBA(0x00, 0x00, 0x00, 0xff) == 0xff000000){
+			swap_rb(inbuf, inw * inh);
+			return (av_pixel*) inbuf;
+		}
+
+		av_pixel* work = (av_pixel*) inbuf;
+		for (size_t count = inw * inh; count > 0; count--, work++){
+			uint32_t val = *work;
+			*work = RGBA(
+				((val & 0x000000ff) >> 0),
+				((val & 0x0000ff00) >> 8),
+				((val & 0x00ff0000) >> 16),
+				((val & 0xff000000) >> 24)
+			);
+		}
+		return (av_pixel*) inbuf;
+	}
+
 	av_pixel* imgbuf = arcan_alloc_mem(sizeof(av_pixel) * inw * inh,
-		ARCAN_MEM_VBUFFER | ARCAN_MEM_NONFATAL, 0, ARCAN_MEMALIGN_PAGE);
+		ARCAN_MEM_VBUFFER, ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_PAGE);
 
 		if (!imgbuf)
 			goto done;
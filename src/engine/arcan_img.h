@@ -39,6 +39,8 @@ arcan_errc arcan_img_outpng(FILE* dst,
  * make sure that inbuf is propery aligned
  * and matches the native engine color format.
  * returns NULL on failure but [inbuf] will always be freed (or re-used)
+ * for 32-bit native formats the conversion is done in place and [inbuf]
+ * is returned, so the decoder output can be used as the store directly.
  */
 av_pixel* arcan_img_repack(uint32_t* inbuf, size_t inw, size_t inh);
 #endif
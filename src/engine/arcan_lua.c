@@ -115,6 +115,26 @@
 	(RESOURCE_SYS_LIBS)
 #endif
 
+/*
+ * budgeted gc: start a new cycle when the heap has grown by PAUSE percent
+ * since the last one completed, collect in full at PRESSURE percent
+ */
+#ifndef GC_SLACK_PAUSE
+#define GC_SLACK_PAUSE 200
+#endif
+
+#ifndef GC_SLACK_PRESSURE
+#define GC_SLACK_PRESSURE 400
+#endif
+
+#ifndef GC_SLACK_MIN_KB
+#define GC_SLACK_MIN_KB 4096
+#endif
+
+#ifndef GC_SLACK_STEP_KB
+#define GC_SLACK_STEP_KB 16
+#endif
+
 #define STRJOIN2(X) #X
 #define STRJOIN(X) STRJOIN2(X)
 #define LINE_TAG STRJOIN(__LINE__)
@@ -339,6 +359,14 @@ static struct {
 	char* last_crash_source;
 
 	lua_State* last_ctx;
+
+/* budgeted gc state, see arcan_lua_gcslack */
+	struct {
+		lua_State* ctx;
+		size_t live_kb;
+		unsigned step_cost;
+		bool cycle;
+	} gc;
 } luactx = {0};
 
 extern char* _n_strdup(const char* instr, const char* alt);
@@ -850,6 +878,65 @@ static int alua_doresolve(lua_State* ctx, const char* inp)
 	return rv;
 }
 
+unsigned arcan_lua_gcslack(lua_State* ctx, unsigned budget)
+{
+	unsigned long long start = arcan_timemicros();
+
+/* the state might have been rebuilt (collapse, adopt), take over again */
+	if (luactx.gc.ctx != ctx){
+		lua_gc(ctx, LUA_GCSTOP, 0);
+		luactx.gc.ctx = ctx;
+		luactx.gc.live_kb = lua_gc(ctx, LUA_GCCOUNT, 0);
+		luactx.gc.step_cost = 0;
+		luactx.gc.cycle = false;
+	}
+
+	size_t kb = lua_gc(ctx, LUA_GCCOUNT, 0);
+	size_t base = luactx.gc.live_kb > GC_SLACK_MIN_KB ?
+		luactx.gc.live_kb : GC_SLACK_MIN_KB;
+
+	if (kb >= base * GC_SLACK_PRESSURE / 100){
+		lua_gc(ctx, LUA_GCCOLLECT, 0);
+		lua_gc(ctx, LUA_GCSTOP, 0);
+		luactx.gc.live_kb = lua_gc(ctx, LUA_GCCOUNT, 0);
+		luactx.gc.cycle = false;
+
+		unsigned spent = arcan_timemicros() - start;
+		arcan_bench_register_gc(spent, true);
+		return spent;
+	}
+
+	if (!luactx.gc.cycle){
+		if (kb < base * GC_SLACK_PAUSE / 100)
+			return 0;
+		luactx.gc.cycle = true;
+	}
+
+/* always make some progress, otherwise a lack of slack would have us rely
+ * on the pressure collection. STEP re-arms the automatic collector (5.1 and
+ * luajit alike) so it needs to be stopped again after each call. */
+	unsigned spent;
+	do {
+		unsigned long long ts = arcan_timemicros();
+		int done = lua_gc(ctx, LUA_GCSTEP, GC_SLACK_STEP_KB);
+		lua_gc(ctx, LUA_GCSTOP, 0);
+
+		unsigned cost = arcan_timemicros() - ts;
+		luactx.gc.step_cost = luactx.gc.step_cost ?
+			(luactx.gc.step_cost * 3 + cost + 2) / 4 : cost;
+
+		if (done){
+			luactx.gc.live_kb = lua_gc(ctx, LUA_GCCOUNT, 0);
+			luactx.gc.cycle = false;
+		}
+
+		spent = arcan_timemicros() - start;
+	} while (luactx.gc.cycle && spent + luactx.gc.step_cost < budget);
+
+	arcan_bench_register_gc(spent, false);
+	return spent;
+}
+
 void arcan_lua_tick(lua_State* ctx, size_t nticks, size_t global)
 {
 	arcan_lua_setglobalint(ctx, "CLOCK", global);
@@ -869,7 +956,7 @@ char* arcan_lua_main(lua_State* ctx, const char* inp, bool file)
  * an appl is about to be loaded so here is a decent entrypoint */
 	const int suffix_lim = 34;
 
-	free(luactx.prefix_buf);
+	arcan_mem_free(luactx.prefix_buf);
 	luactx.prefix_ofs = arcan_appl_id_len();
 	luactx.prefix_buf = arcan_alloc_mem( arcan_appl_id_len() + suffix_lim,
 		ARCAN_MEM_BINDING, ARCAN_MEM_BZERO, ARCAN_MEMALIGN_SIMD
@@ -1533,8 +1620,8 @@ static int nbio_close(struct nonblock_io** ib)
 		unlink((*ib)->unlink_fn);
 		arcan_mem_free((*ib)->unlink_fn);
 	}
-	free((*ib)->pending);
-	free(*ib);
+	arcan_mem_free((*ib)->pending);
+	arcan_mem_free(*ib);
 	*ib = NULL;
 	return 0;
 }
@@ -2419,6 +2506,37 @@ static int abufsz(lua_State* ctx)
 	LUA_ETRACE("audio_buffer_size", NULL, 1);
 }
 
+static int abufstate(lua_State* ctx)
+{
+	LUA_TRACE("audio_buffer_state");
+	arcan_vobj_id vid = luaL_checkvid(ctx, 1, NULL);
+	vfunc_state* state = arcan_video_feedstate(vid);
+
+	if (!state || state->tag != ARCAN_TAG_FRAMESERV || !state->ptr){
+		arcan_warning("audio_buffer_state(), "
+			"referenced object is not connected to a frameserver.\n");
+		LUA_ETRACE("audio_buffer_state", "not a frameserver", 0);
+	}
+
+	arcan_frameserver* fsrv = state->ptr;
+	unsigned underruns = 0, overruns = 0, rate = 0;
+	size_t period = arcan_audio_output_period(&rate);
+	arcan_audio_bufferstats(fsrv->aid, &underruns, &overruns);
+
+	lua_newtable(ctx);
+	int top = lua_gettop(ctx);
+	tblnum(ctx, "buffer_size", fsrv->abuf_sz, top);
+	tblnum(ctx, "buffer_count", fsrv->abuf_cnt, top);
+	tblnum(ctx, "samplerate", fsrv->desc.samplerate, top);
+	tblnum(ctx, "underruns", underruns, top);
+	tblnum(ctx, "overruns", overruns, top);
+	tblbool(ctx, "bulk", fsrv->aprop.bulk, top);
+	tblnum(ctx, "output_period", period, top);
+	tblnum(ctx, "output_rate", rate, top);
+
+	LUA_ETRACE("audio_buffer_state", NULL, 1);
+}
+
 static int playaudio(lua_State* ctx)
 {
 	LUA_TRACE("play_audio");
@@ -4660,7 +4778,7 @@ void arcan_lua_pushevent(lua_State* ctx, arcan_event* ev)
 				);
 				if (strkey){
 					tblstr(ctx, "key", (const char*) strkey, top);
-					free(strkey);
+					arcan_mem_free(strkey);
 				}
 			break;
 
@@ -7003,6 +7121,9 @@ void arcan_lua_shutdown(lua_State* ctx)
 /* deal with:
  * luactx : rawres, lastsrc, cb_source_kind, db_source_tag, last_segreq,
  * pending_socket_label, pending_socket_descr */
+	if (luactx.gc.ctx == ctx)
+		luactx.gc.ctx = NULL;
+
 	lua_close(ctx);
 }
 
@@ -7731,6 +7852,7 @@ enum target_flags {
 	TARGET_FLAG_ALLOW_GPUAUTH,
 	TARGET_FLAG_LIMIT_SIZE,
 	TARGET_FLAG_SYNCH_SIZE,
+	TARGET_FLAG_PRIORITY,
 	TARGET_FLAG_ENDM
 };
 
@@ -7818,6 +7940,13 @@ static void updateflag(arcan_vobj_id vid, enum target_flags flag, bool toggle)
 		fsrv->flags.rz_ack = toggle;
 	break;
 
+	case TARGET_FLAG_PRIORITY:
+		if (toggle)
+			arcan_frameserver_priority(fsrv);
+		else if (fsrv->flags.priority)
+			arcan_frameserver_priority(NULL);
+	break;
+
 	case TARGET_FLAG_ENDM:
 	break;
 	}
@@ -8803,6 +8932,7 @@ static int procimage_histo(lua_State* ctx)
 	int packing = luaL_optnumber(ctx, 3, HIST_MERGE);
 	size_t dst_row = luaL_optnumber(ctx, 4, 0);
 
+	arcan_vint_imgcache_unshare(vobj);
 	av_pixel* base = (av_pixel*) vobj->vstore->vinf.text.raw;
 	if (dst_row > vobj->vstore->h){
 		arcan_fatal("calcImage:histogram_impose, "
@@ -9094,7 +9224,7 @@ static int meshaccess_type(lua_State* ctx)
 enum arcan_ffunc_rv arcan_lua_proctarget FFUNC_HEAD
 {
 	if (cmd == FFUNC_DESTROY){
-		free(state.ptr);
+		arcan_mem_free(state.ptr);
 		return 0;
 	}
 
@@ -9733,14 +9863,14 @@ static int recordset(lua_State* ctx)
 				!= AOBJ_CAPTUREFEED){
 				arcan_warning("recordset(%d), unsupported AID source type,"
 					" only STREAMs currently supported. Audio recording disabled.\n");
-				free(aidlocks);
+				arcan_mem_free(aidlocks);
 				aidlocks = NULL;
 				naids = 0;
 				char* ol = arcan_alloc_mem(strlen(argl) + sizeof(":noaudio=true"),
 					ARCAN_MEM_STRINGBUF, 0, ARCAN_MEMALIGN_NATURAL);
 
 				sprintf(ol, "%s%s", argl, ":noaudio=true");
-				free(argl);
+				arcan_mem_free(argl);
 				argl = ol;
 				break;
 			}
@@ -9753,7 +9883,7 @@ static int recordset(lua_State* ctx)
 		char* ol = arcan_alloc_mem(strlen(argl) + sizeof(":noaudio=true"),
 			ARCAN_MEM_STRINGBUF, 0, ARCAN_MEMALIGN_NATURAL);
 		sprintf(ol, "%s%s", argl, ":noaudio=true");
-		free(argl);
+		arcan_mem_free(argl);
 		argl = ol;
 	}
 
@@ -9762,7 +9892,7 @@ static int recordset(lua_State* ctx)
 		spawn_recfsrv(ctx, did, dfsrv, naids, aidlocks, argl, resf);
 
 cleanup:
-	free(argl);
+	arcan_mem_free(argl);
 	LUA_ETRACE("define_recordtarget", NULL, rc);
 }
 
@@ -9797,7 +9927,10 @@ static int togglebench(lua_State* ctx)
 	else
 		benchdata.bench_enabled = !benchdata.bench_enabled;
 
-	arcan_video_display.ignore_dirty = benchdata.bench_enabled;
+/* forcing full redraws every frame is the default, but measuring the dirty
+ * tracking itself requires that to be disabled */
+	bool force = nargs > 1 ? lua_toboolean(ctx, 2) : true;
+	arcan_video_display.ignore_dirty = benchdata.bench_enabled && force;
 
 /* always reset on data change */
 	memset(benchdata.ticktime, '\0', sizeof(benchdata.ticktime));
@@ -9805,6 +9938,10 @@ static int togglebench(lua_State* ctx)
 	memset(benchdata.framecost, '\0', sizeof(benchdata.framecost));
 	benchdata.tickofs = benchdata.frameofs = benchdata.costofs = 0;
 	benchdata.framecount = benchdata.tickcount = benchdata.costcount = 0;
+	memset(&benchdata.damage, '\0', sizeof(benchdata.damage));
+	memset(&benchdata.gc, '\0', sizeof(benchdata.gc));
+	memset(&benchdata.draw, '\0', sizeof(benchdata.draw));
+	memset(benchdata.stage, '\0', sizeof(benchdata.stage));
 
 	LUA_ETRACE("benchmark_enable", NULL, 0);
 }
@@ -9855,7 +9992,119 @@ static int getbenchvals(lua_State* ctx)
 		i = (i + 1) % bench_sz;
 	}
 
-	LUA_ETRACE("benchmark_data", NULL, 6);
+/* named counters that don't fit the ringbuffer pattern */
+	lua_newtable(ctx);
+	top = lua_gettop(ctx);
+	tblnum(ctx, "damage_full", benchdata.damage.full, top);
+	tblnum(ctx, "damage_partial", benchdata.damage.partial, top);
+	tblnum(ctx, "damage_skip", benchdata.damage.skipped, top);
+	tblnum(ctx, "damage_rects", benchdata.damage.rects, top);
+	tblnum(ctx, "damage_px", benchdata.damage.pixels, top);
+	tblnum(ctx, "damage_total_px", benchdata.damage.total_pixels, top);
+	tblnum(ctx, "gc_us", benchdata.gc.time, top);
+	tblnum(ctx, "gc_frames", benchdata.gc.frames, top);
+	tblnum(ctx, "gc_max_us", benchdata.gc.max, top);
+	tblnum(ctx, "gc_full", benchdata.gc.full, top);
+	tblnum(ctx, "draw_calls", benchdata.draw.calls, top);
+	tblnum(ctx, "draw_objects", benchdata.draw.objects, top);
+	tblnum(ctx, "draw_batched", benchdata.draw.batched, top);
+
+	LUA_ETRACE("benchmark_data", NULL, 7);
+}
+
+static int getbenchhist(lua_State* ctx)
+{
+	LUA_TRACE("benchmark_histogram");
+
+	lua_newtable(ctx);
+	int top = lua_gettop(ctx);
+
+	for (size_t i = 0; i < ARCAN_BENCH_STAGE_LIMIT; i++){
+		struct arcan_bench_hist* hist = &benchdata.stage[i];
+		lua_pushstring(ctx, arcan_bench_stagename(i));
+		lua_newtable(ctx);
+		int stop = lua_gettop(ctx);
+		tblnum(ctx, "count", hist->count, stop);
+		tblnum(ctx, "min", hist->min, stop);
+		tblnum(ctx, "max", hist->max, stop);
+		tblnum(ctx, "mean", hist->count ? hist->sum / hist->count : 0, stop);
+		tblnum(ctx, "p50", arcan_bench_percentile(i, 0.5), stop);
+		tblnum(ctx, "p90", arcan_bench_percentile(i, 0.9), stop);
+		tblnum(ctx, "p99", arcan_bench_percentile(i, 0.99), stop);
+		tblnum(ctx, "p999", arcan_bench_percentile(i, 0.999), stop);
+		lua_rawset(ctx, top);
+	}
+
+	LUA_ETRACE("benchmark_histogram", NULL, 1);
+}
+
+static int getconductorstats(lua_State* ctx)
+{
+	LUA_TRACE("conductor_stats");
+	struct conductor_stats stats;
+	arcan_conductor_stats(&stats);
+
+	lua_newtable(ctx);
+	int top = lua_gettop(ctx);
+	tblnum(ctx, "frames", stats.frames, top);
+	tblnum(ctx, "frameservers", stats.frameservers, top);
+	tblnum(ctx, "uploads", stats.uploads, top);
+	tblnum(ctx, "deferred", stats.deferred, top);
+	tblnum(ctx, "deferred_total", stats.deferred_total, top);
+	tblnum(ctx, "upload_budget", stats.upload_budget, top);
+	tblnum(ctx, "synch_period", stats.synch_period, top);
+	tblnum(ctx, "slack", stats.slack, top);
+	tblnum(ctx, "gc", stats.gc, top);
+
+	static const char* stage_names[] = {
+		"feed", "event", "frame", "synch", "idle"
+	};
+	_Static_assert(COUNT_OF(stage_names) == CONDUCTOR_STAGE_LIMIT,
+		"conductor_stats: stage names out of synch");
+
+	for (size_t i = 0; i < CONDUCTOR_STAGE_LIMIT; i++){
+		lua_pushstring(ctx, stage_names[i]);
+		lua_newtable(ctx);
+		int stop = lua_gettop(ctx);
+		tblnum(ctx, "last", stats.stage[i].last, stop);
+		tblnum(ctx, "avg", stats.stage[i].avg, stop);
+		tblnum(ctx, "max", stats.stage[i].max, stop);
+		lua_rawset(ctx, top);
+	}
+
+	LUA_ETRACE("conductor_stats", NULL, 1);
+}
+
+static int getmemstats(lua_State* ctx)
+{
+	LUA_TRACE("memory_stats");
+	static const char* type_names[] = {
+		NULL, "vbuffer", "vstruct", "extstruct", "abuffer", "stringbuf",
+		"vtag", "atag", "binding", "modeldata", "threadctx"
+	};
+	_Static_assert(COUNT_OF(type_names) == ARCAN_MEM_ENDMARKER,
+		"memory_stats: type names out of synch");
+
+	lua_newtable(ctx);
+	int top = lua_gettop(ctx);
+
+	for (size_t i = ARCAN_MEM_VBUFFER; i < ARCAN_MEM_ENDMARKER; i++){
+		struct arcan_memstats stats;
+		if (!arcan_mem_stats(i, &stats))
+			continue;
+
+		lua_pushstring(ctx, type_names[i]);
+		lua_newtable(ctx);
+		int stop = lua_gettop(ctx);
+		tblnum(ctx, "allocs", stats.alloc_cnt, stop);
+		tblnum(ctx, "frees", stats.dealloc_cnt, stop);
+		tblnum(ctx, "in_use", stats.in_use, stop);
+		tblnum(ctx, "peak", stats.peak, stop);
+		tblnum(ctx, "pool", stats.pool_sz, stop);
+		lua_rawset(ctx, top);
+	}
+
+	LUA_ETRACE("memory_stats", NULL, 1);
 }
 
 static int timestamp(lua_State* ctx)
@@ -10812,7 +11061,7 @@ static int net_open(lua_State* ctx)
 
 	lua_launch_fsrv(ctx, &args, ref);
 
-	free(instr);
+	arcan_mem_free(instr);
 	free(workstr);
 
 	LUA_ETRACE("net_open", NULL, 1);
@@ -11305,6 +11554,7 @@ static const luaL_Reg audfuns[] = {
 {"load_asample",      loadasample },
 {"audio_gain",        gain        },
 {"audio_buffer_size", abufsz      },
+{"audio_buffer_state", abufstate   },
 {"capture_audio",     captureaudio},
 {"list_audio_inputs", capturelist },
 {NULL, NULL}
@@ -11441,6 +11691,9 @@ static const luaL_Reg sysfuns[] = {
 {"benchmark_enable",    togglebench      },
 {"benchmark_timestamp", timestamp        },
 {"benchmark_data",      getbenchvals     },
+{"benchmark_histogram", getbenchhist     },
+{"conductor_stats",     getconductorstats},
+{"memory_stats",        getmemstats      },
 {"system_identstr",     getidentstr      },
 {"system_defaultfont",  setdefaultfont   },
 #ifdef _DEBUG
@@ -11620,6 +11873,7 @@ void arcan_lua_pushglobalconsts(lua_State* ctx){
 {"TARGET_ALLOWGPU", TARGET_FLAG_ALLOW_GPUAUTH},
 {"TARGET_LIMITSIZE", TARGET_FLAG_LIMIT_SIZE},
 {"TARGET_SYNCHSIZE", TARGET_FLAG_SYNCH_SIZE},
+{"TARGET_PRIORITY", TARGET_FLAG_PRIORITY},
 {"DISPLAY_STANDBY", ADPMS_STANDBY},
 {"DISPLAY_OFF", ADPMS_OFF},
 {"DISPLAY_SUSPEND", ADPMS_SUSPEND},
@@ -12244,7 +12498,7 @@ ctx.vobjs[vobj.cellid] = vobj;\n", (long int)vid_toluavid(i));
 		}
 
 		for (size_t i = 0; i < ctx->n_rtargets; i++){
-			struct rendertarget* rtgt = &ctx->rtargets[i];
+			struct rendertarget* rtgt = ctx->rtargets[i];
 			fprintf(dst, "\
 local rtgt = {\n\
 	attached = {");
@@ -12384,12 +12638,12 @@ void arcan_lua_stategrab(lua_State* ctx, char* dstfun, int src)
 		}
 
 		if (statebuf_ofs == statebuf_sz - 1){
-			statebuf_sz <<= 1;
-			char* newp = realloc(statebuf, statebuf_sz);
-			if (newp)
+			char* newp = arcan_mem_grow(statebuf, statebuf_sz, statebuf_sz,
+				ARCAN_MEM_BZERO | ARCAN_MEM_NONFATAL);
+			if (newp){
 				statebuf = newp;
-			else
-				statebuf_sz >>= 1;
+				statebuf_sz <<= 1;
+			}
 		}
 
 	}
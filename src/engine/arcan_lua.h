@@ -33,6 +33,13 @@ void arcan_lua_cbdrop();
 void arcan_lua_shutdown(struct arcan_luactx*);
 void arcan_lua_tick(struct arcan_luactx*, size_t, size_t);
 
+/* Budgeted garbage collection: the first call stops the automatic collector
+ * for the context, and from then on each call runs incremental steps for at
+ * most [budget] microseconds (at least one step if a cycle is in progress).
+ * A full collection is only forced when the heap grows far beyond the size
+ * it had after the last completed cycle. Returns the microseconds spent. */
+unsigned arcan_lua_gcslack(struct arcan_luactx*, unsigned budget);
+
 /* add a set of wrapper functions exposing arcan_video and friends
  * to the Lua state, debugfuncs corresponds to desired debug level / behavior */
 arcan_errc arcan_lua_exposefuncs(struct arcan_luactx* dst,
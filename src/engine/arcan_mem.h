@@ -227,6 +227,23 @@ void arcan_mem_unlock(void*);
  */
 void arcan_mem_tick();
 
+/*
+ * implemented in <platform>/mem.c
+ * retrieve the allocation counters for a specific memory type.
+ * (in_use) is the number of bytes currently handed out (for pooled types this
+ * is rounded up to the size class), (peak) the highest value (in_use) has had
+ * and (pool_sz) the number of bytes held in pools reserved for the type.
+ * Returns false if the type is out of range.
+ */
+struct arcan_memstats {
+	size_t alloc_cnt;
+	size_t dealloc_cnt;
+	size_t in_use;
+	size_t peak;
+	size_t pool_sz;
+};
+bool arcan_mem_stats(enum arcan_memtypes, struct arcan_memstats*);
+
 /*
  * implemented in <platform>/mem.c
  * aggregates a mem_alloc and a mem_copy from a source buffer.
@@ -58,6 +58,16 @@
 #define CACHED_BITMAP	0x01
 #define CACHED_PIXMAP	0x02
 
+/* set when the font lacks the glyph so fallback chains don't repeat lookups */
+#define CACHED_MISSING	0x20
+
+/* The glyph cache is set-associative with LRU replacement inside each set,
+ * keyed on codepoint (or glyph index), lookup mode and the glyph-affecting
+ * style bits. Face and size are implied by the font itself. Sets must be a
+ * power of two. */
+#define TTF_CACHE_SETS 256
+#define TTF_CACHE_WAYS 8
+
 /* Cached glyph information */
 typedef struct cached_glyph {
 	int stored;
@@ -70,7 +80,12 @@ typedef struct cached_glyph {
 	int maxy;
 	int yoffset;
 	int advance;
+
+/* cache key and last use, tick == 0 marks a free slot */
 	uint32_t cached;
+	int style;
+	bool by_ind;
+	uint32_t tick;
 
 /* special case, set this to true when we deal with non- scalable fonts with
  * embedded bitmaps where we scale to fit the set pt- size (or, with a
@@ -106,9 +121,10 @@ struct _TTF_Font {
 	int underline_offset;
 	int underline_height;
 
-	/* Cache for style-transformed glyphs */
+	/* Cache for style-transformed glyphs, allocated on first lookup */
 	c_glyph *current;
-	c_glyph cache[257]; /* 257 is a prime */
+	c_glyph *cache;
+	uint32_t cache_tick;
 
 	/* We are responsible for closing the font stream */
 	FILE* src;
@@ -489,19 +505,19 @@ static void Flush_Glyph( c_glyph* glyph )
 		glyph->pixmap.buffer = 0;
 	}
 	glyph->cached = 0;
+	glyph->tick = 0;
 }
 
 void TTF_Flush_Cache( TTF_Font* font )
 {
-	int i;
-	int size = sizeof( font->cache ) / sizeof( font->cache[0] );
-
-	for( i = 0; i < size; ++i ) {
-		if( font->cache[i].cached ) {
-			Flush_Glyph( &font->cache[i] );
-		}
+	if (!font->cache)
+		return;
 
+	for (size_t i = 0; i < TTF_CACHE_SETS * TTF_CACHE_WAYS; i++){
+		if (font->cache[i].tick)
+			Flush_Glyph(&font->cache[i]);
 	}
+	font->current = NULL;
 }
 
 static FT_Error Load_Glyph(
@@ -525,8 +541,10 @@ static FT_Error Load_Glyph(
 			cached->index = ch;
 		else
 			cached->index = FT_Get_Char_Index( face, ch );
-		if (0 == cached->index)
+		if (0 == cached->index){
+			cached->stored |= CACHED_MISSING;
 			return -1;
+		}
 	}
 	error = FT_Load_Glyph( face, cached->index,
 		(FT_LOAD_DEFAULT | FT_LOAD_COLOR | FT_LOAD_TARGET_(font->hinting))
@@ -836,13 +854,52 @@ static FT_Error Find_Glyph(
 	TTF_Font* font, uint32_t ch, int want, bool by_ind)
 {
 	int retval = 0;
-	int hsize = sizeof( font->cache ) / sizeof( font->cache[0] );
+	int style = font->style & ~TTF_STYLE_NO_GLYPH_CHANGE;
+
+	if (!font->cache){
+		font->cache = calloc(TTF_CACHE_SETS * TTF_CACHE_WAYS, sizeof(c_glyph));
+		if (!font->cache)
+			return FT_Err_Out_Of_Memory;
+	}
 
-	int h = ch % hsize;
-	font->current = &font->cache[h];
+/* on wrap-around, age everything down so 0 still means 'free' */
+	if (0 == ++font->cache_tick){
+		for (size_t i = 0; i < TTF_CACHE_SETS * TTF_CACHE_WAYS; i++)
+			if (font->cache[i].tick)
+				font->cache[i].tick = 1;
+		font->cache_tick = 2;
+	}
+
+	uint32_t h = ch ^ ((uint32_t)style << 24) ^ ((uint32_t)by_ind << 31);
+	h = (h * 2654435761u) >> 24;
+	c_glyph* set = &font->cache[(h % TTF_CACHE_SETS) * TTF_CACHE_WAYS];
+
+/* find the key or, failing that, the least recently used way to replace */
+	c_glyph* victim = &set[0];
+	font->current = NULL;
+	for (size_t i = 0; i < TTF_CACHE_WAYS; i++){
+		c_glyph* slot = &set[i];
+		if (slot->tick && slot->cached == ch &&
+			slot->style == style && slot->by_ind == by_ind){
+			font->current = slot;
+			break;
+		}
+		if (slot->tick < victim->tick)
+			victim = slot;
+	}
 
-	if (font->current->cached != ch)
-		Flush_Glyph( font->current );
+	if (!font->current){
+		if (victim->tick)
+			Flush_Glyph(victim);
+		victim->cached = ch;
+		victim->style = style;
+		victim->by_ind = by_ind;
+		font->current = victim;
+	}
+	font->current->tick = font->cache_tick;
+
+	if (font->current->stored & CACHED_MISSING)
+		return -1;
 
 	if ( (font->current->stored & want) != want ) {
 		retval = Load_Glyph( font, ch, font->current, want, by_ind );
@@ -867,6 +924,7 @@ void TTF_CloseFont( TTF_Font* font )
 {
 	if ( font ) {
 		TTF_Flush_Cache( font );
+		free( font->cache );
 		if ( font->face ) {
 			FT_Done_Face( font->face );
 		}
@@ -1050,15 +1108,9 @@ int TTF_GlyphMetrics(TTF_Font *font, uint32_t ch,
 
 void TTF_SetFontStyle( TTF_Font* font, int style )
 {
-	int prev_style = font->style;
+/* the glyph-affecting style bits are part of the cache key, so switching
+ * between e.g. bold and regular no longer invalidates anything */
 	font->style = style | font->face_style;
-
-	/* Flush the cache if the style has changed.
-	* Ignore UNDERLINE which does not impact glyph drawning.
-	* */
-	if ( (font->style | TTF_STYLE_NO_GLYPH_CHANGE ) != ( prev_style | TTF_STYLE_NO_GLYPH_CHANGE )) {
-		TTF_Flush_Cache( font );
-	}
 }
 
 _Thread_local static size_t pool_cnt;
@@ -1231,7 +1283,7 @@ int TTF_SizeUNICODEchain(TTF_Font **font, size_t n,
  * and clean rewrite. The 'direct' rendering mode in FreeType comes to
  * mind
  */
-static inline av_pixel pack_pixel_bg(uint8_t fg[4], uint8_t bg[4], uint8_t a)
+static inline PIXEL pack_pixel_bg(uint8_t fg[4], uint8_t bg[4], uint8_t a)
 {
 	if (0 == a)
 		return PACK(bg[0], bg[1], bg[2], bg[3]);
@@ -1249,13 +1301,13 @@ static inline av_pixel pack_pixel_bg(uint8_t fg[4], uint8_t bg[4], uint8_t a)
 	}
 }
 
-static inline av_pixel pack_pixel(uint8_t fg[4], uint8_t a)
+static inline PIXEL pack_pixel(uint8_t fg[4], uint8_t a)
 {
 	uint8_t fa = a > 0;
 	return PACK(fg[0] * fa, fg[1] * fa, fg[2] * fa, a);
 }
 
-static inline av_pixel pack_subpx_bg(uint8_t fg[4], uint8_t bg[4],
+static inline PIXEL pack_subpx_bg(uint8_t fg[4], uint8_t bg[4],
 	uint8_t r, uint8_t g, uint8_t b)
 {
 	uint8_t a = (r + g + b) / 3;
@@ -1274,7 +1326,7 @@ static inline av_pixel pack_subpx_bg(uint8_t fg[4], uint8_t bg[4],
 	return pack_pixel(fg, a);
 }
 
-static inline av_pixel pack_subpx(uint8_t fg[4],
+static inline PIXEL pack_subpx(uint8_t fg[4],
 	uint8_t r, uint8_t g, uint8_t b)
 {
 	uint8_t a = (r + g + b) / 3;
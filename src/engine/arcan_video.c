@@ -32,6 +32,11 @@
 #define ASYNCH_CONCURRENT_THREADS 12
 #endif
 
+/* upper bound (bytes) for decoded images retained after their last user */
+#ifndef ARCAN_IMGCACHE_LIMIT
+#define ARCAN_IMGCACHE_LIMIT (64 * 1024 * 1024)
+#endif
+
 #include PLATFORM_HEADER
 
 #include "arcan_shmif.h"
@@ -59,7 +64,6 @@
 
 long long ARCAN_VIDEO_WORLDID = -1;
 static surface_properties empty_surface();
-static sem_handle asynchsynch;
 
 /* these match arcan_vinterpolant enum */
 static arcan_interp_3d_function lut_interp_3d[] = {
@@ -93,6 +97,7 @@ struct arcan_video_display arcan_video_display = {
 	.imageproc = IMAGEPROC_NORMAL,
 	.mipmap = ARCAN_VIDEO_DEFAULT_MIPMAP_STATE,
 	.dirty = 0,
+	.damage_epoch = 1,
 	.cursor.w = 24,
 	.cursor.h = 16
 };
@@ -119,6 +124,11 @@ unsigned vcontext_ind = 0;
 static bool detach_fromtarget(struct rendertarget* dst, arcan_vobject* src);
 static void attach_object(struct rendertarget* dst, arcan_vobject* src);
 static arcan_errc update_zv(arcan_vobject* vobj, int newzv);
+static void index_drop(struct rendertarget* dst);
+static bool index_sync(struct rendertarget* dst);
+static void sampled_drop(struct rendertarget* dst);
+static void imgcache_release(struct agp_vstore* s);
+static void imgcache_flush_live();
 static void rebase_transform(struct surface_transform*, int64_t);
 static size_t process_rendertarget(struct rendertarget*, float);
 static arcan_vobject* new_vobject(arcan_vobj_id* id,
@@ -126,6 +136,7 @@ struct arcan_video_context* dctx);
 static inline void build_modelview(float* dmatr,
 	float* imatr, surface_properties* prop, arcan_vobject* src);
 static inline void process_readback(struct rendertarget* tgt, float fract);
+static void damage_region(struct rendertarget* tgt, struct rtgt_region r);
 
 static inline void trace(const char* msg, ...)
 {
@@ -151,6 +162,8 @@ void arcan_vint_drop_vstore(struct agp_vstore* s)
 	s->refcount--;
 
 	if (s->refcount == 0){
+		imgcache_release(s);
+
 		if (s->txmapped != TXSTATE_OFF && s->vinf.text.glid){
 			if (s->vinf.text.raw){
 				arcan_mem_free(s->vinf.text.raw);
@@ -185,8 +198,8 @@ struct rendertarget* arcan_vint_findrt_vstore(struct agp_vstore* st)
 		return NULL;
 
 	for (size_t i = 0; i < current_context->n_rtargets && st; i++)
-		if (current_context->rtargets[i].color->vstore == st)
-			return &current_context->rtargets[i];
+		if (current_context->rtargets[i]->color->vstore == st)
+			return current_context->rtargets[i];
 
 	if (current_context->stdoutp.color &&
 		st == current_context->stdoutp.color->vstore)
@@ -196,14 +209,135 @@ struct rendertarget* arcan_vint_findrt_vstore(struct agp_vstore* st)
 
 struct rendertarget* arcan_vint_findrt(arcan_vobject* vobj)
 {
-	for (size_t i = 0; i < current_context->n_rtargets && vobj; i++)
-		if (current_context->rtargets[i].color == vobj)
-			return &current_context->rtargets[i];
+	if (!vobj)
+		return NULL;
 
 	if (vobj == &current_context->world)
 		return &current_context->stdoutp;
 
-	return NULL;
+	return vobj->rtgt;
+}
+
+/*
+ * Stores that have been damaged since the last refresh, one entry per store
+ * (appended on the first damage in an epoch). Just like rendertarget->sampled
+ * the pointers are only compared against, never accessed.
+ */
+static struct {
+	struct agp_vstore** stores;
+	size_t count;
+	size_t limit;
+} damaged;
+
+/*
+ * The order rendertargets are refreshed in, as indices into the context
+ * rtargets, with the ones that feed into others first. Rebuilt whenever the
+ * set of rendertargets or what they sample from changes.
+ */
+static struct {
+	size_t* order;
+	size_t count;
+	size_t limit;
+	bool valid;
+} rtgt_graph;
+
+static void rtgt_dirty_all()
+{
+	for (size_t i = 0; i < current_context->n_rtargets; i++)
+		current_context->rtargets[i]->dirtyc++;
+	current_context->stdoutp.dirtyc++;
+}
+
+void arcan_vint_flagdirty(arcan_vobject* vobj)
+{
+	arcan_video_display.dirty++;
+
+/* the rest is picked up by comparing against the state the object had when
+ * it was last drawn, see collect_damage */
+	if (!vobj){
+		arcan_video_display.full_damage = true;
+		rtgt_dirty_all();
+		return;
+	}
+
+	vobj->dirtyc++;
+	if (vobj->owner)
+		vobj->owner->dirtyc++;
+
+/* an object attached to more than its owner would need a scan through every
+ * pipeline to find the others, just step them all instead. For the color of
+ * a rendertarget, each item attached to it also counts as an attachment */
+	int attachments = vobj->extrefc.attachments;
+	if (FL_TEST(vobj, FL_RTGT)){
+		struct rendertarget* tgt = arcan_vint_findrt(vobj);
+		if (tgt){
+			tgt->dirtyc++;
+			attachments -= 1 + (index_sync(tgt) ? tgt->index.count : 0);
+		}
+	}
+
+	if (attachments > 1)
+		rtgt_dirty_all();
+}
+
+void arcan_vint_storedamage(struct agp_vstore* vs,
+	size_t x1, size_t y1, size_t x2, size_t y2)
+{
+	if (!vs)
+		return;
+
+	arcan_video_display.dirty++;
+
+	if (x2 > vs->w)
+		x2 = vs->w;
+	if (y2 > vs->h)
+		y2 = vs->h;
+	if (x1 >= x2 || y1 >= y2)
+		x1 = y1 = x2 = y2 = 0;
+
+/* first change this refresh, restart the accumulated region and note it so
+ * that the rendertargets that sample from it get stepped */
+	if (vs->damage.epoch != arcan_video_display.damage_epoch){
+		vs->damage.epoch = arcan_video_display.damage_epoch;
+		vs->damage.base = vs->damage.gen;
+
+		if (damaged.count == damaged.limit){
+			size_t limit = damaged.limit ? damaged.limit * 2 : 64;
+			struct agp_vstore** stores = arcan_alloc_mem(limit * sizeof(*stores),
+				ARCAN_MEM_VSTRUCT, ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_NATURAL);
+
+/* without the list we can't know who is affected, so step everyone */
+			if (!stores)
+				rtgt_dirty_all();
+			else {
+				if (damaged.stores)
+					memcpy(stores, damaged.stores, damaged.count * sizeof(*stores));
+				arcan_mem_free(damaged.stores);
+				damaged.stores = stores;
+				damaged.limit = limit;
+			}
+		}
+
+		if (damaged.count < damaged.limit)
+			damaged.stores[damaged.count++] = vs;
+	}
+
+	if (vs->damage.gen == vs->damage.base){
+		vs->damage.x1 = x1;
+		vs->damage.y1 = y1;
+		vs->damage.x2 = x2;
+		vs->damage.y2 = y2;
+	}
+	else if (x2 == 0 || vs->damage.x2 == 0)
+		vs->damage.x2 = 0;
+	else {
+		vs->damage.x1 = x1 < vs->damage.x1 ? x1 : vs->damage.x1;
+		vs->damage.y1 = y1 < vs->damage.y1 ? y1 : vs->damage.y1;
+		vs->damage.x2 = x2 > vs->damage.x2 ? x2 : vs->damage.x2;
+		vs->damage.y2 = y2 > vs->damage.y2 ? y2 : vs->damage.y2;
+	}
+
+	vs->damage.gen++;
 }
 
 static void addchild(arcan_vobject* parent, arcan_vobject* child)
@@ -422,6 +556,7 @@ static void push_transfer_persists(
 		memcpy(dstobj, srcobj, sizeof(arcan_vobject));
 		dst->nalive++; /* fake allocate */
 		dstobj->parent = &dst->world; /* don't cross- reference worlds */
+		dstobj->rtgt = NULL; /* nor rendertargets */
 		attach_object(&dst->stdoutp, dstobj);
 		trace("vcontext_stack_push() : transfer-attach: %s\n", srcobj->tracetag);
 	}
@@ -444,6 +579,7 @@ static void pop_transfer_persists(
 			continue;
 
 		arcan_vobject* parent = dstobj->parent;
+		struct rendertarget* rtgt = dstobj->rtgt;
 
 		detach_fromtarget(srcobj->owner, srcobj);
 		src->nalive--;
@@ -451,6 +587,7 @@ static void pop_transfer_persists(
 		memcpy(dstobj, srcobj, sizeof(arcan_vobject));
 		attach_object(&dst->stdoutp, dstobj);
 		dstobj->parent = parent;
+		dstobj->rtgt = rtgt;
 		memset(srcobj, '\0', sizeof(arcan_vobject));
 	}
 }
@@ -619,6 +756,7 @@ signed arcan_video_pushcontext()
 /* copy everything then manually reset some fields to defaults */
 	memcpy(&vcontext_stack[ ++vcontext_ind ], current_context,
 		sizeof(struct arcan_video_context));
+	imgcache_flush_live();
 	deallocate_gl_context(current_context, false, empty_vobj.vstore);
 
 	current_context = &vcontext_stack[ vcontext_ind ];
@@ -638,7 +776,19 @@ signed arcan_video_pushcontext()
 		ARCAN_MEM_VSTRUCT, ARCAN_MEM_BZERO, ARCAN_MEMALIGN_NATURAL
 	);
 
-	current_context->rtargets[0].first = NULL;
+/* the rendertargets belong to the context that was copied, and reference
+ * objects in its pool */
+	current_context->rtargets = NULL;
+	current_context->n_rtargets = 0;
+	current_context->rtarget_limit = 0;
+	current_context->attachment = NULL;
+
+/* the index storage belongs to the context that was copied */
+	memset(&current_context->stdoutp.index, '\0',
+		sizeof(current_context->stdoutp.index));
+	memset(&current_context->stdoutp.sampled, '\0',
+		sizeof(current_context->stdoutp.sampled));
+	rtgt_graph.valid = false;
 
 /* propagate persistent flagged objects upwards */
 	push_transfer_persists(
@@ -873,7 +1023,17 @@ unsigned arcan_video_popcontext()
 		pop_transfer_persists(
 			current_context, &vcontext_stack[vcontext_ind-1]);
 
+	imgcache_flush_live();
 	deallocate_gl_context(current_context, true, current_context->world.vstore);
+	index_drop(&current_context->stdoutp);
+	sampled_drop(&current_context->stdoutp);
+	rtgt_graph.valid = false;
+
+/* deleting the objects has dropped the rendertargets themselves */
+	arcan_mem_free(current_context->rtargets);
+	current_context->rtargets = NULL;
+	current_context->n_rtargets = 0;
+	current_context->rtarget_limit = 0;
 
 	if (vcontext_ind > 0){
 		vcontext_ind--;
@@ -972,7 +1132,11 @@ arcan_errc arcan_video_resampleobject(arcan_vobj_id vid,
 			return ARCAN_ERRC_OUT_OF_SPACE;
 		}
 
-/* and now swap and the rest of the function should behave as normal */
+/* and now swap and the rest of the function should behave as normal, the
+ * store may be shared through the decode cache so detach it first or the
+ * resize would hit every other object that loaded the same image, and the
+ * rendertarget setup would draw into a copy that never reaches did */
+		arcan_vint_imgcache_unshare(dvobj);
 		if (dvobj->vstore->w != neww || dvobj->vstore->h != newh){
 			agp_resize_vstore(dvobj->vstore, neww, newh);
 		}
@@ -1043,6 +1207,8 @@ arcan_errc arcan_video_mipmapset(arcan_vobj_id vid, bool enable)
 		!vobj->vstore->vinf.text.raw)
 		return ARCAN_ERRC_UNACCEPTED_STATE;
 
+	arcan_vint_imgcache_unshare(vobj);
+
 /*
  * For both disable and enable, we need to recreate the
  * gl_store and possibly remove the old one.
@@ -1196,6 +1362,173 @@ arcan_vobject* arcan_video_getobject(arcan_vobj_id id)
 	return rc;
 }
 
+/*
+ * The order index mirrors the pipeline list, see struct rendertarget. Both
+ * are sorted on order and items with the same order are kept in attachment
+ * sequence, which is what attach_object has always done.
+ */
+static bool index_reserve(struct rendertarget* dst, size_t n)
+{
+	if (n <= dst->index.limit)
+		return true;
+
+	size_t limit = dst->index.limit ? dst->index.limit : 64;
+	while (limit < n)
+		limit *= 2;
+
+	arcan_vobject_litem** items = arcan_alloc_mem(limit * sizeof(*items),
+		ARCAN_MEM_VSTRUCT, ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_NATURAL);
+	if (!items)
+		return false;
+
+	if (dst->index.items){
+		memcpy(items, dst->index.items, dst->index.count * sizeof(*items));
+		arcan_mem_free(dst->index.items);
+	}
+
+	dst->index.items = items;
+	dst->index.limit = limit;
+	return true;
+}
+
+static void index_drop(struct rendertarget* dst)
+{
+	arcan_mem_free(dst->index.items);
+	dst->index.items = NULL;
+	dst->index.count = dst->index.limit = 0;
+	dst->index.valid = false;
+}
+
+static bool index_sync(struct rendertarget* dst)
+{
+	if (dst->index.valid)
+		return true;
+
+	dst->index.count = 0;
+	for (arcan_vobject_litem* cur = dst->first; cur; cur = cur->next){
+		if (!index_reserve(dst, dst->index.count + 1))
+			return false;
+		dst->index.items[dst->index.count++] = cur;
+	}
+
+	dst->index.valid = true;
+	return true;
+}
+
+/* first position with an order larger than [order] */
+static size_t index_upper(struct rendertarget* dst, int order)
+{
+	size_t lo = 0, hi = dst->index.count;
+	while (lo < hi){
+		size_t mid = lo + ((hi - lo) >> 1);
+		if (dst->index.items[mid]->elem->order <= order)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* position of the item for [src] or -1, only the run of items with the same
+ * order needs to be searched */
+static ssize_t index_find(struct rendertarget* dst, arcan_vobject* src)
+{
+	size_t lo = 0, hi = dst->index.count;
+	while (lo < hi){
+		size_t mid = lo + ((hi - lo) >> 1);
+		if (dst->index.items[mid]->elem->order < src->order)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (; lo < dst->index.count &&
+		dst->index.items[lo]->elem->order == src->order; lo++)
+		if (dst->index.items[lo]->elem == src)
+			return lo;
+
+/* the order of an object is only updated in the pipeline of its owner, so
+ * in any other rendertarget it is attached to, it can be out of place */
+	for (size_t i = 0; i < dst->index.count; i++)
+		if (dst->index.items[i]->elem == src)
+			return i;
+
+	return -1;
+}
+
+static void sampled_drop(struct rendertarget* dst)
+{
+	arcan_mem_free(dst->sampled.stores);
+	dst->sampled.stores = NULL;
+	dst->sampled.count = dst->sampled.limit = 0;
+}
+
+static bool sampled_find(struct rendertarget* dst, struct agp_vstore* vs)
+{
+	size_t lo = 0, hi = dst->sampled.count;
+	while (lo < hi){
+		size_t mid = lo + ((hi - lo) >> 1);
+		if (dst->sampled.stores[mid] == vs)
+			return true;
+		if ((uintptr_t) dst->sampled.stores[mid] < (uintptr_t) vs)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return false;
+}
+
+/* number of stores damaged since the last refresh that [dst] samples from */
+static size_t sampled_damage(struct rendertarget* dst)
+{
+	size_t res = 0;
+	if (!dst->sampled.count)
+		return 0;
+
+	for (size_t i = 0; i < damaged.count; i++)
+		res += sampled_find(dst, damaged.stores[i]);
+
+	return res;
+}
+
+/* step dirtyc with the changes that don't reach it through FLAG_DIRTY */
+static void rtgt_pending(struct rendertarget* dst)
+{
+	if (FL_TEST(dst, TGTFL_UNTRACKED) && arcan_video_display.dirty)
+		dst->dirtyc++;
+
+	dst->dirtyc += sampled_damage(dst);
+}
+
+/*
+ * Change the order of an object without detaching / reattaching it, this is
+ * possible when the new order would put it in the same place anyhow.
+ */
+static bool slide_order(struct rendertarget* dst, arcan_vobject* src, int order)
+{
+	while (dst->link)
+		dst = dst->link;
+
+	if (!index_sync(dst))
+		return false;
+
+	ssize_t pos = index_find(dst, src);
+	if (-1 == pos)
+		return false;
+
+	arcan_vobject_litem* prev = pos > 0 ? dst->index.items[pos-1] : NULL;
+	arcan_vobject_litem* next =
+		pos + 1 < dst->index.count ? dst->index.items[pos+1] : NULL;
+
+	if ((prev && prev->elem->order > order) ||
+		(next && next->elem->order <= order))
+		return false;
+
+	src->order = order;
+	FLAG_DIRTY(src);
+	return true;
+}
+
 static bool detach_fromtarget(struct rendertarget* dst, arcan_vobject* src)
 {
 	arcan_vobject_litem* torem;
@@ -1222,15 +1555,28 @@ static bool detach_fromtarget(struct rendertarget* dst, arcan_vobject* src)
 		dst->camtag = ARCAN_EID;
 
 /* find it */
-	torem = dst->first;
-	while(torem){
-		if (torem->elem == src)
-			break;
+	ssize_t pos = -1;
+	if (index_sync(dst)){
+		pos = index_find(dst, src);
+		if (-1 == pos)
+			return false;
 
-		torem = torem->next;
+		torem = dst->index.items[pos];
+		memmove(&dst->index.items[pos], &dst->index.items[pos+1],
+			(dst->index.count - pos - 1) * sizeof(arcan_vobject_litem*));
+		dst->index.count--;
+	}
+	else {
+		torem = dst->first;
+		while(torem){
+			if (torem->elem == src)
+				break;
+
+			torem = torem->next;
+		}
+		if (!torem)
+			return false;
 	}
-	if (!torem)
-		return false;
 
 /* (1.) remove first */
 	if (dst->first == torem){
@@ -1252,7 +1598,13 @@ static bool detach_fromtarget(struct rendertarget* dst, arcan_vobject* src)
 		torem->previous->next = torem->next;
 	}
 
-/* (4.) mark as something easy to find in dumps */
+/* (4.) the area the object last covered needs to be redrawn, and as src
+ * might not be owned by dst, FLAG_DIRTY won't necessarily reach it */
+	if (torem->damage.valid && torem->damage.visible)
+		damage_region(dst, torem->damage.region);
+	dst->dirtyc++;
+
+/* (5.) mark as something easy to find in dumps */
 	torem->elem = (arcan_vobject*) 0xfeedface;
 
 /* cleanup torem */
@@ -1280,7 +1632,7 @@ static bool detach_fromtarget(struct rendertarget* dst, arcan_vobject* src)
 		src->cellid, video_tracetag(src), src->extrefc.attachments);
 	}
 
-	FLAG_DIRTY(NULL);
+	FLAG_DIRTY(src);
 	return true;
 }
 
@@ -1320,9 +1672,10 @@ static void attach_object(struct rendertarget* dst, arcan_vobject* src)
 	if (dst->link)
 		return attach_object(dst->link, src);
 
+/* zeroed so that damage tracking treats it as never drawn */
 	arcan_vobject_litem* new_litem =
 		arcan_alloc_mem(sizeof *new_litem,
-			ARCAN_MEM_VSTRUCT, 0, ARCAN_MEMALIGN_NATURAL);
+			ARCAN_MEM_VSTRUCT, ARCAN_MEM_BZERO, ARCAN_MEMALIGN_NATURAL);
 
 	new_litem->next = new_litem->previous = NULL;
 	new_litem->elem = src;
@@ -1332,6 +1685,31 @@ static void attach_object(struct rendertarget* dst, arcan_vobject* src)
 		src->owner = dst;
 	}
 
+/* 1. with the index, the insertion point is after the last item with an
+ * order that is <= the new one, and the rest is plain list insertion */
+	bool indexed = index_sync(dst) && index_reserve(dst, dst->index.count + 1);
+	if (!indexed)
+		dst->index.valid = false;
+
+	if (indexed){
+		size_t pos = index_upper(dst, src->order);
+		arcan_vobject_litem* prev = pos ? dst->index.items[pos-1] : NULL;
+
+		memmove(&dst->index.items[pos+1], &dst->index.items[pos],
+			(dst->index.count - pos) * sizeof(arcan_vobject_litem*));
+		dst->index.items[pos] = new_litem;
+		dst->index.count++;
+
+		new_litem->previous = prev;
+		new_litem->next = prev ? prev->next : dst->first;
+		if (new_litem->next)
+			new_litem->next->previous = new_litem;
+		if (prev)
+			prev->next = new_litem;
+		else
+			dst->first = new_litem;
+	}
+	else
 /* 2. insert first into empty? */
 	if (!dst->first)
 		dst->first = new_litem;
@@ -1368,6 +1746,7 @@ static void attach_object(struct rendertarget* dst, arcan_vobject* src)
 	}
 
 	FLAG_DIRTY(src);
+	dst->dirtyc++;
 	if (dst->color){
 		src->extrefc.attachments++;
 		dst->color->extrefc.attachments++;
@@ -1581,10 +1960,6 @@ arcan_errc arcan_video_init(uint16_t width, uint16_t height, uint8_t bpp,
 
 /* might be called multiple times due to longjmp recover etc. */
 	if (firstinit){
-		if (-1 == arcan_sem_init(&asynchsynch, ASYNCH_CONCURRENT_THREADS)){
-			arcan_warning("video_init couldn't create synchronization handle\n");
-		}
-
 		arcan_vint_defaultmapping(arcan_video_display.default_txcos, 1.0, 1.0);
 		arcan_vint_defaultmapping(arcan_video_display.cursor_txcos, 1.0, 1.0);
 		arcan_vint_mirrormapping(arcan_video_display.mirror_txcos, 1.0, 1.0);
@@ -1646,6 +2021,11 @@ arcan_errc arcan_video_resize_canvas(size_t neww, size_t newh)
 				| RENDERTARGET_DOUBLEBUFFER
 #endif
 			);
+/* the buffers are swapped after each frame, so what was drawn before is
+ * not the current contents and partial updates can't be used */
+#ifdef ARCAN_LWA
+			FL_SET(&current_context->stdoutp, TGTFL_NODAMAGE);
+#endif
 		}
 		else
 			agp_resize_rendertarget(current_context->stdoutp.art, neww, newh);
@@ -1666,6 +2046,305 @@ arcan_errc arcan_video_resize_canvas(size_t neww, size_t newh)
 	return ARCAN_OK;
 }
 
+/*
+ * Decoded image cache - themes tend to load the same icons and atlases over
+ * and over. Entries are keyed on the resolved path, the file identity
+ * (device, inode, size, mtime) and everything that affects the decoded
+ * result (forced dimensions, scale, imageproc) or the store (filter and
+ * texture modes). While some object still uses the store, a hit just shares
+ * it. When the last user goes away, the raw buffer is moved to a bounded LRU
+ * so that a reload only costs the upload. Stores that are modified through
+ * arcan_vint_imgcache_unshare are dropped from the cache.
+ */
+#define IMGCACHE_BUCKETS 256
+
+struct imgcache_key {
+	char* path;
+	uint64_t hash;
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
+	size_t w, h;
+	uint8_t scale, imageproc, filtermode, txu, txv;
+};
+
+struct imgcache_ent {
+	struct imgcache_key key;
+	uint16_t origw, origh;
+
+/* set while the store is alive, otherwise the pixels live in raw */
+	struct agp_vstore* store;
+	av_pixel* raw;
+	size_t s_raw, w, h;
+
+	struct imgcache_ent* next;
+	struct imgcache_ent* lru_prev;
+	struct imgcache_ent* lru_next;
+};
+
+static struct {
+	struct imgcache_ent* buckets[IMGCACHE_BUCKETS];
+	struct imgcache_ent* lru_first;
+	struct imgcache_ent* lru_last;
+	size_t lru_sz;
+} imgcache;
+
+static uint64_t imgcache_fnv(uint64_t hash, const void* buf, size_t nb)
+{
+	const uint8_t* data = buf;
+	for (size_t i = 0; i < nb; i++){
+		hash ^= data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static bool imgcache_mkkey(const char* fname,
+	img_cons forced, struct agp_vstore* vs, struct imgcache_key* key)
+{
+	struct stat fs;
+	*key = (struct imgcache_key){
+		.w = forced.w,
+		.h = forced.h,
+		.scale = vs->scale,
+		.imageproc = vs->imageproc,
+		.filtermode = vs->filtermode,
+		.txu = vs->txu,
+		.txv = vs->txv
+	};
+
+	if (!fname || vs->txmapped != TXSTATE_TEX2D)
+		return false;
+
+	key->path = realpath(fname, NULL);
+	if (!key->path)
+		return false;
+
+	if (-1 == stat(key->path, &fs) || !S_ISREG(fs.st_mode)){
+		free(key->path);
+		key->path = NULL;
+		return false;
+	}
+
+	key->dev = fs.st_dev;
+	key->ino = fs.st_ino;
+	key->size = fs.st_size;
+	key->mtime = fs.st_mtime;
+
+	uint64_t hash = imgcache_fnv(0xcbf29ce484222325ULL,
+		key->path, strlen(key->path));
+	hash = imgcache_fnv(hash, &key->ino, sizeof(key->ino));
+	hash = imgcache_fnv(hash, &key->mtime, sizeof(key->mtime));
+	hash = imgcache_fnv(hash, &key->w, sizeof(key->w));
+	hash = imgcache_fnv(hash, &key->h, sizeof(key->h));
+	uint8_t opts[] = {key->scale,
+		key->imageproc, key->filtermode, key->txu, key->txv};
+	key->hash = imgcache_fnv(hash, opts, sizeof(opts));
+
+	return true;
+}
+
+static bool imgcache_keyeq(struct imgcache_key* a, struct imgcache_key* b)
+{
+	return a->hash == b->hash && a->dev == b->dev && a->ino == b->ino &&
+		a->size == b->size && a->mtime == b->mtime &&
+		a->w == b->w && a->h == b->h && a->scale == b->scale &&
+		a->imageproc == b->imageproc && a->filtermode == b->filtermode &&
+		a->txu == b->txu && a->txv == b->txv &&
+		strcmp(a->path, b->path) == 0;
+}
+
+static void imgcache_lru_unlink(struct imgcache_ent* ent)
+{
+	if (ent->lru_prev)
+		ent->lru_prev->lru_next = ent->lru_next;
+	else
+		imgcache.lru_first = ent->lru_next;
+
+	if (ent->lru_next)
+		ent->lru_next->lru_prev = ent->lru_prev;
+	else
+		imgcache.lru_last = ent->lru_prev;
+
+	ent->lru_prev = ent->lru_next = NULL;
+	imgcache.lru_sz -= ent->s_raw;
+}
+
+static void imgcache_remove(struct imgcache_ent* ent)
+{
+	struct imgcache_ent** cur = &imgcache.buckets[ent->key.hash % IMGCACHE_BUCKETS];
+	while (*cur != ent)
+		cur = &(*cur)->next;
+	*cur = ent->next;
+
+	if (ent->store)
+		ent->store->cache = NULL;
+	else {
+		imgcache_lru_unlink(ent);
+		arcan_mem_free(ent->raw);
+	}
+
+	free(ent->key.path);
+	arcan_mem_free(ent);
+}
+
+/* the last user of a cached store is gone, hold on to the pixels if there
+ * is room for them, oldest entries go first */
+static void imgcache_release(struct agp_vstore* s)
+{
+	struct imgcache_ent* ent = s->cache;
+	if (!ent)
+		return;
+
+	if (!s->vinf.text.raw || s->vinf.text.s_raw > ARCAN_IMGCACHE_LIMIT){
+		imgcache_remove(ent);
+		return;
+	}
+
+	ent->store = NULL;
+	s->cache = NULL;
+	ent->raw = s->vinf.text.raw;
+	ent->s_raw = s->vinf.text.s_raw;
+	ent->w = s->w;
+	ent->h = s->h;
+	s->vinf.text.raw = NULL;
+	s->vinf.text.s_raw = 0;
+
+	ent->lru_prev = imgcache.lru_last;
+	if (imgcache.lru_last)
+		imgcache.lru_last->lru_next = ent;
+	else
+		imgcache.lru_first = ent;
+	imgcache.lru_last = ent;
+	imgcache.lru_sz += ent->s_raw;
+
+	while (imgcache.lru_sz > ARCAN_IMGCACHE_LIMIT)
+		imgcache_remove(imgcache.lru_first);
+}
+
+/* on hit, [dst] gets the cached store (or a new one built from the retained
+ * pixels) and the key is consumed */
+static bool imgcache_lookup(arcan_vobject* dst, struct imgcache_key* key)
+{
+	struct imgcache_ent* ent = imgcache.buckets[key->hash % IMGCACHE_BUCKETS];
+	while (ent && !imgcache_keyeq(&ent->key, key))
+		ent = ent->next;
+
+	if (!ent)
+		return false;
+
+	if (ent->store){
+		arcan_vint_drop_vstore(dst->vstore);
+		dst->vstore = ent->store;
+		dst->vstore->refcount++;
+	}
+	else {
+		struct agp_vstore* vs = dst->vstore;
+		imgcache_lru_unlink(ent);
+		vs->vinf.text.raw = ent->raw;
+		vs->vinf.text.s_raw = ent->s_raw;
+		vs->vinf.text.source = strdup(ent->key.path);
+		vs->w = ent->w;
+		vs->h = ent->h;
+		ent->raw = NULL;
+		ent->store = vs;
+		vs->cache = ent;
+		agp_update_vstore(vs, true);
+	}
+
+	dst->origw = ent->origw;
+	dst->origh = ent->origh;
+	free(key->path);
+	key->path = NULL;
+
+	return true;
+}
+
+/* register the freshly decoded store in [src], consumes the key */
+static void imgcache_insert(arcan_vobject* src, struct imgcache_key* key)
+{
+	struct imgcache_ent* ent = NULL;
+	if (src->vstore->cache || src->vstore->refcount != 1 ||
+		!(ent = arcan_alloc_mem(sizeof(struct imgcache_ent),
+		ARCAN_MEM_VSTRUCT, ARCAN_MEM_NONFATAL | ARCAN_MEM_BZERO,
+		ARCAN_MEMALIGN_NATURAL))){
+		free(key->path);
+		key->path = NULL;
+		return;
+	}
+
+	ent->key = *key;
+	key->path = NULL;
+	ent->origw = src->origw;
+	ent->origh = src->origh;
+	ent->store = src->vstore;
+	src->vstore->cache = ent;
+
+	size_t ind = ent->key.hash % IMGCACHE_BUCKETS;
+	ent->next = imgcache.buckets[ind];
+	imgcache.buckets[ind] = ent;
+}
+
+/* live stores are tied to the context that owns the objects, on push/pop
+ * they are about to be dropped or rebuilt so stop handing them out */
+static void imgcache_flush_live()
+{
+	for (size_t i = 0; i < IMGCACHE_BUCKETS; i++){
+		struct imgcache_ent* ent = imgcache.buckets[i];
+		while (ent){
+			struct imgcache_ent* next = ent->next;
+			if (ent->store)
+				imgcache_remove(ent);
+			ent = next;
+		}
+	}
+}
+
+void arcan_vint_imgcache_unshare(arcan_vobject* vobj)
+{
+	struct agp_vstore* old = vobj->vstore;
+	if (!old->cache)
+		return;
+
+	imgcache_remove(old->cache);
+	if (old->refcount == 1 || !old->vinf.text.raw)
+		return;
+
+	struct agp_vstore* vs = arcan_alloc_mem(sizeof(struct agp_vstore),
+		ARCAN_MEM_VSTRUCT, ARCAN_MEM_NONFATAL | ARCAN_MEM_BZERO,
+		ARCAN_MEMALIGN_NATURAL);
+	if (!vs)
+		return;
+
+	vs->vinf.text.raw = arcan_alloc_fillmem(old->vinf.text.raw,
+		old->vinf.text.s_raw, ARCAN_MEM_VBUFFER,
+		ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_PAGE);
+	if (!vs->vinf.text.raw){
+		arcan_mem_free(vs);
+		return;
+	}
+
+	vs->refcount = 1;
+	vs->vinf.text.s_raw = old->vinf.text.s_raw;
+	vs->vinf.text.source =
+		old->vinf.text.source ? strdup(old->vinf.text.source) : NULL;
+	vs->w = old->w;
+	vs->h = old->h;
+	vs->bpp = old->bpp;
+	vs->txmapped = old->txmapped;
+	vs->txu = old->txu;
+	vs->txv = old->txv;
+	vs->scale = old->scale;
+	vs->imageproc = old->imageproc;
+	vs->filtermode = old->filtermode;
+	agp_update_vstore(vs, true);
+
+	arcan_vint_drop_vstore(old);
+	vobj->vstore = vs;
+	FLAG_DIRTY(vobj);
+}
+
 static uint16_t nexthigher(uint16_t k)
 {
 	k--;
@@ -1677,26 +2356,18 @@ static uint16_t nexthigher(uint16_t k)
 arcan_errc arcan_vint_getimage(const char* fname, arcan_vobject* dst,
 	img_cons forced, bool asynchsrc)
 {
-/*
- * with asynchsynch, it's likely that we get a storm of requests and we'd
- * likely suffer thrashing, so limit this.  also, look into using
- * pthread_setschedparam and switch to pthreads exclusively
- */
-	arcan_sem_wait(asynchsynch);
-
+/* the number of concurrent calls is bounded by the size of the loader pool,
+ * see loadpool_enqueue */
 	size_t inw, inh;
 
 /* try- open */
 	data_source inres = arcan_open_resource(fname);
-	if (inres.fd == BADFD){
-		arcan_sem_post(asynchsynch);
+	if (inres.fd == BADFD)
 		return ARCAN_ERRC_BAD_RESOURCE;
-	}
 
 /* mmap (preferred) or buffer (mmap not working / useful due to alignment) */
 	map_region inmem = arcan_map_resource(&inres, false);
 	if (inmem.ptr == NULL){
-		arcan_sem_post(asynchsynch);
 		arcan_release_resource(&inres);
 		return ARCAN_ERRC_BAD_RESOURCE;
 	}
@@ -1713,12 +2384,9 @@ arcan_errc arcan_vint_getimage(const char* fname, arcan_vobject* dst,
 	if (ARCAN_OK != rv)
 		goto done;
 
-	av_pixel* imgbuf = arcan_img_repack(ch_imgbuf, inw, inh);
-	if (!imgbuf){
-		rv = ARCAN_ERRC_OUT_OF_SPACE;
-		goto done;
-	}
-
+/* the decoder allocates its output as page aligned VBUFFER memory, so unless
+ * we need to rescale, that buffer is used as the store as is */
+	av_pixel* imgbuf = (av_pixel*) ch_imgbuf;
 	uint16_t neww, newh;
 
 /* store this so we can maintain aspect ratios etc. while still
@@ -1761,14 +2429,37 @@ arcan_errc arcan_vint_getimage(const char* fname, arcan_vobject* dst,
 		dstframe->vinf.text.raw = arcan_alloc_mem(dstframe->vinf.text.s_raw,
 			ARCAN_MEM_VBUFFER, 0, ARCAN_MEMALIGN_PAGE);
 
+/* the scaler doesn't care about channel order, so convert whichever of the
+ * two buffers is the smaller one */
+		bool convert_src = (size_t) inw * inh <= (size_t) neww * newh;
+		if (convert_src && !(imgbuf = arcan_img_repack(ch_imgbuf, inw, inh))){
+			arcan_mem_free(dstframe->vinf.text.raw);
+			dstframe->vinf.text.raw = NULL;
+			dstframe->vinf.text.s_raw = 0;
+			rv = ARCAN_ERRC_OUT_OF_SPACE;
+			goto done;
+		}
+
 		arcan_renderfun_stretchblit((char*)imgbuf, inw, inh,
 			(uint32_t*) dstframe->vinf.text.raw,
 			neww, newh, dst->vstore->imageproc == IMAGEPROC_FLIPH);
 		arcan_mem_free(imgbuf);
+
+/* repack releases its input buffer on failure */
+		if (!convert_src && !(dstframe->vinf.text.raw = arcan_img_repack(
+			(uint32_t*) dstframe->vinf.text.raw, neww, newh))){
+			dstframe->vinf.text.s_raw = 0;
+			rv = ARCAN_ERRC_OUT_OF_SPACE;
+			goto done;
+		}
 	}
 	else {
 		neww = inw;
 		newh = inh;
+		if (!(imgbuf = arcan_img_repack(ch_imgbuf, inw, inh))){
+			rv = ARCAN_ERRC_OUT_OF_SPACE;
+			goto done;
+		}
 		dstframe->vinf.text.raw = imgbuf;
 		dstframe->vinf.text.s_raw = inw * inh * sizeof(av_pixel);
 	}
@@ -1785,7 +2476,6 @@ push_comp:
 		agp_update_vstore(dst->vstore, true);
 
 done:
-	arcan_sem_post(asynchsynch);
 	return rv;
 }
 
@@ -2028,7 +2718,8 @@ arcan_errc arcan_video_rendertargetdensity(
 		cent = cent->next;
 	}
 
-	FLAG_DIRTY(rtgt);
+	rtgt->damage.full = true;
+	FLAG_DIRTY(rtgt->color);
 	return ARCAN_OK;
 }
 
@@ -2045,11 +2736,8 @@ arcan_errc arcan_video_detachfromrendertarget(arcan_vobj_id did,
 		return ARCAN_OK;
 	}
 
-	for (size_t ind = 0; ind < current_context->n_rtargets; ind++){
-		if (current_context->rtargets[ind].color == dstobj &&
-			srcobj->owner != &current_context->rtargets[ind])
-				detach_fromtarget(&current_context->rtargets[ind], srcobj);
-	}
+	if (dstobj->rtgt && srcobj->owner != dstobj->rtgt)
+		detach_fromtarget(dstobj->rtgt, srcobj);
 
 	return ARCAN_OK;
 }
@@ -2087,19 +2775,17 @@ arcan_errc arcan_video_attachtorendertarget(arcan_vobj_id did,
 		return ARCAN_OK;
 	}
 
-/* linear search for rendertarget matching the destination id */
-	for (size_t ind = 0; ind < current_context->n_rtargets; ind++){
-		if (current_context->rtargets[ind].color == dstobj){
+	struct rendertarget* rtgt = dstobj->rtgt;
+	if (rtgt){
 /* find whatever rendertarget we're already attached to, and detach */
-			if (srcobj->owner && detach)
-				detach_fromtarget(srcobj->owner, srcobj);
+		if (srcobj->owner && detach)
+			detach_fromtarget(srcobj->owner, srcobj);
 
 /* try and detach (most likely fail) to make sure that we don't get duplicates*/
-			detach_fromtarget(&current_context->rtargets[ind], srcobj);
-			attach_object(&current_context->rtargets[ind], srcobj);
+		detach_fromtarget(rtgt, srcobj);
+		attach_object(rtgt, srcobj);
 
-			return ARCAN_OK;
-		}
+		return ARCAN_OK;
 	}
 
 	return ARCAN_ERRC_BAD_ARGUMENT;
@@ -2242,15 +2928,36 @@ arcan_errc arcan_video_setuprendertarget(arcan_vobj_id did,
 		return rv;
 	}
 
-/* hard-coded number of render-targets allowed */
-	if (current_context->n_rtargets >= RENDERTARGET_LIMIT)
-		return ARCAN_ERRC_OUT_OF_SPACE;
+	arcan_vint_imgcache_unshare(vobj);
 
-	int ind = current_context->n_rtargets++;
-	struct rendertarget* dst = &current_context->rtargets[ ind ];
-	*dst = (struct rendertarget){};
+	if (current_context->n_rtargets == current_context->rtarget_limit){
+		size_t limit = current_context->rtarget_limit ?
+			current_context->rtarget_limit * 2 : 16;
+		struct rendertarget** rtargets = arcan_alloc_mem(
+			limit * sizeof(struct rendertarget*),
+			ARCAN_MEM_VSTRUCT, ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_NATURAL);
+		if (!rtargets)
+			return ARCAN_ERRC_OUT_OF_SPACE;
 
-	FL_SET(vobj, FL_RTGT);
+		if (current_context->rtargets){
+			memcpy(rtargets, current_context->rtargets,
+				current_context->n_rtargets * sizeof(struct rendertarget*));
+			arcan_mem_free(current_context->rtargets);
+		}
+		current_context->rtargets = rtargets;
+		current_context->rtarget_limit = limit;
+	}
+
+	struct rendertarget* dst = arcan_alloc_mem(sizeof(struct rendertarget),
+		ARCAN_MEM_VSTRUCT, ARCAN_MEM_NONFATAL | ARCAN_MEM_BZERO,
+		ARCAN_MEMALIGN_SIMD);
+	if (!dst)
+		return ARCAN_ERRC_OUT_OF_SPACE;
+
+	current_context->rtargets[current_context->n_rtargets++] = dst;
+
+	FL_SET(vobj, FL_RTGT);
+	vobj->rtgt = dst;
 	FL_SET(dst, TGTFL_ALIVE);
 	dst->color = vobj;
 	dst->camtag = ARCAN_EID;
@@ -2263,6 +2970,9 @@ arcan_errc arcan_video_setuprendertarget(arcan_vobj_id did,
 	dst->vppcm = dst->hppcm = 28.346456692913385;
 	dst->min_order = 0;
 	dst->max_order = 65536;
+	dst->dirtyc = 1;
+	dst->damage.full = true;
+	rtgt_graph.valid = false;
 
 	static int rendertarget_id;
 	rendertarget_id = (rendertarget_id + 1) % (INT_MAX-1);
@@ -2340,35 +3050,286 @@ arcan_errc arcan_video_setasframe(arcan_vobj_id dst,
 	return ARCAN_OK;
 }
 
+/*
+ * Asynchronous image loads are serviced by a fixed pool of workers (one per
+ * core, at most ASYNCH_CONCURRENT_THREADS) that take jobs from a shared queue,
+ * ordered so that objects that are visible go first and then on submission.
+ * The workers decode into a job- local vobj/store rather than the destination,
+ * so the job can be dropped when the object is deleted without waiting for it,
+ * and the results are moved over on the main thread in arcan_vint_joinasynch.
+ */
+enum asynch_state {
+	ASYNCH_QUEUED,
+	ASYNCH_RUNNING,
+	ASYNCH_DONE,
+	ASYNCH_CANCELLED
+};
+
 struct thread_loader_args {
 	arcan_vobject* dst;
-	pthread_t self;
 	arcan_vobj_id dstid;
 	char* fname;
 	intptr_t tag;
 	img_cons constraints;
 	arcan_errc rc;
+
+/* decode target, origw/origh and the raw buffer are taken on join */
+	arcan_vobject shadow;
+	struct agp_vstore store;
+
+/* cache identity for registering the result, cached is set if the store was
+ * shared from the image cache and there is nothing to decode */
+	struct imgcache_key key;
+	bool keyed, cached;
+
+/* queue position and ordering, protected by the loadpool lock */
+	enum asynch_state state;
+	bool visible;
+	uint64_t seq;
+	size_t heap_ind;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+
+	struct thread_loader_args** heap;
+	size_t count;
+	size_t limit;
+
+	uint64_t seq;
+	size_t n_workers;
+} loadpool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.work = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER
 };
 
+static bool loadpool_before(
+	struct thread_loader_args* a, struct thread_loader_args* b)
+{
+	if (a->visible != b->visible)
+		return a->visible;
+	return a->seq < b->seq;
+}
+
+static void loadpool_swap(size_t a, size_t b)
+{
+	struct thread_loader_args* tmp = loadpool.heap[a];
+	loadpool.heap[a] = loadpool.heap[b];
+	loadpool.heap[b] = tmp;
+	loadpool.heap[a]->heap_ind = a;
+	loadpool.heap[b]->heap_ind = b;
+}
+
+static void loadpool_up(size_t i)
+{
+	while (i > 0){
+		size_t parent = (i - 1) >> 1;
+		if (!loadpool_before(loadpool.heap[i], loadpool.heap[parent]))
+			break;
+		loadpool_swap(i, parent);
+		i = parent;
+	}
+}
+
+static void loadpool_down(size_t i)
+{
+	for (;;){
+		size_t best = i;
+		size_t l = 2 * i + 1;
+		size_t r = l + 1;
+
+		if (l < loadpool.count &&
+			loadpool_before(loadpool.heap[l], loadpool.heap[best]))
+			best = l;
+		if (r < loadpool.count &&
+			loadpool_before(loadpool.heap[r], loadpool.heap[best]))
+			best = r;
+		if (best == i)
+			break;
+
+		loadpool_swap(i, best);
+		i = best;
+	}
+}
+
+static void loadpool_remove(struct thread_loader_args* job)
+{
+	size_t i = job->heap_ind;
+	loadpool.count--;
+	if (i != loadpool.count){
+		loadpool.heap[i] = loadpool.heap[loadpool.count];
+		loadpool.heap[i]->heap_ind = i;
+		loadpool_up(i);
+		loadpool_down(loadpool.heap[i]->heap_ind);
+	}
+}
+
+static void loadpool_free(struct thread_loader_args* job)
+{
+	arcan_mem_free(job->store.vinf.text.raw);
+	arcan_mem_free(job->store.vinf.text.source);
+	arcan_mem_free(job->fname);
+	free(job->key.path);
+	arcan_mem_free(job);
+}
+
 static void* thread_loader(void* in)
 {
-	struct thread_loader_args* largs = (struct thread_loader_args*) in;
-	arcan_vobject* dst = largs->dst;
-	largs->rc = arcan_vint_getimage(largs->fname, dst, largs->constraints, true);
-	dst->feed.state.tag = ARCAN_TAG_ASYNCIMGRD;
-	return 0;
+	pthread_mutex_lock(&loadpool.lock);
+
+	for(;;){
+		while (!loadpool.count)
+			pthread_cond_wait(&loadpool.work, &loadpool.lock);
+
+		struct thread_loader_args* job = loadpool.heap[0];
+		loadpool_remove(job);
+		job->state = ASYNCH_RUNNING;
+		pthread_mutex_unlock(&loadpool.lock);
+
+		arcan_errc rc = arcan_vint_getimage(
+			job->fname, &job->shadow, job->constraints, true);
+
+		pthread_mutex_lock(&loadpool.lock);
+		job->rc = rc;
+
+/* the object died while we were busy, nobody left to collect */
+		if (job->state == ASYNCH_CANCELLED){
+			loadpool_free(job);
+			continue;
+		}
+
+		job->state = ASYNCH_DONE;
+		job->dst->feed.state.tag = ARCAN_TAG_ASYNCIMGRD;
+		pthread_cond_broadcast(&loadpool.done);
+	}
+
+	return NULL;
 }
 
-void arcan_vint_joinasynch(arcan_vobject* img, bool emit, bool force)
+static bool loadpool_enqueue(struct thread_loader_args* job)
 {
-	if (!force && img->feed.state.tag != ARCAN_TAG_ASYNCIMGRD){
+	pthread_mutex_lock(&loadpool.lock);
+
+	if (!loadpool.n_workers){
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		size_t nw = ncpu > 0 ? ncpu : 1;
+		if (nw > ASYNCH_CONCURRENT_THREADS)
+			nw = ASYNCH_CONCURRENT_THREADS;
+
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+		for (size_t i = 0; i < nw; i++){
+			pthread_t pth;
+			if (0 == pthread_create(&pth, &attr, thread_loader, NULL))
+				loadpool.n_workers++;
+		}
+		pthread_attr_destroy(&attr);
+
+		if (!loadpool.n_workers){
+			pthread_mutex_unlock(&loadpool.lock);
+			return false;
+		}
+	}
+
+	if (loadpool.count == loadpool.limit){
+		size_t limit = loadpool.limit ? loadpool.limit * 2 : 64;
+		struct thread_loader_args** heap = arcan_alloc_mem(
+			limit * sizeof(struct thread_loader_args*),
+			ARCAN_MEM_THREADCTX, ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_NATURAL);
+
+		if (!heap){
+			pthread_mutex_unlock(&loadpool.lock);
+			return false;
+		}
+
+		if (loadpool.heap){
+			memcpy(heap, loadpool.heap,
+				loadpool.count * sizeof(struct thread_loader_args*));
+			arcan_mem_free(loadpool.heap);
+		}
+		loadpool.heap = heap;
+		loadpool.limit = limit;
+	}
+
+	job->state = ASYNCH_QUEUED;
+	job->seq = loadpool.seq++;
+	job->heap_ind = loadpool.count;
+	loadpool.heap[loadpool.count++] = job;
+	loadpool_up(job->heap_ind);
+
+	pthread_cond_signal(&loadpool.work);
+	pthread_mutex_unlock(&loadpool.lock);
+	return true;
+}
+
+/* the object has become visible while its job is still waiting, move it
+ * ahead of those that aren't */
+static void loadpool_prioritize(struct thread_loader_args* job)
+{
+	pthread_mutex_lock(&loadpool.lock);
+	job->visible = true;
+	if (job->state == ASYNCH_QUEUED)
+		loadpool_up(job->heap_ind);
+	pthread_mutex_unlock(&loadpool.lock);
+}
+
+/* drop the job for an object that is going away, without waiting for it */
+static void loadpool_cancel(arcan_vobject* vobj)
+{
+	struct thread_loader_args* job = vobj->feed.state.ptr;
+	if (!job)
 		return;
+
+	pthread_mutex_lock(&loadpool.lock);
+	if (job->state == ASYNCH_RUNNING)
+		job->state = ASYNCH_CANCELLED;
+	else {
+		if (job->state == ASYNCH_QUEUED)
+			loadpool_remove(job);
+		loadpool_free(job);
 	}
+	pthread_mutex_unlock(&loadpool.lock);
+
+	vobj->feed.state.ptr = NULL;
+	vobj->feed.state.tag = ARCAN_TAG_NONE;
+}
 
+void arcan_vint_joinasynch(arcan_vobject* img, bool emit, bool force)
+{
 	struct thread_loader_args* args =
 		(struct thread_loader_args*) img->feed.state.ptr;
 
-	pthread_join(args->self, NULL);
+	if (!force && img->feed.state.tag != ARCAN_TAG_ASYNCIMGRD){
+		if (img->feed.state.tag == ARCAN_TAG_ASYNCIMGLD &&
+			args && !args->visible && img->current.opa > EPSILON)
+			loadpool_prioritize(args);
+		return;
+	}
+
+/* if the job hasn't been picked up yet, it is faster to just do it here
+ * than to wait for a worker to become available */
+	pthread_mutex_lock(&loadpool.lock);
+	if (args->state == ASYNCH_QUEUED){
+		loadpool_remove(args);
+		args->state = ASYNCH_RUNNING;
+		pthread_mutex_unlock(&loadpool.lock);
+
+		arcan_errc rc = arcan_vint_getimage(
+			args->fname, &args->shadow, args->constraints, true);
+
+		pthread_mutex_lock(&loadpool.lock);
+		args->rc = rc;
+		args->state = ASYNCH_DONE;
+	}
+
+	while (args->state != ASYNCH_DONE)
+		pthread_cond_wait(&loadpool.done, &loadpool.lock);
+	pthread_mutex_unlock(&loadpool.lock);
 
 	arcan_event loadev = {
 		.category = EVENT_VIDEO,
@@ -2376,7 +3337,22 @@ void arcan_vint_joinasynch(arcan_vobject* img, bool emit, bool force)
 		.vid.source = args->dstid
 	};
 
-	if (args->rc == ARCAN_OK){
+	if (args->cached){
+		loadev.vid.kind = EVENT_VIDEO_ASYNCHIMAGE_LOADED;
+		loadev.vid.width = img->origw;
+		loadev.vid.height = img->origh;
+	}
+	else if (args->rc == ARCAN_OK){
+		img->origw = args->shadow.origw;
+		img->origh = args->shadow.origh;
+		img->vstore->vinf.text.raw = args->store.vinf.text.raw;
+		img->vstore->vinf.text.s_raw = args->store.vinf.text.s_raw;
+		img->vstore->vinf.text.source = args->store.vinf.text.source;
+		img->vstore->w = args->store.w;
+		img->vstore->h = args->store.h;
+		args->store.vinf.text.raw = NULL;
+		args->store.vinf.text.source = NULL;
+
 		loadev.vid.kind = EVENT_VIDEO_ASYNCHIMAGE_LOADED;
 		loadev.vid.width = img->origw;
 		loadev.vid.height = img->origh;
@@ -2399,13 +3375,16 @@ void arcan_vint_joinasynch(arcan_vobject* img, bool emit, bool force)
 		loadev.vid.kind = EVENT_VIDEO_ASYNCHIMAGE_FAILED;
 	}
 
-	agp_update_vstore(img->vstore, true);
+	if (!args->cached){
+		agp_update_vstore(img->vstore, true);
+		if (args->keyed && args->rc == ARCAN_OK)
+			imgcache_insert(img, &args->key);
+	}
 
 	if (emit)
 		arcan_event_enqueue(arcan_event_defaultctx(), &loadev);
 
-	arcan_mem_free(args->fname);
-	arcan_mem_free(args);
+	loadpool_free(args);
 	img->feed.state.ptr = NULL;
 	img->feed.state.tag = ARCAN_TAG_IMAGE;
 }
@@ -2420,7 +3399,7 @@ static arcan_vobj_id loadimage_asynch(const char* fname,
 
 	struct thread_loader_args* args = arcan_alloc_mem(
 		sizeof(struct thread_loader_args),
-		ARCAN_MEM_THREADCTX, 0, ARCAN_MEMALIGN_NATURAL);
+		ARCAN_MEM_THREADCTX, ARCAN_MEM_BZERO, ARCAN_MEMALIGN_NATURAL);
 
 	args->dstid = rv;
 	args->dst = dstobj;
@@ -2428,10 +3407,31 @@ static arcan_vobj_id loadimage_asynch(const char* fname,
 	args->tag = tag;
 	args->constraints = constraints;
 
+/* the decode options (scale, imageproc, ...) come from the store */
+	args->store = *dstobj->vstore;
+	args->store.vinf.text.raw = NULL;
+	args->store.vinf.text.source = NULL;
+	args->shadow.vstore = &args->store;
+
 	dstobj->feed.state.tag = ARCAN_TAG_ASYNCIMGLD;
 	dstobj->feed.state.ptr = args;
 
-	pthread_create(&args->self, NULL, thread_loader, (void*) args);
+/* already decoded, the join will only have to emit the event */
+	args->keyed = imgcache_mkkey(fname, constraints, dstobj->vstore, &args->key);
+	if (args->keyed && imgcache_lookup(dstobj, &args->key)){
+		args->cached = true;
+		args->rc = ARCAN_OK;
+		args->state = ASYNCH_DONE;
+		dstobj->feed.state.tag = ARCAN_TAG_ASYNCIMGRD;
+		return rv;
+	}
+
+/* no workers, fall back to doing it synchronously on the next join */
+	if (!loadpool_enqueue(args)){
+		args->rc = arcan_vint_getimage(fname, &args->shadow, constraints, true);
+		args->state = ASYNCH_DONE;
+		dstobj->feed.state.tag = ARCAN_TAG_ASYNCIMGRD;
+	}
 
 	return rv;
 }
@@ -2463,10 +3463,24 @@ static arcan_vobj_id loadimage(const char* fname, img_cons constraints,
 	if (newvobj == NULL)
 		return ARCAN_EID;
 
+	struct imgcache_key key;
+	bool keyed = imgcache_mkkey(fname, constraints, newvobj->vstore, &key);
+	if (keyed && imgcache_lookup(newvobj, &key)){
+		newvobj->feed.state.tag = ARCAN_TAG_IMAGE;
+		if (errcode != NULL)
+			*errcode = ARCAN_OK;
+		return rv;
+	}
+
 	arcan_errc rc = arcan_vint_getimage(fname, newvobj, constraints, false);
 
 	if (rc != ARCAN_OK)
 		arcan_video_deleteobject(rv);
+	else if (keyed)
+		imgcache_insert(newvobj, &key);
+
+	if (keyed)
+		free(key.path);
 
 	if (errcode != NULL)
 		*errcode = rc;
@@ -2494,6 +3508,7 @@ arcan_errc arcan_video_alterfeed(arcan_vobj_id id,
 	if (!vobj)
 		return ARCAN_ERRC_NO_SUCH_OBJECT;
 
+	arcan_vint_imgcache_unshare(vobj);
 	vobj->feed.state = state;
 	vobj->feed.ffunc = cb;
 
@@ -2559,6 +3574,8 @@ arcan_errc arcan_video_resizefeed(arcan_vobj_id id, size_t w, size_t h)
 		vobj->feed.state.tag == ARCAN_TAG_ASYNCIMGRD)
 		arcan_video_pushasynch(id);
 
+	arcan_vint_imgcache_unshare(vobj);
+
 /* rescale transformation chain */
 	float ox = (float)vobj->origw*vobj->current.scale.x;
 	float oy = (float)vobj->origh*vobj->current.scale.y;
@@ -2579,7 +3596,7 @@ arcan_errc arcan_video_resizefeed(arcan_vobj_id id, size_t w, size_t h)
 	invalidate_cache(vobj);
 	agp_resize_vstore(vobj->vstore, w, h);
 
-	FLAG_DIRTY();
+	FLAG_DIRTY(vobj);
 	return ARCAN_OK;
 }
 
@@ -2710,18 +3727,17 @@ static arcan_errc update_zv(arcan_vobject* vobj, int newzv)
 /*
  * attach also works like an insertion sort where
  * the insertion criterion is <= order, to aid dynamic
- * corruption checks, this could be further optimized
- * by using the fact that we're simply "sliding" in the
- * same chain.
+ * corruption checks. If the new order doesn't move the
+ * object past any of its neighbours, just slide it.
  */
 	int oldv = vobj->order;
-	detach_fromtarget(owner, vobj);
-	vobj->order = newzv;
+	int order = vobj->feed.state.tag == ARCAN_TAG_3DOBJ ? -newzv : newzv;
 
-	if (vobj->feed.state.tag == ARCAN_TAG_3DOBJ)
-		vobj->order *= -1;
-
-	attach_object(owner, vobj);
+	if (!slide_order(owner, vobj, order)){
+		detach_fromtarget(owner, vobj);
+		vobj->order = order;
+		attach_object(owner, vobj);
+	}
 
 /*
  * unfortunately, we need to do this recursively AND
@@ -2912,6 +3928,7 @@ arcan_errc arcan_video_objecttexmode(arcan_vobj_id id,
 	arcan_errc rv = ARCAN_ERRC_NO_SUCH_OBJECT;
 
 	if (src){
+		arcan_vint_imgcache_unshare(src);
 		src->vstore->txu = modes;
 		src->vstore->txv = modet;
 		agp_update_vstore(src->vstore, false);
@@ -2929,6 +3946,7 @@ arcan_errc arcan_video_objectfilter(arcan_vobj_id id,
 
 /* fake an upload with disabled filteroptions */
 	if (src){
+		arcan_vint_imgcache_unshare(src);
 		src->vstore->filtermode = mode;
 		agp_update_vstore(src->vstore, false);
 	}
@@ -3026,23 +4044,19 @@ arcan_errc arcan_video_transfertransform(arcan_vobj_id sid, arcan_vobj_id did)
 static void drop_rtarget(arcan_vobject* vobj)
 {
 /* check if vobj is indeed a rendertarget */
-	struct rendertarget* dst = NULL;
+	struct rendertarget* dst = vobj->rtgt;
 	int cascade_c = 0;
 	arcan_vobject** pool;
 
 	unsigned dstind;
 
-/* linear search for the vobj among rendertargets */
-	for (dstind = 0; dstind < current_context->n_rtargets; dstind++){
-		if (current_context->rtargets[dstind].color == vobj){
-			dst = &current_context->rtargets[dstind];
-			break;
-		}
-	}
-
 	if (!dst)
 		return;
 
+	for (dstind = 0; dstind < current_context->n_rtargets; dstind++)
+		if (current_context->rtargets[dstind] == dst)
+			break;
+
 	if (current_context->attachment == dst)
 		current_context->attachment = NULL;
 
@@ -3101,15 +4115,19 @@ static void drop_rtarget(arcan_vobject* vobj)
 		arcan_mem_free(last);
 	}
 
-/* compact the context array of rendertargets */
-	if (dstind+1 < RENDERTARGET_LIMIT)
+	index_drop(dst);
+	sampled_drop(dst);
+	rtgt_graph.valid = false;
+
+/* compact the context array of rendertargets, the rendertarget itself is
+ * kept until the attached objects have been reassigned as they may still
+ * refer to it as owner */
+	if (dstind < current_context->n_rtargets)
 		memmove(&current_context->rtargets[dstind],
 			&current_context->rtargets[dstind+1],
-			sizeof(struct rendertarget) * (RENDERTARGET_LIMIT - 1 - dstind));
-
-/* always kill the last element */
-	memset(&current_context->rtargets[RENDERTARGET_LIMIT- 1], 0,
-		sizeof(struct rendertarget));
+			sizeof(struct rendertarget*) * (current_context->n_rtargets - dstind));
+	FL_CLEAR(dst, TGTFL_ALIVE);
+	vobj->rtgt = NULL;
 
 /* self-reference gone */
 	vobj->extrefc.attachments--;
@@ -3137,12 +4155,13 @@ static void drop_rtarget(arcan_vobject* vobj)
  * to normal/empty ones */
 	cascade_c = 0;
 	for (dstind = 0; dstind < current_context->n_rtargets; dstind++){
-		if (current_context->rtargets[dstind].link == dst){
-			current_context->rtargets[dstind].link = NULL;
+		if (current_context->rtargets[dstind]->link == dst){
+			current_context->rtargets[dstind]->link = NULL;
 		}
 	}
 
 	arcan_mem_free(pool);
+	arcan_mem_free(dst);
 }
 
 static void drop_frameset(arcan_vobject* vobj)
@@ -3196,7 +4215,7 @@ arcan_errc arcan_video_deleteobject(arcan_vobj_id id)
 	detach_fromtarget(&current_context->stdoutp, vobj);
 	for (unsigned int i = 0; i < current_context->n_rtargets &&
 		vobj->extrefc.attachments; i++)
-		detach_fromtarget(&current_context->rtargets[i], vobj);
+		detach_fromtarget(current_context->rtargets[i], vobj);
 
 /* step two, disconnect from parent, WORLD references doesn't count */
 	if (vobj->parent && vobj->parent != &current_context->world)
@@ -3245,8 +4264,9 @@ arcan_errc arcan_video_deleteobject(arcan_vobj_id id)
 		vobj->feed.state.tag = ARCAN_TAG_NONE;
 	}
 
-	if (vobj->feed.state.tag == ARCAN_TAG_ASYNCIMGLD)
-		arcan_video_pushasynch(id);
+	if (vobj->feed.state.tag == ARCAN_TAG_ASYNCIMGLD ||
+		vobj->feed.state.tag == ARCAN_TAG_ASYNCIMGRD)
+		loadpool_cancel(vobj);
 
 /* video storage, will take care of refcounting in case of shared storage */
 	arcan_vint_drop_vstore(vobj->vstore);
@@ -4168,6 +5188,16 @@ static int tick_rendertarget(struct rendertarget* tgt)
 		if (elem->last_updated != arcan_video_display.c_ticks)
 			tgt->transfc += update_object(elem, arcan_video_display.c_ticks);
 
+/* a parent in some other rendertarget may be the one that is moving, that
+ * only shows up as the resolved properties not being cacheable */
+		if (!elem->valid_cache)
+			for (arcan_vobject* par = elem->parent;
+				par && par != &current_context->world; par = par->parent)
+				if (par->transform){
+					tgt->dirtyc++;
+					break;
+				}
+
 		if (elem->feed.ffunc)
 			arcan_ffunc_lookup(elem->feed.ffunc)
 				(FFUNC_TICK, 0, 0, 0, 0, 0, elem->feed.state, elem->cellid);
@@ -4189,8 +5219,11 @@ static int tick_rendertarget(struct rendertarget* tgt)
 
 	if (tgt->refresh > 0 && process_counter(tgt,
 		&tgt->refreshcnt, tgt->refresh, 0.0)){
+		unsigned long long bts = arcan_bench_timestamp();
+		rtgt_pending(tgt);
 		tgt->transfc += process_rendertarget(tgt, 0.0);
 		tgt->dirtyc = 0;
+		arcan_bench_register_stage(ARCAN_BENCH_RTGT, bts);
 	}
 
 	if (tgt->readback < 0)
@@ -4215,12 +5248,15 @@ unsigned arcan_video_tick(unsigned steps, unsigned* njobs)
 		arcan_video_display.dirty +=
 			update_object(&current_context->world, arcan_video_display.c_ticks);
 
-		arcan_video_display.dirty +=
-			agp_shader_envv(TIMESTAMP_D, &tsd, sizeof(uint32_t));
+/* can't know what a timed shader will do, so redraw everything */
+		int nshtime = agp_shader_envv(TIMESTAMP_D, &tsd, sizeof(uint32_t));
+		arcan_video_display.dirty += nshtime;
+		if (nshtime > 0)
+			arcan_video_display.full_damage = true;
 
 		for (size_t i = 0; i < current_context->n_rtargets; i++)
 			arcan_video_display.dirty +=
-				tick_rendertarget(&current_context->rtargets[i]);
+				tick_rendertarget(current_context->rtargets[i]);
 
 		arcan_video_display.dirty +=
 			tick_rendertarget(&current_context->stdoutp);
@@ -4261,6 +5297,10 @@ arcan_errc arcan_video_persistobject(arcan_vobj_id id)
 	if (!vobj)
 		return ARCAN_ERRC_NO_SUCH_OBJECT;
 
+/* the store might be shared through the image cache */
+	if (!vobj->frameset)
+		arcan_vint_imgcache_unshare(vobj);
+
 	if (!vobj->frameset &&
 		vobj->vstore->refcount == 1 &&
 		vobj->parent == &current_context->world){
@@ -4535,27 +5575,36 @@ static void update_shenv(arcan_vobject* src, surface_properties* prop)
 	}
 }
 
-static inline void setup_surf(struct rendertarget* dst,
-	surface_properties* prop, arcan_vobject* src, float** mv)
+/*
+ * resolve the modelview for a 2D surface, [prop] is modified so that scale
+ * is the half-extent of the quad centered around the origin
+ */
+static inline float* surf_modelview(struct rendertarget* dst,
+	surface_properties* prop, arcan_vobject* src)
 {
 /* just temporary storage/scratch */
 	static float _Alignas(16) dmatr[16];
 
-	if (src->feed.state.tag == ARCAN_TAG_ASYNCIMGLD)
-		return;
-
 /* currently, we only cache the primary rendertarget */
 	if (src->valid_cache && dst == src->owner){
 		prop->scale.x *= src->origw * 0.5f;
 		prop->scale.y *= src->origh * 0.5f;
 		prop->position.x += prop->scale.x;
 		prop->position.y += prop->scale.y;
-		*mv = src->prop_matr;
-	}
-	else {
-		build_modelview(dmatr, dst->base, prop, src);
-		*mv = dmatr;
+		return src->prop_matr;
 	}
+
+	build_modelview(dmatr, dst->base, prop, src);
+	return dmatr;
+}
+
+static inline void setup_surf(struct rendertarget* dst,
+	surface_properties* prop, arcan_vobject* src, float** mv)
+{
+	if (src->feed.state.tag == ARCAN_TAG_ASYNCIMGLD)
+		return;
+
+	*mv = surf_modelview(dst, prop, src);
 	update_shenv(src, prop);
 }
 
@@ -4623,41 +5672,66 @@ static inline void draw_texsurf(struct rendertarget* dst,
 	}
 }
 
-static void ffunc_process(arcan_vobject* dst, int cookie)
+/*
+ * Feeds that reported a new frame during polling, processed in priority
+ * order after all of them have been polled, see arcan_video_pollfeed.
+ */
+static struct arcan_strarr pending_feeds;
+
+/* after this many deferred polls in a row, a frame is processed regardless */
+#define FEED_DEFER_LIMIT 4
+
+static bool ffunc_poll(arcan_vobject* dst, int cookie)
 {
 /* we use an update cookie to make sure that we don't process
  * the same object multiple times when/if it is shared */
 	if (!dst->feed.ffunc || dst->feed.pcookie == cookie)
-		return;
+		return false;
 
 	dst->feed.pcookie = cookie;
 
+	return arcan_ffunc_lookup(dst->feed.ffunc)(FFUNC_POLL,
+		0, 0, 0, 0, 0, dst->feed.state, dst->cellid) == FRV_GOTFRAME;
+}
+
+static void ffunc_render(arcan_vobject* dst)
+{
 /* if there is a new frame available, we make sure to flag it
  * dirty so that it will be rendered */
-	if (dst->feed.ffunc && arcan_ffunc_lookup(dst->feed.ffunc)(FFUNC_POLL,
-		0, 0, 0, 0, 0, dst->feed.state, dst->cellid) == FRV_GOTFRAME){
-		FLAG_DIRTY(dst);
+	arcan_video_display.dirty++;
+	dst->feed.deferred = 0;
 
 /* cycle active frame store (depending on how often we want to
  * track history frames, might not be every time) */
-		if (dst->frameset && dst->frameset->mctr != 0){
-			dst->frameset->ctr--;
+	if (dst->frameset && dst->frameset->mctr != 0){
+		dst->frameset->ctr--;
 
-			if (dst->frameset->ctr == 0){
-				dst->frameset->ctr = abs( dst->frameset->mctr );
-				step_active_frame(dst);
-			}
+		if (dst->frameset->ctr == 0){
+			dst->frameset->ctr = abs( dst->frameset->mctr );
+			step_active_frame(dst);
 		}
-
-		arcan_ffunc_lookup(dst->feed.ffunc)(FFUNC_RENDER,
-			dst->vstore->vinf.text.raw, dst->vstore->vinf.text.s_raw,
-			dst->vstore->w, dst->vstore->h,
-			dst->vstore->vinf.text.glid,
-			dst->feed.state, dst->cellid
-		);
 	}
 
-	return;
+/* feeds that know which part of the store they touched (frameserver with
+ * subregion hints) will have marked it, otherwise assume all of it */
+	struct agp_vstore* vs = dst->vstore;
+	uint32_t gen = vs->damage.gen;
+
+	arcan_ffunc_lookup(dst->feed.ffunc)(FFUNC_RENDER,
+		dst->vstore->vinf.text.raw, dst->vstore->vinf.text.s_raw,
+		dst->vstore->w, dst->vstore->h,
+		dst->vstore->vinf.text.glid,
+		dst->feed.state, dst->cellid
+	);
+
+	if (vs == dst->vstore && gen == vs->damage.gen)
+		arcan_vint_storedamage(vs, 0, 0, 0, 0);
+}
+
+static void ffunc_process(arcan_vobject* dst, int cookie)
+{
+	if (ffunc_poll(dst, cookie))
+		ffunc_render(dst);
 }
 
 arcan_errc arcan_vint_pollfeed(arcan_vobj_id vid)
@@ -4687,14 +5761,27 @@ static void poll_list(arcan_vobject_litem* current, int cookie)
 	while(current && current->elem){
 		arcan_vobject* celem = current->elem;
 
-		if (celem->feed.ffunc)
-			ffunc_process(celem, cookie);
+		if (celem->feed.ffunc && ffunc_poll(celem, cookie)){
+			if (pending_feeds.count == pending_feeds.limit)
+				arcan_mem_growarr(&pending_feeds);
+			pending_feeds.cdata[pending_feeds.count++] = celem;
+		}
 
 		current = current->next;
 	}
 }
 
-void arcan_video_pollfeed()
+/* priority feed first, then the ones that have waited the longest */
+static inline bool feed_before(arcan_vobject* a, arcan_vobject* b,
+	arcan_vobj_id prio)
+{
+	if ((a->cellid == prio) != (b->cellid == prio))
+		return a->cellid == prio;
+
+	return a->feed.deferred > b->feed.deferred;
+}
+
+size_t arcan_video_pollfeed(arcan_vobj_id prio, unsigned budget, size_t* nupd)
 {
 /* vcookie is used just to make sure that we won't update the same
  * object multiple times during one frame due to the feed being
@@ -4702,14 +5789,54 @@ void arcan_video_pollfeed()
 	static int vcookie = 1;
 	vcookie++;
 
- for (off_t ind = 0; ind < current_context->n_rtargets; ind++)
-		arcan_vint_pollreadback(&current_context->rtargets[ind]);
-	arcan_vint_pollreadback(&current_context->stdoutp);
+	pending_feeds.count = 0;
 
 	for (size_t i = 0; i < current_context->n_rtargets; i++)
-		poll_list(current_context->rtargets[i].first, vcookie);
+		poll_list(current_context->rtargets[i]->first, vcookie);
 
 	poll_list(current_context->stdoutp.first, vcookie);
+
+/* stable insertion sort, the set is small and mostly in order already */
+	arcan_vobject** set = (arcan_vobject**) pending_feeds.cdata;
+	for (size_t i = 1; i < pending_feeds.count; i++){
+		arcan_vobject* cur = set[i];
+		size_t j = i;
+		for (; j > 0 && feed_before(cur, set[j-1], prio); j--)
+			set[j] = set[j-1];
+		set[j] = cur;
+	}
+
+	unsigned long long start = budget ? arcan_timemicros() : 0;
+	size_t ndef = 0, nproc = 0;
+
+	for (size_t i = 0; i < pending_feeds.count; i++){
+		arcan_vobject* cur = set[i];
+
+/* the pending frame stays in the feed, so the next poll will get it again */
+		if (budget && nproc && cur->cellid != prio &&
+			cur->feed.deferred < FEED_DEFER_LIMIT &&
+			arcan_timemicros() - start > budget){
+			cur->feed.deferred++;
+			ndef++;
+			continue;
+		}
+
+		ffunc_render(cur);
+		nproc++;
+	}
+
+	if (nupd)
+		*nupd = nproc;
+
+	return ndef;
+}
+
+void arcan_video_pollreadback()
+{
+	for (size_t ind = 0; ind < current_context->n_rtargets; ind++)
+		arcan_vint_pollreadback(current_context->rtargets[ind]);
+
+	arcan_vint_pollreadback(&current_context->stdoutp);
 }
 
 static inline void populate_stencil(struct rendertarget* tgt,
@@ -4867,87 +5994,655 @@ struct rendertarget* arcan_vint_current_rt()
 	return current_rendertarget;
 }
 
-static size_t process_rendertarget(struct rendertarget* tgt, float fract)
+static inline bool region_empty(const struct rtgt_region* r)
 {
-	arcan_vobject_litem* current;
-	if (tgt->link){
-		current = tgt->link->first;
-		tgt->dirtyc += tgt->link->dirtyc;
-		tgt->transfc += tgt->link->transfc;
-	}
-	else
-		current = tgt->first;
+	return r->x2 <= r->x1 || r->y2 <= r->y1;
+}
 
-	if (arcan_video_display.ignore_dirty == false &&
-		(!tgt->link && tgt->dirtyc == 0 && tgt->transfc == 0))
-		return 0;
+static inline bool region_overlap(
+	const struct rtgt_region* a, const struct rtgt_region* b)
+{
+	return a->x1 < b->x2 && b->x1 < a->x2 && a->y1 < b->y2 && b->y1 < a->y2;
+}
 
-	current_rendertarget = tgt;
-	agp_activate_rendertarget(tgt->art);
-	agp_shader_envv(RTGT_ID, &tgt->id, sizeof(int));
+static inline struct rtgt_region region_union(
+	const struct rtgt_region* a, const struct rtgt_region* b)
+{
+	return (struct rtgt_region){
+		.x1 = a->x1 < b->x1 ? a->x1 : b->x1,
+		.y1 = a->y1 < b->y1 ? a->y1 : b->y1,
+		.x2 = a->x2 > b->x2 ? a->x2 : b->x2,
+		.y2 = a->y2 > b->y2 ? a->y2 : b->y2
+	};
+}
 
-	if (!FL_TEST(tgt, TGTFL_NOCLEAR))
-		agp_rendertarget_clear();
+static inline size_t region_area(const struct rtgt_region* r)
+{
+	return region_empty(r) ? 0 : (size_t)(r->x2 - r->x1) * (r->y2 - r->y1);
+}
 
-	size_t pc = 0;
+static void damage_region(struct rendertarget* tgt, struct rtgt_region r)
+{
+	if (tgt->damage.full || region_empty(&r))
+		return;
 
-/* first, handle all 3d work (which may require multiple passes etc.) */
-	if (tgt->order3d == ORDER3D_FIRST && current && current->elem->order < 0){
-		current = arcan_3d_refresh(tgt->camtag, current, fract);
-		pc++;
+/* absorb everything the new region overlaps, as the grown region may
+ * in turn overlap others, repeat until it settles */
+	bool merged;
+	do {
+		merged = false;
+		for (size_t i = 0; i < tgt->damage.n_rects; i++){
+			if (!region_overlap(&tgt->damage.rects[i], &r))
+				continue;
+
+			r = region_union(&tgt->damage.rects[i], &r);
+			tgt->damage.rects[i] = tgt->damage.rects[--tgt->damage.n_rects];
+			merged = true;
+			break;
+		}
+	} while (merged);
+
+	if (tgt->damage.n_rects < RENDERTARGET_DAMAGE_LIMIT){
+		tgt->damage.rects[tgt->damage.n_rects++] = r;
+		return;
 	}
 
-/* skip a possible 3d pipeline */
-	while (current && current->elem->order < 0)
-		current = current->next;
+/* out of slots, grow the one that would cost the least extra fill, the
+ * result may overlap others but that only means some pixels are drawn twice */
+	size_t best = 0, best_cost = SIZE_MAX;
+	for (size_t i = 0; i < tgt->damage.n_rects; i++){
+		struct rtgt_region u = region_union(&tgt->damage.rects[i], &r);
+		size_t cost = region_area(&u) - region_area(&tgt->damage.rects[i]);
+		if (cost < best_cost){
+			best = i;
+			best_cost = cost;
+		}
+	}
 
-	if (!current)
-		goto end3d;
+	tgt->damage.rects[best] = region_union(&tgt->damage.rects[best], &r);
+}
 
-/* make sure we're in a decent state for 2D */
-	agp_pipeline_hint(PIPELINE_2D);
+/*
+ * take the quad (x1, y1, x2, y2) in object space through modelview and the
+ * projection of the rendertarget and return the covered framebuffer pixels,
+ * padded to be safe against filtering and rounding differences
+ */
+static struct rtgt_region project_region(struct rendertarget* tgt,
+	float* mv, float x1, float y1, float x2, float y2)
+{
+	int w = tgt->color->vstore->w;
+	int h = tgt->color->vstore->h;
+	struct rtgt_region res = {.x2 = w, .y2 = h};
 
-	agp_shader_activate(agp_default_shader(BASIC_2D));
-	agp_shader_envv(PROJECTION_MATR, tgt->projection, sizeof(float)*16);
+	float xs[4] = {x1, x2, x2, x1};
+	float ys[4] = {y1, y1, y2, y2};
+	float minx = INFINITY, miny = INFINITY, maxx = -INFINITY, maxy = -INFINITY;
 
-	while (current && current->elem->order >= 0){
-		arcan_vobject* elem = current->elem;
+	for (size_t i = 0; i < 4; i++){
+		float _Alignas(16) inv[4] = {xs[i], ys[i], 0.0, 1.0};
+		float _Alignas(16) eye[4];
+		float _Alignas(16) clip[4];
 
-		if (current->elem->order < tgt->min_order){
-			current = current->next;
-			continue;
-		}
+		mult_matrix_vecf(mv, inv, eye);
+		mult_matrix_vecf(tgt->projection, eye, clip);
 
-		if (current->elem->order > tgt->max_order)
-			break;
+		if (fabsf(clip[3]) < EPSILON)
+			return res;
 
-/* calculate coordinate system translations, world cannot be masked */
-		surface_properties dprops = empty_surface();
-		arcan_resolve_vidprop(elem, fract, &dprops);
+		float px = (clip[0] / clip[3] + 1.0) * 0.5 * (float) w;
+		float py = (clip[1] / clip[3] + 1.0) * 0.5 * (float) h;
+		minx = px < minx ? px : minx;
+		miny = py < miny ? py : miny;
+		maxx = px > maxx ? px : maxx;
+		maxy = py > maxy ? py : maxy;
+	}
 
-/* don't waste time on objects that aren't supposed to be visible */
-		if ( dprops.opa <= EPSILON || elem == tgt->color){
-			current = current->next;
-			continue;
-		}
+	if (!isfinite(minx) || !isfinite(miny) || !isfinite(maxx) || !isfinite(maxy))
+		return res;
 
-/* enable clipping using stencil buffer, we need to reset the state of the
- * stencil buffer between draw calls so track if it's enabled or not */
-		bool clipped = false;
+	res.x1 = minx - 1.0 < 0.0 ? 0 : (int) floorf(minx) - 1;
+	res.y1 = miny - 1.0 < 0.0 ? 0 : (int) floorf(miny) - 1;
+	res.x2 = maxx + 1.0 > (float) w ? w : (int) ceilf(maxx) + 1;
+	res.y2 = maxy + 1.0 > (float) h ? h : (int) ceilf(maxy) + 1;
+
+	if (res.x1 > w)
+		res.x1 = w;
+	if (res.y1 > h)
+		res.y1 = h;
+	if (res.x2 < 0)
+		res.x2 = 0;
+	if (res.y2 < 0)
+		res.y2 = 0;
+
+	return res;
+}
 
 /*
- * texture coordinates that will be passed to the draw call, clipping and other
- * effects may maintain a local copy and manipulate these
+ * map the changed region of a store through the texture coordinates used to
+ * sample it onto the quad, only for the simple axis aligned [0..1] case
  */
-		float* txcos = elem->txcos;
-		float** dstcos = &txcos;
+static bool store_subregion(struct rendertarget* tgt, float* mv,
+	surface_properties* prop, struct agp_vstore* store, float* txcos,
+	struct rtgt_region* out)
+{
+	float s0 = txcos[0], t0 = txcos[1], s1 = txcos[4], t1 = txcos[5];
+
+	if (txcos[2] != s1 || txcos[3] != t0 || txcos[6] != s0 || txcos[7] != t1)
+		return false;
+
+	if (fabsf(s1 - s0) < EPSILON || fabsf(t1 - t0) < EPSILON ||
+		!store->w || !store->h)
+		return false;
+
+	if (s0 < 0.0 || s0 > 1.0 || s1 < 0.0 || s1 > 1.0 ||
+		t0 < 0.0 || t0 > 1.0 || t1 < 0.0 || t1 > 1.0)
+		return false;
+
+	float sx = prop->scale.x, sy = prop->scale.y;
+	float lx1 = -sx + ((float)store->damage.x1 / store->w - s0) / (s1 - s0) * 2 * sx;
+	float lx2 = -sx + ((float)store->damage.x2 / store->w - s0) / (s1 - s0) * 2 * sx;
+	float ly1 = -sy + ((float)store->damage.y1 / store->h - t0) / (t1 - t0) * 2 * sy;
+	float ly2 = -sy + ((float)store->damage.y2 / store->h - t0) / (t1 - t0) * 2 * sy;
+
+	float minx = fmaxf(fminf(lx1, lx2), fminf(-sx, sx));
+	float maxx = fminf(fmaxf(lx1, lx2), fmaxf(-sx, sx));
+	float miny = fmaxf(fminf(ly1, ly2), fminf(-sy, sy));
+	float maxy = fminf(fmaxf(ly1, ly2), fmaxf(-sy, sy));
+
+/* the change is outside of what is being sampled */
+	if (maxx <= minx || maxy <= miny){
+		*out = (struct rtgt_region){0};
+		return true;
+	}
+
+	*out = project_region(tgt, mv, minx, miny, maxx, maxy);
+	return true;
+}
+
+/* an invisible object can still affect others by being used for clipping */
+static bool clip_anchor(arcan_vobject* vobj)
+{
+	for (size_t i = 0; i < vobj->childslots; i++)
+		if (vobj->children[i] && vobj->children[i]->clip != ARCAN_CLIP_OFF)
+			return true;
+
+	return false;
+}
+
+/*
+ * The 2D part of a rendertarget pipeline is flattened into these packed
+ * arrays before each refresh, with the properties resolved once. Damage
+ * collection and the draw loop(s) then iterate them linearly instead of
+ * chasing the litem -> vobj -> vstore/parent chain for each pass, and the
+ * less used parts of the vobj (frameset, shape, tracetag, ...) are only
+ * touched when the flags say so. The storage is shared between rendertargets
+ * as it is rebuilt on every refresh anyhow.
+ */
+enum drawlist_flags {
+	DRAW_VISIBLE   = 1,
+	DRAW_ROOTED    = 2,
+	DRAW_ROTATED   = 4,
+	DRAW_FRAMESET  = 8,
+	DRAW_SHAPE     = 16
+};
+
+static struct {
+	size_t count;
+	size_t limit;
+	bool has3d;
+
+	surface_properties* props;
+	struct rtgt_region* region;
+	struct agp_vstore** vstore;
+	float** txcos;
+	agp_shader_id* program;
+	int* order;
+	uint8_t* clip;
+	uint8_t* blend;
+	uint8_t* flags;
+
+	arcan_vobject** elem;
+	arcan_vobject_litem** item;
+} drawlist;
+
+static bool drawlist_grow()
+{
+	size_t limit = drawlist.limit ? drawlist.limit * 2 : 256;
+	size_t esz =
+		sizeof(surface_properties) + sizeof(struct rtgt_region) +
+		sizeof(struct agp_vstore*) + sizeof(float*) + sizeof(agp_shader_id) +
+		sizeof(int) + sizeof(arcan_vobject*) + sizeof(arcan_vobject_litem*) + 3;
+
+	uint8_t* buf = arcan_alloc_mem(limit * esz,
+		ARCAN_MEM_VSTRUCT, ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_SIMD);
+	if (!buf)
+		return false;
+
+/* largest alignment first, then slice the block and move the old contents */
+	uint8_t* ofs = buf;
+#define SLICE(X) do {\
+	void* _old = drawlist.X;\
+	drawlist.X = (void*) ofs;\
+	if (_old)\
+		memcpy(drawlist.X, _old, drawlist.count * sizeof(*drawlist.X));\
+	ofs += limit * sizeof(*drawlist.X);\
+} while (0)
+	void* oldbuf = drawlist.props;
+	SLICE(props);
+	SLICE(region);
+	SLICE(vstore);
+	SLICE(txcos);
+	SLICE(elem);
+	SLICE(item);
+	SLICE(program);
+	SLICE(order);
+	SLICE(clip);
+	SLICE(blend);
+	SLICE(flags);
+#undef SLICE
+
+	arcan_mem_free(oldbuf);
+	drawlist.limit = limit;
+	return true;
+}
+
+static void build_drawlist(struct rendertarget* tgt,
+	arcan_vobject_litem* current, float fract)
+{
+	drawlist.count = 0;
+	drawlist.has3d = false;
+
+	for (; current; current = current->next){
+		arcan_vobject* elem = current->elem;
+
+		if (elem->order < 0){
+			drawlist.has3d = true;
+			continue;
+		}
+
+		if (elem->order < tgt->min_order || elem == tgt->color)
+			continue;
+
+		if (elem->order > tgt->max_order)
+			break;
+
+		if (drawlist.count == drawlist.limit && !drawlist_grow())
+			break;
 
+		size_t i = drawlist.count++;
+		drawlist.props[i] = empty_surface();
+		arcan_resolve_vidprop(elem, fract, &drawlist.props[i]);
+
+		float* txcos = elem->txcos;
 		if ( (elem->mask & MASK_MAPPING) > 0)
 			txcos = elem->parent != &current_context->world ?
 				elem->parent->txcos : elem->txcos;
 
-		if (!txcos)
-			txcos = arcan_video_display.default_txcos;
+		drawlist.txcos[i] = txcos ? txcos : arcan_video_display.default_txcos;
+		drawlist.vstore[i] = elem->vstore;
+		drawlist.program[i] = elem->program;
+		drawlist.order[i] = elem->order;
+		drawlist.clip[i] = elem->clip;
+		drawlist.blend[i] = elem->blendmode;
+		drawlist.flags[i] =
+			(elem->parent == &current_context->world ? DRAW_ROOTED : 0) |
+			(elem->rotate_state ? DRAW_ROTATED : 0) |
+			(elem->frameset ? DRAW_FRAMESET : 0) |
+			(elem->shape ? DRAW_SHAPE : 0) |
+			(current->damage.visible ? DRAW_VISIBLE : 0);
+		drawlist.region[i] = current->damage.region;
+		drawlist.elem[i] = elem;
+		drawlist.item[i] = current;
+	}
+}
+
+/*
+ * Walk the pipeline and compare each item against the state it had when it
+ * was last drawn in this rendertarget, anything that differs damages the old
+ * and the new region it covers. Objects where only the contents of the store
+ * has changed can be limited further to the part of the store that changed.
+ * This is done regardless of the dirty source so that we don't have to track
+ * every possible property change at the source.
+ */
+static void collect_damage(struct rendertarget* tgt)
+{
+	static float _Alignas(16) dmatr[16];
+
+	if (memcmp(tgt->damage.projection, tgt->projection, sizeof(float) * 16)){
+		memcpy(tgt->damage.projection, tgt->projection, sizeof(float) * 16);
+		tgt->damage.full = true;
+	}
+
+/* the 3d pipeline has its own camera, depth and passes, just redraw */
+	if (drawlist.has3d)
+		tgt->damage.full = true;
+
+	for (size_t i = 0; i < drawlist.count; i++){
+		arcan_vobject* elem = drawlist.elem[i];
+		arcan_vobject_litem* current = drawlist.item[i];
+		surface_properties* dprops = &drawlist.props[i];
+
+/* same resolution as in the draw loop, for multitexture framesets we only
+ * track the primary store and rely on frame stepping flagging the object */
+		struct agp_vstore* store = drawlist.vstore[i];
+		float* txcos = drawlist.txcos[i];
+
+		if ((drawlist.flags[i] & DRAW_FRAMESET) &&
+			elem->frameset->mode != ARCAN_FRAMESET_MULTITEXTURE){
+			struct frameset_store* ds =
+				&elem->frameset->frames[elem->frameset->index];
+			txcos = ds->txcos;
+			store = ds->frame;
+		}
+
+		bool visible = dprops->opa > EPSILON &&
+			elem->feed.state.tag != ARCAN_TAG_ASYNCIMGLD &&
+			(drawlist.vstore[i]->txmapped == TXSTATE_TEX2D ||
+			(drawlist.vstore[i]->txmapped == TXSTATE_OFF && drawlist.program[i] != 0));
+
+		bool same = current->damage.valid &&
+			current->damage.visible == visible &&
+			current->damage.store == store &&
+			current->damage.dirtyc == elem->dirtyc &&
+			current->damage.origw == elem->origw &&
+			current->damage.origh == elem->origh &&
+			current->damage.origo_ofs.x == elem->origo_ofs.x &&
+			current->damage.origo_ofs.y == elem->origo_ofs.y &&
+			current->damage.program == drawlist.program[i] &&
+			current->damage.blendmode == drawlist.blend[i] &&
+			current->damage.clip == drawlist.clip[i] &&
+			current->damage.order == drawlist.order[i] &&
+			memcmp(&current->damage.props, dprops, sizeof(*dprops)) == 0 &&
+			memcmp(current->damage.txcos, txcos, sizeof(float) * 8) == 0;
+
+		bool same_store = current->damage.store_gen == store->damage.gen;
+		if (same && same_store)
+			continue;
+
+		bool anchor = !visible && clip_anchor(elem);
+		struct rtgt_region region = {0};
+
+/* shapes can be displaced in the vertex stage, so no way of knowing */
+		if ((drawlist.flags[i] & DRAW_SHAPE) && (visible || current->damage.visible))
+			tgt->damage.full = true;
+
+		else if (visible || anchor){
+			surface_properties lprops = *dprops;
+			build_modelview(dmatr, tgt->base, &lprops, elem);
+			region = project_region(tgt, dmatr,
+				-lprops.scale.x, -lprops.scale.y, lprops.scale.x, lprops.scale.y);
+
+			struct rtgt_region sub;
+			if (same && visible &&
+				current->damage.store_gen == store->damage.base &&
+				store->damage.x2 > 0 &&
+				store_subregion(tgt, dmatr, &lprops, store, txcos, &sub))
+				damage_region(tgt, sub);
+			else
+				damage_region(tgt, region);
+		}
+
+		if (!same && current->damage.valid &&
+			(current->damage.visible || anchor))
+			damage_region(tgt, current->damage.region);
+
+		current->damage.valid = true;
+		current->damage.visible = visible;
+		current->damage.region = region;
+		current->damage.props = *dprops;
+		current->damage.store = store;
+		current->damage.store_gen = store->damage.gen;
+		current->damage.dirtyc = elem->dirtyc;
+		current->damage.origw = elem->origw;
+		current->damage.origh = elem->origh;
+		current->damage.origo_ofs = elem->origo_ofs;
+		memcpy(current->damage.txcos, txcos, sizeof(float) * 8);
+		current->damage.program = drawlist.program[i];
+		current->damage.blendmode = drawlist.blend[i];
+		current->damage.clip = drawlist.clip[i];
+		current->damage.order = drawlist.order[i];
+
+		drawlist.region[i] = region;
+		drawlist.flags[i] = visible ?
+			drawlist.flags[i] | DRAW_VISIBLE : drawlist.flags[i] & ~DRAW_VISIBLE;
+	}
+}
+
+/*
+ * Consecutive drawlist items that use the default shaders with the same store
+ * and blend state are merged into one draw call. The quads are transformed
+ * here rather than in the vertex stage, so the per-object modelview and
+ * opacity don't have to be uniforms.
+ */
+#define BATCH_VERTS 6
+#define BATCH_LIMIT 1024
+
+static struct {
+	size_t count;
+	size_t limit;
+
+/* state shared by all quads in the batch */
+	enum SHADER_TYPES shader;
+	struct agp_vstore* store;
+	enum arcan_blendfunc blend;
+
+	float* verts;
+	float* txcos;
+	float* colors;
+} batch;
+
+static bool batch_grow()
+{
+	size_t limit = batch.limit ? batch.limit * 2 : 64;
+	float* buf = arcan_alloc_mem(
+		limit * BATCH_VERTS * (3 + 2 + 4) * sizeof(float),
+		ARCAN_MEM_VSTRUCT, ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_SIMD
+	);
+	if (!buf)
+		return false;
+
+	float* verts = buf;
+	float* txcos = &verts[limit * BATCH_VERTS * 3];
+	float* colors = &txcos[limit * BATCH_VERTS * 2];
+
+	if (batch.count){
+		memcpy(verts, batch.verts, batch.count * BATCH_VERTS * 3 * sizeof(float));
+		memcpy(txcos, batch.txcos, batch.count * BATCH_VERTS * 2 * sizeof(float));
+		memcpy(colors, batch.colors, batch.count * BATCH_VERTS * 4 * sizeof(float));
+	}
+
+	arcan_mem_free(batch.verts);
+	batch.verts = verts;
+	batch.txcos = txcos;
+	batch.colors = colors;
+	batch.limit = limit;
+	return true;
+}
+
+static void batch_flush()
+{
+	if (!batch.count)
+		return;
+
+	agp_shader_activate(agp_default_shader(batch.shader));
+	if (batch.store)
+		agp_activate_vstore(batch.store);
+	agp_blendstate(batch.blend);
+
+	agp_submit_batch(batch.verts,
+		batch.shader == BATCH_2D ? batch.txcos : NULL, batch.colors, batch.count);
+
+	arcan_bench_register_draw(batch.count, true);
+	batch.count = 0;
+}
+
+/*
+ * Check if drawlist item [i] can be drawn as part of a batch, and if so with
+ * which shader. Anything that needs custom uniforms, multitexturing, stencil
+ * clipping or a mesh goes through the normal path.
+ */
+static enum SHADER_TYPES batch_type(size_t i)
+{
+	arcan_vobject* elem = drawlist.elem[i];
+	uint8_t flags = drawlist.flags[i];
+	agp_shader_id prg = drawlist.program[i];
+
+	if ((flags & DRAW_SHAPE) ||
+		elem->feed.state.tag == ARCAN_TAG_ASYNCIMGLD ||
+		((flags & DRAW_FRAMESET) &&
+		elem->frameset->mode == ARCAN_FRAMESET_MULTITEXTURE))
+		return SHADER_TYPE_ENDM;
+
+	if (drawlist.clip[i] != ARCAN_CLIP_OFF && !(flags & DRAW_ROOTED) &&
+		(drawlist.clip[i] != ARCAN_CLIP_SHALLOW || (flags & DRAW_ROTATED)))
+		return SHADER_TYPE_ENDM;
+
+	if (drawlist.vstore[i]->txmapped == TXSTATE_TEX2D &&
+		(prg == 0 || prg == agp_default_shader(BASIC_2D)))
+		return BATCH_2D;
+
+	if (drawlist.vstore[i]->txmapped == TXSTATE_OFF &&
+		prg == agp_default_shader(COLOR_2D))
+		return BATCH_COLOR_2D;
+
+	return SHADER_TYPE_ENDM;
+}
+
+/*
+ * Append one object to the current batch, flushing it first if the state
+ * differs. Returns false if there is no room, in which case the caller
+ * draws it the normal way.
+ */
+static bool batch_add(struct rendertarget* tgt, arcan_vobject* elem,
+	surface_properties prop, enum SHADER_TYPES shader,
+	struct agp_vstore* store, enum arcan_blendfunc blend,
+	const float* txcos, const float col[4])
+{
+	if (batch.count &&
+		(batch.shader != shader || batch.store != store || batch.blend != blend))
+		batch_flush();
+
+	if (batch.count == batch.limit &&
+		(batch.limit >= BATCH_LIMIT || !batch_grow()))
+		batch_flush();
+
+	if (batch.count == batch.limit)
+		return false;
+
+	batch.shader = shader;
+	batch.store = store;
+	batch.blend = blend;
+
+	float* mv = surf_modelview(tgt, &prop, elem);
+	float xs[4] = {-prop.scale.x, prop.scale.x, prop.scale.x, -prop.scale.x};
+	float ys[4] = {-prop.scale.y, -prop.scale.y, prop.scale.y, prop.scale.y};
+	float _Alignas(16) corners[4][4];
+
+	for (size_t i = 0; i < 4; i++){
+		float _Alignas(16) inv[4] = {xs[i], ys[i], 0.0, 1.0};
+		mult_matrix_vecf(mv, inv, corners[i]);
+	}
+
+/* same winding as the triangle fan in agp_draw_vobj */
+	static const uint8_t tri[BATCH_VERTS] = {0, 1, 2, 0, 2, 3};
+	float* vdst = &batch.verts[batch.count * BATCH_VERTS * 3];
+	float* tdst = &batch.txcos[batch.count * BATCH_VERTS * 2];
+	float* cdst = &batch.colors[batch.count * BATCH_VERTS * 4];
+
+	for (size_t i = 0; i < BATCH_VERTS; i++){
+		memcpy(&vdst[i * 3], corners[tri[i]], sizeof(float) * 3);
+		tdst[i * 2 + 0] = txcos[tri[i] * 2 + 0];
+		tdst[i * 2 + 1] = txcos[tri[i] * 2 + 1];
+		memcpy(&cdst[i * 4], col, sizeof(float) * 4);
+	}
+
+	batch.count++;
+	return true;
+}
+
+/*
+ * draw the 2D part of the pipeline (as flattened by build_drawlist), if
+ * [clip] is set, only the items that were last drawn (see collect_damage)
+ * inside that region will be processed
+ */
+static size_t draw_2d(struct rendertarget* tgt,
+	float fract, struct rtgt_region* clip)
+{
+	size_t pc = 0;
+
+/* make sure we're in a decent state for 2D */
+	agp_pipeline_hint(PIPELINE_2D);
+
+	agp_shader_activate(agp_default_shader(BASIC_2D));
+	agp_shader_envv(PROJECTION_MATR, tgt->projection, sizeof(float)*16);
+
+/* should the batch shaders have failed to build, everything is drawn 1:1 */
+	bool can_batch = agp_default_shader(BATCH_2D) != BROKEN_SHADER &&
+		agp_default_shader(BATCH_COLOR_2D) != BROKEN_SHADER;
+
+	for (size_t i = 0; i < drawlist.count; i++){
+		if (clip && (!(drawlist.flags[i] & DRAW_VISIBLE) ||
+			!region_overlap(&drawlist.region[i], clip)))
+			continue;
+
+/* don't waste time on objects that aren't supposed to be visible */
+		if (drawlist.props[i].opa <= EPSILON)
+			continue;
+
+		arcan_vobject* elem = drawlist.elem[i];
+		surface_properties dprops = drawlist.props[i];
+		struct agp_vstore* vstore = drawlist.vstore[i];
+		uint8_t flags = drawlist.flags[i];
+
+		enum arcan_blendfunc blend = drawlist.blend[i];
+		if (!(dprops.opa < 1.0 - EPSILON || blend == BLEND_NONE) &&
+			blend != BLEND_FORCE)
+			blend = BLEND_NORMAL;
+
+		enum SHADER_TYPES btype = can_batch ? batch_type(i) : SHADER_TYPE_ENDM;
+		if (btype != SHADER_TYPE_ENDM){
+			float* txcos = drawlist.txcos[i];
+			struct agp_vstore* store = vstore;
+
+			if (flags & DRAW_FRAMESET){
+				struct frameset_store* ds =
+					&elem->frameset->frames[elem->frameset->index];
+				txcos = ds->txcos;
+				store = ds->frame;
+			}
+
+			if (drawlist.clip[i] == ARCAN_CLIP_SHALLOW &&
+				!(flags & (DRAW_ROOTED | DRAW_ROTATED)) &&
+				!setup_shallow_texclip(elem, &txcos, &dprops, fract))
+				continue;
+
+			float col[4] = {1.0, 1.0, 1.0, dprops.opa};
+			if (btype == BATCH_COLOR_2D){
+				col[0] = vstore->vinf.col.r;
+				col[1] = vstore->vinf.col.g;
+				col[2] = vstore->vinf.col.b;
+				store = NULL;
+			}
+
+			if (batch_add(tgt, elem, dprops, btype, store, blend, txcos, col)){
+				pc++;
+				continue;
+			}
+		}
+
+/* anything drawn the normal way has to come after what is queued */
+		batch_flush();
+
+/* enable clipping using stencil buffer, we need to reset the state of the
+ * stencil buffer between draw calls so track if it's enabled or not */
+		bool clipped = false;
+
+/*
+ * texture coordinates that will be passed to the draw call, clipping and other
+ * effects may maintain a local copy and manipulate these
+ */
+		float* txcos = drawlist.txcos[i];
+		float** dstcos = &txcos;
 
 /* depending on frameset- mode, we may need to split the frameset up into
  * multitexturing, or switch the txcos with the ones that may be used for
@@ -4955,10 +6650,10 @@ static size_t process_rendertarget(struct rendertarget* tgt, float fract)
  * To not skip on the early-out-on-clipping and not incur additional state
  * change costs, only do it in this edge case. */
 		bool shader_sw = false;
-		agp_shader_id shid = elem->program > 0 ?
-			elem->program : agp_default_shader(BASIC_2D);
+		agp_shader_id shid = drawlist.program[i] > 0 ?
+			drawlist.program[i] : agp_default_shader(BASIC_2D);
 
-		if (elem->frameset){
+		if (flags & DRAW_FRAMESET){
 			if (elem->frameset->mode == ARCAN_FRAMESET_MULTITEXTURE){
 				agp_shader_activate(shid);
 				shader_sw = true;
@@ -4972,20 +6667,17 @@ static size_t process_rendertarget(struct rendertarget* tgt, float fract)
 			}
 		}
 		else
-			agp_activate_vstore(elem->vstore);
+			agp_activate_vstore(vstore);
 
 /* a common clipping situation is that we have an invisible clipping parent
  * where neither objects is in a rotated state, which gives an easy way
  * out through the drawing region */
-		if (elem->clip == ARCAN_CLIP_SHALLOW &&
-			elem->parent != &current_context->world && !elem->rotate_state){
-			if (!setup_shallow_texclip(elem, dstcos, &dprops, fract)){
-				current = current->next;
+		if (drawlist.clip[i] == ARCAN_CLIP_SHALLOW &&
+			!(flags & (DRAW_ROOTED | DRAW_ROTATED))){
+			if (!setup_shallow_texclip(elem, dstcos, &dprops, fract))
 				continue;
-			}
 		}
-		else if (elem->clip != ARCAN_CLIP_OFF &&
-			elem->parent != &current_context->world){
+		else if (drawlist.clip[i] != ARCAN_CLIP_OFF && !(flags & DRAW_ROOTED)){
 			clipped = true;
 			populate_stencil(tgt, elem, fract);
 		}
@@ -4993,31 +6685,195 @@ static size_t process_rendertarget(struct rendertarget* tgt, float fract)
 		if (!shader_sw)
 			agp_shader_activate(shid);
 
-		if (dprops.opa < 1.0 - EPSILON || elem->blendmode == BLEND_NONE)
-			agp_blendstate(elem->blendmode);
-		else
-			if (elem->blendmode == BLEND_FORCE)
-				agp_blendstate(elem->blendmode);
-			else
-				agp_blendstate(BLEND_NORMAL);
+		agp_blendstate(blend);
 
-		if (elem->vstore->txmapped == TXSTATE_OFF && elem->program != 0)
-			draw_colorsurf(tgt, dprops, elem, elem->vstore->vinf.col.r,
-				elem->vstore->vinf.col.g, elem->vstore->vinf.col.b, *dstcos);
-		else if (elem->vstore->txmapped == TXSTATE_TEX2D)
+		if (vstore->txmapped == TXSTATE_OFF && drawlist.program[i] != 0){
+			draw_colorsurf(tgt, dprops, elem, vstore->vinf.col.r,
+				vstore->vinf.col.g, vstore->vinf.col.b, *dstcos);
+			arcan_bench_register_draw(1, false);
+		}
+		else if (vstore->txmapped == TXSTATE_TEX2D){
 			draw_texsurf(tgt, dprops, elem, *dstcos);
+			arcan_bench_register_draw(1, false);
+		}
 		else
 			;
 		pc++;
 
 		if (clipped)
 			agp_disable_stencil();
+	}
 
-		current = current->next;
+	batch_flush();
+	return pc;
+}
+
+static int cmp_storeptr(const void* a, const void* b)
+{
+	uintptr_t l = (uintptr_t) *(struct agp_vstore* const*) a;
+	uintptr_t r = (uintptr_t) *(struct agp_vstore* const*) b;
+	return l < r ? -1 : (l > r ? 1 : 0);
+}
+
+static bool sampled_add(struct agp_vstore*** set,
+	size_t* count, size_t* limit, struct agp_vstore* vs)
+{
+	if (*count == *limit){
+		size_t nl = *limit ? *limit * 2 : 16;
+		struct agp_vstore** ns = arcan_alloc_mem(nl * sizeof(*ns),
+			ARCAN_MEM_VSTRUCT, ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_NATURAL);
+		if (!ns)
+			return false;
+
+		if (*set)
+			memcpy(ns, *set, *count * sizeof(*ns));
+		arcan_mem_free(*set);
+		*set = ns;
+		*limit = nl;
 	}
 
+	(*set)[(*count)++] = vs;
+	return true;
+}
+
+/*
+ * Rebuild the set of stores that the freshly built drawlist samples from,
+ * if the set of rendertarget stores in it changes, the refresh order needs
+ * to be recalculated.
+ */
+static void sampled_update(struct rendertarget* tgt)
+{
+	static struct agp_vstore** set;
+	static size_t limit;
+	size_t count = 0;
+
+	if (drawlist.has3d)
+		FL_SET(tgt, TGTFL_UNTRACKED);
+	else
+		FL_CLEAR(tgt, TGTFL_UNTRACKED);
+
+	for (size_t i = 0; i < drawlist.count; i++){
+		arcan_vobject* elem = drawlist.elem[i];
+		bool ok = sampled_add(&set, &count, &limit, drawlist.vstore[i]);
+
+		if (ok && (drawlist.flags[i] & DRAW_FRAMESET))
+			for (size_t j = 0; j < elem->frameset->n_frames && ok; j++)
+				ok = sampled_add(
+					&set, &count, &limit, elem->frameset->frames[j].frame);
+
+/* not knowing what is sampled from is the same as sampling everything */
+		if (!ok){
+			FL_SET(tgt, TGTFL_UNTRACKED);
+			break;
+		}
+	}
+
+	qsort(set, count, sizeof(*set), cmp_storeptr);
+	size_t nu = 0;
+	for (size_t i = 0; i < count; i++)
+		if (!nu || set[nu-1] != set[i])
+			set[nu++] = set[i];
+
+	if (nu == tgt->sampled.count &&
+		(!nu || memcmp(set, tgt->sampled.stores, nu * sizeof(*set)) == 0))
+		return;
+
+/* the graph only changes if a rendertarget store was added or removed, but
+ * the set is usually small enough for it to not be worth finding out */
+	rtgt_graph.valid = false;
+
+	if (nu > tgt->sampled.limit){
+		struct agp_vstore** ns = arcan_alloc_mem(nu * sizeof(*ns),
+			ARCAN_MEM_VSTRUCT, ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_NATURAL);
+		if (!ns){
+			FL_SET(tgt, TGTFL_UNTRACKED);
+			return;
+		}
+		arcan_mem_free(tgt->sampled.stores);
+		tgt->sampled.stores = ns;
+		tgt->sampled.limit = nu;
+	}
+
+	if (nu)
+		memcpy(tgt->sampled.stores, set, nu * sizeof(*set));
+	tgt->sampled.count = nu;
+}
+
+static size_t process_rendertarget(struct rendertarget* tgt, float fract)
+{
+	arcan_vobject_litem* current;
+	if (tgt->link){
+		current = tgt->link->first;
+		tgt->dirtyc += tgt->link->dirtyc;
+		tgt->transfc += tgt->link->transfc;
+	}
+	else
+		current = tgt->first;
+
+	if (arcan_video_display.ignore_dirty == false &&
+		(!tgt->link && tgt->dirtyc == 0 && tgt->transfc == 0))
+		return 0;
+
+/* a linked rendertarget draws the pipeline of another, the per-item damage
+ * state belongs to that one so don't touch it */
+	build_drawlist(tgt, current, fract);
+	sampled_update(tgt);
+	if (tgt->link)
+		tgt->damage.full = true;
+	else
+		collect_damage(tgt);
+
+	size_t total = (size_t) tgt->color->vstore->w * tgt->color->vstore->h;
+	size_t area = 0;
+	for (size_t i = 0; i < tgt->damage.n_rects; i++)
+		area += region_area(&tgt->damage.rects[i]);
+
+/* without clearing, the previous contents are part of the output and we
+ * can't know what they are, and there is no point in scissoring if most of
+ * the target would be redrawn anyhow */
+	bool full = tgt->damage.full || !tgt->art ||
+		arcan_video_display.ignore_dirty ||
+		FL_TEST(tgt, TGTFL_NOCLEAR) || FL_TEST(tgt, TGTFL_NODAMAGE) ||
+		area * 100 > total * RENDERTARGET_DAMAGE_CUTOFF;
+
+	if (!full && tgt->damage.n_rects == 0){
+		arcan_bench_register_damage(false, 0, 0, total);
+		return 0;
+	}
+
+	current_rendertarget = tgt;
+	agp_activate_rendertarget(tgt->art);
+	agp_shader_envv(RTGT_ID, &tgt->id, sizeof(int));
+
+/* uniform updates while drawing would otherwise invalidate everything */
+	bool full_damage = arcan_video_display.full_damage;
+	size_t pc = 0;
+
+	if (!full){
+		for (size_t i = 0; i < tgt->damage.n_rects; i++){
+			struct rtgt_region* r = &tgt->damage.rects[i];
+			agp_rendertarget_scissor(tgt->art,
+				r->x1, r->y1, r->x2 - r->x1, r->y2 - r->y1);
+			agp_rendertarget_clear();
+			pc += draw_2d(tgt, fract, r);
+		}
+		agp_rendertarget_scissor(tgt->art, 0, 0, 0, 0);
+		goto out;
+	}
+
+	if (!FL_TEST(tgt, TGTFL_NOCLEAR))
+		agp_rendertarget_clear();
+
+/* first, handle all 3d work (which may require multiple passes etc.) */
+	if (tgt->order3d == ORDER3D_FIRST && current && current->elem->order < 0){
+		current = arcan_3d_refresh(tgt->camtag, current, fract);
+		pc++;
+	}
+
+	if (drawlist.count)
+		pc += draw_2d(tgt, fract, NULL);
+
 /* reset and try the 3d part again if requested */
-end3d:
 	current = tgt->first;
 	if (current && current->elem->order < 0 && tgt->order3d == ORDER3D_LAST){
 		agp_shader_activate(agp_default_shader(BASIC_2D));
@@ -5026,6 +6882,25 @@ end3d:
 			pc++;
 	}
 
+out:
+	arcan_video_display.full_damage = full_damage;
+
+/* forward to anything that samples from the rendertarget */
+	if (full)
+		arcan_vint_storedamage(tgt->color->vstore, 0, 0, 0, 0);
+	else {
+		struct rtgt_region u = tgt->damage.rects[0];
+		for (size_t i = 1; i < tgt->damage.n_rects; i++)
+			u = region_union(&u, &tgt->damage.rects[i]);
+		arcan_vint_storedamage(tgt->color->vstore, u.x1, u.y1, u.x2, u.y2);
+	}
+
+	arcan_bench_register_damage(full,
+		full ? 0 : tgt->damage.n_rects, full ? total : area, total);
+
+	tgt->damage.n_rects = 0;
+	tgt->damage.full = false;
+
 	return pc;
 }
 
@@ -5097,6 +6972,7 @@ arcan_errc arcan_video_forceupdate(arcan_vobj_id vid)
 
 	FLAG_DIRTY(vobj);
 
+	unsigned long long bts = arcan_bench_timestamp();
 	bool id = arcan_video_display.ignore_dirty;
 	arcan_video_display.ignore_dirty = true;
 	process_rendertarget(tgt, arcan_video_display.c_lerp);
@@ -5108,6 +6984,7 @@ arcan_errc arcan_video_forceupdate(arcan_vobj_id vid)
 		process_readback(tgt, arcan_video_display.c_lerp);
 		arcan_vint_pollreadback(tgt);
 	}
+	arcan_bench_register_stage(ARCAN_BENCH_RTGT, bts);
 
 	return ARCAN_OK;
 }
@@ -5160,16 +7037,69 @@ static size_t steptgt(float fract, struct rendertarget* tgt)
 	size_t transfc = 0;
 	if (tgt->refresh < 0 && process_counter(tgt,
 		&tgt->refreshcnt, tgt->refresh, fract)){
+		unsigned long long bts = arcan_bench_timestamp();
 		process_rendertarget(tgt, fract);
 		transfc = tgt->transfc;
 		tgt->dirtyc = 0;
 /* may need to readback even if we havn't updated as it may
  * be used as clock (though optimization possibility of using buffer) */
 		process_readback(tgt, fract);
+		arcan_bench_register_stage(ARCAN_BENCH_RTGT, bts);
 	}
 	return transfc;
 }
 
+/*
+ * Depth-first over the rendertargets that each one samples from, so that a
+ * rendertarget is placed after everything that feeds into it. Cycles (two
+ * rendertargets sampling each other) are broken where they are found, and
+ * that edge simply takes an extra refresh like before.
+ */
+static void rtgt_graph_visit(size_t ind, uint8_t* mark)
+{
+	struct rendertarget* tgt = current_context->rtargets[ind];
+	mark[ind] = 1;
+
+	for (size_t i = 0; i < current_context->n_rtargets; i++){
+		if (mark[i])
+			continue;
+
+		struct rendertarget* src = current_context->rtargets[i];
+		if (src->color && (src == tgt->link ||
+			sampled_find(tgt, src->color->vstore)))
+			rtgt_graph_visit(i, mark);
+	}
+
+	mark[ind] = 2;
+	rtgt_graph.order[rtgt_graph.count++] = ind;
+}
+
+static void rtgt_graph_sort()
+{
+	size_t n = current_context->n_rtargets;
+	rtgt_graph.count = 0;
+
+	if (n > rtgt_graph.limit){
+		size_t* order = arcan_alloc_mem(n * sizeof(size_t),
+			ARCAN_MEM_VSTRUCT, ARCAN_MEM_NONFATAL, ARCAN_MEMALIGN_NATURAL);
+		if (!order)
+			return;
+
+		arcan_mem_free(rtgt_graph.order);
+		rtgt_graph.order = order;
+		rtgt_graph.limit = n;
+	}
+
+	uint8_t mark[n > 0 ? n : 1];
+	memset(mark, '\0', sizeof(mark));
+
+	for (size_t i = 0; i < n; i++)
+		if (!mark[i])
+			rtgt_graph_visit(i, mark);
+
+	rtgt_graph.valid = true;
+}
+
 unsigned arcan_vint_refresh(float fract, size_t* ndirty)
 {
 	long long int pre = arcan_timemillis();
@@ -5179,26 +7109,60 @@ unsigned arcan_vint_refresh(float fract, size_t* ndirty)
 	arcan_video_display.c_lerp = fract;
 
 /* active shaders with counter counts towards dirty */
-	arcan_video_display.dirty +=
-		agp_shader_envv(FRACT_TIMESTAMP_F, &fract, sizeof(float));
-
-/* rendertargets may be composed on world- output, begin there */
-	for (size_t ind = 0; ind < current_context->n_rtargets; ind++){
-		struct rendertarget* tgt = &current_context->rtargets[ind];
-		tgt->dirtyc += arcan_video_display.dirty;
-		transfc += steptgt(fract, tgt);
-	}
+	int nshtime = agp_shader_envv(FRACT_TIMESTAMP_F, &fract, sizeof(float));
+	arcan_video_display.dirty += nshtime;
+	if (nshtime > 0)
+		arcan_video_display.full_damage = true;
+
+/* invalidations that could not be attributed to a region */
+	if (arcan_video_display.full_damage){
+		for (size_t ind = 0; ind < current_context->n_rtargets; ind++)
+			current_context->rtargets[ind]->damage.full = true;
+		current_context->stdoutp.damage.full = true;
+		rtgt_dirty_all();
+		arcan_video_display.full_damage = false;
+	}
+
+	if (!rtgt_graph.valid)
+		rtgt_graph_sort();
+	size_t pending = damaged.count;
+
+/* rendertargets may be composed on world- output, begin there, and as the
+ * store damage from a processed rendertarget is added to the list, anything
+ * that samples from it later in the order will see it */
+	if (rtgt_graph.valid)
+		for (size_t i = 0; i < rtgt_graph.count; i++){
+			struct rendertarget* tgt =
+				current_context->rtargets[rtgt_graph.order[i]];
+			rtgt_pending(tgt);
+			transfc += steptgt(fract, tgt);
+		}
+	else
+		for (size_t ind = 0; ind < current_context->n_rtargets; ind++){
+			struct rendertarget* tgt = current_context->rtargets[ind];
+			rtgt_pending(tgt);
+			transfc += steptgt(fract, tgt);
+		}
 
 /* reset the bound rendertarget, otherwise we may be in an undefined
  * state if world isn't dirty or with pending transfers */
 	current_rendertarget = NULL;
 	agp_activate_rendertarget(NULL);
 
-	current_context->stdoutp.dirtyc += arcan_video_display.dirty;
+	rtgt_pending(&current_context->stdoutp);
 	transfc += steptgt(fract, &current_context->stdoutp);
 	*ndirty = arcan_video_display.dirty;
 	arcan_video_display.dirty = transfc;
 
+/* store changes from here on accumulate into a new region, what the
+ * rendertargets themselves damaged is kept as it may be sampled by one that
+ * came before in the order (cycle) */
+	arcan_video_display.damage_epoch++;
+	damaged.count -= pending;
+	if (damaged.count)
+		memmove(damaged.stores, &damaged.stores[pending],
+			damaged.count * sizeof(struct agp_vstore*));
+
 	long long int post = arcan_timemillis();
 	return post - pre;
 }
@@ -5322,6 +7286,7 @@ arcan_errc arcan_video_sliceobject(arcan_vobj_id sid,
 	if (!src)
 		return ARCAN_ERRC_NO_SUCH_OBJECT;
 
+	arcan_vint_imgcache_unshare(src);
 	return (agp_slice_vstore(src->vstore, n_slices, base,
 		type == ARCAN_CUBEMAP ? TXSTATE_CUBE : TXSTATE_TEX3D))
 		? ARCAN_OK : ARCAN_ERRC_UNACCEPTED_STATE;
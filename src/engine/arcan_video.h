@@ -493,10 +493,22 @@ vfunc_state* arcan_video_feedstate(arcan_vobj_id);
 
 /*
  * Run through all registered dynamic feed objects and request that they
- * notify if their internal state has changed or not. If it has, backing
- * stores will update.
+ * notify if their internal state has changed or not. The ones that have are
+ * gathered and their backing stores updated, feeds bound to [prio] first and
+ * the rest in order of how many times they have been deferred.
+ *
+ * If [budget] (microseconds, 0 for no limit) has been exceeded, remaining
+ * updates are deferred to the next call, unless they have been deferred too
+ * many times already. Returns the number of deferred updates and sets
+ * [nupd] (if provided) to the number of performed ones.
+ */
+size_t arcan_video_pollfeed(arcan_vobj_id prio, unsigned budget, size_t* nupd);
+
+/*
+ * Check rendertargets for completed asynchronous readbacks and forward the
+ * results to the feed function of each target.
  */
-void arcan_video_pollfeed();
+void arcan_video_pollreadback();
 
 /*
  * Forcibly alter the feed state for the specified object,
@@ -517,10 +529,11 @@ arcan_errc arcan_video_resizefeed(arcan_vobj_id id, size_t w, size_t h);
  * defined in the resource will be retained, otherwise the image will be
  * rescaled upon loading (unfiltered and rather slow).
  *
- * The asynchronous version will spawn a worker thread (up to a certain
- * number, compile-time limited with ASYNCH_CONCURRENT_THREADS).
- * Context operations will force a join on any outstanding asynchronous
- * loading jobs.
+ * The asynchronous version will queue the decoding to a pool of worker
+ * threads (one per core, compile-time limited with ASYNCH_CONCURRENT_THREADS)
+ * where objects that are visible are serviced first. Deleting the object
+ * cancels the job. Context operations will force a join on any outstanding
+ * asynchronous loading jobs.
  *
  * Loadimage returns ARCAN_EID on failure, asynch will always succeed but
  * may later enqueue EVENT_ASYNCHIMAGE_FAILED or EVENT_VIDEO_ASYNCHIMAGE_LOADED
@@ -12,17 +12,30 @@
 #ifndef _HAVE_ARCAN_VIDEOINT
 #define _HAVE_ARCAN_VIDEOINT
 
-#ifndef RENDERTARGET_LIMIT
-#define RENDERTARGET_LIMIT 64
+/*
+ * number of separate invalidation regions tracked per rendertarget before
+ * they start getting merged, past this point the cost of re-walking the
+ * pipeline for each region tends to outweigh the saved fillrate
+ */
+#ifndef RENDERTARGET_DAMAGE_LIMIT
+#define RENDERTARGET_DAMAGE_LIMIT 8
+#endif
+
+/*
+ * if the damaged area covers more than this percentage of the rendertarget,
+ * just go with a full redraw
+ */
+#ifndef RENDERTARGET_DAMAGE_CUTOFF
+#define RENDERTARGET_DAMAGE_CUTOFF 70
 #endif
 
 /*
  *  Indicate that the video pipeline is in such a state that
- *  it should be redrawn. X should be NULL or a vobj reference
- *  (to permit partial redraws in the future if we need to save
- *  bandwidth).
+ *  it should be redrawn. X should be NULL or a vobj reference,
+ *  with NULL invalidating every rendertarget in full while a vobj
+ *  reference limits the redraw to the region the vobj covers.
  */
-#define FLAG_DIRTY(X) (arcan_video_display.dirty++);
+#define FLAG_DIRTY(X) (arcan_vint_flagdirty(X));
 
 #define FL_SET(obj_ptr, fl) ((obj_ptr)->flags |= fl)
 #define FL_CLEAR(obj_ptr, fl) ((obj_ptr)->flags &= ~fl)
@@ -32,9 +45,16 @@ struct arcan_vobject_litem;
 struct arcan_vobject;
 
 enum rtgt_flags {
-	TGTFL_READING = 1,
-	TGTFL_ALIVE   = 2,
-	TGTFL_NOCLEAR = 4
+	TGTFL_READING  = 1,
+	TGTFL_ALIVE    = 2,
+	TGTFL_NOCLEAR  = 4,
+	TGTFL_NODAMAGE = 8, /* contents not retained between frames, always redraw */
+	TGTFL_UNTRACKED = 16 /* 3d pipeline, changes can't be attributed, see dirtyc */
+};
+
+/* invalidated area in framebuffer pixels, origo in the lower left corner */
+struct rtgt_region {
+	int x1, y1, x2, y2;
 };
 
 struct rendertarget {
@@ -50,6 +70,17 @@ struct rendertarget {
 	struct arcan_vobject* color;
 	struct arcan_vobject_litem* first;
 
+/* the same items as the pipeline, in the same order but as a sorted array,
+ * so that insertion points and items can be found with a binary search
+ * rather than a walk of the list. If !valid, it is rebuilt from the list on
+ * next use (e.g. after a context push copied the rendertarget) */
+	struct {
+		struct arcan_vobject_litem** items;
+		size_t count;
+		size_t limit;
+		bool valid;
+	} index;
+
 /* it is possible for one rendertarget to share the pipeline with
  * another, if so, first is set to NULL and link points to the rtgt vid */
 	struct rendertarget* link;
@@ -78,15 +109,39 @@ struct rendertarget {
 	size_t transfc;
 
 /*
- * dirty- management is still incomplete in two ways, one is that dirty-
- * flagging is a global video state and not bound to rendertarget which is in
- * conflict with rendertargets being updated at different clocks.
- * second is that we do not consider the dirty- area, and just go for a full
- * redraw when it is time. Important optimizations but still low on the list.
- * When it is to be implemented, use this variable, an list of invalidation
- * rects and sweep the codebase for FLAG_DIRTY
+ * dirtyc counts changes that are known to affect this rendertarget: objects
+ * in the pipeline flagged dirty (via their owner), running transformations,
+ * and damage to any of the stores in [sampled]. Only if it is non-zero does
+ * the refresh bother with building the drawlist at all. Targets flagged as
+ * UNTRACKED are stepped by any change, like every target used to be.
+ *
+ * The actual invalidation is tracked in damage: each pipeline item remembers
+ * the region and state it was last drawn with (see collect_damage in
+ * arcan_video.c), changes get added as rects here, and the refresh then
+ * clears and redraws only those regions using the scissor. Anything that
+ * can't be attributed to a region (FLAG_DIRTY(NULL), timed shaders, 3d
+ * pipeline, ...) sets full.
  */
 	size_t dirtyc;
+	struct {
+		struct rtgt_region rects[RENDERTARGET_DAMAGE_LIMIT];
+		size_t n_rects;
+		bool full;
+		float projection[16];
+	} damage;
+
+/*
+ * the stores that the pipeline sampled from the last time it was processed,
+ * sorted on address. These are only ever compared against, never accessed,
+ * as the store might have been dropped since. Used both to find out if a
+ * damaged store affects this target, and which other rendertargets feed into
+ * this one so that they can be refreshed first.
+ */
+	struct {
+		struct agp_vstore** stores;
+		size_t count;
+		size_t limit;
+	} sampled;
 
 /*
  * track density per rendertarget, this affects some video objects that gets
@@ -192,9 +247,9 @@ struct vobject_frameset {
  *
  *  - smaller types -> a lot of members use way to large integer ranges
  *
- *  - rendertargets -> dynamically grow, pack / re-arrange on creation
- *
- *  - prefetch vobj->next and vobj
+ *  - the per-frame state the draw loop needs is flattened into packed
+ *    arrays (see build_drawlist in arcan_video.c), so the members here that
+ *    are only read through that path can be grouped further
  *
  *  - use external re-order tool to cut down on padding
  *
@@ -218,6 +273,10 @@ typedef struct arcan_vobject {
 		enum arcan_ffunc ffunc;
 		vfunc_state state;
 		int pcookie;
+
+/* number of polls in a row where a pending frame has been deferred due to
+ * the upload budget, used to order and to prevent starvation */
+		uint8_t deferred;
 	} feed;
 
 /* if NULL, a default mapping will be used */
@@ -253,6 +312,9 @@ typedef struct arcan_vobject {
 	struct rendertarget* owner;
 	arcan_vobj_id cellid;
 
+/* set if the object is the color attachment of a rendertarget (FL_RTGT) */
+	struct rendertarget* rtgt;
+
 #ifdef _DEBUG
 	bool frozen;
 #endif
@@ -265,6 +327,9 @@ typedef struct arcan_vobject {
 	} extrefc;
 
 	char* tracetag;
+
+/* stepped on FLAG_DIRTY(vobj), compared against in damage tracking */
+	uint32_t dirtyc;
 } arcan_vobject;
 
 /* regular old- linked list, but also mapped to an array */
@@ -272,6 +337,24 @@ struct arcan_vobject_litem {
 	arcan_vobject* elem;
 	struct arcan_vobject_litem* next;
 	struct arcan_vobject_litem* previous;
+
+/* the region and state the object had when last drawn in this particular
+ * rendertarget, as the same vobj can be attached to several of them */
+	struct {
+		bool valid, visible;
+		struct rtgt_region region;
+		surface_properties props;
+		struct agp_vstore* store;
+		uint32_t store_gen;
+		uint32_t dirtyc;
+		size_t origw, origh;
+		point origo_ofs;
+		float txcos[8];
+		agp_shader_id program;
+		enum arcan_blendfunc blendmode;
+		enum arcan_clipmode clip;
+		int order;
+	} damage;
 };
 typedef struct arcan_vobject_litem arcan_vobject_litem;
 
@@ -279,7 +362,8 @@ struct arcan_video_display {
 	bool suspended, fullscreen, conservative, in_video, no_stdout;
 
 	int dirty;
-	bool ignore_dirty;
+	bool ignore_dirty, full_damage;
+	uint32_t damage_epoch;
 	enum arcan_order3d order3d;
 
 /*
@@ -337,9 +421,13 @@ struct arcan_video_context {
 	arcan_vobject world;
 	arcan_vobject* vitems_pool;
 
-	struct rendertarget rtargets[RENDERTARGET_LIMIT];
+/* each rendertarget is allocated separately so that references to it
+ * (vobj->owner, ->rtgt, link, attachment) stay valid when the array grows
+ * or gets compacted on delete, and a context push doesn't need to copy them */
+	struct rendertarget** rtargets;
 	struct rendertarget* attachment;
 	ssize_t n_rtargets;
+	size_t rtarget_limit;
 
 	struct rendertarget stdoutp;
 };
@@ -356,6 +444,10 @@ extern struct arcan_video_display arcan_video_display;
  *
  * This will only populate the underlying vstores, mapping to the output
  * display is made by the platform_video_sync function.
+ *
+ * Rendertargets are processed so that one which samples from the store of
+ * another comes after it, so chains settle within the same refresh, and only
+ * those that had something they contain or sample change are redrawn.
  */
 unsigned arcan_vint_refresh(float fragment, size_t* ndirty);
 
@@ -369,6 +461,22 @@ void arcan_resolve_vidprop(arcan_vobject* vobj,
 arcan_vobject* arcan_video_getobject(arcan_vobj_id id);
 arcan_vobject* arcan_video_newvobject(arcan_vobj_id* id);
 
+/*
+ * implementation of FLAG_DIRTY, [vobj] can be NULL and then every
+ * rendertarget will be fully redrawn on the next refresh
+ */
+void arcan_vint_flagdirty(arcan_vobject* vobj);
+
+/*
+ * mark that the contents of a store has changed, any object that samples
+ * from it will be damaged on the next refresh. The region is in store pixels
+ * (texture rows, so y1 is the first row uploaded) and will be clamped, a
+ * region of x2 <= x1 or y2 <= y1 covers the entire store. Also counts
+ * towards the dirty state like FLAG_DIRTY.
+ */
+void arcan_vint_storedamage(struct agp_vstore* vs,
+	size_t x1, size_t y1, size_t x2, size_t y2);
+
 /*
  * agp_drop_vstore does not explicitly manage reference counting etc. that is
  * up to the video layer. All cases that access s-> directly should be
@@ -386,12 +494,21 @@ void arcan_vint_pollreadback(struct rendertarget* rtgt);
 arcan_errc arcan_vint_attachobject(arcan_vobj_id id);
 
 /*
- * semaphore- rate limited image decoding and repacking to native
- * format used both threaded and non-threaded
+ * image decoding and conversion to the native format used both threaded
+ * and non-threaded, unless the image needs to be rescaled the decoder output
+ * is converted in place and becomes the store buffer
  */
 arcan_errc arcan_vint_getimage(const char* fname,
 	arcan_vobject* dst, img_cons forced, bool asynchsrc);
 
+/*
+ * images loaded from the same file with the same decode options share one
+ * store through the decoded image cache. Call this before modifying the store
+ * (contents, filtering, dimensions, ...) so that the changes only apply to
+ * [vobj], it will get a private copy if the store is shared this way.
+ */
+void arcan_vint_imgcache_unshare(arcan_vobject* vobj);
+
 #ifdef _DEBUG
 void arcan_debug_tracetag_dump();
 #endif
@@ -9,6 +9,8 @@
 #include <signal.h>
 #include <pthread.h>
 #include <poll.h>
+#include <fcntl.h>
+#include <stdatomic.h>
 #include "tsm/libtsm.h"
 #include "tsm/libtsm_int.h"
 #include "tsm/shl-pty.h"
@@ -20,9 +22,42 @@ static struct {
 	pid_t child;
 
 	bool alive;
-	long last_input;
 } term;
 
+/*
+ * The pty is read from a separate thread into this ring so that a flood of
+ * output doesn't compete with input handling and drawing. Single producer
+ * (reader thread), single consumer (main loop); head and tail are free
+ * running counters and only the owner of each side writes to it.
+ */
+#define PTY_RING_SZ (1 << 22)
+#define PTY_RING_CHUNK 16384
+
+static struct {
+	uint8_t* buf;
+	_Atomic size_t head;
+	_Atomic size_t tail;
+
+/* wakeup pipe for the main loop, only written on the empty -> data edge */
+	int wake[2];
+	_Atomic bool wake_pending;
+
+/* reader blocks here when the ring is full, until the main loop consumes */
+	pthread_mutex_t lock;
+	pthread_cond_t space;
+
+	pthread_t thread;
+	bool thread_alive;
+	_Atomic bool shutdown;
+	_Atomic bool eof;
+	int fd;
+} ring = {
+	.wake = {-1, -1},
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.space = PTHREAD_COND_INITIALIZER,
+	.fd = -1
+};
+
 static inline void trace(const char* msg, ...)
 {
 #ifdef TRACE_ENABLE
@@ -34,27 +69,172 @@ static inline void trace(const char* msg, ...)
 #endif
 }
 
+static void ring_wake()
+{
+	if (!atomic_exchange(&ring.wake_pending, true)){
+		char ch = 0;
+		if (-1 == write(ring.wake[1], &ch, 1) && errno != EAGAIN)
+			trace("ring wakeup failed: %s", strerror(errno));
+	}
+}
+
 /*
- * process one round of PTY input, this is non-blocking
+ * reader thread: poll the pty (own dup of the descriptor so a close on the
+ * main thread can't pull it out from under us) and read straight into the
+ * free part of the ring. If the ring is full we simply stop reading and let
+ * the pty apply backpressure to the client.
  */
-void pump_pty()
+static void* pty_reader(void* tag)
 {
-	int count = 10;
-	while (term.alive && count--){
-		int rv = shl_pty_dispatch(term.pty);
-		if (rv == -ENODEV){
-			term.alive = false;
+	struct pollfd pfd = {
+		.fd = ring.fd,
+		.events = POLLIN
+	};
+
+	while (!atomic_load(&ring.shutdown)){
+		size_t head = atomic_load_explicit(&ring.head, memory_order_relaxed);
+		size_t tail = atomic_load_explicit(&ring.tail, memory_order_acquire);
+		size_t space = PTY_RING_SZ - (head - tail);
+
+		if (!space){
+			pthread_mutex_lock(&ring.lock);
+			while (!atomic_load(&ring.shutdown) &&
+				atomic_load_explicit(&ring.tail, memory_order_acquire) + PTY_RING_SZ == head)
+				pthread_cond_wait(&ring.space, &ring.lock);
+			pthread_mutex_unlock(&ring.lock);
+			continue;
 		}
-		else if (rv == -EAGAIN){
+
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+
+		size_t ofs = head & (PTY_RING_SZ - 1);
+		size_t ntr = PTY_RING_SZ - ofs;
+		if (ntr > space)
+			ntr = space;
+
+		ssize_t nr = read(ring.fd, &ring.buf[ofs], ntr);
+		if (nr > 0){
+			atomic_store_explicit(&ring.head, head + nr, memory_order_release);
+			ring_wake();
 			continue;
 		}
-		else if (rv > 0){
-			term.last_input = arcan_timemillis();
-			break;
+
+		if (nr == -1 && (errno == EAGAIN || errno == EINTR))
+			continue;
+
+/* EOF or EIO when the client side is gone */
+		break;
+	}
+
+	atomic_store(&ring.eof, true);
+	ring_wake();
+	close(ring.fd);
+	return NULL;
+}
+
+static bool ring_setup(int fd)
+{
+	ring.buf = malloc(PTY_RING_SZ);
+	if (!ring.buf)
+		return false;
+
+	if (-1 == pipe(ring.wake))
+		return false;
+
+	for (size_t i = 0; i < 2; i++){
+		fcntl(ring.wake[i], F_SETFD, FD_CLOEXEC);
+		fcntl(ring.wake[i], F_SETFL, O_NONBLOCK);
+	}
+
+	ring.fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	if (-1 == ring.fd)
+		return false;
+
+/* signals (SIGHUP, SIGCHLD, ...) should keep arriving on the main thread */
+	sigset_t mask, old;
+	sigfillset(&mask);
+	pthread_sigmask(SIG_SETMASK, &mask, &old);
+	ring.thread_alive = 0 == pthread_create(&ring.thread, NULL, pty_reader, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (!ring.thread_alive){
+		close(ring.fd);
+		ring.fd = -1;
+	}
+
+	return ring.thread_alive;
+}
+
+static void ring_shutdown()
+{
+	if (ring.thread_alive){
+		pthread_mutex_lock(&ring.lock);
+		atomic_store(&ring.shutdown, true);
+		pthread_cond_signal(&ring.space);
+		pthread_mutex_unlock(&ring.lock);
+		pthread_join(ring.thread, NULL);
+		ring.thread_alive = false;
+	}
+
+	for (size_t i = 0; i < 2; i++)
+		if (-1 != ring.wake[i]){
+			close(ring.wake[i]);
+			ring.wake[i] = -1;
 		}
-		else
-			break;
+
+	free(ring.buf);
+	ring.buf = NULL;
+}
+
+static bool ring_pending()
+{
+	return atomic_load_explicit(&ring.head, memory_order_acquire) !=
+		atomic_load_explicit(&ring.tail, memory_order_relaxed);
+}
+
+/*
+ * feed what the reader thread has queued into the state machine until the
+ * ring is empty or [budget] ms have been spent, returns the time spent
+ */
+static int ring_drain(int budget)
+{
+	char dump[64];
+	while (read(ring.wake[0], dump, sizeof(dump)) > 0){}
+	atomic_store(&ring.wake_pending, false);
+
+	long long start = arcan_timemillis();
+	size_t head = atomic_load_explicit(&ring.head, memory_order_acquire);
+	size_t tail = atomic_load_explicit(&ring.tail, memory_order_relaxed);
+	size_t first = tail;
+
+	while (tail != head && arcan_timemillis() - start < budget){
+		size_t ofs = tail & (PTY_RING_SZ - 1);
+		size_t ntw = head - tail;
+		if (ntw > PTY_RING_SZ - ofs)
+			ntw = PTY_RING_SZ - ofs;
+		if (ntw > PTY_RING_CHUNK)
+			ntw = PTY_RING_CHUNK;
+
+		tsm_vte_input(term.vte, (char*) &ring.buf[ofs], ntw);
+		tail += ntw;
+		atomic_store_explicit(&ring.tail, tail, memory_order_release);
+		head = atomic_load_explicit(&ring.head, memory_order_acquire);
 	}
+
+/* the reader might be waiting for space, taking the lock here means it is
+ * either already in the wait or will see the new tail before it */
+	if (tail != first){
+		pthread_mutex_lock(&ring.lock);
+		pthread_cond_signal(&ring.space);
+		pthread_mutex_unlock(&ring.lock);
+	}
+
+/* only consider the client gone when everything it wrote has been shown */
+	if (tail == head && atomic_load(&ring.eof))
+		term.alive = false;
+
+	return arcan_timemillis() - start;
 }
 
 static void dump_help()
@@ -74,10 +254,12 @@ static void dump_help()
 		"             \t           \t vline, uline)\n"
 		" blink       \t ticks     \t set blink period, 0 to disable (default: 12)\n"
 		" login       \t [user]    \t login (optional: user, only works for root)\n"
-		" min_upd     \t ms        \t wait at least [ms] between refreshes (default: 30)\n"
+		" min_upd     \t ms        \t wait at least [ms] between refreshes (default: 24)\n"
+		" budget      \t ms        \t max time spent parsing per refresh (default: 16)\n"
 		" substitute  \t           \t (experimental) allow ligature substitution\n"
 		" shape       \t           \t (experimental) allow non-monospace font shaping\n"
 		" scroll      \t steps     \t (experimental) smooth scrolling, (default:0=off) steps px/upd\n"
+		" scrollback  \t lines     \t lines of history to keep (default: 1000)\n"
 		" palette     \t name      \t use built-in palette (below)\n"
 		"Built-in palettes:\n"
 		"default, solarized, solarized-black, solarized-white\n"
@@ -169,12 +351,6 @@ static void on_resize(struct tui_context* c,
 	last_frame = 0;
 }
 
-static void read_callback(struct shl_pty* pty,
-	void* data, char* u8, size_t len)
-{
-	tsm_vte_input(term.vte, u8, len);
-}
-
 static void write_callback(struct tsm_vte* vte,
 	const char* u8, size_t len, void* data)
 {
@@ -325,15 +501,16 @@ int afsrv_terminal(struct arcan_shmif_cont* con, struct arg_arr* args)
 	}
 
 /* 24 ms + font rendering time should put us at a passive refresh rate of
- * about 30Hz, then we short this if we get keyboard input */
+ * about 30Hz, with at most cap_budget of that spent parsing pty output so
+ * that input handling and drawing still gets its share under a flood */
 	int cap_refresh = 24;
-	int cap_timeout = 200;
+	int cap_budget = 16;
 
 	if (arg_lookup(args, "min_upd", 0, &val))
 		cap_refresh = strtol(val, NULL, 10);
 
-	if (arg_lookup(args, "min_wait", 0, &val))
-		cap_timeout = strtol(val, NULL, 10);
+	if (arg_lookup(args, "budget", 0, &val))
+		cap_budget = strtol(val, NULL, 10);
 
 	struct tui_cbcfg cbcfg = {
 		.input_mouse_motion = on_mouse_motion,
@@ -407,7 +584,7 @@ int afsrv_terminal(struct arcan_shmif_cont* con, struct arg_arr* args)
  */
 	size_t rows = 0, cols = 0;
 	arcan_tui_dimensions(term.screen, &rows, &cols);
-	term.child = shl_pty_open(&term.pty, read_callback, NULL, cols, rows);
+	term.child = shl_pty_open(&term.pty, NULL, NULL, cols, rows);
 	if (term.child < 0){
 		arcan_tui_destroy(term.screen, "Shell process died unexpectedly");
 		return EXIT_FAILURE;
@@ -439,34 +616,61 @@ int afsrv_terminal(struct arcan_shmif_cont* con, struct arg_arr* args)
 	pledge(SHMIF_PLEDGE_PREFIX " tty", NULL);
 #endif
 
+	if (!ring_setup(shl_pty_get_fd(term.pty))){
+		ring_shutdown();
+		shl_pty_close(term.pty);
+		arcan_tui_destroy(term.screen, "Couldn't setup pty reader");
+		return EXIT_FAILURE;
+	}
+
 	term.alive = true;
 
 /* the better latency tactic would be to align against the falling edge, but
  * with a pending render refactor to move it upstream, any synch will be much
- * more deterministic so better to wait for that */
+ * more deterministic so better to wait for that. Until then, the pty output
+ * is coalesced and we refresh at most once every cap_refresh ms. */
+	int spent = 0;
+	long long budget_ts = 0;
 	while (term.alive){
-		do {
-			int delta = arcan_timemillis() - last_frame;
-			if (delta < cap_refresh)
-				delta = cap_refresh - delta;
-			else
-				delta = 0;
-
-			int ptyfd = shl_pty_get_fd(term.pty);
-			pump_pty();
-			struct tui_process_res res =
-				arcan_tui_process(&term.screen, 1, &ptyfd, 1, delta);
-
-			if (res.errc < TUI_ERRC_OK || res.bad){
-				goto out;
-			}
+		long long now = arcan_timemillis();
+		if (now - budget_ts >= cap_refresh){
+			budget_ts = now;
+			spent = 0;
 		}
-		while (
-			arcan_timemillis() - term.last_input < cap_refresh &&
-			arcan_timemillis() - last_frame < cap_timeout
-		);
 
-/* and on an actually successful update, reset the user-input flag and timing */
+		int delta = now - last_frame;
+		if (delta < cap_refresh)
+			delta = cap_refresh - delta;
+		else
+			delta = 0;
+
+/* with data left over and budget to spare, don't sleep on the event loop, with
+ * the budget exhausted, don't wake up on more data arriving either */
+		bool parse = spent < cap_budget;
+		if (parse && ring_pending())
+			delta = 0;
+
+		struct tui_process_res res = arcan_tui_process(
+			&term.screen, 1, &ring.wake[0], parse ? 1 : 0, delta);
+
+		if (res.errc < TUI_ERRC_OK || res.bad){
+			goto out;
+		}
+
+		if (parse)
+			spent += ring_drain(cap_budget - spent);
+
+/* SIGHUP closes the pty from under us, the reader has its own descriptor so
+ * it is shut down on the way out to let the child see the hangup */
+		if (!term.pty || -ENODEV == shl_pty_flush(term.pty)){
+			term.alive = false;
+			break;
+		}
+
+		if (arcan_timemillis() - last_frame < cap_refresh)
+			continue;
+
+/* and on an actually successful update, reset the timing */
 		int rc = arcan_tui_refresh(term.screen);
 		tsm_vte_update_debug(term.vte);
 
@@ -478,6 +682,8 @@ int afsrv_terminal(struct arcan_shmif_cont* con, struct arg_arr* args)
 
 /* might have been destroyed already, just in case */
 	out:
+	ring_shutdown();
+
 	if (term.pty)
 		term.pty = (shl_pty_close(term.pty), NULL);
 
@@ -144,6 +144,7 @@ struct tsm_vte {
 	char *palette_name;
 
 	struct tsm_utf8_mach *mach;
+	bool mach_idle;
 	unsigned long parse_cnt;
 
 	unsigned int state;
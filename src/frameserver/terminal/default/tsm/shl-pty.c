@@ -440,6 +440,14 @@ int shl_pty_dispatch(struct shl_pty *pty)
 	return r;
 }
 
+int shl_pty_flush(struct shl_pty *pty)
+{
+	if (!shl_pty_is_open(pty))
+		return -ENODEV;
+
+	return pty_write(pty);
+}
+
 int shl_pty_write(struct shl_pty *pty, const char *u8, size_t len)
 {
 	if (!shl_pty_is_open(pty))
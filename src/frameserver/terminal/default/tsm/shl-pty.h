@@ -50,6 +50,9 @@ int shl_pty_get_fd(struct shl_pty *pty);
 pid_t shl_pty_get_child(struct shl_pty *pty);
 
 int shl_pty_dispatch(struct shl_pty *pty);
+
+/* only flush pending writes, for when the read side is serviced elsewhere */
+int shl_pty_flush(struct shl_pty *pty);
 int shl_pty_write(struct shl_pty *pty, const char *u8, size_t len);
 int shl_pty_signal(struct shl_pty *pty, int sig);
 int shl_pty_resize(struct shl_pty *pty,
@@ -51,6 +51,12 @@
 #include <inttypes.h>
 #include "libtsm_int.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 /* Input parser states */
 enum parser_state {
 	STATE_NONE,		/* placeholder */
@@ -841,6 +847,7 @@ void tsm_vte_reset(struct tsm_vte *vte)
 	arcan_tui_set_flags(vte->con, TUI_AUTO_WRAP);
 
 	tsm_utf8_mach_reset(vte->mach);
+	vte->mach_idle = true;
 	vte->state = STATE_GROUND;
 	vte->gl = &vte->g0;
 	vte->gr = &vte->g1;
@@ -2633,6 +2640,150 @@ static void parse_data(struct tsm_vte *vte, uint32_t raw)
 	DEBUG_LOG(vte, "unhandled input %u in state %d", raw, vte->state);
 }
 
+/* upper bound on the number of codepoints forwarded in one ground run write */
+#define VTE_RUN_MAX 512
+
+/*
+ * Length of the leading stretch of printable ASCII (0x20..0x7e) in [buf],
+ * 16 bytes at a time where we have the vector units for it.
+ */
+static size_t ascii_run(const uint8_t* buf, size_t len)
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+/* bias so that 0x20..0x7e lands in [-128, -34] and a single signed compare
+ * covers both ends of the range */
+	const __m128i bias = _mm_set1_epi8(0x60);
+	const __m128i lim = _mm_set1_epi8((char) 0xdf);
+
+	for (; i + 16 <= len; i += 16){
+		__m128i v = _mm_add_epi8(_mm_loadu_si128((const __m128i*) &buf[i]), bias);
+		unsigned mask = _mm_movemask_epi8(_mm_cmplt_epi8(v, lim));
+		if (mask != 0xffff)
+			return i + __builtin_ctz(~mask);
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	const uint8x16_t lo = vdupq_n_u8(0x20);
+	const uint8x16_t hi = vdupq_n_u8(0x7e);
+
+	for (; i + 16 <= len; i += 16){
+		uint8x16_t v = vld1q_u8(&buf[i]);
+		uint64x2_t ok = vreinterpretq_u64_u8(
+			vandq_u8(vcgeq_u8(v, lo), vcleq_u8(v, hi)));
+		if ((vgetq_lane_u64(ok, 0) & vgetq_lane_u64(ok, 1)) != ~(uint64_t)0)
+			break;
+	}
+#endif
+
+	while (i < len && buf[i] >= 0x20 && buf[i] < 0x7f)
+		i++;
+
+	return i;
+}
+
+/*
+ * Decode one complete UTF-8 sequence at [buf] into [out], returning the number
+ * of bytes consumed or 0 if the sequence is incomplete, malformed or decodes to
+ * something that the state machine in parse_data would treat differently than
+ * a plain PRINT (C1 controls, GR- mapped latin-1).
+ */
+static size_t utf8_run_seq(
+	struct tsm_vte* vte, const uint8_t* buf, size_t len, uint32_t* out)
+{
+	uint8_t c = buf[0];
+	size_t n;
+	uint32_t cp;
+
+	if (c >= 0xc2 && c <= 0xdf){
+		n = 2;
+		cp = c & 0x1f;
+	}
+	else if (c >= 0xe0 && c <= 0xef){
+		n = 3;
+		cp = c & 0x0f;
+	}
+	else if (c >= 0xf0 && c <= 0xf4){
+		n = 4;
+		cp = c & 0x07;
+	}
+	else
+		return 0;
+
+	if (n > len)
+		return 0;
+
+	for (size_t i = 1; i < n; i++){
+		if ((buf[i] & 0xc0) != 0x80)
+			return 0;
+		cp = (cp << 6) | (buf[i] & 0x3f);
+	}
+
+/* vte_map only touches 161..254 in this range, and only if a non-identity GR
+ * set is active */
+	if (cp < 0x100){
+		if (cp < 0xa0 || vte->grt || *vte->gr != &tsm_vte_unicode_upper)
+			return 0;
+	}
+
+	*out = cp;
+	return n;
+}
+
+/*
+ * Ground state fast path: consume as much of [u8] as possible as printable
+ * ASCII or complete UTF-8 sequences and forward them as runs sharing the
+ * current attribute. Returns the number of bytes consumed, anything left
+ * (controls, escapes, partial sequences) goes through the state machine.
+ */
+static size_t ground_run(struct tsm_vte* vte, const uint8_t* u8, size_t len)
+{
+	uint32_t run[VTE_RUN_MAX];
+	size_t nr = 0, i = 0;
+
+	to_rgb(vte, false);
+
+	while (i < len){
+		size_t n = ascii_run(&u8[i], len - i);
+
+		while (n){
+			size_t step = VTE_RUN_MAX - nr;
+			if (step > n)
+				step = n;
+
+			for (size_t j = 0; j < step; j++)
+				run[nr + j] = u8[i + j];
+
+			nr += step;
+			i += step;
+			n -= step;
+
+			if (nr == VTE_RUN_MAX){
+				arcan_tui_writeucs4(vte->con, run, nr, &vte->cattr);
+				nr = 0;
+			}
+		}
+
+		if (i == len || u8[i] < 0x80)
+			break;
+
+		n = utf8_run_seq(vte, &u8[i], len - i, &run[nr]);
+		if (!n)
+			break;
+
+		i += n;
+		if (++nr == VTE_RUN_MAX){
+			arcan_tui_writeucs4(vte->con, run, nr, &vte->cattr);
+			nr = 0;
+		}
+	}
+
+	if (nr)
+		arcan_tui_writeucs4(vte->con, run, nr, &vte->cattr);
+
+	return i;
+}
+
 SHL_EXPORT
 void tsm_vte_input(struct tsm_vte *vte, const char *u8, size_t len)
 {
@@ -2645,6 +2796,20 @@ void tsm_vte_input(struct tsm_vte *vte, const char *u8, size_t len)
 
 	++vte->parse_cnt;
 	for (i = 0; i < len; ++i) {
+/* plain text in the ground state with an identity GL set is by far the most
+ * common case, take it in bulk and only return to the per-byte path at the
+ * first control, escape or sequence that needs the state machine */
+		if ((uint8_t)u8[i] >= 0x20 && (uint8_t)u8[i] != 0x7f &&
+			vte->state == STATE_GROUND && vte->mach_idle &&
+			!(vte->flags & (FLAG_7BIT_MODE | FLAG_8BIT_MODE)) &&
+			!vte->glt && *vte->gl == &tsm_vte_unicode_lower) {
+			size_t n = ground_run(vte, (const uint8_t*) &u8[i], len - i);
+			if (n){
+				i += n - 1;
+				continue;
+			}
+		}
+
 		if (vte->flags & FLAG_7BIT_MODE) {
 			if (u8[i] & 0x80)
 				DEBUG_LOG(vte, "receiving 8bit character U+%d from pty while in 7bit mode",
@@ -2654,6 +2819,8 @@ void tsm_vte_input(struct tsm_vte *vte, const char *u8, size_t len)
 			parse_data(vte, u8[i]);
 		} else {
 			state = tsm_utf8_mach_feed(vte->mach, u8[i]);
+			vte->mach_idle = state == TSM_UTF8_ACCEPT ||
+				state == TSM_UTF8_REJECT || state == TSM_UTF8_START;
 			if (state == TSM_UTF8_ACCEPT ||
 			    state == TSM_UTF8_REJECT) {
 				ucs4 = tsm_utf8_mach_get(vte->mach);
@@ -78,6 +78,18 @@ static void speex_free (void *ptr) {free(ptr);}
 
 #include "stack_alloc.h"
 #include <math.h>
+#include <pthread.h>
+
+/* pick up the vector paths from the target unless told otherwise */
+#if !defined(FIXED_POINT) && !defined(_USE_SSE) && !defined(_NO_SIMD) && (defined(__SSE__) || defined(__x86_64__))
+#define _USE_SSE
+#endif
+#if defined(_USE_SSE) && !defined(_USE_SSE2) && (defined(__SSE2__) || defined(__x86_64__))
+#define _USE_SSE2
+#endif
+#if !defined(FIXED_POINT) && !defined(_USE_SSE) && !defined(_USE_NEON) && !defined(_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define _USE_NEON
+#endif
 
 #ifndef M_PI
 #define M_PI 3.14159263
@@ -98,6 +110,8 @@ static void speex_free (void *ptr) {free(ptr);}
 
 #ifdef _USE_SSE
 #include "resample_sse.h"
+#elif defined(_USE_NEON)
+#include "resample_neon.h"
 #endif
 
 /* Numer of elements to allocate on the stack */
@@ -134,7 +148,7 @@ struct SpeexResamplerState_ {
 
    spx_word16_t *mem;
    spx_word16_t *sinc_table;
-   spx_uint32_t sinc_table_length;
+   struct shared_sinc *sinc_shared;
    resampler_basic_func resampler_ptr;
 
    int    in_stride;
@@ -554,7 +568,140 @@ static int resampler_basic_interpolate_double(SpeexResamplerState *st, spx_uint3
 }
 #endif
 
-static void update_filter(SpeexResamplerState *st)
+/* This resampler is used to produce zero output in situations where memory
+   for the filter could not be allocated.  The expected numbers of input and
+   output samples are still processed so that callers failing to check error
+   codes are not surprised, possibly getting into infinite loops. */
+static int resampler_basic_zero(SpeexResamplerState *st, spx_uint32_t channel_index, const spx_word16_t *in, spx_uint32_t *in_len, spx_word16_t *out, spx_uint32_t *out_len)
+{
+   int out_sample = 0;
+   int last_sample = st->last_sample[channel_index];
+   spx_uint32_t samp_frac_num = st->samp_frac_num[channel_index];
+   const int out_stride = st->out_stride;
+   const int int_advance = st->int_advance;
+   const int frac_advance = st->frac_advance;
+   const spx_uint32_t den_rate = st->den_rate;
+
+   while (!(last_sample >= (spx_int32_t)*in_len || out_sample >= (spx_int32_t)*out_len))
+   {
+      out[out_stride * out_sample++] = 0;
+      last_sample += int_advance;
+      samp_frac_num += frac_advance;
+      if (samp_frac_num >= den_rate)
+      {
+         samp_frac_num -= den_rate;
+         last_sample++;
+      }
+   }
+
+   st->last_sample[channel_index] = last_sample;
+   st->samp_frac_num[channel_index] = samp_frac_num;
+   return out_sample;
+}
+
+/* The sinc tables only depend on the filter parameters, and computing them
+   is slow. Instances with the same parameters share one refcounted table. */
+struct shared_sinc {
+   int direct;
+   int quality;
+   spx_uint32_t filt_len;
+   spx_uint32_t oversample;
+   spx_uint32_t den_rate;
+   float cutoff;
+   spx_uint32_t refs;
+   spx_word16_t *table;
+   struct shared_sinc *next;
+};
+
+static struct shared_sinc *shared_sincs;
+static pthread_mutex_t shared_sinc_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void sinc_release(struct shared_sinc *tbl)
+{
+   struct shared_sinc **cur;
+   if (!tbl)
+      return;
+
+   pthread_mutex_lock(&shared_sinc_lock);
+   if (--tbl->refs == 0)
+   {
+      for (cur = &shared_sincs; *cur != tbl; cur = &(*cur)->next);
+      *cur = tbl->next;
+      speex_free(tbl->table);
+      speex_free(tbl);
+   }
+   pthread_mutex_unlock(&shared_sinc_lock);
+}
+
+static struct shared_sinc *sinc_acquire(SpeexResamplerState *st, int direct)
+{
+   struct shared_sinc *tbl;
+   /* the direct table doesn't depend on the oversampling, the interpolated
+      one doesn't depend on the rate */
+   spx_uint32_t oversample = direct ? 0 : st->oversample;
+   spx_uint32_t den_rate = direct ? st->den_rate : 0;
+
+   pthread_mutex_lock(&shared_sinc_lock);
+   for (tbl = shared_sincs; tbl; tbl = tbl->next)
+   {
+      if (tbl->direct == direct && tbl->quality == st->quality &&
+         tbl->filt_len == st->filt_len && tbl->oversample == oversample &&
+         tbl->den_rate == den_rate && tbl->cutoff == st->cutoff)
+      {
+         tbl->refs++;
+         pthread_mutex_unlock(&shared_sinc_lock);
+         return tbl;
+      }
+   }
+
+   tbl = (struct shared_sinc *)speex_alloc(sizeof(struct shared_sinc));
+   if (!tbl)
+   {
+      pthread_mutex_unlock(&shared_sinc_lock);
+      return NULL;
+   }
+
+   if (direct)
+   {
+      spx_uint32_t i;
+      tbl->table = (spx_word16_t *)speex_alloc(st->filt_len*st->den_rate*sizeof(spx_word16_t));
+      for (i=0;tbl->table && i<st->den_rate;i++)
+      {
+         spx_int32_t j;
+         for (j=0;j<st->filt_len;j++)
+         {
+            tbl->table[i*st->filt_len+j] = sinc(st->cutoff,((j-(spx_int32_t)st->filt_len/2+1)-((float)i)/st->den_rate), st->filt_len, quality_map[st->quality].window_func);
+         }
+      }
+   } else {
+      spx_int32_t i;
+      tbl->table = (spx_word16_t *)speex_alloc((st->filt_len*st->oversample+8)*sizeof(spx_word16_t));
+      for (i=-4;tbl->table && i<(spx_int32_t)(st->oversample*st->filt_len+4);i++)
+         tbl->table[i+4] = sinc(st->cutoff,(i/(float)st->oversample - st->filt_len/2), st->filt_len, quality_map[st->quality].window_func);
+   }
+
+   if (!tbl->table)
+   {
+      speex_free(tbl);
+      pthread_mutex_unlock(&shared_sinc_lock);
+      return NULL;
+   }
+
+   tbl->direct = direct;
+   tbl->quality = st->quality;
+   tbl->filt_len = st->filt_len;
+   tbl->oversample = oversample;
+   tbl->den_rate = den_rate;
+   tbl->cutoff = st->cutoff;
+   tbl->refs = 1;
+   tbl->next = shared_sincs;
+   shared_sincs = tbl;
+   pthread_mutex_unlock(&shared_sinc_lock);
+
+   return tbl;
+}
+
+static int update_filter(SpeexResamplerState *st)
 {
    spx_uint32_t old_length;
 
@@ -585,25 +732,18 @@ static void update_filter(SpeexResamplerState *st)
       st->cutoff = quality_map[st->quality].upsample_bandwidth;
    }
 
+   st->int_advance = st->num_rate/st->den_rate;
+   st->frac_advance = st->num_rate%st->den_rate;
+
    /* Choose the resampling type that requires the least amount of memory */
    if (st->den_rate <= st->oversample)
    {
-      spx_uint32_t i;
-      if (!st->sinc_table)
-         st->sinc_table = (spx_word16_t *)speex_alloc(st->filt_len*st->den_rate*sizeof(spx_word16_t));
-      else if (st->sinc_table_length < st->filt_len*st->den_rate)
-      {
-         st->sinc_table = (spx_word16_t *)speex_realloc(st->sinc_table,st->filt_len*st->den_rate*sizeof(spx_word16_t));
-         st->sinc_table_length = st->filt_len*st->den_rate;
-      }
-      for (i=0;i<st->den_rate;i++)
-      {
-         spx_int32_t j;
-         for (j=0;j<st->filt_len;j++)
-         {
-            st->sinc_table[i*st->filt_len+j] = sinc(st->cutoff,((j-(spx_int32_t)st->filt_len/2+1)-((float)i)/st->den_rate), st->filt_len, quality_map[st->quality].window_func);
-         }
-      }
+      struct shared_sinc *tbl = sinc_acquire(st, 1);
+      if (!tbl)
+         goto fail;
+      sinc_release(st->sinc_shared);
+      st->sinc_shared = tbl;
+      st->sinc_table = tbl->table;
 #ifdef FIXED_POINT
       st->resampler_ptr = resampler_basic_direct_single;
 #else
@@ -614,16 +754,12 @@ static void update_filter(SpeexResamplerState *st)
 #endif
       /*fprintf (stderr, "resampler uses direct sinc table and normalised cutoff %f\n", cutoff);*/
    } else {
-      spx_int32_t i;
-      if (!st->sinc_table)
-         st->sinc_table = (spx_word16_t *)speex_alloc((st->filt_len*st->oversample+8)*sizeof(spx_word16_t));
-      else if (st->sinc_table_length < st->filt_len*st->oversample+8)
-      {
-         st->sinc_table = (spx_word16_t *)speex_realloc(st->sinc_table,(st->filt_len*st->oversample+8)*sizeof(spx_word16_t));
-         st->sinc_table_length = st->filt_len*st->oversample+8;
-      }
-      for (i=-4;i<(spx_int32_t)(st->oversample*st->filt_len+4);i++)
-         st->sinc_table[i+4] = sinc(st->cutoff,(i/(float)st->oversample - st->filt_len/2), st->filt_len, quality_map[st->quality].window_func);
+      struct shared_sinc *tbl = sinc_acquire(st, 0);
+      if (!tbl)
+         goto fail;
+      sinc_release(st->sinc_shared);
+      st->sinc_shared = tbl;
+      st->sinc_table = tbl->table;
 #ifdef FIXED_POINT
       st->resampler_ptr = resampler_basic_interpolate_single;
 #else
@@ -634,10 +770,6 @@ static void update_filter(SpeexResamplerState *st)
 #endif
       /*fprintf (stderr, "resampler uses interpolated sinc table and normalised cutoff %f\n", cutoff);*/
    }
-   st->int_advance = st->num_rate/st->den_rate;
-   st->frac_advance = st->num_rate%st->den_rate;
-
-
    /* Here's the place where we update the filter memory to take into account
       the change in filter length. It's probably the messiest part of the code
       due to handling of lots of corner cases. */
@@ -719,7 +851,15 @@ static void update_filter(SpeexResamplerState *st)
          st->magic_samples[i] += old_magic;
       }
    }
+   return RESAMPLER_ERR_SUCCESS;
 
+fail:
+   st->resampler_ptr = resampler_basic_zero;
+   /* st->mem may still contain consumed input samples for the filter.
+      Restore filt_len so that filt_len - 1 still points to the position after
+      the last of these samples. */
+   st->filt_len = old_length;
+   return RESAMPLER_ERR_ALLOC_FAILED;
 }
 
 EXPORT SpeexResamplerState *speex_resampler_init(spx_uint32_t nb_channels, spx_uint32_t in_rate, spx_uint32_t out_rate, int quality, int *err)
@@ -731,6 +871,7 @@ EXPORT SpeexResamplerState *speex_resampler_init_frac(spx_uint32_t nb_channels,
 {
    spx_uint32_t i;
    SpeexResamplerState *st;
+   int filter_err;
    if (quality > 10 || quality < 0)
    {
       if (err)
@@ -745,7 +886,8 @@ EXPORT SpeexResamplerState *speex_resampler_init_frac(spx_uint32_t nb_channels,
    st->num_rate = 0;
    st->den_rate = 0;
    st->quality = -1;
-   st->sinc_table_length = 0;
+   st->sinc_table = 0;
+   st->sinc_shared = 0;
    st->mem_alloc_size = 0;
    st->filt_len = 0;
    st->mem = 0;
@@ -777,11 +919,16 @@ EXPORT SpeexResamplerState *speex_resampler_init_frac(spx_uint32_t nb_channels,
    speex_resampler_set_rate_frac(st, ratio_num, ratio_den, in_rate, out_rate);
 
 
-   update_filter(st);
-
-   st->initialised = 1;
+   filter_err = update_filter(st);
+   if (filter_err == RESAMPLER_ERR_SUCCESS)
+   {
+      st->initialised = 1;
+   } else {
+      speex_resampler_destroy(st);
+      st = NULL;
+   }
    if (err)
-      *err = RESAMPLER_ERR_SUCCESS;
+      *err = filter_err;
 
    return st;
 }
@@ -789,7 +936,7 @@ EXPORT SpeexResamplerState *speex_resampler_init_frac(spx_uint32_t nb_channels,
 EXPORT void speex_resampler_destroy(SpeexResamplerState *st)
 {
    speex_free(st->mem);
-   speex_free(st->sinc_table);
+   sinc_release(st->sinc_shared);
    speex_free(st->last_sample);
    speex_free(st->magic_samples);
    speex_free(st->samp_frac_num);
@@ -1045,7 +1192,7 @@ EXPORT int speex_resampler_set_rate_frac(SpeexResamplerState *st, spx_uint32_t r
    }
 
    if (st->initialised)
-      update_filter(st);
+      return update_filter(st);
    return RESAMPLER_ERR_SUCCESS;
 }
 
@@ -1063,7 +1210,7 @@ EXPORT int speex_resampler_set_quality(SpeexResamplerState *st, int quality)
       return RESAMPLER_ERR_SUCCESS;
    st->quality = quality;
    if (st->initialised)
-      update_filter(st);
+      return update_filter(st);
    return RESAMPLER_ERR_SUCCESS;
 }
 
@@ -0,0 +1,35 @@
+/* NEON inner products for resample.c (floating point build only), same
+   interface as resample_sse.h. Same license as resample.c.
+
+   The filter lengths used by update_filter are multiples of 4, the
+   inner products rely on that. The double precision versions are left
+   to the generic code.
+*/
+
+#include <arm_neon.h>
+
+static inline float neon_hsum(float32x4_t sum)
+{
+   float32x2_t r = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+   return vget_lane_f32(vpadd_f32(r, r), 0);
+}
+
+#define OVERRIDE_INNER_PRODUCT_SINGLE
+static inline float inner_product_single(const float *a, const float *b, unsigned int len)
+{
+   unsigned int i;
+   float32x4_t sum = vdupq_n_f32(0);
+   for (i=0;i<len;i+=4)
+      sum = vmlaq_f32(sum, vld1q_f32(a+i), vld1q_f32(b+i));
+   return neon_hsum(sum);
+}
+
+#define OVERRIDE_INTERPOLATE_PRODUCT_SINGLE
+static inline float interpolate_product_single(const float *a, const float *b, unsigned int len, const spx_uint32_t oversample, float *frac)
+{
+   unsigned int i;
+   float32x4_t sum = vdupq_n_f32(0);
+   for (i=0;i<len;i++)
+      sum = vmlaq_n_f32(sum, vld1q_f32(b+i*oversample), a[i]);
+   return neon_hsum(vmulq_f32(vld1q_f32(frac), sum));
+}
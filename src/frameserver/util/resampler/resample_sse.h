@@ -0,0 +1,81 @@
+/* SSE/SSE2 inner products for resample.c, following the interface of
+   resample_sse.h in Speex (Copyright (C) 2007-2008 Jean-Marc Valin,
+   Copyright (C) 2008 Thorvald Natvig). Same license as resample.c.
+
+   The filter lengths used by update_filter are multiples of 4, the
+   inner products rely on that.
+*/
+
+#include <xmmintrin.h>
+
+static inline float sse_hsum(__m128 sum)
+{
+   float ret;
+   sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+   sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+   _mm_store_ss(&ret, sum);
+   return ret;
+}
+
+#define OVERRIDE_INNER_PRODUCT_SINGLE
+static inline float inner_product_single(const float *a, const float *b, unsigned int len)
+{
+   unsigned int i;
+   __m128 sum = _mm_setzero_ps();
+   for (i=0;i<len;i+=4)
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a+i), _mm_loadu_ps(b+i)));
+   return sse_hsum(sum);
+}
+
+#define OVERRIDE_INTERPOLATE_PRODUCT_SINGLE
+static inline float interpolate_product_single(const float *a, const float *b, unsigned int len, const spx_uint32_t oversample, float *frac)
+{
+   unsigned int i;
+   __m128 sum = _mm_setzero_ps();
+   for (i=0;i<len;i++)
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load1_ps(a+i), _mm_loadu_ps(b+i*oversample)));
+   return sse_hsum(_mm_mul_ps(_mm_loadu_ps(frac), sum));
+}
+
+#ifdef _USE_SSE2
+#include <emmintrin.h>
+
+#define OVERRIDE_INNER_PRODUCT_DOUBLE
+static inline double inner_product_double(const float *a, const float *b, unsigned int len)
+{
+   unsigned int i;
+   double ret;
+   __m128d sum = _mm_setzero_pd();
+   for (i=0;i<len;i+=4)
+   {
+      __m128 t = _mm_mul_ps(_mm_loadu_ps(a+i), _mm_loadu_ps(b+i));
+      sum = _mm_add_pd(sum, _mm_cvtps_pd(t));
+      sum = _mm_add_pd(sum, _mm_cvtps_pd(_mm_movehl_ps(t, t)));
+   }
+   sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+   _mm_store_sd(&ret, sum);
+   return ret;
+}
+
+#define OVERRIDE_INTERPOLATE_PRODUCT_DOUBLE
+static inline double interpolate_product_double(const float *a, const float *b, unsigned int len, const spx_uint32_t oversample, float *frac)
+{
+   unsigned int i;
+   double ret;
+   __m128d sum1 = _mm_setzero_pd();
+   __m128d sum2 = _mm_setzero_pd();
+   __m128 f = _mm_loadu_ps(frac);
+   for (i=0;i<len;i++)
+   {
+      __m128 t = _mm_mul_ps(_mm_load1_ps(a+i), _mm_loadu_ps(b+i*oversample));
+      sum1 = _mm_add_pd(sum1, _mm_cvtps_pd(t));
+      sum2 = _mm_add_pd(sum2, _mm_cvtps_pd(_mm_movehl_ps(t, t)));
+   }
+   sum1 = _mm_mul_pd(_mm_cvtps_pd(f), sum1);
+   sum2 = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(f, f)), sum2);
+   sum1 = _mm_add_pd(sum1, sum2);
+   sum1 = _mm_add_sd(sum1, _mm_unpackhi_pd(sum1, sum1));
+   _mm_store_sd(&ret, sum1);
+   return ret;
+}
+#endif
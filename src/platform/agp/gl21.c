@@ -63,6 +63,43 @@ const char * defcvprg =
 " gl_Position = (projection * modelview) * vertex;\n"
 "}";
 
+/*
+ * batched variants, vertices are already in modelview space and the
+ * per-object color / opacity comes through the color attribute
+ */
+static const char* batchvprg =
+"#version 120\n"
+"uniform mat4 projection;\n"
+"attribute vec4 vertex;\n"
+"attribute vec2 texcoord;\n"
+"attribute vec4 color;\n"
+"varying vec2 texco;\n"
+"varying vec4 vcol;\n"
+"void main(){\n"
+"	gl_Position = projection * vertex;\n"
+"	texco = texcoord;\n"
+"	vcol = color;\n"
+"}";
+
+static const char* batchfprg =
+"#version 120\n"
+"uniform sampler2D map_diffuse;\n"
+"varying vec2 texco;\n"
+"varying vec4 vcol;\n"
+"void main(){\n"
+"	vec4 col = texture2D(map_diffuse, texco);\n"
+"	col.a = col.a * vcol.a;\n"
+"	gl_FragColor = col;\n"
+"}";
+
+static const char* batchcfprg =
+"#version 120\n"
+"varying vec2 texco;\n"
+"varying vec4 vcol;\n"
+"void main(){\n"
+"	gl_FragColor = vcol;\n"
+"}";
+
 agp_shader_id agp_default_shader(enum SHADER_TYPES type)
 {
 	static agp_shader_id shids[SHADER_TYPE_ENDM];
@@ -75,6 +112,10 @@ agp_shader_id agp_default_shader(enum SHADER_TYPES type)
 		shids[COLOR_2D] = agp_shader_build(
 			"DEFAULT_COLOR", NULL, defcvprg, defcfprg);
 		shids[BASIC_3D] = shids[BASIC_2D];
+		shids[BATCH_2D] = agp_shader_build(
+			"DEFAULT_BATCH", NULL, batchvprg, batchfprg);
+		shids[BATCH_COLOR_2D] = agp_shader_build(
+			"DEFAULT_BATCH_COLOR", NULL, batchvprg, batchcfprg);
 		defshdr_build = true;
 	}
 
@@ -101,6 +142,16 @@ void agp_shader_source(enum SHADER_TYPES type,
 			*frag = defcfprg;
 		break;
 
+		case BATCH_2D:
+			*vert = batchvprg;
+			*frag = batchfprg;
+		break;
+
+		case BATCH_COLOR_2D:
+			*vert = batchvprg;
+			*frag = batchcfprg;
+		break;
+
 		default:
 			*vert = NULL;
 			*frag = NULL;
@@ -87,6 +87,46 @@ const char * defcvprg =
 " gl_Position = (projection * modelview) * vertex;\n"
 "}";
 
+/*
+ * batched variants, vertices are already in modelview space and the
+ * per-object color / opacity comes through the color attribute
+ */
+static const char* batchvprg =
+"#version 100\n"
+"precision mediump float;\n"
+"uniform mat4 projection;\n"
+"attribute vec4 vertex;\n"
+"attribute vec2 texcoord;\n"
+"attribute vec4 color;\n"
+"varying vec2 texco;\n"
+"varying vec4 vcol;\n"
+"void main(){\n"
+"	gl_Position = projection * vertex;\n"
+"	texco = texcoord;\n"
+"	vcol = color;\n"
+"}";
+
+static const char* batchfprg =
+"#version 100\n"
+"precision mediump float;\n"
+"uniform sampler2D map_diffuse;\n"
+"varying vec2 texco;\n"
+"varying vec4 vcol;\n"
+"void main(){\n"
+"	vec4 col = texture2D(map_diffuse, texco);\n"
+"	col.a = col.a * vcol.a;\n"
+"	gl_FragColor = col;\n"
+"}";
+
+static const char* batchcfprg =
+"#version 100\n"
+"precision mediump float;\n"
+"varying vec2 texco;\n"
+"varying vec4 vcol;\n"
+"void main(){\n"
+"	gl_FragColor = vcol;\n"
+"}";
+
 agp_shader_id agp_default_shader(enum SHADER_TYPES type)
 {
 	static agp_shader_id shids[SHADER_TYPE_ENDM];
@@ -99,6 +139,10 @@ agp_shader_id agp_default_shader(enum SHADER_TYPES type)
 		shids[COLOR_2D] = agp_shader_build(
 			"DEFAULT_COLOR", NULL, defcvprg, defcfprg);
 		shids[BASIC_3D] = shids[BASIC_2D];
+		shids[BATCH_2D] = agp_shader_build(
+			"DEFAULT_BATCH", NULL, batchvprg, batchfprg);
+		shids[BATCH_COLOR_2D] = agp_shader_build(
+			"DEFAULT_BATCH_COLOR", NULL, batchvprg, batchcfprg);
 		defshdr_build = true;
 	}
 
@@ -142,6 +186,16 @@ void agp_shader_source(enum SHADER_TYPES type,
 		*frag = defcfprg;
 	break;
 
+	case BATCH_2D:
+		*vert = batchvprg;
+		*frag = batchfprg;
+	break;
+
+	case BATCH_COLOR_2D:
+		*vert = batchvprg;
+		*frag = batchcfprg;
+	break;
+
 	default:
 		*vert = NULL;
 		*frag = NULL;
@@ -303,6 +357,13 @@ struct stream_meta agp_stream_prepare(struct agp_vstore* s,
 		av_pixel* ptr = s->vinf.text.raw, (* buf) = meta.buf;
 		s->update_ts = arcan_timemillis();
 
+/* only the rows covering the dirty region */
+		if (meta.dirty){
+			ptr += meta.y1 * s->w;
+			buf += meta.y1 * s->w;
+			ntc = meta.h * s->w;
+		}
+
 		if ( ((uintptr_t)ptr % 16) == 0 && ((uintptr_t)buf % 16) == 0	)
 			memcpy(ptr, buf, ntc * sizeof(av_pixel));
 		else
@@ -320,10 +381,18 @@ struct stream_meta agp_stream_prepare(struct agp_vstore* s,
 	case STREAM_RAW_DIRECT:
 	case STREAM_RAW_DIRECT_SYNCHRONOUS:
 	agp_activate_vstore(s);
-		env->tex_subimage_2d(GL_TEXTURE_2D, 0, 0, 0, s->w, s->h,
-			s->vinf.text.s_fmt ? s->vinf.text.s_fmt : GL_PIXEL_FORMAT,
-			GL_UNSIGNED_BYTE, meta.buf
-		);
+/* no UNPACK_ROW_LENGTH to rely on, but the full rows covering the dirty
+ * region are still contiguous in the source buffer */
+		if (meta.dirty)
+			env->tex_subimage_2d(GL_TEXTURE_2D, 0, 0, meta.y1, s->w, meta.h,
+				s->vinf.text.s_fmt ? s->vinf.text.s_fmt : GL_PIXEL_FORMAT,
+				GL_UNSIGNED_BYTE, &meta.buf[meta.y1 * s->w]
+			);
+		else
+			env->tex_subimage_2d(GL_TEXTURE_2D, 0, 0, 0, s->w, s->h,
+				s->vinf.text.s_fmt ? s->vinf.text.s_fmt : GL_PIXEL_FORMAT,
+				GL_UNSIGNED_BYTE, meta.buf
+			);
 		agp_deactivate_vstore();
 	break;
 
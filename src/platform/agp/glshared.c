@@ -27,7 +27,10 @@
 
 #ifdef HEADLESS_NOARCAN
 #undef FLAG_DIRTY
-#define FLAG_DIRTY()
+#define FLAG_DIRTY(X)
+#define STORE_DAMAGE(X)
+#else
+#define STORE_DAMAGE(X) arcan_vint_storedamage(X, 0, 0, 0, 0)
 #endif
 
 #ifndef GL_VERTEX_PROGRAM_POINT_SIZE
@@ -786,7 +789,7 @@ void agp_update_vstore(struct agp_vstore* s, bool copy)
 	if (s->txmapped == TXSTATE_OFF)
 		return;
 
-	FLAG_DIRTY();
+	STORE_DAMAGE(s);
 
 	if (!copy)
 		env->bind_texture(GL_TEXTURE_2D, s->vinf.text.glid);
@@ -993,6 +996,47 @@ void agp_draw_vobj(float x1, float y1, float x2, float y2,
 	}
 }
 
+void agp_submit_batch(const float* verts,
+	const float* txcos, const float* colors, size_t n)
+{
+	struct agp_fenv* env = agp_env();
+
+	agp_shader_envv(MODELVIEW_MATR, ident, sizeof(float) * 16);
+
+	GLint attrindv = agp_shader_vattribute_loc(ATTRIBUTE_VERTEX);
+	GLint attrindt = agp_shader_vattribute_loc(ATTRIBUTE_TEXCORD0);
+	GLint attrindc = agp_shader_vattribute_loc(ATTRIBUTE_COLOR);
+
+	if (attrindv == -1 || !n)
+		return;
+
+	bool settex = txcos && attrindt != -1;
+	bool setcol = colors && attrindc != -1;
+
+	env->enable_vertex_attrarray(attrindv);
+	env->vertex_attrpointer(attrindv, 3, GL_FLOAT, GL_FALSE, 0, verts);
+
+	if (settex){
+		env->enable_vertex_attrarray(attrindt);
+		env->vertex_attrpointer(attrindt, 2, GL_FLOAT, GL_FALSE, 0, txcos);
+	}
+
+	if (setcol){
+		env->enable_vertex_attrarray(attrindc);
+		env->vertex_attrpointer(attrindc, 4, GL_FLOAT, GL_FALSE, 0, colors);
+	}
+
+	env->draw_arrays(GL_TRIANGLES, 0, n * 6);
+
+	if (setcol)
+		env->disable_vertex_attrarray(attrindc);
+
+	if (settex)
+		env->disable_vertex_attrarray(attrindt);
+
+	env->disable_vertex_attrarray(attrindv);
+}
+
 static void toggle_debugstates(float* modelview)
 {
 	struct agp_fenv* env = agp_env();
@@ -1308,6 +1352,26 @@ void agp_rendertarget_clearcolor(
 	tgt->clearcol[3] = a;
 }
 
+void agp_rendertarget_scissor(
+	struct agp_rendertarget* tgt, size_t x, size_t y, size_t w, size_t h)
+{
+	struct agp_fenv* env = agp_env();
+
+	if (w && h){
+		env->scissor(x, y, w, h);
+		return;
+	}
+
+	if (tgt)
+		env->scissor(0, 0, tgt->store->w, tgt->store->h);
+#ifndef HEADLESS_NOARCAN
+	else {
+		struct monitor_mode mode = platform_video_dimensions();
+		env->scissor(0, 0, mode.width, mode.height);
+	}
+#endif
+}
+
 void agp_drop_mesh(struct agp_mesh_store* s)
 {
 	if (!s)
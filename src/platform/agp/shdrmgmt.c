@@ -25,7 +25,7 @@
 
 #ifdef HEADLESS_NOARCAN
 #undef FLAG_DIRTY
-#define FLAG_DIRTY()
+#define FLAG_DIRTY(X)
 #endif
 
 #define TBLSIZE (1 + TIMESTAMP_D - MODELVIEW_MATR)
@@ -259,7 +259,9 @@ bool agp_shader_destroy(agp_shader_id shid)
 	if (!agp_shader_valid(shid) ||
 		shid == agp_default_shader(BASIC_2D) ||
 		shid == agp_default_shader(BASIC_3D) ||
-		shid == agp_default_shader(COLOR_2D))
+		shid == agp_default_shader(COLOR_2D) ||
+		shid == agp_default_shader(BATCH_2D) ||
+		shid == agp_default_shader(BATCH_COLOR_2D))
 		return false;
 
 	struct shader_cont* cur = &shdr_global.slots[SHADER_INDEX(shid)];
@@ -612,7 +614,7 @@ void agp_shader_forceunif(const char* label, enum shdrutype type, void* value)
 	assert(shdr_global.active_prg != BROKEN_SHADER);
 	struct shader_cont* slot = &shdr_global.slots[
 		SHADER_INDEX(shdr_global.active_prg)];
-	FLAG_DIRTY();
+	FLAG_DIRTY(NULL);
 
 /* linear search */
 	struct shaderv** current = (struct shaderv**) &(
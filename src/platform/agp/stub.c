@@ -139,7 +139,7 @@ void agp_activate_vstore_multi(struct agp_vstore** backing, size_t n)
 
 void agp_update_vstore(struct agp_vstore* s, bool copy)
 {
-	FLAG_DIRTY();
+	arcan_vint_storedamage(s, 0, 0, 0, 0);
 }
 
 void agp_prepare_stencil()
@@ -163,6 +163,11 @@ void agp_draw_vobj(float x1, float y1,
 {
 }
 
+void agp_submit_batch(const float* verts,
+	const float* txcos, const float* colors, size_t n)
+{
+}
+
 void agp_submit_mesh(struct agp_mesh_store* base, enum agp_mesh_flags fl)
 {
 }
@@ -258,6 +263,11 @@ void agp_rendertarget_clearcolor(
 {
 }
 
+void agp_rendertarget_scissor(
+	struct agp_rendertarget* tgt, size_t x, size_t y, size_t w, size_t h)
+{
+}
+
 void agp_render_options(struct agp_render_options)
 {
 }
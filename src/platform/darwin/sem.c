@@ -35,6 +35,43 @@ int arcan_sem_wait(sem_handle sem)
 	return sem_wait(sem);
 }
 
+/*
+ * no sem_timedwait here either, so poll at a fixed interval
+ */
+int arcan_sem_timedwait(sem_handle sem, int msecs)
+{
+	if (msecs < 0)
+		return sem_wait(sem);
+
+	for (;;){
+		if (0 == sem_trywait(sem))
+			return 0;
+
+		if (msecs <= 0)
+			break;
+
+		int step = msecs > 1 ? 1 : msecs;
+		usleep(step * 1000);
+		msecs -= step;
+	}
+
+	errno = ETIMEDOUT;
+	return -1;
+}
+
+/* no wait-on-address primitive we can rely on, stay with the semaphores */
+int arcan_futex_wait(volatile _Atomic unsigned* addr, unsigned val, int msecs)
+{
+	errno = ENOSYS;
+	return -1;
+}
+
+int arcan_futex_wake(volatile _Atomic unsigned* addr, int n)
+{
+	errno = ENOSYS;
+	return -1;
+}
+
 /*
  * In its infinite wisdom, darwin only supports
  * named semaphores (seriously). We are forced to
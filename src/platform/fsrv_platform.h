@@ -153,4 +153,12 @@ bool platform_fsrv_lastwords(struct arcan_frameserver*, char* dst, size_t n);
  * Release any shared memory resources associated with the frameserver
  */
 void platform_fsrv_dropshared(struct arcan_frameserver* ctx);
+
+/*
+ * Wake a client waiting for shm.ptr->vready (or aready if [audio]) to be
+ * released, using the method the client picked in the synch_mode page
+ * field. The caller is expected to have cleared the word and to be inside
+ * a platform_fsrv_enter/leave pair.
+ */
+void platform_fsrv_release(struct arcan_frameserver* ctx, bool audio);
 #endif
@@ -33,9 +33,19 @@ int arcan_sem_post(sem_handle sem);
 int arcan_sem_unlink(sem_handle sem, char* key);
 int arcan_sem_wait(sem_handle sem);
 int arcan_sem_trywait(sem_handle sem);
+int arcan_sem_timedwait(sem_handle sem, int msecs);
 int arcan_sem_init(sem_handle*, unsigned value);
 int arcan_sem_destroy(sem_handle);
 
+/*
+ * Wait-on-address for a word in memory shared between processes. _wait
+ * sleeps as long as *addr == val (or until [msecs], < 0 for no timeout)
+ * and _wake releases up to [n] (< 0, all) waiters. Both return -1 and set
+ * errno to ENOSYS where the platform lacks support.
+ */
+int arcan_futex_wait(volatile _Atomic unsigned* addr, unsigned val, int msecs);
+int arcan_futex_wake(volatile _Atomic unsigned* addr, int n);
+
 typedef int8_t arcan_errc;
 typedef int arcan_aobj_id;
 
@@ -45,6 +55,12 @@ typedef int arcan_aobj_id;
  */
 unsigned long long arcan_timemillis();
 
+/*
+ * Same clock as arcan_timemillis, but in microseconds. Used for timing
+ * measurements where milliseconds are too coarse.
+ */
+unsigned long long arcan_timemicros();
+
 /*
  * Both these functions expect [argv / envv] to be modifiable and their
  * internal contents dynamically allocated (hence will possible replace / free
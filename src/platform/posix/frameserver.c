@@ -188,6 +188,20 @@ out:
 	return false;
 }
 
+void platform_fsrv_release(struct arcan_frameserver* src, bool audio)
+{
+	struct arcan_shmif_page* shmpage = src->shm.ptr;
+
+/* the client only ever has one thread waiting on a word, and if the
+ * wake fails we can still fall back to the semaphore */
+	if (shmpage &&
+		atomic_load(&shmpage->synch_mode) == SHMIF_SYNCH_FUTEX &&
+		arcan_futex_wake(audio ? &shmpage->aready : &shmpage->vready, 1) >= 0)
+		return;
+
+	arcan_sem_post(audio ? src->async : src->vsync);
+}
+
 bool platform_fsrv_destroy(arcan_frameserver* src)
 {
 	if (!src)
@@ -232,6 +246,8 @@ if (shmpage){
 		shmpage->aready = false;
 		arcan_sem_post( src->vsync );
 		arcan_sem_post( src->async );
+		arcan_futex_wake(&shmpage->vready, -1);
+		arcan_futex_wake(&shmpage->aready, -1);
 	}
 
 /* if BUS happens during _enter, the handler will take
@@ -1231,10 +1247,39 @@ int platform_fsrv_resynch(struct arcan_frameserver* s)
  * you can potentially have a really big audiobuffer (or well, quite a few 64k
  * ones unless we exceed the upper limit, but by setting 0 there's the
  * indication that we want the size that match the output device the best.
- * Currently, we can't know this and there's a pending audio subsystem refactor
- * to remedy this (kindof) but for now, just have it as a user controlled var.
+ * The engine proposes a size from the output device period and the underrun
+ * history of the segment (s->aprop), low-latency clients get that size with
+ * more buffers and bulk clients get fewer, larger ones. Without a proposal or
+ * below it, the user controlled var is the floor.
  */
-	if (abufsz < default_abuf_sz)
+	size_t frame_sz = sizeof(shmif_asample) * ARCAN_SHMIF_ACHANNELS;
+	size_t prop_sz = 0;
+	if (s->aprop.frames && s->aprop.rate){
+		size_t rate = samplerate ? samplerate :
+			(s->desc.samplerate ? s->desc.samplerate : ARCAN_SHMIF_SAMPLERATE);
+		prop_sz = s->aprop.frames * rate / s->aprop.rate * frame_sz;
+	}
+	if (prop_sz < default_abuf_sz)
+		prop_sz = default_abuf_sz;
+
+	if (abufc && s->aprop.frames){
+		if (s->aprop.bulk || abufsz >= prop_sz * FSRV_ABUF_BULK_FACTOR){
+			if (abufsz < prop_sz * FSRV_ABUF_BULK_FACTOR)
+				abufsz = prop_sz * FSRV_ABUF_BULK_FACTOR;
+			if (abufc > FSRV_ABUF_BULK_CNT)
+				abufc = FSRV_ABUF_BULK_CNT;
+		}
+		else {
+			abufsz = prop_sz;
+			if (abufc < FSRV_ABUF_LL_CNT)
+				abufc = FSRV_ABUF_LL_CNT;
+		}
+
+		if (abufsz > FSRV_ABUF_MAX)
+			abufsz = FSRV_ABUF_MAX;
+		abufsz -= abufsz % frame_sz;
+	}
+	else if (abufsz < default_abuf_sz)
 		abufsz = default_abuf_sz;
 
 /*
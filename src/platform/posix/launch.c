@@ -253,6 +253,8 @@ arcan_frameserver* platform_launch_listen_external(
 		return NULL;
 	}
 
+	arcan_conductor_register_frameserver(res);
+
 	return res;
 }
 
@@ -5,9 +5,15 @@
  */
 
 /*
- * This is mostly a stub implementation still, serious attempts
- * at getting a strong and efficient implementation is slated for
- * 0.8-0.9.
+ * The small, frequently churned types (VSTRUCT, EXTSTRUCT, STRINGBUF,
+ * VTAG/ATAG) are served from per-type size-class pools, and blocks hinted as
+ * TEMPORARY come from scratch slabs that are recycled as soon as they drain.
+ * Everything else goes to the system allocator but is still accounted for.
+ * Set ARCAN_MEM_NOPOOL in the environment to bypass the pools (valgrind,
+ * asan, ...).
+ *
+ * The guard/checksum/protection behaviors described further below are
+ * still not implemented.
  */
 
 #include <stdlib.h>
@@ -17,6 +23,7 @@
 #include <stdbool.h>
 #include <signal.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include <sys/mman.h>
 
@@ -38,17 +45,88 @@
 #define REALLOC_STEP 16
 #endif
 
-struct mempool_meta {
-/*	mempool_hook_t alloc;
-	  mempool_hook_t free; */
+/*
+ * Small-object pools: the arena is a reserved (PROT_NONE) range of address
+ * space that is cut into slabs on demand. A slab either belongs to one
+ * (type, size class) pool, or is a scratch slab used for TEMPORARY
+ * allocations. Membership is decided on the pointer alone so that
+ * arcan_mem_free does not need to know the type.
+ */
+#ifndef POOL_ARENA_SZ
+#define POOL_ARENA_SZ (256 * 1024 * 1024)
+#endif
+
+#define POOL_SLAB_SZ (64 * 1024)
+#define POOL_NSLABS (POOL_ARENA_SZ / POOL_SLAB_SZ)
+#define POOL_MIN_SHIFT 4
+#define POOL_CLASSES 8
+#define POOL_MAX_SZ (1 << (POOL_MIN_SHIFT + POOL_CLASSES - 1))
+#define POOL_NOSLAB UINT32_MAX
 
+/* scratch slabs prefix each block with its size and type, and hand out
+ * blocks in a bump-allocator fashion until the slab is full */
+#define SCRATCH_CLASS 0xff
+#define SCRATCH_HDR 16
+#define SCRATCH_MAX_SZ (16 * 1024)
+
+/* number of recycled scratch slabs to keep resident across ticks */
+#define SCRATCH_RESERVE 4
+
+struct mempool_meta {
 	size_t alloc_cnt;
 	size_t dealloc_cnt;
 	size_t in_use;
-	size_t monitor_sz;
+	size_t peak;
 	size_t n_pages;
 };
 
+struct slab {
+	uint8_t type;
+	uint8_t cls;
+	uint32_t live;
+	uint32_t ofs;
+	uint32_t next;
+};
+
+struct pool {
+	void* free;
+	uint32_t slab;
+};
+
+/* allocations outside of the pools are tracked in an open-addressed table
+ * so that the counters can be kept per type, and so grow/trunc can verify */
+struct sysblock {
+	uintptr_t ptr;
+	size_t size;
+	uint8_t type;
+};
+
+#define SYSBLOCK_TOMB 1
+
+static struct {
+	pthread_once_t init;
+	pthread_mutex_t lock;
+	bool disabled;
+
+	uint8_t* base;
+	size_t n_slabs;
+	struct slab slabs[POOL_NSLABS];
+	struct pool pools[ARCAN_MEM_ENDMARKER][POOL_CLASSES];
+
+	uint32_t scratch;
+	uint32_t scratch_free;
+
+	struct sysblock* sys;
+	size_t sys_cap, sys_used, sys_tomb;
+
+	struct mempool_meta meta[ARCAN_MEM_ENDMARKER];
+} mem = {
+	.init = PTHREAD_ONCE_INIT,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.scratch = POOL_NOSLAB,
+	.scratch_free = POOL_NOSLAB
+};
+
 /* pool behaviors:
  * [ SENSITIVE is always a special case ]
  *   |-> pages will remain mapped in dumps, but data will be
@@ -107,6 +185,42 @@ struct mempool_meta {
 
 int system_page_size = 4096;
 
+static void lock_mem()
+{
+	pthread_mutex_lock(&mem.lock);
+}
+
+static void unlock_mem()
+{
+	pthread_mutex_unlock(&mem.lock);
+}
+
+static void pool_setup()
+{
+/* children (frameserver launch, closefrom, ...) allocate between fork and
+ * exec, so the lock can't be held by some other thread at fork time */
+	pthread_atfork(lock_mem, unlock_mem, unlock_mem);
+
+	if (getenv("ARCAN_MEM_NOPOOL")){
+		mem.disabled = true;
+		return;
+	}
+
+/* only reserve, slabs are made accessible when they are handed out */
+	void* base = mmap(NULL, POOL_ARENA_SZ,
+		PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (MAP_FAILED == base){
+		mem.disabled = true;
+		return;
+	}
+
+	mem.base = base;
+	for (size_t i = 0; i < ARCAN_MEM_ENDMARKER; i++)
+		for (size_t j = 0; j < POOL_CLASSES; j++)
+			mem.pools[i][j].slab = POOL_NOSLAB;
+}
+
 /*
  * map initial pools, pre-fill some video buffers,
  * get limits and assert that our build-time minimal
@@ -114,16 +228,282 @@ int system_page_size = 4096;
  */
 void arcan_mem_init()
 {
+	pthread_once(&mem.init, pool_setup);
+}
+
+static inline void track_alloc(enum arcan_memtypes type, size_t nb)
+{
+	struct mempool_meta* meta = &mem.meta[type];
+	meta->alloc_cnt++;
+	meta->in_use += nb;
+	if (meta->in_use > meta->peak)
+		meta->peak = meta->in_use;
+}
+
+static inline void track_free(enum arcan_memtypes type, size_t nb)
+{
+	struct mempool_meta* meta = &mem.meta[type];
+	meta->dealloc_cnt++;
+	meta->in_use -= nb > meta->in_use ? meta->in_use : nb;
+}
+
+static uint32_t slab_get()
+{
+	uint32_t ind;
+
+	if (POOL_NOSLAB != mem.scratch_free){
+		ind = mem.scratch_free;
+		mem.scratch_free = mem.slabs[ind].next;
+	}
+	else {
+		if (mem.n_slabs == POOL_NSLABS)
+			return POOL_NOSLAB;
+
+		ind = mem.n_slabs;
+		if (-1 == mprotect(mem.base + (size_t)ind * POOL_SLAB_SZ,
+			POOL_SLAB_SZ, PROT_READ | PROT_WRITE))
+			return POOL_NOSLAB;
+		mem.n_slabs++;
+	}
+
+	mem.slabs[ind] = (struct slab){.next = POOL_NOSLAB};
+	return ind;
+}
+
+static inline struct slab* slab_lookup(void* ptr, size_t* ind)
+{
+	uintptr_t ofs = (uintptr_t) ptr - (uintptr_t) mem.base;
+	if (!mem.base || (uintptr_t) ptr < (uintptr_t) mem.base ||
+		ofs >= (size_t) mem.n_slabs * POOL_SLAB_SZ)
+		return NULL;
+
+	*ind = ofs / POOL_SLAB_SZ;
+	return &mem.slabs[*ind];
+}
+
+static size_t size_class(size_t nb)
+{
+	size_t cls = 0;
+	while (((size_t)1 << (POOL_MIN_SHIFT + cls)) < nb)
+		cls++;
+	return cls;
+}
+
+static void* pool_alloc(enum arcan_memtypes type, size_t nb)
+{
+	size_t cls = size_class(nb);
+	size_t bsz = (size_t)1 << (POOL_MIN_SHIFT + cls);
+	struct pool* pool = &mem.pools[type][cls];
+	void* res = pool->free;
+
+	if (res){
+		pool->free = *(void**) res;
+		goto out;
+	}
+
+/* carve from the current slab or grab a new one, slabs are never returned
+ * from a pool as the free-list can contain blocks from any of them */
+	struct slab* slab = POOL_NOSLAB != pool->slab ? &mem.slabs[pool->slab] : NULL;
+	if (!slab || slab->ofs + bsz > POOL_SLAB_SZ){
+		uint32_t ind = slab_get();
+		if (POOL_NOSLAB == ind)
+			return NULL;
+
+		pool->slab = ind;
+		slab = &mem.slabs[ind];
+		slab->type = type;
+		slab->cls = cls;
+		mem.meta[type].n_pages += POOL_SLAB_SZ / system_page_size;
+	}
+
+	res = mem.base + (size_t)pool->slab * POOL_SLAB_SZ + slab->ofs;
+	slab->ofs += bsz;
 
+out:
+	mem.slabs[((uint8_t*)res - mem.base) / POOL_SLAB_SZ].live++;
+	track_alloc(type, bsz);
+	return res;
+}
+
+static void* scratch_alloc(enum arcan_memtypes type, size_t nb)
+{
+	size_t bsz = SCRATCH_HDR + ((nb + 15) & ~(size_t)15);
+	struct slab* slab = POOL_NOSLAB != mem.scratch ?
+		&mem.slabs[mem.scratch] : NULL;
+
+/* a full scratch slab is left to be recycled when its last block is freed,
+ * (an empty one would already have been rewound) */
+	if (!slab || slab->ofs + bsz > POOL_SLAB_SZ){
+		uint32_t ind = slab_get();
+		if (POOL_NOSLAB == ind)
+			return NULL;
+
+		mem.scratch = ind;
+		slab = &mem.slabs[ind];
+		slab->cls = SCRATCH_CLASS;
+	}
+
+	uint8_t* blk = mem.base + (size_t)mem.scratch * POOL_SLAB_SZ + slab->ofs;
+	slab->ofs += bsz;
+	slab->live++;
+
+	*(size_t*) blk = nb;
+	blk[sizeof(size_t)] = type;
+	track_alloc(type, nb);
+
+	return blk + SCRATCH_HDR;
+}
+
+static void pool_free(struct slab* slab, size_t ind, void* ptr)
+{
+	if (slab->cls == SCRATCH_CLASS){
+		uint8_t* blk = (uint8_t*) ptr - SCRATCH_HDR;
+		track_free(blk[sizeof(size_t)], *(size_t*) blk);
+
+		if (--slab->live)
+			return;
+
+/* the current scratch slab can just be rewound, others go on the list */
+		if (ind == mem.scratch)
+			slab->ofs = 0;
+		else {
+			slab->next = mem.scratch_free;
+			mem.scratch_free = ind;
+		}
+		return;
+	}
+
+	slab->live--;
+	*(void**) ptr = mem.pools[slab->type][slab->cls].free;
+	mem.pools[slab->type][slab->cls].free = ptr;
+	track_free(slab->type, (size_t)1 << (POOL_MIN_SHIFT + slab->cls));
+}
+
+static inline size_t sys_hash(uintptr_t ptr, size_t cap)
+{
+	return ((ptr >> 4) * 0x9E3779B97F4A7C15ull) & (cap - 1);
+}
+
+static struct sysblock* sys_find(uintptr_t ptr)
+{
+	if (!mem.sys_cap)
+		return NULL;
+
+	size_t i = sys_hash(ptr, mem.sys_cap);
+	while (mem.sys[i].ptr){
+		if (mem.sys[i].ptr == ptr)
+			return &mem.sys[i];
+		i = (i + 1) & (mem.sys_cap - 1);
+	}
+
+	return NULL;
+}
+
+static bool sys_grow()
+{
+	size_t ncap = mem.sys_cap ? mem.sys_cap * 2 : 1024;
+	if (mem.sys_used * 4 < mem.sys_cap)
+		ncap = mem.sys_cap;
+
+	struct sysblock* nset = calloc(ncap, sizeof(struct sysblock));
+	if (!nset)
+		return false;
+
+	for (size_t i = 0; i < mem.sys_cap; i++){
+		if (mem.sys[i].ptr <= SYSBLOCK_TOMB)
+			continue;
+
+		size_t j = sys_hash(mem.sys[i].ptr, ncap);
+		while (nset[j].ptr)
+			j = (j + 1) & (ncap - 1);
+		nset[j] = mem.sys[i];
+	}
+
+	free(mem.sys);
+	mem.sys = nset;
+	mem.sys_cap = ncap;
+	mem.sys_tomb = 0;
+	return true;
+}
+
+static void sys_track(void* ptr, size_t nb, enum arcan_memtypes type)
+{
+/* a stale entry means the block was released with free() rather than
+ * arcan_mem_free, account for it here and reuse the slot */
+	struct sysblock* blk = sys_find((uintptr_t) ptr);
+	if (blk){
+		track_free(blk->type, blk->size);
+		blk->size = nb;
+		blk->type = type;
+		track_alloc(type, nb);
+		return;
+	}
+
+	if ((mem.sys_used + mem.sys_tomb + 1) * 2 > mem.sys_cap && !sys_grow()){
+		track_alloc(type, nb);
+		return;
+	}
+
+	size_t i = sys_hash((uintptr_t) ptr, mem.sys_cap);
+	while (mem.sys[i].ptr > SYSBLOCK_TOMB)
+		i = (i + 1) & (mem.sys_cap - 1);
+
+	if (mem.sys[i].ptr == SYSBLOCK_TOMB)
+		mem.sys_tomb--;
+
+	mem.sys[i] = (struct sysblock){
+		.ptr = (uintptr_t) ptr,
+		.size = nb,
+		.type = type
+	};
+	mem.sys_used++;
+	track_alloc(type, nb);
+}
+
+static bool poolable(enum arcan_memtypes type,
+	enum arcan_memhint hint, enum arcan_memalign align)
+{
+	if (mem.disabled || align == ARCAN_MEMALIGN_PAGE ||
+		(hint & (ARCAN_MEM_SENSITIVE | ARCAN_MEM_EXEC | ARCAN_MEM_READONLY)))
+		return false;
+
+	switch (type){
+	case ARCAN_MEM_VSTRUCT:
+	case ARCAN_MEM_EXTSTRUCT:
+	case ARCAN_MEM_STRINGBUF:
+	case ARCAN_MEM_VTAG:
+	case ARCAN_MEM_ATAG:
+		return true;
+	default:
+		return (hint & ARCAN_MEM_TEMPORARY) > 0;
+	}
 }
 
 /*
  * there should essentially be NO memory blocks marked
  * TEMPORARY or SENSITIVE (NON VIDEO/AUDIO) alive at this
  * point, use the tick point to check and trap as leaks.
+ *
+ * For now, the tick only trims the recycled scratch slabs so that a burst
+ * of temporary allocations doesn't stay resident. A recycled slab keeps its
+ * offset until reused, so that doubles as a 'pages are dirty' marker.
  */
 void arcan_mem_tick()
 {
+	pthread_mutex_lock(&mem.lock);
+
+	size_t kept = 0;
+	for (uint32_t ind = mem.scratch_free;
+		POOL_NOSLAB != ind; ind = mem.slabs[ind].next){
+		struct slab* slab = &mem.slabs[ind];
+		if (kept++ < SCRATCH_RESERVE || !slab->ofs)
+			continue;
+
+		madvise(mem.base + (size_t)ind * POOL_SLAB_SZ, POOL_SLAB_SZ, MADV_DONTNEED);
+		slab->ofs = 0;
+	}
+
+	pthread_mutex_unlock(&mem.lock);
 }
 
 /*static void sigsegv_hand(int sig, siginfo_t* si, void* unused)
@@ -155,40 +535,40 @@ void* arcan_alloc_mem(size_t nb,
 	size_t padding_sz = 0;
 	size_t total;
 
-	switch (type){
-	case ARCAN_MEM_BINDING:
-	case ARCAN_MEM_THREADCTX:
-	case ARCAN_MEM_VBUFFER:
-	case ARCAN_MEM_ABUFFER:
-	case ARCAN_MEM_MODELDATA:
-	case ARCAN_MEM_VSTRUCT:
-	case ARCAN_MEM_EXTSTRUCT:
-	case ARCAN_MEM_STRINGBUF:
-	case ARCAN_MEM_VTAG:
-	case ARCAN_MEM_ATAG:
+	if (type <= 0 || type >= ARCAN_MEM_ENDMARKER)
+		abort();
 
-		total = header_sz + footer_sz + padding_sz + nb;
+	arcan_mem_init();
+	total = header_sz + footer_sz + padding_sz + nb;
 
-		switch(align){
-		case ARCAN_MEMALIGN_NATURAL:
-			rptr = malloc(total);
-		break;
+	if (nb && poolable(type, hint, align)){
+		pthread_mutex_lock(&mem.lock);
+		if (hint & ARCAN_MEM_TEMPORARY){
+			if (nb <= SCRATCH_MAX_SZ)
+				rptr = scratch_alloc(type, nb);
+		}
+		else if (nb <= POOL_MAX_SZ)
+			rptr = pool_alloc(type, nb);
+		pthread_mutex_unlock(&mem.lock);
+	}
 
-		case ARCAN_MEMALIGN_PAGE:
-			if (-1 == posix_memalign(&rptr, system_page_size, total))
-				rptr = NULL;
-		break;
+	if (rptr)
+		goto pooled;
 
-		case ARCAN_MEMALIGN_SIMD:
-			if (-1 == posix_memalign(&rptr, 16, total))
-				rptr = NULL;
-		break;
-		}
+	switch(align){
+	case ARCAN_MEMALIGN_NATURAL:
+		rptr = malloc(total);
 	break;
 
-	case ARCAN_MEM_ENDMARKER:
-	default:
-			abort();
+	case ARCAN_MEMALIGN_PAGE:
+		if (0 != posix_memalign(&rptr, system_page_size, total))
+			rptr = NULL;
+	break;
+
+	case ARCAN_MEMALIGN_SIMD:
+		if (0 != posix_memalign(&rptr, 16, total))
+			rptr = NULL;
+	break;
 	}
 
 	if (!rptr){
@@ -197,6 +577,10 @@ void* arcan_alloc_mem(size_t nb,
 		return NULL;
 	}
 
+	pthread_mutex_lock(&mem.lock);
+	sys_track(rptr, total, type);
+	pthread_mutex_unlock(&mem.lock);
+
 /*
  * Post-alloc hooks
  */
@@ -219,6 +603,7 @@ void* arcan_alloc_mem(size_t nb,
 	if (madvflag)
 		madvise(rptr, total, madvflag);
 
+pooled:
 	if (hint & ARCAN_MEM_BZERO){
 		if (type == ARCAN_MEM_VBUFFER){
 			av_pixel* buf = (av_pixel*) rptr;
@@ -232,6 +617,106 @@ void* arcan_alloc_mem(size_t nb,
 	return rptr;
 }
 
+/*
+ * Returns the usable size and type of a block, false if it isn't known
+ * (i.e. came from some other allocator).
+ */
+static bool block_info(void* ptr, size_t* nb, enum arcan_memtypes* type)
+{
+	size_t ind;
+	bool rv = true;
+
+	pthread_mutex_lock(&mem.lock);
+	struct slab* slab = slab_lookup(ptr, &ind);
+	struct sysblock* blk;
+
+	if (slab && slab->cls == SCRATCH_CLASS){
+		uint8_t* hdr = (uint8_t*) ptr - SCRATCH_HDR;
+		*nb = *(size_t*) hdr;
+		*type = hdr[sizeof(size_t)];
+	}
+	else if (slab){
+		*nb = (size_t)1 << (POOL_MIN_SHIFT + slab->cls);
+		*type = slab->type;
+	}
+	else if ((blk = sys_find((uintptr_t) ptr))){
+		*nb = blk->size;
+		*type = blk->type;
+	}
+	else
+		rv = false;
+
+	pthread_mutex_unlock(&mem.lock);
+	return rv;
+}
+
+static void* mem_resize(void* src, size_t nz, size_t nb, enum arcan_memhint hint)
+{
+	size_t cur;
+	enum arcan_memtypes type;
+
+	if (!block_info(src, &cur, &type) || nz > cur)
+		arcan_fatal("arcan_mem_grow/trunc(), unknown block or size mismatch\n");
+
+	switch (type){
+	case ARCAN_MEM_VSTRUCT:
+	case ARCAN_MEM_EXTSTRUCT:
+	case ARCAN_MEM_THREADCTX:
+		arcan_fatal("arcan_mem_grow/trunc(), static-sized type\n");
+	default:
+	break;
+	}
+
+/* no alignment information is kept, so resized blocks are natural aligned
+ * unless they fit in place */
+	if (nb <= cur)
+		return src;
+
+	void* res = arcan_alloc_mem(nb, type, hint & ARCAN_MEM_NONFATAL,
+		ARCAN_MEMALIGN_NATURAL);
+	if (!res)
+		return NULL;
+
+	memcpy(res, src, nz);
+	if (hint & ARCAN_MEM_BZERO)
+		memset((uint8_t*)res + nz, '\0', nb - nz);
+
+	arcan_mem_free(src);
+	return res;
+}
+
+void* arcan_mem_grow(void* src, size_t nz, size_t nb, enum arcan_memhint hint)
+{
+	return mem_resize(src, nz, nz + nb, hint);
+}
+
+void* arcan_mem_trunc(void* src, size_t nz, size_t nb, enum arcan_memhint hint)
+{
+	if (nb > nz)
+		arcan_fatal("arcan_mem_trunc(), truncating past the block size\n");
+
+	return mem_resize(src, nz, nz - nb, hint);
+}
+
+bool arcan_mem_stats(enum arcan_memtypes type, struct arcan_memstats* out)
+{
+	if (type <= 0 || type >= ARCAN_MEM_ENDMARKER || !out)
+		return false;
+
+	pthread_mutex_lock(&mem.lock);
+	struct mempool_meta* meta = &mem.meta[type];
+	*out = (struct arcan_memstats){
+		.alloc_cnt = meta->alloc_cnt,
+		.dealloc_cnt = meta->dealloc_cnt,
+		.in_use = meta->in_use,
+		.peak = meta->peak,
+		.pool_sz = meta->n_pages * system_page_size
+	};
+	pthread_mutex_unlock(&mem.lock);
+
+	return true;
+}
+
 void arcan_mem_growarr(struct arcan_strarr* res)
 {
 /* _alloc functions lacks a grow at the moment,
@@ -283,13 +768,33 @@ void* arcan_alloc_fillmem(const void* data,
 
 void arcan_mem_free(void* inptr)
 {
-/* lock then free */
 /* depending on type and flag, verify integrity,
  * then cleanup. VBUFFER for instance doesn't
  * automatically shrink, but rather reset and flag
  * as unused */
+	if (!inptr)
+		return;
 
+	size_t ind;
+	pthread_mutex_lock(&mem.lock);
+	struct slab* slab = slab_lookup(inptr, &ind);
+
+	if (slab){
+		pool_free(slab, ind, inptr);
+		pthread_mutex_unlock(&mem.lock);
+		return;
+	}
+
+/* blocks that didn't come from arcan_alloc_mem (strdup etc.) are also
+ * accepted, they simply aren't tracked */
+	struct sysblock* blk = sys_find((uintptr_t) inptr);
+	if (blk){
+		track_free(blk->type, blk->size);
+		blk->ptr = SYSBLOCK_TOMB;
+		mem.sys_used--;
+		mem.sys_tomb++;
+	}
+	pthread_mutex_unlock(&mem.lock);
 
 	free(inptr);
 }
-
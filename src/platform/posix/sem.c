@@ -8,6 +8,12 @@
 #include <time.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <limits.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 #ifndef PLATFORM_HEADER
 #include "arcan_shmif.h"
@@ -35,6 +41,56 @@ int arcan_sem_wait(sem_handle sem)
 	return sem_wait(sem);
 }
 
+int arcan_sem_timedwait(sem_handle sem, int msecs)
+{
+	if (msecs < 0)
+		return sem_wait(sem);
+
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += msecs / 1000;
+	ts.tv_nsec += (long)(msecs % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L){
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	int rv;
+	while (-1 == (rv = sem_timedwait(sem, &ts)) && errno == EINTR){}
+	return rv;
+}
+
+/*
+ * The futex words live in the shared page (vready/aready), so these can't be
+ * the _PRIVATE variants. Other platforms fail with ENOSYS and the caller is
+ * expected to stay with the semaphores.
+ */
+int arcan_futex_wait(volatile _Atomic unsigned* addr, unsigned val, int msecs)
+{
+#ifdef __linux__
+	struct timespec ts = {
+		.tv_sec = msecs / 1000,
+		.tv_nsec = (long)(msecs % 1000) * 1000000L
+	};
+	return syscall(SYS_futex,
+		addr, FUTEX_WAIT, val, msecs < 0 ? NULL : &ts, NULL, 0);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+int arcan_futex_wake(volatile _Atomic unsigned* addr, int n)
+{
+#ifdef __linux__
+	return syscall(SYS_futex,
+		addr, FUTEX_WAKE, n < 0 ? INT_MAX : n, NULL, NULL, 0);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
 int arcan_sem_init(sem_handle* sem, unsigned val)
 {
 	if (*sem == NULL){
@@ -172,6 +172,19 @@ struct agp_vstore {
 	size_t refcount;
 	uint32_t update_ts;
 
+/* managed by the video layer (arcan_vint_storedamage), gen is stepped whenever
+ * the contents change. The region (in store pixels) is the union of all the
+ * changes since gen was [base], accumulated for one refresh [epoch]. This lets
+ * the objects sharing the store track damage, x2 == 0 means the entire store */
+	struct {
+		uint32_t gen, base, epoch;
+		size_t x1, y1, x2, y2;
+	} damage;
+
+/* set by the video layer when the store is handed out by the decoded image
+ * cache, so that the cache entry can follow the store when it is dropped */
+	void* cache;
+
 	union {
 		struct {
 /* ID number connecting to AGP, this MAY be bound diretly to the glid
@@ -570,11 +583,16 @@ typedef uint32_t agp_shader_id;
  * Retrieve the default shader for a specific purpose,
  * BASIC_2D => single textured, alpha in obj_opacity
  * COLOR_2D => not textured, color channel in uniforms
+ * BATCH_2D => as BASIC_2D, but pre-transformed vertices and opacity in the
+ *             color attribute, used with agp_submit_batch
+ * BATCH_COLOR_2D => as COLOR_2D, color and opacity in the color attribute
  */
 enum SHADER_TYPES {
 	BASIC_2D = 0,
 	COLOR_2D,
 	BASIC_3D,
+	BATCH_2D,
+	BATCH_COLOR_2D,
 	SHADER_TYPE_ENDM
 };
 agp_shader_id agp_default_shader(enum SHADER_TYPES);
@@ -824,6 +842,16 @@ void agp_blendstate(enum arcan_blendfunc);
 void agp_draw_vobj(float x1, float y1, float x2, float y2,
 	const float* txcos, const float* modelview);
 
+/*
+ * Draw [n] quads in one call using the currently active shader and vstore,
+ * intended for the BATCH_2D / BATCH_COLOR_2D default shaders. The vertices
+ * are expected to be transformed by their modelview already (only projection
+ * is applied) and each quad is 6 vertices (two triangles) with 3 floats in [verts], 2 in
+ * [txcos] and 4 (rgba) in [colors]. [txcos] can be NULL.
+ */
+void agp_submit_batch(const float* verts,
+	const float* txcos, const float* colors, size_t n);
+
 /*
  * Destination format for rendertargets. Note that we do not currently suport
  * floating point targets and that for some platforms, COLOR_DEPTH will map to
@@ -898,6 +926,15 @@ void agp_rendertarget_clear();
 void agp_rendertarget_clearcolor(
 	struct agp_rendertarget*, float, float, float, float);
 
+/*
+ * Limit clearing and drawing in the currently active rendertarget to the
+ * region (x, y, w, h) in framebuffer pixels, origo in the lower left corner.
+ * A region with w or h set to 0 resets to cover the entire rendertarget.
+ * agp_activate_rendertarget always resets the region.
+ */
+void agp_rendertarget_scissor(
+	struct agp_rendertarget*, size_t x, size_t y, size_t w, size_t h);
+
 enum agp_mesh_type {
 	AGP_MESH_TRISOUP,
 	AGP_MESH_POINTCLOUD
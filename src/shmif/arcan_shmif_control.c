@@ -104,6 +104,13 @@ struct shmif_hidden {
 	uint8_t vbuf_ind, vbuf_cnt;
 	shmif_pixel* vbuf[ARCAN_SHMIF_VBUFC_LIM];
 
+/* regions added through _dirty in SUBREGION_CHAIN mode for the next frame,
+ * count > ARCAN_SHMIF_DIRTYCHAIN_LIM means overflow (use bounding box) */
+	struct {
+		struct arcan_shmif_region regions[ARCAN_SHMIF_DIRTYCHAIN_LIM];
+		uint8_t count;
+	} dirty_chain;
+
 	shmif_trigger_hook audio_hook;
 	void* audio_hook_data;
 	uint8_t abuf_ind, abuf_cnt;
@@ -118,6 +125,7 @@ struct shmif_hidden {
 	bool alive : 1;
 	bool paused : 1;
 	bool log_event : 1;
+	bool futex : 1;
 
 	char* alt_conn;
 
@@ -1222,6 +1230,14 @@ struct arcan_shmif_cont shmif_acquire_int(
 		((struct shmif_hidden*)res.priv)->output = true;
 	}
 
+/* output segments have the server as the producer, keep those on the
+ * semaphores. A zero-wake probes if the primitive is there at all. */
+	else if (((flags & SHMIF_FUTEX_SYNCH) || getenv("ARCAN_SHMIF_FUTEX")) &&
+		arcan_futex_wake(&res.addr->vready, 0) >= 0){
+		res.priv->futex = true;
+		atomic_store(&res.addr->synch_mode, SHMIF_SYNCH_FUTEX);
+	}
+
 	return res;
 }
 
@@ -1373,10 +1389,28 @@ static bool step_v(struct arcan_shmif_cont* ctx)
 /* subregion is part of the shared block and not the video buffer
  * itself. this is a design flaw that should be moved into a
  * VBI- style post-buffer footer */
-	if (ctx->hints & SHMIF_RHINT_SUBREGION){
+	if (ctx->hints & (SHMIF_RHINT_SUBREGION | SHMIF_RHINT_SUBREGION_CHAIN)){
 		atomic_store(&ctx->addr->dirty, ctx->dirty);
 	}
 
+/* the chain lives in the shared block for the same reason, it is only
+ * written while the server is not looking (vready == 0) and is reset for
+ * every frame, unlike the dirty region which is left to the caller */
+	if (ctx->hints & SHMIF_RHINT_SUBREGION_CHAIN){
+		uint8_t count = priv->dirty_chain.count;
+		if (count > ARCAN_SHMIF_DIRTYCHAIN_LIM)
+			count = 0;
+
+		memcpy(ctx->addr->dirty_chain.regions,
+			priv->dirty_chain.regions, sizeof(struct arcan_shmif_region) * count);
+		atomic_store(&ctx->addr->dirty_chain.count, count);
+
+		priv->dirty_chain.count = 0;
+		ctx->dirty = (struct arcan_shmif_region){
+			.x1 = ctx->w, .y1 = ctx->h
+		};
+	}
+
 /* mark the current buffer as pending, this is used when we have
  * non-subregion + (double, triple, quadruple buffer) rendering */
 	int pending = atomic_fetch_or_explicit(
@@ -1431,6 +1465,38 @@ static bool step_a(struct arcan_shmif_cont* ctx)
 	return lock;
 }
 
+/*
+ * Wait for the server to release [word] (vready or aready). In futex mode the
+ * wait is on the word itself, capped so that the dms gets re-checked as the
+ * guard thread only knows how to pull the semaphores. [msecs] < 0 waits until
+ * released or dead, returns false on timeout.
+ */
+#define SYNCH_FUTEX_STEP 100
+static bool synch_wait(struct arcan_shmif_cont* ctx,
+	volatile atomic_uint* word, sem_handle sem, int msecs)
+{
+	long long start = msecs > 0 ? arcan_timemillis() : 0;
+	int left = msecs;
+	unsigned val;
+
+	while ((val = atomic_load_explicit(word, memory_order_acquire)) &&
+		ctx->addr->dms){
+		if (msecs > 0)
+			left = msecs - (int)(arcan_timemillis() - start);
+
+		if (msecs >= 0 && left <= 0)
+			return false;
+
+		if (ctx->priv->futex)
+			arcan_futex_wait(word, val,
+				left < 0 || left > SYNCH_FUTEX_STEP ? SYNCH_FUTEX_STEP : left);
+		else
+			arcan_sem_timedwait(sem, left);
+	}
+
+	return atomic_load(word) == 0;
+}
+
 unsigned arcan_shmif_signal(struct arcan_shmif_cont* ctx,
 	enum arcan_shmif_sigmask mask)
 {
@@ -1460,8 +1526,12 @@ unsigned arcan_shmif_signal(struct arcan_shmif_cont* ctx,
 		bool lock = step_a(ctx);
 
 /* guard-thread will pull the sems for us on dms */
-		if (lock && !(mask & SHMIF_SIGBLK_NONE))
-			arcan_sem_wait(ctx->asem);
+		if (lock && !(mask & SHMIF_SIGBLK_NONE)){
+			if (priv->futex)
+				synch_wait(ctx, &ctx->addr->aready, ctx->asem, -1);
+			else
+				arcan_sem_wait(ctx->asem);
+		}
 		else
 			arcan_sem_trywait(ctx->asem);
 	}
@@ -1469,22 +1539,21 @@ unsigned arcan_shmif_signal(struct arcan_shmif_cont* ctx,
  * check before running the step_v */
 	if (mask & SHMIF_SIGVID){
 		if (priv->log_event){
-			fprintf(stderr, "SIGVID (block: %d region: %zu,%zu-%zu,%zu)\n",
+			fprintf(stderr, "SIGVID (block: %d region: %zu,%zu-%zu,%zu chain: %d)\n",
 				(mask & SHMIF_SIGBLK_NONE) ? 0 : 1,
 				(size_t)ctx->dirty.x1, (size_t)ctx->dirty.y1,
-				(size_t)ctx->dirty.x2, (size_t)ctx->dirty.y2
+				(size_t)ctx->dirty.x2, (size_t)ctx->dirty.y2,
+				(int)priv->dirty_chain.count
 			);
 		}
 
-		while ((ctx->hints & SHMIF_RHINT_SUBREGION) && ctx->addr->vready)
-			arcan_sem_wait(ctx->vsem);
+		if (ctx->hints & (SHMIF_RHINT_SUBREGION | SHMIF_RHINT_SUBREGION_CHAIN))
+			synch_wait(ctx, &ctx->addr->vready, ctx->vsem, -1);
 
 		bool lock = step_v(ctx);
 
-		if (lock && !(mask & SHMIF_SIGBLK_NONE)){
-			while (ctx->addr->vready)
-				arcan_sem_wait(ctx->vsem);
-		}
+		if (lock && !(mask & SHMIF_SIGBLK_NONE))
+			synch_wait(ctx, &ctx->addr->vready, ctx->vsem, -1);
 		else
 			arcan_sem_trywait(ctx->vsem);
 	}
@@ -1492,6 +1561,30 @@ unsigned arcan_shmif_signal(struct arcan_shmif_cont* ctx,
 	return arcan_timemillis() - startt;
 }
 
+bool arcan_shmif_signal_wait(
+	struct arcan_shmif_cont* ctx, int mask, int timeout)
+{
+	if (!ctx || !ctx->addr || !ctx->priv || !ctx->addr->dms)
+		return false;
+
+	long long start = arcan_timemillis();
+
+	if ((mask & SHMIF_SIGVID) &&
+		!synch_wait(ctx, &ctx->addr->vready, ctx->vsem, timeout))
+		return false;
+
+	if (mask & SHMIF_SIGAUD){
+		if (timeout > 0){
+			timeout -= (int)(arcan_timemillis() - start);
+			timeout = timeout < 0 ? 0 : timeout;
+		}
+		if (!synch_wait(ctx, &ctx->addr->aready, ctx->asem, timeout))
+			return false;
+	}
+
+	return true;
+}
+
 struct arg_arr* arcan_shmif_args( struct arcan_shmif_cont* inctx)
 {
 	if (!inctx || !inctx->priv)
@@ -1594,14 +1687,8 @@ static bool shmif_resize(struct arcan_shmif_cont* arg,
 	}
 
 /* wait for any outstanding v/asynch */
-	if (atomic_load(&arg->addr->vready)){
-		while (atomic_load(&arg->addr->vready) && arg->addr->dms)
-			arcan_sem_wait(arg->vsem);
-	}
-	if (atomic_load(&arg->addr->aready)){
-		while (atomic_load(&arg->addr->aready) && arg->addr->dms)
-			arcan_sem_wait(arg->asem);
-	}
+	synch_wait(arg, &arg->addr->vready, arg->vsem, -1);
+	synch_wait(arg, &arg->addr->aready, arg->asem, -1);
 
 	width = width < 1 ? 1 : width;
 	height = height < 1 ? 1 : height;
@@ -2091,11 +2178,8 @@ enum shmif_migrate_status arcan_shmif_migrate(
 
 /* got a valid connection, first synch source segment so we don't have
  * anything pending */
-	while(atomic_load(&cont->addr->vready) && cont->addr->dms)
-		arcan_sem_wait(cont->vsem);
-
-	while(atomic_load(&cont->addr->aready) && cont->addr->dms)
-		arcan_sem_wait(cont->asem);
+	synch_wait(cont, &cont->addr->vready, cont->vsem, -1);
+	synch_wait(cont, &cont->addr->aready, cont->asem, -1);
 
 	size_t w = atomic_load(&cont->addr->w);
 	size_t h = atomic_load(&cont->addr->h);
@@ -2656,16 +2740,38 @@ pid_t arcan_shmif_handover_exec(
 
 unsigned arcan_shmif_deadline(struct arcan_shmif_cont* c, int* errc)
 {
-	if (!c || !c->addr)
-		return -1;
+	int dummy;
+	if (!errc)
+		errc = &dummy;
 
-	if (c->addr->vready)
-		return -2;
+	if (!c || !c->addr || !c->addr->dms){
+		*errc = -1;
+		return 0;
+	}
 
-/*
- * no actual deadline information yet, just first part in hooking it up
- */
-	return -3;
+	if (atomic_load(&c->addr->vready)){
+		*errc = -2;
+		return 0;
+	}
+
+	unsigned long long next = atomic_load(&c->addr->vsynch.next);
+	unsigned period = atomic_load(&c->addr->vsynch.period);
+	unsigned cost = atomic_load(&c->addr->vsynch.cost);
+
+	if (!next || !period){
+		*errc = -3;
+		return 0;
+	}
+
+/* the server only updates this when it polls us, so the projection might be
+ * for a synch that has already passed - step forward in whole periods */
+	unsigned long long now = arcan_timemillis();
+	unsigned long long cutoff = next > cost ? next - cost : 0;
+	if (cutoff < now)
+		cutoff += ((now - cutoff) / period + 1) * period;
+
+	*errc = 0;
+	return cutoff - now;
 }
 
 int arcan_shmif_dirty(struct arcan_shmif_cont* cont,
@@ -2694,15 +2800,42 @@ int arcan_shmif_dirty(struct arcan_shmif_cont* cont,
 	if (y2 > cont->dirty.y2)
 		cont->dirty.y2 = y2;
 
-	return 0;
+	if (!(cont->hints & SHMIF_RHINT_SUBREGION_CHAIN))
+		return 0;
 
-/*
- * Missing: special behavior for SHMIF_RHINT_SUBREGION_CHAIN, setup chain of
- * atomic [uint32_t, bitfl] and walk from first position to last free. Bitfl
- * marks both the server side "I know this" and client side "synch this or
- * wait".
- *
- * If there's not enough store left to walk on, signal video and wait (unless
- * noblock flag is set)
- */
+/* the bounding box above is kept as the fallback for overflow, and for
+ * servers that doesn't understand the chain */
+	struct shmif_hidden* priv = cont->priv;
+	if (priv->dirty_chain.count > ARCAN_SHMIF_DIRTYCHAIN_LIM)
+		return 0;
+
+	if (x2 > cont->w)
+		x2 = cont->w;
+
+	if (y2 > cont->h)
+		y2 = cont->h;
+
+	if (x1 >= x2 || y1 >= y2)
+		return 0;
+
+	struct arcan_shmif_region reg = {.x1 = x1, .y1 = y1, .x2 = x2, .y2 = y2};
+
+/* drop regions already covered, and let a covering region replace one */
+	for (size_t i = 0; i < priv->dirty_chain.count; i++){
+		struct arcan_shmif_region* cur = &priv->dirty_chain.regions[i];
+		if (x1 >= cur->x1 && y1 >= cur->y1 && x2 <= cur->x2 && y2 <= cur->y2)
+			return 0;
+
+		if (x1 <= cur->x1 && y1 <= cur->y1 && x2 >= cur->x2 && y2 >= cur->y2){
+			*cur = reg;
+			return 0;
+		}
+	}
+
+/* this will step past the limit and mark the chain as overflowed */
+	if (priv->dirty_chain.count < ARCAN_SHMIF_DIRTYCHAIN_LIM)
+		priv->dirty_chain.regions[priv->dirty_chain.count] = reg;
+	priv->dirty_chain.count++;
+
+	return 0;
 }
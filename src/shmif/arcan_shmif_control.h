@@ -121,6 +121,12 @@ static const int ARCAN_SHMIF_ACHANNELS = 2;
  */
 #define ARCAN_SHMIF_ABUFC_LIM 12
 #define ARCAN_SHMIF_VBUFC_LIM 3
+
+/*
+ * Number of separate dirty regions that can be provided per frame in
+ * SHMIF_RHINT_SUBREGION_CHAIN mode, also affects ABI
+ */
+#define ARCAN_SHMIF_DIRTYCHAIN_LIM 16
 /*
  * These are technically limited by the combination of graphics and video
  * platforms. Since the buffers are placed at the end of the struct, they
@@ -299,6 +305,24 @@ enum ARCAN_FLAGS {
 
 /* Setting this flag will avoid sending the register event on acquire */
 	SHMIF_NOREGISTER = 1024,
+
+/*
+ * Wait directly on the vready/aready words in the shared page (futex) rather
+ * than on the semaphores, making a signal/ack round-trip one syscall on each
+ * side. This is silently ignored on platforms without such a primitive and
+ * for output segments. Can also be enabled by setting ARCAN_SHMIF_FUTEX
+ * in the environment.
+ */
+	SHMIF_FUTEX_SYNCH = 2048
+};
+
+/*
+ * Values for the page synch_mode field, the server side uses this to pick
+ * the wakeup method when releasing vready / aready.
+ */
+enum shmif_synch_mode {
+	SHMIF_SYNCH_SEMAPHORE = 0,
+	SHMIF_SYNCH_FUTEX = 1
 };
 
 /*
@@ -545,6 +569,18 @@ void arcan_shmif_drop(struct arcan_shmif_cont*);
  */
 unsigned arcan_shmif_signal(struct arcan_shmif_cont*, enum arcan_shmif_sigmask);
 
+/*
+ * Block until the buffers in [mask] (SHMIF_SIGVID, SHMIF_SIGAUD) from a
+ * previous signal with SHMIF_SIGBLK_NONE have been released by the server,
+ * or [timeout] miliseconds have passed (< 0 waits indefinitely).
+ *
+ * Returns true if the buffers were released, false on timeout or if the
+ * connection is dead. This lets the client pair a non-blocking signal with
+ * a deadline of its own, e.g. to keep processing input while waiting.
+ */
+bool arcan_shmif_signal_wait(
+	struct arcan_shmif_cont*, int mask, int timeout);
+
 /*
  * Signal a video transfer that is based on buffer sharing rather than on data
  * in the shmpage. Otherwise it behaves like [arcan_shmif_signal] but with a
@@ -693,7 +729,7 @@ struct arcan_shmif_cont {
  * SHMIF_RHINT_ORIGO_UL (or LL),
  * SHMIF_RHINT_IGNORE_ALPHA
  * SHMIF_RHINT_SUBREGION (only synch dirty region below)
- * SHMIF_RHINT_SUBREGION_CHAIN (reserved, not in use)
+ * SHMIF_RHINT_SUBREGION_CHAIN (synch a set of dirty regions, see _dirty)
  * SHMIF_RHINT_CSPACE_SRGB (non-linear color space)
  * SHMIF_RHINT_AUTH_TOK
  * SHMIF_RHINT_VSIGNAL_EV (get frame- delivery notification via STEPFRAME)
@@ -822,12 +858,12 @@ enum rhint_mask {
 	SHMIF_RHINT_VSIGNAL_EV = 32,
 
 /*
- * [Reserved, not yet used]
- * Change the buffer contents management method to be a chain of dirty
- * rectangles rather than one continous buffer. This means that the contents of
- * the normal vidp, stride and pitch members may mutate between calls to
- * arcan_shmif_dirty and that it is write only, you can't use it for reliable
- * blending etc. Setting this bit will invalidate SHMIF_RHINT_SUBREGION.
+ * Extends SHMIF_RHINT_SUBREGION so that each call to arcan_shmif_dirty adds a
+ * separate region to a chain (up to ARCAN_SHMIF_DIRTYCHAIN_LIM) rather than
+ * growing a single bounding box. The chain is synched and reset with each
+ * video signal, and the server MAY synch only the regions in the chain. If the
+ * chain overflows, it falls back to the bounding box behavior for that frame.
+ * The buffer contents are still required to be intact outside the regions.
  */
 	SHMIF_RHINT_SUBREGION_CHAIN = 64
 };
@@ -880,11 +916,28 @@ struct arcan_shmif_page {
  */
 	volatile _Atomic uint_least8_t hints;
 
+/* [FSRV-SET, ARCAN-ACK(vready/aready)]
+ * Set through the SHMIF_FUTEX_SYNCH flag, not here. Indicates how the
+ * client waits for [vready] and [aready] to be released, see
+ * enum shmif_synch_mode.
+ */
+	volatile _Atomic uint_least8_t synch_mode;
+
 /*
  * see dirty- field in _cont, manipulate there, not here.
  */
 	volatile _Atomic struct arcan_shmif_region dirty;
 
+/* [FSRV-SET, ARCAN-ACK(vready)]
+ * With SHMIF_RHINT_SUBREGION_CHAIN, the regions that were marked for the
+ * frame in [vready]. Only the [count] first are valid, 0 means that the
+ * [dirty] bounding box applies. Use arcan_shmif_dirty, not this.
+ */
+	struct {
+		volatile _Atomic uint_least8_t count;
+		struct arcan_shmif_region regions[ARCAN_SHMIF_DIRTYCHAIN_LIM];
+	} dirty_chain;
+
 /* [FSRV-SET]
  * Unique (or 0) segment identifier. Prvodes a local namespace for specifying
  * relative properties (e.g. VIEWPORT command from popups) between subsegments,
@@ -964,6 +1017,20 @@ struct arcan_shmif_page {
  */
 	volatile _Atomic uint_least64_t vpts;
 
+/*
+ * [ARCAN-SET]
+ * Deadline feedback, see arcan_shmif_deadline. [next] is the projected time
+ * (arcan_timemillis) of the next display synch and [period] the estimated
+ * time between synchs. [cost] is the measured time from a buffer of this
+ * segment being picked up until it has been composed and synched. All in
+ * milliseconds, 0 if unknown.
+ */
+	struct {
+		volatile _Atomic uint_least64_t next;
+		volatile _Atomic uint_least32_t period;
+		volatile _Atomic uint_least32_t cost;
+	} vsynch;
+
 /*
  * [ARCAN-SET]
  * Set during segment initalization, provides some identifier to determine
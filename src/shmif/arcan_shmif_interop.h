@@ -81,6 +81,9 @@ file_handle arcan_fetchhandle(int insock, bool block);
 bool arcan_pushhandle(int fd, int channel);
 int arcan_sem_wait(sem_handle sem);
 int arcan_sem_trywait(sem_handle sem);
+int arcan_sem_timedwait(sem_handle sem, int msecs);
+int arcan_futex_wait(volatile _Atomic unsigned* addr, unsigned val, int msecs);
+int arcan_futex_wake(volatile _Atomic unsigned* addr, int n);
 #endif
 
 struct arcan_shmif_cont;
@@ -323,26 +326,16 @@ pid_t arcan_shmif_handover_exec(
  * context is dead / broken. You are still required to use shmif_signal calls
  * to synchronize the contents. Only the set of damaged regions will grow.
  *
- * [ Not yet implemented ]
- * This interface combines a number of latency and performance sensitive
- * usecases, with the ideal should re-add the possibility of run-ahead or
- * a run-behind the beam on a single buffered output.
+ * For SHMIF_RHINT_SUBREGION_CHAIN, each call adds a separate region to a
+ * chain that is synched and reset on the next video signal, so that updates
+ * to regions far apart (e.g. a status bar and a cursor) do not turn into one
+ * large bounding box. Regions that are covered by one already in the chain
+ * are ignored. If more than ARCAN_SHMIF_DIRTYCHAIN_LIM regions are added, the
+ * frame falls back to using the bounding box of all of them. The function
+ * returns 0 on success or -1 if the context is dead / broken.
  *
- * For SHMIF_RHINT_SUBREGION_CHAIN, the options to the flags function are:
- * SHMIF_DIRTY_NONBLOCK, SHMIF_DIRTY_PARTIAL and SHMIF_DIRTY_SIGNAL.
- * Bitmask behavior is: NONBLOCK | (PARTIAL ^ SIGNAL).
- *
- * If NONBLOCK is set, the function returns SHMIF_DIRTY_EWOULDBLOCK if the
- * operation would block and in that case, the dirty region won't register.
- *
- * if PARTIAL is set, the update will be synched to whatever output the
- * connection may be mapped to but no other notification about the update will
- * be triggered. Instead, if SIGNAL is set, when the region has been synched,
- * other subsystems will be alerted as to a logical 'frame' update.
- *
- * This is used in order to allow 'per scanline' like updates but without
- * storming subsystems that reason on a "logical buffer" update where the
- * cost per frame might be too high to be invoked in smaller chunks.
+ * [fl] is reserved for future synchronization options (e.g. non-blocking or
+ * per-scanline partial updates) and should be set to 0.
  *
  * If the dirty region provides invalid constraints (x1 >= x2, y1 >= y2,
  * x2 > cont->w, y2 > cont->h) the values will be clamped to the size of
@@ -352,13 +345,21 @@ int arcan_shmif_dirty(struct arcan_shmif_cont*,
 	size_t x1, size_t y1, size_t x2, size_t y2, int fl);
 
 /*
- * Get an estimate on how many MICROSECONDS left until the next ideal time
- * to synch. Possible [errc] values:
+ * Get an estimate on how many MILLISECONDS are left until the cutoff for
+ * getting a signalled frame into the next display synch, i.e. the projected
+ * synch time minus the measured upload and composition cost for this segment.
+ * If the cutoff has already passed, the one for the synch after that is used.
+ *
+ * [errc] (if provided) is set to 0 on success, or one of:
  *  -1, invalid / dead context
- *  -2, context in a blocked state
+ *  -2, context in a blocked state (last frame not yet released)
  *  -3, no deadline information available
+ * in which case 0 is returned.
+ *
  * This is primarily intended for clients with special timing needs due to
- * latency concerns, typically games and multimedia.
+ * latency concerns, typically games and multimedia, that want to sample input
+ * and render as late as possible rather than having a finished frame wait in
+ * the queue.
  */
 unsigned arcan_shmif_deadline(struct arcan_shmif_cont*, int* errc);
 
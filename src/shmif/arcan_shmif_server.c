@@ -351,7 +351,7 @@ struct shmifsrv_vbuffer shmifsrv_video(struct shmifsrv_client* cl, bool step)
 	if (step){
 /* signal that we're done with the buffer */
 		atomic_store_explicit(&cl->con->shm.ptr->vready, 0, memory_order_release);
-		arcan_sem_post(cl->con->vsync);
+		platform_fsrv_release(cl->con, false);
 
 /* If the frameserver has indicated that it wants a frame callback every time
  * we consume. This is primarily for cases where a client needs to I/O mplex
@@ -409,7 +409,7 @@ struct shmifsrv_abuffer shmifsrv_audio(
 /* missing, copy buffer, re-use buf if possible, release if we're out
  * of buffers */
 	atomic_store_explicit(&cl->con->shm.ptr->aready, 0, memory_order_release);
-	arcan_sem_post(cl->con->async);
+	platform_fsrv_release(cl->con, true);
 	return res;
 }
 
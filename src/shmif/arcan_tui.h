@@ -116,6 +116,7 @@
  *  erase_current_line(ctgx)
  *  erase_chars(ctx, n)
  *  write(ucs4, attr)
+ *  writeucs4(uint32_t* ucs4, size_t n, attr)
  *  writeu8(uint8_t* u8, size_t n, attr)
  *  insert_lines(ctx, n)
  *  newline(ctx)
@@ -219,6 +220,9 @@ struct tui_settings {
 
 /* see syms for possible render flags */
 	unsigned render_flags;
+
+/* number of lines kept in the scrollback buffer, 0 to disable */
+	unsigned scrollback;
 };
 
 struct tui_context;
@@ -793,6 +797,14 @@ uint32_t arcan_tui_screens(struct tui_context*);
 void arcan_tui_write(struct tui_context*,
 	uint32_t ucode, struct tui_screen_attr*);
 
+/*
+ * Insert [n] unicode codepoints from [ucs4] at the current cursor position,
+ * sharing the same attribute. This behaves as repeated calls to
+ * arcan_tui_write but is considerably cheaper for longer runs.
+ */
+void arcan_tui_writeucs4(struct tui_context*,
+	const uint32_t* ucs4, size_t n, struct tui_screen_attr*);
+
 /*
  * (Helper function)
  * This converts [n] bytes from [u8] as UTF-8 into multiple UCS4 writes.
@@ -980,6 +992,7 @@ typedef bool (* PTUISWSCR)(struct tui_context*, unsigned);
 typedef bool (* PTUIDELSCR)(struct tui_context*, unsigned);
 typedef uint32_t (* PTUISCREENS)(struct tui_context*);
 typedef void (* PTUIWRITE)(struct tui_context*, uint32_t, struct tui_screen_attr*);
+typedef void (* PTUIWRITEUCS4)(struct tui_context*, const uint32_t*, size_t, struct tui_screen_attr*);
 typedef bool (* PTUIWRITEU8)(struct tui_context*, const uint8_t*, size_t, struct tui_screen_attr*);
 typedef bool (* PTUIWRITESTR)(struct tui_context*, const char*, struct tui_screen_attr*);
 typedef void (* PTUICURSORPOS)(struct tui_context*, size_t*, size_t*);
@@ -1046,6 +1059,7 @@ static PTUISWSCR arcan_tui_switch_screen;
 static PTUIDELSCR arcan_tui_delete_screen;
 static PTUISCREENS arcan_tui_screens;
 static PTUIWRITE arcan_tui_write;
+static PTUIWRITEUCS4 arcan_tui_writeucs4;
 static PTUIWRITEU8 arcan_tui_writeu8;
 static PTUIWRITESTR arcan_tui_writestr;
 static PTUICURSORPOS arcan_tui_cursorpos;
@@ -1114,6 +1128,7 @@ M(PTUISWSCR,arcan_tui_switch_screen);
 M(PTUIDELSCR,arcan_tui_delete_screen);
 M(PTUISCREENS,arcan_tui_screens);
 M(PTUIWRITE,arcan_tui_write);
+M(PTUIWRITEUCS4,arcan_tui_writeucs4);
 M(PTUIWRITEU8,arcan_tui_writeu8);
 M(PTUIWRITESTR,arcan_tui_writestr);
 M(PTUICURSORPOS,arcan_tui_cursorpos);
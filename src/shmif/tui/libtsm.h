@@ -186,6 +186,11 @@ int tsm_screen_set_margins(struct tsm_screen *con,
 void tsm_screen_set_max_sb(struct tsm_screen *con, unsigned int max);
 void tsm_screen_clear_sb(struct tsm_screen *con);
 
+/* heap bytes held by the screen, [sb] gets the part used by the
+ * scrollback and [sb_lines] the number of lines in it (both optional) */
+size_t tsm_screen_memory(struct tsm_screen *con,
+	size_t *sb, unsigned int *sb_lines);
+
 int tsm_screen_sb_up(struct tsm_screen *con, unsigned int num);
 int tsm_screen_sb_down(struct tsm_screen *con, unsigned int num);
 int tsm_screen_sb_page_up(struct tsm_screen *con, unsigned int num);
@@ -210,6 +215,8 @@ void tsm_screen_reset_all_tabstops(struct tsm_screen *con);
 
 int tsm_screen_write(struct tsm_screen *con, tsm_symbol_t ch,
 		const struct tui_screen_attr *attr);
+int tsm_screen_write_run(struct tsm_screen *con, const tsm_symbol_t *ch,
+		size_t n, const struct tui_screen_attr *attr);
 int tsm_screen_newline(struct tsm_screen *con);
 int tsm_screen_scroll_up(struct tsm_screen *con, unsigned int num);
 int tsm_screen_scroll_down(struct tsm_screen *con, unsigned int num);
@@ -298,9 +305,16 @@ int tsm_screen_get_word(struct tsm_screen *con,
 /* returns: !0 if cell is empty */
 int tsm_screen_empty(struct tsm_screen *con, unsigned x, unsigned y);
 
+/*
+ * Only rows that have been written to since the last call are walked (all of
+ * them when viewing scrollback or with an active selection). Use
+ * tsm_screen_invalidate when the receiver of draw_cb has lost its copy.
+ */
 tsm_age_t tsm_screen_draw(
 	struct tsm_screen *con, tsm_screen_draw_cb draw_cb, void *data);
 
+void tsm_screen_invalidate(struct tsm_screen *con);
+
 #ifdef __cplusplus
 }
 #endif
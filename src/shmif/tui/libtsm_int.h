@@ -94,18 +94,31 @@ struct cell {
 };
 
 struct line {
-	struct line *next;
-	struct line *prev;
-
 	unsigned int size;
 	struct cell *cells;
-	uint64_t sb_id;
+	tsm_age_t age;
+};
+
+/* encoded scrollback lines, see "Scrollback storage" in tsm_screen.c */
+struct sb_run {
+	uint16_t start;
+	uint16_t attr;
+};
+
+struct sb_line {
+	size_t ofs;
+	uint32_t len;
+	uint16_t size;		/* columns when the line left the screen */
+	uint16_t n_cells;	/* encoded cells, rest repeat the last run */
+	uint32_t n_runs;	/* run slots, including inline escaped keys */
+	bool narrow;		/* symbols are stored as u8 */
+	bool wide;		/* per-cell widths follow the symbols */
 	tsm_age_t age;
 };
 
 #define SELECTION_TOP -1
 struct selection_pos {
-	struct line *line;
+	uint64_t line; /* scrollback line id, 0 if on the active screen */
 	unsigned int x;
 	int y;
 };
@@ -133,14 +146,32 @@ struct tsm_screen {
 	struct line **alt_lines;
 	tsm_age_t age;
 
+	/* rows touched since the last tsm_screen_draw, one bit per line_num */
+	uint64_t *dirty_rows;
+
 	/* scroll-back buffer */
+	struct sb_line *sb_lines;	/* ring of encoded line records */
+	unsigned int sb_cap;		/* allocated records in sb_lines */
+	unsigned int sb_first;		/* ring index of the oldest line */
 	unsigned int sb_count;		/* number of lines in sb */
-	struct line *sb_first;		/* first line; was moved first */
-	struct line *sb_last;		/* last line; was moved last*/
 	unsigned int sb_max;		/* max-limit of lines in sb */
-	struct line *sb_pos;		/* current position in sb or NULL */
+	uint64_t sb_pos;		/* id of line at top of view or 0 */
 	uint64_t sb_last_id;		/* last id given to sb-line */
 
+	uint8_t *sb_data;		/* arena with the encoded lines */
+	size_t sb_data_sz;
+	size_t sb_data_head;		/* end of the newest line */
+
+	uint64_t *sb_attr_key;		/* interned attributes, packed */
+	size_t sb_attr_count;
+	size_t sb_attr_cap;
+	uint32_t *sb_attr_ht;		/* index + 1 into sb_attr, 0 if free */
+	size_t sb_attr_ht_sz;
+	uint64_t sb_attr_gc_next;	/* no collect until sb_last_id reaches it */
+
+	struct line sb_scratch;		/* decoded sb line for draw/copy */
+	unsigned int sb_scratch_cap;
+
 	/* cursor */
 	unsigned int cursor_x;
 	unsigned int cursor_y;
@@ -96,6 +96,41 @@ void tsm_screen_inc_age(struct tsm_screen *con)
 	}
 }
 
+/*
+ * Every write path marks the rows it touches so that tsm_screen_draw can skip
+ * the rest, operations that move or restyle everything age the screen as a
+ * whole and mark all rows.
+ */
+static inline void row_dirty(struct tsm_screen *con, unsigned int y)
+{
+	if (y < con->line_num)
+		con->dirty_rows[y >> 6] |= (uint64_t)1 << (y & 63);
+}
+
+static void rows_dirty(struct tsm_screen *con)
+{
+	if (con->dirty_rows)
+		memset(con->dirty_rows, 0xff,
+			((con->line_num + 63) >> 6) * sizeof(uint64_t));
+}
+
+static void screen_dirty(struct tsm_screen *con)
+{
+	inc_age(con);
+	con->age = con->age_cnt;
+	rows_dirty(con);
+}
+
+/* for cells that moved within or between lines, their own age is stale */
+static void lines_moved(struct tsm_screen *con,
+	unsigned int y_from, unsigned int y_to)
+{
+	for (; y_from <= y_to && y_from < con->size_y; y_from++) {
+		con->lines[y_from]->age = con->age_cnt;
+		row_dirty(con, y_from);
+	}
+}
+
 static struct cell *get_cursor_cell(struct tsm_screen *con)
 {
 	unsigned int cur_x, cur_y;
@@ -155,8 +190,6 @@ static int line_new(struct tsm_screen *con, struct line **out,
 	line = malloc(sizeof(*line));
 	if (!line)
 		return -ENOMEM;
-	line->next = NULL;
-	line->prev = NULL;
 	line->size = width;
 	line->age = con->age_cnt;
 
@@ -203,91 +236,588 @@ static int line_resize(struct tsm_screen *con, struct line *line,
 	return 0;
 }
 
-/* This links the given line into the scrollback-buffer */
-static void link_to_scrollback(struct tsm_screen *con, struct line *line)
+/*
+ * Scrollback storage:
+ * Lines that leave the screen are encoded into a byte arena that is used as
+ * a FIFO, with a ring of fixed-size records (struct sb_line) indexing it.
+ * Line ids are handed out incrementally, so the record for an id is found
+ * by its distance to the oldest id without walking anything.
+ *
+ * An encoded line is [n_cells symbols, u8 if all are below 0x100 or u32]
+ * [n_cells * u8 width if any cell is not single-width][n_runs * struct
+ * sb_run], padded to 8 bytes.
+ * Attributes are interned per screen and referenced by a 16-bit index from
+ * the runs, and blank trailing cells are dropped and restored on decode with
+ * the attribute of the last run. A run whose attribute couldn't be interned
+ * has SB_ATTR_ESCAPE as index and the full key in the two slots after it.
+ */
+#define SB_ATTR_ESCAPE 0xffff
+#define SB_ATTR_LIMIT SB_ATTR_ESCAPE
+#define SB_ATTR_GC_MIN (SB_ATTR_LIMIT / 8)
+_Static_assert(sizeof(struct sb_run) * 2 == sizeof(uint64_t), "sb_run size");
+#define SB_ALIGN(X) (((X) + 7) & ~(size_t)7)
+
+static uint64_t attr_key(const struct tui_screen_attr *attr)
+{
+	return
+		(uint64_t)attr->fr |
+		((uint64_t)attr->fg << 8) |
+		((uint64_t)attr->fb << 16) |
+		((uint64_t)attr->br << 24) |
+		((uint64_t)attr->bg << 32) |
+		((uint64_t)attr->bb << 40) |
+		((uint64_t)attr->bold << 48) |
+		((uint64_t)attr->underline << 49) |
+		((uint64_t)attr->italic << 50) |
+		((uint64_t)attr->inverse << 51) |
+		((uint64_t)attr->protect << 52) |
+		((uint64_t)attr->blink << 53) |
+		((uint64_t)attr->strikethrough << 54) |
+		((uint64_t)attr->shape_break << 55) |
+		((uint64_t)attr->custom_id << 56);
+}
+
+static struct tui_screen_attr attr_unkey(uint64_t key)
+{
+	return (struct tui_screen_attr){
+		.fr = key & 0xff,
+		.fg = (key >> 8) & 0xff,
+		.fb = (key >> 16) & 0xff,
+		.br = (key >> 24) & 0xff,
+		.bg = (key >> 32) & 0xff,
+		.bb = (key >> 40) & 0xff,
+		.bold = (key >> 48) & 1,
+		.underline = (key >> 49) & 1,
+		.italic = (key >> 50) & 1,
+		.inverse = (key >> 51) & 1,
+		.protect = (key >> 52) & 1,
+		.blink = (key >> 53) & 1,
+		.strikethrough = (key >> 54) & 1,
+		.shape_break = (key >> 55) & 1,
+		.custom_id = (key >> 56) & 0xff
+	};
+}
+
+/* same as tui_attr_equal, the attribute packs into 8 bytes with no padding */
+static inline bool attr_same(
+	const struct tui_screen_attr *a, const struct tui_screen_attr *b)
 {
-	struct line *tmp;
+	_Static_assert(sizeof(struct tui_screen_attr) == 8, "attr size");
+	uint64_t va, vb;
+	memcpy(&va, a, 8);
+	memcpy(&vb, b, 8);
+	return va == vb;
+}
 
-	con->age = con->age_cnt;
+static size_t attr_slot(uint64_t key, size_t ht_sz)
+{
+	return (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32) & (ht_sz - 1);
+}
 
-	if (con->sb_max == 0) {
-		if (con->sel_active) {
-			if (con->sel_start.line == line) {
-				con->sel_start.line = NULL;
-				con->sel_start.y = SELECTION_TOP;
-			}
-			if (con->sel_end.line == line) {
-				con->sel_end.line = NULL;
-				con->sel_end.y = SELECTION_TOP;
-			}
+static bool attr_rehash(struct tsm_screen *con, size_t ht_sz)
+{
+	uint32_t *ht = calloc(ht_sz, sizeof(uint32_t));
+	if (!ht)
+		return false;
+
+	for (size_t i = 0; i < con->sb_attr_count; i++) {
+		size_t slot = attr_slot(con->sb_attr_key[i], ht_sz);
+		while (ht[slot])
+			slot = (slot + 1) & (ht_sz - 1);
+		ht[slot] = i + 1;
+	}
+
+	free(con->sb_attr_ht);
+	con->sb_attr_ht = ht;
+	con->sb_attr_ht_sz = ht_sz;
+	return true;
+}
+
+/* grow the table so that [n] more keys can be interned without allocating */
+static bool attr_reserve(struct tsm_screen *con, size_t n)
+{
+	size_t want = con->sb_attr_count + n;
+	if (want > SB_ATTR_LIMIT)
+		want = SB_ATTR_LIMIT;
+
+	if (want > con->sb_attr_cap) {
+		size_t cap = con->sb_attr_cap ? con->sb_attr_cap : 64;
+		while (cap < want)
+			cap *= 2;
+		uint64_t *keys = realloc(con->sb_attr_key, cap * sizeof(uint64_t));
+		if (!keys)
+			return false;
+		con->sb_attr_key = keys;
+		con->sb_attr_cap = cap;
+	}
+
+	size_t ht_sz = con->sb_attr_ht_sz ? con->sb_attr_ht_sz : 128;
+	while ((want + 1) * 2 > ht_sz)
+		ht_sz *= 2;
+	if (ht_sz != con->sb_attr_ht_sz)
+		return attr_rehash(con, ht_sz);
+
+	return true;
+}
+
+/* returns the interned index of [key], SB_ATTR_ESCAPE if it can't be added */
+static uint16_t attr_intern(struct tsm_screen *con, uint64_t key)
+{
+	size_t slot;
+
+	if (con->sb_attr_ht_sz) {
+		slot = attr_slot(key, con->sb_attr_ht_sz);
+		while (con->sb_attr_ht[slot]) {
+			uint32_t ind = con->sb_attr_ht[slot] - 1;
+			if (con->sb_attr_key[ind] == key)
+				return ind;
+			slot = (slot + 1) & (con->sb_attr_ht_sz - 1);
 		}
-		line_free(line);
+	}
+
+	if (con->sb_attr_count == SB_ATTR_LIMIT)
+		return SB_ATTR_ESCAPE;
+
+	if (con->sb_attr_count == con->sb_attr_cap) {
+		size_t cap = con->sb_attr_cap ? con->sb_attr_cap * 2 : 64;
+		uint64_t *keys = realloc(con->sb_attr_key, cap * sizeof(uint64_t));
+		if (!keys)
+			return SB_ATTR_ESCAPE;
+		con->sb_attr_key = keys;
+		con->sb_attr_cap = cap;
+	}
+
+/* keep the load factor below 1/2 */
+	if ((con->sb_attr_count + 1) * 2 > con->sb_attr_ht_sz) {
+		if (!attr_rehash(con, con->sb_attr_ht_sz ? con->sb_attr_ht_sz * 2 : 128))
+			return SB_ATTR_ESCAPE;
+	}
+
+	slot = attr_slot(key, con->sb_attr_ht_sz);
+	while (con->sb_attr_ht[slot])
+		slot = (slot + 1) & (con->sb_attr_ht_sz - 1);
+
+	con->sb_attr_key[con->sb_attr_count] = key;
+	con->sb_attr_ht[slot] = ++con->sb_attr_count;
+	return con->sb_attr_count - 1;
+}
+
+static inline uint64_t sb_first_id(struct tsm_screen *con)
+{
+	return con->sb_last_id - con->sb_count + 1;
+}
+
+static inline struct sb_line *sb_get(struct tsm_screen *con, uint64_t id)
+{
+	return &con->sb_lines[
+		(con->sb_first + (id - sb_first_id(con))) % con->sb_cap];
+}
+
+static inline uint64_t sb_next(struct tsm_screen *con, uint64_t id)
+{
+	return id == con->sb_last_id ? 0 : id + 1;
+}
+
+static inline size_t sb_runs_ofs(unsigned n_cells, bool narrow, bool wide)
+{
+	return (n_cells * (narrow ? 1 : 4) + (wide ? n_cells : 0) + 3) & ~(size_t)3;
+}
+
+static inline struct sb_run *sb_runs(struct tsm_screen *con, struct sb_line *l)
+{
+	return (struct sb_run *)&con->sb_data[
+		l->ofs + sb_runs_ofs(l->n_cells, l->narrow, l->wide)];
+}
+
+/*
+ * Interned attributes that are no longer referenced by any line in the
+ * scrollback are only dropped when the table is about to run out of
+ * indices, at which point the live runs are remapped into a new table.
+ * If that didn't free up a fair share of the table, the live set is about as
+ * large as the table and collecting on every new line would rescan the whole
+ * scrollback each time, so hold off until it has been replaced and let new
+ * runs store their keys inline until then.
+ */
+static void attr_collect(struct tsm_screen *con)
+{
+	uint64_t *old = con->sb_attr_key;
+	size_t old_count = con->sb_attr_count;
+	size_t old_cap = con->sb_attr_cap;
+	uint32_t *old_ht = con->sb_attr_ht;
+	size_t old_ht_sz = con->sb_attr_ht_sz;
+
+/* size the new table for every live key up front so the remap can't fail
+ * halfway through, if that doesn't work out just keep the old one */
+	con->sb_attr_key = NULL;
+	con->sb_attr_count = con->sb_attr_cap = 0;
+	con->sb_attr_ht = NULL;
+	con->sb_attr_ht_sz = 0;
+
+	if (!attr_reserve(con, old_count)) {
+		free(con->sb_attr_key);
+		free(con->sb_attr_ht);
+		con->sb_attr_key = old;
+		con->sb_attr_count = old_count;
+		con->sb_attr_cap = old_cap;
+		con->sb_attr_ht = old_ht;
+		con->sb_attr_ht_sz = old_ht_sz;
+		con->sb_attr_gc_next = con->sb_last_id + con->sb_count;
 		return;
 	}
+	free(old_ht);
+
+	for (unsigned i = 0; i < con->sb_count; i++) {
+		struct sb_line *l = &con->sb_lines[(con->sb_first + i) % con->sb_cap];
+		struct sb_run *runs = sb_runs(con, l);
+		for (size_t j = 0; j < l->n_runs; j++) {
+			if (runs[j].attr == SB_ATTR_ESCAPE)
+				j += 2;
+			else
+				runs[j].attr = attr_intern(con, old[runs[j].attr]);
+		}
+	}
 
-	/* Remove a line from the scrollback buffer if it reaches its maximum.
-	 * We must take care to correctly keep the current position as the new
-	 * line is linked in after we remove the top-most line here.
-	 * sb_max == 0 is tested earlier so we can assume sb_max > 0 here. In
-	 * other words, buf->sb_first is a valid line if sb_count >= sb_max. */
-	if (con->sb_count >= con->sb_max) {
-		tmp = con->sb_first;
-		con->sb_first = tmp->next;
-		if (tmp->next)
-			tmp->next->prev = NULL;
-		else
-			con->sb_last = NULL;
-		--con->sb_count;
-
-		/* (position == tmp && !next) means we have sb_max=1 so set
-		 * position to the new line. Otherwise, set to new first line.
-		 * If position!=tmp and we have a fixed-position then nothing
-		 * needs to be done because we can stay at the same line. If we
-		 * have no fixed-position, we need to set the position to the
-		 * next inserted line, which can be "line", too. */
-		if (con->sb_pos) {
-			if (con->sb_pos == tmp ||
-			    !(con->flags & TSM_SCREEN_FIXED_POS)) {
-				if (con->sb_pos->next)
-					con->sb_pos = con->sb_pos->next;
-				else
-					con->sb_pos = line;
+	con->sb_attr_gc_next =
+		con->sb_attr_count + SB_ATTR_GC_MIN <= old_count ?
+		0 : con->sb_last_id + con->sb_count;
+
+	free(old);
+}
+
+static void sb_free(struct tsm_screen *con)
+{
+	free(con->sb_lines);
+	free(con->sb_data);
+	free(con->sb_attr_key);
+	free(con->sb_attr_ht);
+	free(con->sb_scratch.cells);
+
+	con->sb_lines = NULL;
+	con->sb_cap = con->sb_first = con->sb_count = 0;
+	con->sb_data = NULL;
+	con->sb_data_sz = con->sb_data_head = 0;
+	con->sb_attr_key = NULL;
+	con->sb_attr_count = con->sb_attr_cap = 0;
+	con->sb_attr_ht = NULL;
+	con->sb_attr_ht_sz = 0;
+	con->sb_attr_gc_next = 0;
+	con->sb_scratch = (struct line){0};
+	con->sb_scratch_cap = 0;
+}
+
+/* drop the oldest line, caller takes care of sb_pos and selection */
+static uint64_t sb_evict(struct tsm_screen *con)
+{
+	uint64_t id = sb_first_id(con);
+
+	con->sb_first = (con->sb_first + 1) % con->sb_cap;
+	if (!--con->sb_count)
+		con->sb_data_head = 0;
+
+	if (con->sel_active) {
+		if (con->sel_start.line == id) {
+			con->sel_start.line = 0;
+			con->sel_start.y = SELECTION_TOP;
+		}
+		if (con->sel_end.line == id) {
+			con->sel_end.line = 0;
+			con->sel_end.y = SELECTION_TOP;
+		}
+	}
+
+	return id;
+}
+
+/* grow the arena so that [len] more bytes fit, packing live lines in order */
+static bool sb_data_grow(struct tsm_screen *con, size_t len)
+{
+	size_t used = 0, sz;
+	uint8_t *buf;
+
+	for (unsigned i = 0; i < con->sb_count; i++)
+		used += con->sb_lines[(con->sb_first + i) % con->sb_cap].len;
+
+	sz = con->sb_data_sz ? con->sb_data_sz : 65536;
+	while (sz < 2 * (used + len))
+		sz *= 2;
+
+	buf = malloc(sz);
+	if (!buf)
+		return false;
+
+	used = 0;
+	for (unsigned i = 0; i < con->sb_count; i++) {
+		struct sb_line *l = &con->sb_lines[(con->sb_first + i) % con->sb_cap];
+		memcpy(&buf[used], &con->sb_data[l->ofs], l->len);
+		l->ofs = used;
+		used += l->len;
+	}
+
+	free(con->sb_data);
+	con->sb_data = buf;
+	con->sb_data_sz = sz;
+	con->sb_data_head = used;
+	return true;
+}
+
+/* reserve [len] bytes after the newest line and return its offset in [ofs] */
+static bool sb_data_alloc(struct tsm_screen *con, size_t len, size_t *ofs)
+{
+	size_t head = con->sb_data_head;
+
+	if (con->sb_count) {
+		size_t tail = con->sb_lines[con->sb_first].ofs;
+
+/* live data is [tail, head) or wrapped around as [tail, sz) + [0, head) */
+		if (head > tail) {
+			if (con->sb_data_sz - head >= len)
+				goto out;
+			if (tail >= len) {
+				head = 0;
+				goto out;
 			}
 		}
+		else if (tail - head >= len)
+			goto out;
+	}
+	else {
+		head = 0;
+		if (con->sb_data_sz >= len)
+			goto out;
+	}
 
-		if (con->sel_active) {
-			if (con->sel_start.line == tmp) {
-				con->sel_start.line = NULL;
-				con->sel_start.y = SELECTION_TOP;
+	if (!sb_data_grow(con, len))
+		return false;
+	head = con->sb_data_head;
+
+out:
+	con->sb_data_head = head + len;
+	*ofs = head;
+	return true;
+}
+
+static bool sb_reserve_line(struct tsm_screen *con)
+{
+	unsigned cap;
+	struct sb_line *lines;
+
+	if (con->sb_count < con->sb_cap)
+		return true;
+
+	cap = con->sb_cap ? con->sb_cap * 2 : 256;
+	if (cap > con->sb_max)
+		cap = con->sb_max;
+
+	lines = malloc(sizeof(struct sb_line) * cap);
+	if (!lines)
+		return false;
+
+	for (unsigned i = 0; i < con->sb_count; i++)
+		lines[i] = con->sb_lines[(con->sb_first + i) % con->sb_cap];
+
+	free(con->sb_lines);
+	con->sb_lines = lines;
+	con->sb_cap = cap;
+	con->sb_first = 0;
+	return true;
+}
+
+static bool sb_encode(struct tsm_screen *con, struct line *line)
+{
+	unsigned size = line->size < con->size_x ? line->size : con->size_x;
+	if (size > UINT16_MAX)
+		size = UINT16_MAX;
+	unsigned n_cells = size, n_runs = 0, max_runs;
+	struct cell *cells = line->cells;
+	tsm_age_t age = line->age;
+	uint32_t ch_mask = 0;
+	bool wide = false, narrow;
+
+/* trailing blanks that share an attribute are restored from the last run */
+	while (n_cells && !cells[n_cells - 1].ch &&
+		cells[n_cells - 1].width == 1 &&
+		attr_same(&cells[n_cells - 1].attr, &cells[size - 1].attr))
+		n_cells--;
+
+	if (!sb_reserve_line(con))
+		return false;
+
+/* make sure the whole line can be interned without remapping midway, and
+ * if the table still can't take it all the rest get escaped runs that
+ * carry the key inline */
+	if (con->sb_attr_count + n_cells + 1 > SB_ATTR_LIMIT &&
+		con->sb_last_id >= con->sb_attr_gc_next)
+		attr_collect(con);
+
+	if (!attr_reserve(con, n_cells + 1))
+		return false;
+
+	max_runs = n_cells + 1;
+	if (con->sb_attr_count + max_runs > SB_ATTR_LIMIT)
+		max_runs *= 3;
+
+/* reserve for the worst case and hand the rest back when the line is done,
+ * it is the newest allocation so that is just moving the head back */
+	size_t ofs, len;
+	size_t runs_ofs = sb_runs_ofs(n_cells, false, true);
+	if (!sb_data_alloc(con,
+		SB_ALIGN(runs_ofs + max_runs * sizeof(struct sb_run)), &ofs))
+		return false;
+
+	uint32_t *chs = (uint32_t *)&con->sb_data[ofs];
+	uint8_t *widths = (uint8_t *)&chs[n_cells];
+	struct sb_run *runs = (struct sb_run *)&con->sb_data[ofs + runs_ofs];
+
+	for (unsigned i = 0; i < size; i++) {
+		if (!i || !attr_same(&cells[i].attr, &cells[i-1].attr)) {
+			uint64_t key = attr_key(&cells[i].attr);
+			runs[n_runs].start = i;
+			runs[n_runs].attr = attr_intern(con, key);
+			if (runs[n_runs++].attr == SB_ATTR_ESCAPE) {
+				memcpy(&runs[n_runs], &key, sizeof(key));
+				n_runs += 2;
 			}
-			if (con->sel_end.line == tmp) {
-				con->sel_end.line = NULL;
-				con->sel_end.y = SELECTION_TOP;
+		}
+		if (i >= n_cells)
+			break;
+		chs[i] = cells[i].ch;
+		ch_mask |= cells[i].ch;
+		widths[i] = cells[i].width;
+		wide |= cells[i].width != 1;
+		if (cells[i].age > age)
+			age = cells[i].age;
+	}
+
+/* pack the sections down to what the line actually needs */
+	narrow = ch_mask < 0x100;
+	if (narrow) {
+		for (unsigned i = 0; i < n_cells; i++)
+			con->sb_data[ofs + i] = chs[i];
+		if (wide)
+			memmove(&con->sb_data[ofs + n_cells], widths, n_cells);
+	}
+
+	if (runs_ofs != sb_runs_ofs(n_cells, narrow, wide)) {
+		runs_ofs = sb_runs_ofs(n_cells, narrow, wide);
+		memmove(&con->sb_data[ofs + runs_ofs],
+			runs, n_runs * sizeof(struct sb_run));
+	}
+	len = SB_ALIGN(runs_ofs + n_runs * sizeof(struct sb_run));
+	con->sb_data_head = ofs + len;
+
+	con->sb_lines[(con->sb_first + con->sb_count) % con->sb_cap] =
+	(struct sb_line){
+		.ofs = ofs,
+		.len = len,
+		.size = size,
+		.n_cells = n_cells,
+		.n_runs = n_runs,
+		.narrow = narrow,
+		.wide = wide,
+		.age = age
+	};
+	con->sb_count++;
+	con->sb_last_id++;
+	return true;
+}
+
+/* expand a scrollback line into the shared scratch line and return it */
+static struct line *sb_decode(struct tsm_screen *con, uint64_t id)
+{
+	struct sb_line *l = sb_get(con, id);
+	struct line *out = &con->sb_scratch;
+	struct sb_run *runs = sb_runs(con, l);
+	uint8_t *chs = &con->sb_data[l->ofs];
+	uint8_t *widths = &chs[l->n_cells * (l->narrow ? 1 : 4)];
+
+	if (l->size > con->sb_scratch_cap) {
+		struct cell *cells = realloc(out->cells, sizeof(struct cell) * l->size);
+		if (cells) {
+			out->cells = cells;
+			con->sb_scratch_cap = l->size;
+		}
+	}
+	out->size = l->size < con->sb_scratch_cap ? l->size : con->sb_scratch_cap;
+	out->age = l->age;
+
+	for (size_t run = 0, next; run < l->n_runs; run = next) {
+		uint64_t key;
+		next = run + 1;
+		if (runs[run].attr == SB_ATTR_ESCAPE) {
+			memcpy(&key, &runs[next], sizeof(key));
+			next += 2;
+		}
+		else
+			key = con->sb_attr_key[runs[run].attr];
+
+		struct tui_screen_attr attr = attr_unkey(key);
+		size_t end = next < l->n_runs ? runs[next].start : l->size;
+		if (end > out->size)
+			end = out->size;
+
+		for (size_t i = runs[run].start; i < end; i++) {
+			struct cell *cell = &out->cells[i];
+			cell->attr = attr;
+			cell->age = l->age;
+			if (i < l->n_cells) {
+				cell->ch = l->narrow ? chs[i] : ((uint32_t *)chs)[i];
+				cell->width = l->wide ? widths[i] : 1;
+			}
+			else {
+				cell->ch = 0;
+				cell->width = 1;
 			}
 		}
-		line_free(tmp);
 	}
 
-	line->sb_id = ++con->sb_last_id;
-	line->next = NULL;
-	line->prev = con->sb_last;
-	if (con->sb_last)
-		con->sb_last->next = line;
-	else
-		con->sb_first = line;
-	con->sb_last = line;
-	++con->sb_count;
+	return out;
+}
+
+/* This moves the given line into the scrollback-buffer */
+static void link_to_scrollback(struct tsm_screen *con, struct line *line)
+{
+	screen_dirty(con);
+
+	if (con->sb_max == 0)
+		return;
+
+	/* Remove a line from the scrollback buffer if it reaches its maximum.
+	 * We must take care to correctly keep the current position as the new
+	 * line is linked in after we remove the top-most line here. */
+	if (con->sb_count >= con->sb_max) {
+		uint64_t id = sb_evict(con);
+
+		/* If position!=evicted and we have a fixed-position then nothing
+		 * needs to be done because we can stay at the same line. Otherwise
+		 * step to the next line, which can be the one inserted here. */
+		if (con->sb_pos) {
+			if (con->sb_pos == id ||
+			    !(con->flags & TSM_SCREEN_FIXED_POS))
+				con->sb_pos++;
+		}
+	}
+
+	if (!sb_encode(con, line) && con->sb_pos > con->sb_last_id)
+		con->sb_pos = 0;
+}
+
+/* id of the scrollback line [-y] lines above the screen, 0 if none */
+static uint64_t sb_line_above(struct tsm_screen *con, int y)
+{
+	if ((uint64_t)-y > con->sb_count)
+		return 0;
+
+	return con->sb_last_id + 1 + y;
 }
 
 static int screen_scroll_up(struct tsm_screen *con, unsigned int num)
 {
 	unsigned int i, j, max, pos;
-	int ret;
 
 	if (!num)
 		return 0;
 
-	con->age = con->age_cnt;
+	screen_dirty(con);
 
 	max = con->margin_bottom + 1 - con->margin_top;
 	if (num > max)
@@ -305,20 +835,17 @@ static int screen_scroll_up(struct tsm_screen *con, unsigned int num)
 	}
 	struct line *cache[num];
 
+	/* The scrollback keeps an encoded copy, so the line itself is
+	 * cleared and reused at the bottom of the scroll region. */
 	for (i = 0; i < num; ++i) {
 		pos = con->margin_top + i;
+		cache[i] = con->lines[pos];
 		if (!(con->flags & TSM_SCREEN_ALTERNATE))
-			ret = line_new(con, &cache[i], con->size_x);
-		else
-			ret = -EAGAIN;
+			link_to_scrollback(con, cache[i]);
 
-		if (!ret) {
-			link_to_scrollback(con, con->lines[pos]);
-		} else {
-			cache[i] = con->lines[pos];
-			for (j = 0; j < con->size_x; ++j)
-				cell_init(con, &cache[i]->cells[j]);
-		}
+		for (j = 0; j < cache[i]->size; ++j)
+			cell_init(con, &cache[i]->cells[j]);
+		cache[i]->age = con->age_cnt;
 	}
 
 	if (num < max) {
@@ -334,18 +861,14 @@ static int screen_scroll_up(struct tsm_screen *con, unsigned int num)
 		if (!con->sel_start.line && con->sel_start.y >= 0) {
 			con->sel_start.y -= num;
 			if (con->sel_start.y < 0) {
-				con->sel_start.line = con->sb_last;
-				while (con->sel_start.line && ++con->sel_start.y < 0)
-					con->sel_start.line = con->sel_start.line->prev;
+				con->sel_start.line = sb_line_above(con, con->sel_start.y);
 				con->sel_start.y = SELECTION_TOP;
 			}
 		}
 		if (!con->sel_end.line && con->sel_end.y >= 0) {
 			con->sel_end.y -= num;
 			if (con->sel_end.y < 0) {
-				con->sel_end.line = con->sb_last;
-				while (con->sel_end.line && ++con->sel_end.y < 0)
-					con->sel_end.line = con->sel_end.line->prev;
+				con->sel_end.line = sb_line_above(con, con->sel_end.y);
 				con->sel_end.y = SELECTION_TOP;
 			}
 		}
@@ -360,7 +883,7 @@ static int screen_scroll_down(struct tsm_screen *con, unsigned int num)
 	if (!num)
 		return 0;
 
-	con->age = con->age_cnt;
+	screen_dirty(con);
 
 	max = con->margin_bottom + 1 - con->margin_top;
 	if (num > max)
@@ -413,6 +936,7 @@ static void screen_write(struct tsm_screen *con, unsigned int x,
 	}
 
 	line = con->lines[y];
+	row_dirty(con, y);
 
 	if ((con->flags & TSM_SCREEN_INSERT_MODE) &&
 	    (int)x < ((int)con->size_x - len)) {
@@ -442,8 +966,6 @@ void tsm_screen_erase_region(struct tsm_screen *con,
 	unsigned int to;
 	struct line *line;
 
-	con->age = con->age_cnt;
-
 	if (y_to >= con->size_y)
 		y_to = con->size_y - 1;
 	if (x_to >= con->size_x)
@@ -460,6 +982,8 @@ void tsm_screen_erase_region(struct tsm_screen *con,
 			to = x_to;
 		else
 			to = con->size_x - 1;
+
+		row_dirty(con, y_from);
 		for ( ; x_from <= to; ++x_from) {
 			if (protect && line->cells[x_from].attr.protect)
 				continue;
@@ -525,6 +1049,7 @@ err_free:
 	free(con->main_lines);
 	free(con->alt_lines);
 	free(con->tab_ruler);
+	free(con->dirty_rows);
 	tsm_symbol_table_unref(con->sym_table);
 	free(con);
 	return ret;
@@ -555,6 +1080,8 @@ void tsm_screen_unref(struct tsm_screen *con)
 	free(con->main_lines);
 	free(con->alt_lines);
 	free(con->tab_ruler);
+	free(con->dirty_rows);
+	sb_free(con);
 	tsm_symbol_table_unref(con->sym_table);
 	free(con);
 }
@@ -620,6 +1147,12 @@ int tsm_screen_resize(
 			con->lines = cache;
 		con->alt_lines = cache;
 
+		uint64_t *rows = realloc(con->dirty_rows,
+			((y + 63) >> 6) * sizeof(uint64_t));
+		if (!rows)
+			return -ENOMEM;
+		con->dirty_rows = rows;
+
 		/* allocate new lines */
 		if (x > con->size_x)
 			width = x;
@@ -722,6 +1255,7 @@ int tsm_screen_resize(
 	if (con->cursor_y >= con->size_y)
 		move_cursor(con, con->cursor_x, con->size_y - 1);
 
+	rows_dirty(con);
 	return 0;
 }
 
@@ -773,19 +1307,11 @@ int tsm_screen_get_word(struct tsm_screen *con,
 	if (!ascii_test(con, wl->cells[*sx].ch))
 		return -EINVAL;
 
-/* scan left */
+/* scan left, words don't wrap across lines */
 	for(;;){
 		int tx = *sx;
-/* wrap around back */
-		if (tx == 0){
-			wl = wl->prev;
-			if (!wl || !ascii_test(con, wl->cells[wl->size-1].ch))
-				break;
-
-			*sy--;
-			*sx = wl->size - 1;
-			continue;
-		}
+		if (tx == 0)
+			break;
 		else{
 			tx = tx - 1;
 			if (!ascii_test(con, wl->cells[tx].ch))
@@ -794,18 +1320,11 @@ int tsm_screen_get_word(struct tsm_screen *con,
 		}
 	}
 
-	wl = cur;
 /* scan right */
 	for(;;){
 		int tx = *ex;
-		if (tx == wl->size-1){
-			wl = wl->next;
-			if (!wl || !ascii_test(con, wl->cells[0].ch))
-				break;
-
-			*ey++;
-			*ex = 0;
-		}
+		if (tx == wl->size-1)
+			break;
 		else{
 			tx = tx+1;
 			if (!ascii_test(con, wl->cells[tx].ch))
@@ -852,41 +1371,24 @@ SHL_EXPORT
 void tsm_screen_set_max_sb(struct tsm_screen *con,
 			       unsigned int max)
 {
-	struct line *line;
-
 	if (!con)
 		return;
 
 	inc_age(con);
-	con->age = con->age_cnt;
+	screen_dirty(con);
 
 	while (con->sb_count > max) {
-		line = con->sb_first;
-		con->sb_first = line->next;
-		if (line->next)
-			line->next->prev = NULL;
-		else
-			con->sb_last = NULL;
-		con->sb_count--;
+		uint64_t id = sb_evict(con);
 
 		/* We treat fixed/unfixed position the same here because we
 		 * remove lines from the TOP of the scrollback buffer. */
-		if (con->sb_pos == line)
-			con->sb_pos = con->sb_first;
-
-		if (con->sel_active) {
-			if (con->sel_start.line == line) {
-				con->sel_start.line = NULL;
-				con->sel_start.y = SELECTION_TOP;
-			}
-			if (con->sel_end.line == line) {
-				con->sel_end.line = NULL;
-				con->sel_end.y = SELECTION_TOP;
-			}
-		}
-		line_free(line);
+		if (con->sb_pos == id)
+			con->sb_pos = con->sb_count ? id + 1 : 0;
 	}
 
+	if (!max)
+		sb_free(con);
+
 	con->sb_max = max;
 }
 
@@ -894,37 +1396,59 @@ void tsm_screen_set_max_sb(struct tsm_screen *con,
 SHL_EXPORT
 void tsm_screen_clear_sb(struct tsm_screen *con)
 {
-	struct line *iter, *tmp;
-
 	if (!con)
 		return;
 
 	inc_age(con);
-	con->age = con->age_cnt;
-
-	for (iter = con->sb_first; iter; ) {
-		tmp = iter;
-		iter = iter->next;
-		line_free(tmp);
-	}
+	screen_dirty(con);
 
-	con->sb_first = NULL;
-	con->sb_last = NULL;
-	con->sb_count = 0;
-	con->sb_pos = NULL;
+	sb_free(con);
+	con->sb_pos = 0;
 
 	if (con->sel_active) {
 		if (con->sel_start.line) {
-			con->sel_start.line = NULL;
+			con->sel_start.line = 0;
 			con->sel_start.y = SELECTION_TOP;
 		}
 		if (con->sel_end.line) {
-			con->sel_end.line = NULL;
+			con->sel_end.line = 0;
 			con->sel_end.y = SELECTION_TOP;
 		}
 	}
 }
 
+SHL_EXPORT
+size_t tsm_screen_memory(struct tsm_screen *con,
+				size_t *sb, unsigned int *sb_lines)
+{
+	size_t screen = 0, hist = 0;
+	unsigned int i;
+
+	if (!con)
+		return 0;
+
+	screen = sizeof(*con) + con->line_num * 2 * sizeof(struct line *) +
+		con->size_x * sizeof(*con->tab_ruler);
+
+	for (i = 0; i < con->line_num; ++i) {
+		screen += 2 * sizeof(struct line);
+		screen += con->main_lines[i]->size * sizeof(struct cell);
+		screen += con->alt_lines[i]->size * sizeof(struct cell);
+	}
+
+	hist = con->sb_cap * sizeof(struct sb_line) + con->sb_data_sz +
+		con->sb_attr_cap * sizeof(uint64_t) +
+		con->sb_attr_ht_sz * sizeof(uint32_t) +
+		con->sb_scratch_cap * sizeof(struct cell);
+
+	if (sb)
+		*sb = hist;
+	if (sb_lines)
+		*sb_lines = con->sb_count;
+
+	return screen + hist;
+}
+
 SHL_EXPORT
 int tsm_screen_sb_up(struct tsm_screen *con, unsigned int num)
 {
@@ -933,18 +1457,18 @@ int tsm_screen_sb_up(struct tsm_screen *con, unsigned int num)
 
 	unsigned num2 = num;
 	inc_age(con);
-	con->age = con->age_cnt;
+	screen_dirty(con);
 
 	while (num2--) {
 		if (con->sb_pos) {
-			if (!con->sb_pos->prev)
+			if (con->sb_pos == sb_first_id(con))
 				return 0;
 
-			con->sb_pos = con->sb_pos->prev;
-		} else if (!con->sb_last) {
+			con->sb_pos--;
+		} else if (!con->sb_count) {
 			return -(num - num2);
 		} else {
-			con->sb_pos = con->sb_last;
+			con->sb_pos = con->sb_last_id;
 		}
 	}
 	return -num;
@@ -958,11 +1482,11 @@ int tsm_screen_sb_down(struct tsm_screen *con, unsigned int num)
 
 	unsigned num2 = num;
 	inc_age(con);
-	con->age = con->age_cnt;
+	screen_dirty(con);
 
 	while (num2--) {
 		if (con->sb_pos)
-			con->sb_pos = con->sb_pos->next;
+			con->sb_pos = sb_next(con, con->sb_pos);
 		else
 			return (num - num2);
 	}
@@ -996,9 +1520,9 @@ void tsm_screen_sb_reset(struct tsm_screen *con)
 		return;
 
 	inc_age(con);
-	con->age = con->age_cnt;
+	screen_dirty(con);
 
-	con->sb_pos = NULL;
+	con->sb_pos = 0;
 }
 
 SHL_EXPORT
@@ -1026,7 +1550,7 @@ void tsm_screen_reset(struct tsm_screen *con)
 		return;
 
 	inc_age(con);
-	con->age = con->age_cnt;
+	screen_dirty(con);
 
 	con->flags = 0;
 	con->margin_top = 0;
@@ -1056,12 +1580,12 @@ void tsm_screen_set_flags(struct tsm_screen *con, unsigned int flags)
 	con->flags |= flags;
 
 	if (!(old & TSM_SCREEN_ALTERNATE) && (flags & TSM_SCREEN_ALTERNATE)) {
-		con->age = con->age_cnt;
+		screen_dirty(con);
 		con->lines = con->alt_lines;
 	}
 
 	if (!(old & TSM_SCREEN_INVERSE) && (flags & TSM_SCREEN_INVERSE))
-		con->age = con->age_cnt;
+		screen_dirty(con);
 }
 
 SHL_EXPORT
@@ -1079,12 +1603,12 @@ void tsm_screen_reset_flags(struct tsm_screen *con, unsigned int flags)
 	con->flags &= ~flags;
 
 	if ((old & TSM_SCREEN_ALTERNATE) && (flags & TSM_SCREEN_ALTERNATE)) {
-		con->age = con->age_cnt;
+		screen_dirty(con);
 		con->lines = con->main_lines;
 	}
 
 	if ((old & TSM_SCREEN_INVERSE) && (flags & TSM_SCREEN_INVERSE))
-		con->age = con->age_cnt;
+		screen_dirty(con);
 }
 
 SHL_EXPORT
@@ -1186,6 +1710,80 @@ int tsm_screen_write(struct tsm_screen *con, tsm_symbol_t ch,
 	return rv;
 }
 
+/*
+ * Bulk version of tsm_screen_write for runs of symbols sharing the same
+ * attribute (e.g. a printable stretch between two control sequences from
+ * the vte). The autowrap/scroll/insert rules are the same as for the single
+ * symbol version, but the age is only bumped once per run and the cell update
+ * for the common case (width-1 symbol inside the row, no insert mode) is done
+ * inline rather than through screen_write.
+ */
+SHL_EXPORT
+int tsm_screen_write_run(struct tsm_screen *con, const tsm_symbol_t *ch,
+	size_t n, const struct tui_screen_attr *attr)
+{
+	unsigned int last, len;
+	int rv = 0;
+
+	if (!con || !ch || !n)
+		return 0;
+
+	if (!attr)
+		attr = &con->def_attr;
+
+	inc_age(con);
+
+	for (size_t i = 0; i < n; i++){
+		tsm_symbol_t sym = ch[i];
+
+/* printable ASCII is always width 1, skip the table lookup for those */
+		if (sym >= 0x20 && sym < 0x7f)
+			len = 1;
+		else {
+			len = tsm_symbol_get_width(con->sym_table, sym);
+			if (!len)
+				continue;
+		}
+
+		if (con->cursor_y <= con->margin_bottom ||
+			con->cursor_y >= con->size_y)
+			last = con->margin_bottom;
+		else
+			last = con->size_y - 1;
+
+		if (con->cursor_x >= con->size_x) {
+			if (con->flags & TSM_SCREEN_AUTO_WRAP)
+				move_cursor(con, 0, con->cursor_y + 1);
+			else
+				move_cursor(con, con->size_x - 1, con->cursor_y);
+		}
+
+/* same behavior as the single- write, the symbol that triggers the scroll is
+ * consumed by it */
+		if (con->cursor_y > last) {
+			move_cursor(con, con->cursor_x, last);
+			rv += screen_scroll_up(con, 1);
+			continue;
+		}
+
+		if (len == 1 && !(con->flags & TSM_SCREEN_INSERT_MODE) &&
+			con->cursor_y < con->size_y){
+			struct cell* cell = &con->lines[con->cursor_y]->cells[con->cursor_x];
+			row_dirty(con, con->cursor_y);
+			cell->age = con->age_cnt;
+			cell->ch = sym;
+			cell->width = 1;
+			cell->attr = *attr;
+		}
+		else
+			screen_write(con, con->cursor_x, con->cursor_y, sym, len, attr);
+
+		con->cursor_x += len;
+	}
+
+	return rv;
+}
+
 struct export_metadata {
 	uint8_t magic[4];
 	uint32_t sb_count;
@@ -1579,7 +2177,6 @@ void tsm_screen_insert_lines(struct tsm_screen *con, unsigned int num)
 		return;
 
 	inc_age(con);
-	con->age = con->age_cnt;
 
 	max = con->margin_bottom - con->cursor_y + 1;
 	if (num > max)
@@ -1602,6 +2199,7 @@ void tsm_screen_insert_lines(struct tsm_screen *con, unsigned int num)
 		       cache, num * sizeof(struct line*));
 	}
 
+	lines_moved(con, con->cursor_y, con->margin_bottom);
 	con->cursor_x = 0;
 }
 
@@ -1618,7 +2216,6 @@ void tsm_screen_delete_lines(struct tsm_screen *con, unsigned int num)
 		return;
 
 	inc_age(con);
-	con->age = con->age_cnt;
 
 	max = con->margin_bottom - con->cursor_y + 1;
 	if (num > max)
@@ -1641,6 +2238,7 @@ void tsm_screen_delete_lines(struct tsm_screen *con, unsigned int num)
 		       cache, num * sizeof(struct line*));
 	}
 
+	lines_moved(con, con->cursor_y, con->margin_bottom);
 	con->cursor_x = 0;
 }
 
@@ -1654,13 +2252,14 @@ void tsm_screen_insert_chars(struct tsm_screen *con, unsigned int num)
 		return;
 
 	inc_age(con);
-	con->age = con->age_cnt;
 
 	if (con->cursor_x >= con->size_x)
 		con->cursor_x = con->size_x - 1;
 	if (con->cursor_y >= con->size_y)
 		con->cursor_y = con->size_y - 1;
 
+	lines_moved(con, con->cursor_y, con->cursor_y);
+
 	max = con->size_x - con->cursor_x;
 	if (num > max)
 		num = max;
@@ -1686,13 +2285,14 @@ void tsm_screen_delete_chars(struct tsm_screen *con, unsigned int num)
 		return;
 
 	inc_age(con);
-	con->age = con->age_cnt;
 
 	if (con->cursor_x >= con->size_x)
 		con->cursor_x = con->size_x - 1;
 	if (con->cursor_y >= con->size_y)
 		con->cursor_y = con->size_y - 1;
 
+	lines_moved(con, con->cursor_y, con->cursor_y);
+
 	max = con->size_x - con->cursor_x;
 	if (num > max)
 		num = max;
@@ -1828,6 +2428,8 @@ void tsm_screen_erase_screen(struct tsm_screen *con, bool protect)
 	if (!con)
 		return;
 
+	inc_age(con);
+
 	tsm_screen_erase_region(con,
 		0, 0, con->size_x - 1, con->size_y - 1, protect);
 }
@@ -1862,18 +2464,14 @@ void tsm_screen_erase_screen(struct tsm_screen *con, bool protect)
 static void selection_set(struct tsm_screen *con, struct selection_pos *sel,
 			  unsigned int x, unsigned int y)
 {
-	struct line *pos;
-
-	sel->line = NULL;
-	pos = con->sb_pos;
+	uint64_t pos = con->sb_pos;
 
 	while (y && pos) {
 		--y;
-		pos = pos->next;
+		pos = sb_next(con, pos);
 	}
 
-	if (pos)
-		sel->line = pos;
+	sel->line = pos;
 
 	sel->x = x;
 	sel->y = y;
@@ -1886,7 +2484,7 @@ void tsm_screen_selection_reset(struct tsm_screen *con)
 		return;
 
 	inc_age(con);
-	con->age = con->age_cnt;
+	screen_dirty(con);
 
 	con->sel_active = false;
 }
@@ -1900,7 +2498,7 @@ void tsm_screen_selection_start(struct tsm_screen *con,
 		return;
 
 	inc_age(con);
-	con->age = con->age_cnt;
+	screen_dirty(con);
 
 	con->sel_active = true;
 	selection_set(con, &con->sel_start, posx, posy);
@@ -1916,7 +2514,7 @@ void tsm_screen_selection_target(struct tsm_screen *con,
 		return;
 
 	inc_age(con);
-	con->age = con->age_cnt;
+	screen_dirty(con);
 
 	selection_set(con, &con->sel_end, posx, posy);
 }
@@ -1958,7 +2556,8 @@ int tsm_screen_selection_copy(struct tsm_screen *con, char **out, bool conv)
 {
 	unsigned int len, i;
 	struct selection_pos *start, *end;
-	struct line *iter;
+	struct line *line;
+	uint64_t iter;
 	char *str, *pos;
 
 	if (!con || !out)
@@ -1982,10 +2581,10 @@ int tsm_screen_selection_copy(struct tsm_screen *con, char **out, bool conv)
 		start = &con->sel_end;
 		end = &con->sel_start;
 	} else if (con->sel_start.line && con->sel_end.line) {
-		if (con->sel_start.line->sb_id < con->sel_end.line->sb_id) {
+		if (con->sel_start.line < con->sel_end.line) {
 			start = &con->sel_start;
 			end = &con->sel_end;
-		} else if (con->sel_start.line->sb_id > con->sel_end.line->sb_id) {
+		} else if (con->sel_start.line > con->sel_end.line) {
 			start = &con->sel_end;
 			end = &con->sel_start;
 		} else if (con->sel_start.x < con->sel_end.x) {
@@ -2018,33 +2617,34 @@ int tsm_screen_selection_copy(struct tsm_screen *con, char **out, bool conv)
 	/* calculate size of buffer */
 	len = 0;
 	iter = start->line;
-	if (!iter && start->y == SELECTION_TOP)
-		iter = con->sb_first;
+	if (!iter && start->y == SELECTION_TOP && con->sb_count)
+		iter = sb_first_id(con);
 
 	while (iter) {
+		unsigned int size = sb_get(con, iter)->size;
 		if (iter == start->line && iter == end->line) {
-			if (iter->size > start->x) {
-				if (iter->size > end->x)
+			if (size > start->x) {
+				if (size > end->x)
 					len += end->x - start->x + 1;
 				else
-					len += iter->size - start->x;
+					len += size - start->x;
 			}
 			break;
 		} else if (iter == start->line) {
-			if (iter->size > start->x)
-				len += iter->size - start->x;
+			if (size > start->x)
+				len += size - start->x;
 		} else if (iter == end->line) {
-			if (iter->size > end->x)
+			if (size > end->x)
 				len += end->x + 1;
 			else
-				len += iter->size;
+				len += size;
 			break;
 		} else {
-			len += iter->size;
+			len += size;
 		}
 
 		++len;
-		iter = iter->next;
+		iter = sb_next(con, iter);
 	}
 
 	if (!end->line) {
@@ -2088,32 +2688,33 @@ int tsm_screen_selection_copy(struct tsm_screen *con, char **out, bool conv)
 
 	/* copy data into buffer */
 	iter = start->line;
-	if (!iter && start->y == SELECTION_TOP)
-		iter = con->sb_first;
+	if (!iter && start->y == SELECTION_TOP && con->sb_count)
+		iter = sb_first_id(con);
 
 	while (iter) {
+		line = sb_decode(con, iter);
 		if (iter == start->line && iter == end->line) {
-			if (iter->size > start->x) {
-				if (iter->size > end->x)
+			if (line->size > start->x) {
+				if (line->size > end->x)
 					len = end->x - start->x + 1;
 				else
-					len = iter->size - start->x;
-				pos += copy_line(iter, pos, start->x, len, conv);
+					len = line->size - start->x;
+				pos += copy_line(line, pos, start->x, len, conv);
 			}
 			break;
 		} else if (iter == start->line) {
-			if (iter->size > start->x)
-				pos += copy_line(iter, pos, start->x,
-						 iter->size - start->x, conv);
+			if (line->size > start->x)
+				pos += copy_line(line, pos, start->x,
+						 line->size - start->x, conv);
 		} else if (iter == end->line) {
-			if (iter->size > end->x)
+			if (line->size > end->x)
 				len = end->x + 1;
 			else
-				len = iter->size;
-			pos += copy_line(iter, pos, 0, len, conv);
+				len = line->size;
+			pos += copy_line(line, pos, 0, len, conv);
 			break;
 		} else {
-			pos += copy_line(iter, pos, 0, iter->size, conv);
+			pos += copy_line(line, pos, 0, line->size, conv);
 		}
 
 		if (conv){
@@ -2124,7 +2725,7 @@ int tsm_screen_selection_copy(struct tsm_screen *con, char **out, bool conv)
 			memcpy(pos, &ch, 4);
 			pos += 4;
 		}
-		iter = iter->next;
+		iter = sb_next(con, iter);
 	}
 
 	if (!end->line) {
@@ -2133,29 +2734,29 @@ int tsm_screen_selection_copy(struct tsm_screen *con, char **out, bool conv)
 		else
 			i = start->y;
 		for ( ; i < con->size_y; ++i) {
-			iter = con->lines[i];
+			line = con->lines[i];
 			if (!start->line && start->y == i && end->y == i) {
 				if (con->size_x > start->x) {
 					if (con->size_x > end->x)
 						len = end->x - start->x + 1;
 					else
 						len = con->size_x - start->x;
-					pos += copy_line(iter, pos, start->x, len, conv);
+					pos += copy_line(line, pos, start->x, len, conv);
 				}
 				break;
 			} else if (!start->line && start->y == i) {
 				if (con->size_x > start->x)
-					pos += copy_line(iter, pos, start->x,
+					pos += copy_line(line, pos, start->x,
 							 con->size_x - start->x, conv);
 			} else if (end->y == i) {
 				if (con->size_x > end->x)
 					len = end->x + 1;
 				else
 					len = con->size_x;
-				pos += copy_line(iter, pos, 0, len, conv);
+				pos += copy_line(line, pos, 0, len, conv);
 				break;
 			} else {
-				pos += copy_line(iter, pos, 0, con->size_x, conv);
+				pos += copy_line(line, pos, 0, con->size_x, conv);
 			}
 
 			if (conv){
@@ -2180,18 +2781,24 @@ tsm_age_t tsm_screen_draw(struct tsm_screen *con, tsm_screen_draw_cb draw_cb,
 			  void *data)
 {
 	unsigned int i, j, k;
-	struct line *iter, *line = NULL;
+	uint64_t iter, row;
+	struct line *line = NULL;
 	struct cell *cell, empty;
 	struct tui_screen_attr attr;
 	const uint32_t *ch;
 	size_t len;
 	bool in_sel = false, sel_start = false, sel_end = false;
 	bool was_sel = false;
+	bool all_rows;
 	tsm_age_t age;
 
 	if (!con || !draw_cb)
 		return 0;
 
+/* the selection state is toggled while walking and scrollback rows aren't
+ * tracked, in those cases (and on age wrap-around) everything is walked */
+	all_rows = con->age_reset || con->sb_pos || con->sel_active;
+
 	cell_init(con, &empty);
 
 	/* push ech character into rendering pipeline */
@@ -2206,30 +2813,35 @@ tsm_age_t tsm_screen_draw(struct tsm_screen *con, tsm_screen_draw_cb draw_cb,
 			in_sel = !in_sel;
 
 		if (con->sel_start.line &&
-		    (!iter || con->sel_start.line->sb_id < iter->sb_id))
+		    (!iter || con->sel_start.line < iter))
 			in_sel = !in_sel;
 		if (con->sel_end.line &&
-		    (!iter || con->sel_end.line->sb_id < iter->sb_id))
+		    (!iter || con->sel_end.line < iter))
 			in_sel = !in_sel;
 	}
 
 	for (i = 0; i < con->size_y; ++i) {
+		row = iter;
 		if (iter) {
-			line = iter;
-			iter = iter->next;
+			line = sb_decode(con, iter);
+			iter = sb_next(con, iter);
 		} else {
 			line = con->lines[k];
 			k++;
 		}
 
+		if (!all_rows &&
+		    !(con->dirty_rows[i >> 6] & ((uint64_t)1 << (i & 63))))
+			continue;
+
 		if (con->sel_active) {
-			if (con->sel_start.line == line ||
+			if ((row && con->sel_start.line == row) ||
 			    (!con->sel_start.line &&
 			     con->sel_start.y == k - 1))
 				sel_start = true;
 			else
 				sel_start = false;
-			if (con->sel_end.line == line ||
+			if ((row && con->sel_end.line == row) ||
 			    (!con->sel_end.line &&
 			     con->sel_end.y == k - 1))
 				sel_end = true;
@@ -2287,6 +2899,9 @@ tsm_age_t tsm_screen_draw(struct tsm_screen *con, tsm_screen_draw_cb draw_cb,
 		}
 	}
 
+	memset(con->dirty_rows, 0,
+		((con->line_num + 63) >> 6) * sizeof(uint64_t));
+
 	if (con->age_reset) {
 		con->age_reset = 0;
 		return 0;
@@ -2294,3 +2909,12 @@ tsm_age_t tsm_screen_draw(struct tsm_screen *con, tsm_screen_draw_cb draw_cb,
 		return con->age_cnt;
 	}
 }
+
+SHL_EXPORT
+void tsm_screen_invalidate(struct tsm_screen *con)
+{
+	if (!con)
+		return;
+
+	rows_dirty(con);
+}
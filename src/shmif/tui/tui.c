@@ -109,6 +109,9 @@ char* arcan_tui_statedescr(struct tui_context* tui)
 		return NULL;
 
 	int tfl = tui->screen->flags;
+	size_t sb_mem;
+	unsigned sb_lines;
+	size_t mem = tsm_screen_memory(tui->screen, &sb_mem, &sb_lines);
 
 	if (-1 == asprintf(&ret,
 		"frame: %d alpha: %d dblbuf: %d "
@@ -119,7 +122,8 @@ char* arcan_tui_statedescr(struct tui_context* tui)
 		"mods: %d iact: %d "
 		"cursor_x: %d cursor_y: %d off: %d hard_off: %d period: %d "
 		"(screen)age: %d margin_top: %u margin_bottom: %u "
-		"cursor_x: %u cursor_y: %u flags: %s%s%s%s%s%s",
+		"cursor_x: %u cursor_y: %u mem: %zu sb_mem: %zu sb_lines: %u "
+		"flags: %s%s%s%s%s%s",
 		(int) tui->fstamp, (int) tui->alpha, (int) tui->dbl_buf,
 		(int) tui->scroll_lock,
 		tui->rows, tui->cols, tui->cell_w, tui->cell_h, tui->pad_w, tui->pad_h,
@@ -130,6 +134,7 @@ char* arcan_tui_statedescr(struct tui_context* tui)
 		tui->cursor_off, tui->cursor_hard_off, tui->cursor_period,
 		(int) tui->screen->age, tui->screen->margin_top, tui->screen->margin_bottom,
 		tui->screen->cursor_x, tui->screen->cursor_y,
+		mem, sb_mem, sb_lines,
 		(tfl & TSM_SCREEN_INSERT_MODE) ? "insert " : "",
 		(tfl & TSM_SCREEN_AUTO_WRAP) ? "autowrap " : "",
 		(tfl & TSM_SCREEN_REL_ORIGIN) ? "relorig " : "",
@@ -182,6 +187,25 @@ const char* curslbl[] = {
 	NULL
 };
 
+static inline void row_set(struct tui_context* tui, uint64_t* map, int row)
+{
+	if (map && row >= 0 && (size_t)row < tui->row_words * 64)
+		map[row >> 6] |= (uint64_t)1 << (row & 63);
+}
+
+static inline void row_clear(struct tui_context* tui, uint64_t* map, size_t row)
+{
+	if (map && row < tui->row_words * 64)
+		map[row >> 6] &= ~((uint64_t)1 << (row & 63));
+}
+
+static inline bool row_isset(
+	struct tui_context* tui, uint64_t* map, size_t row)
+{
+	return map && row < tui->row_words * 64 &&
+		(map[row >> 6] & ((uint64_t)1 << (row & 63)));
+}
+
 static void resolve_cursor(
 	struct tui_context* tui, int* x, int* y, int* w, int* h)
 {
@@ -325,9 +349,8 @@ static void draw_ch(struct tui_context* tui,
 	draw_box(&tui->acon, base_x, base_y,
 		tui->cell_w, tui->cell_h, SHMIF_RGBA(bg[0], bg[1], bg[2], bg[3]));
 
-/* This one is incredibly costly as a deviation in style regarding
- * bold/italic can invalidate the glyph-cache. Ideally, this should
- * be sorted in tsm_screen */
+/* Style is part of the glyph-cache key, so switching between bold/italic
+ * per cell only selects other cache entries rather than invalidating */
 	TTF_SetFontStyle(tui->font[0], prem);
 	size_t allow_w = tui->cell_w + tui->cell_w *
 		(base_x + tui->cell_w * 2 <= tui->acon.w - tui->pad_h);
@@ -392,6 +415,7 @@ static int tsm_draw_callback(struct tsm_screen* screen, uint32_t id,
 		tui->front[pos].attr = *attr;
 		tui->front[pos].fstamp = tui->fstamp;
 		tui->dirty |= DIRTY_PENDING;
+		row_set(tui, tui->dirty_rows, y);
 	}
 
 	return 0;
@@ -440,6 +464,10 @@ static void draw_cbt(struct tui_context* tui,
 		tui->acon.dirty.y2 = y2;
 
 	tui->dirty |= DIRTY_UPDATED;
+	if (y1 >= 0){
+		row_set(tui, tui->drawn_rows, y1 / tui->cell_h);
+		row_set(tui, tui->drawn_rows, (y2 - 1) / tui->cell_h);
+	}
 
 /* Don't go through the font- path if the cell is just whitespace */
 	if (empty){
@@ -517,24 +545,21 @@ static void draw_shaped(struct tui_context* tui,
 {
 	int cw = tui->cell_w;
 	int ch = tui->cell_h;
+	bool full = !synch || (tui->dirty & DIRTY_PENDING_FULL);
+	if (full)
+		tui->drawn_full = true;
 
 	for (size_t row = 0; row < n_rows; row++){
 
-/* scan a full row for changes, since we need to redo the whole row
- * on an eventual change as the shaping might have changed */
-		if (synch && !(tui->dirty & DIRTY_PENDING_FULL)){
-			bool row_changed = false;
-			struct tui_cell* front_row = &front[tui->cols * row];
-			struct tui_cell* back_row = &back[tui->cols * row];
-			for (size_t col = 0; col < n_cols; col++){
-				if (front_row[col].fstamp != back_row[col].fstamp ||row==tui->cursor_y){
-					row_changed = true;
-					break;
-				}
-			}
-			if (!row_changed)
-				continue;
-		}
+/* any change on a row means redoing the whole row as the shaping might have
+ * changed, double buffered also redoes the rows of the previous frame */
+		if (!full && row != tui->cursor_y &&
+			!row_isset(tui, tui->dirty_rows, row) &&
+			!(tui->dbl_buf && row_isset(tui, tui->synch_rows, row)))
+			continue;
+
+		if (synch)
+			row_clear(tui, tui->dirty_rows, row);
 
 		struct shape_state state = {.ind = 0};
 		struct tui_cell* front_row = &front[tui->cols * row];
@@ -546,6 +571,7 @@ static void draw_shaped(struct tui_context* tui,
 		shmif_pixel bgcol = get_bg_col(tui);
 		draw_box(&tui->acon, 0, cury, tui->acon.w, cury+tui->cell_h, bgcol);
 		tui->acon.dirty.x2 = tui->acon.w;
+		row_set(tui, tui->drawn_rows, row);
 
 		if (tui->handlers.substitute)
 			tui->handlers.substitute(tui,
@@ -601,6 +627,9 @@ static void draw_monospace(struct tui_context* tui,
 	struct tui_cell* bpos = back;
 	int cw = tui->cell_w;
 	int ch = tui->cell_h;
+	bool full = !synch || (tui->dirty & DIRTY_PENDING_FULL);
+	if (full)
+		tui->drawn_full = true;
 /*
  * KEEP AS A NOTE: shouldn't be needed after refactor
 	if (row == tui->cursor_x && col == tui->cursor_y){
@@ -608,6 +637,21 @@ static void draw_monospace(struct tui_context* tui,
 	}
  */
 	for (size_t row = 0; row < n_rows; row++){
+
+/* rows of the previous frame are stale in the other buffer when double
+ * buffered, those are redrawn in full */
+		bool force = full ||
+			(tui->dbl_buf && row_isset(tui, tui->synch_rows, row));
+
+/* and rows that tsm_screen_draw didn't touch can be skipped outright */
+		if (!force && !row_isset(tui, tui->dirty_rows, row)){
+			fpos += n_cols, bpos += n_cols, custom += n_cols;
+			continue;
+		}
+
+		if (synch)
+			row_clear(tui, tui->dirty_rows, row);
+
 		if (tui->handlers.substitute &&
 			tui->handlers.substitute(tui,
 				&front[row * tui->cols], n_cols, row, tui->handlers.tag)){
@@ -619,8 +663,7 @@ static void draw_monospace(struct tui_context* tui,
 		for (size_t col = 0; col < n_cols; col++){
 
 /* only update if the source position has changed, treat custom_id separate */
-			if (synch && !(tui->dirty & DIRTY_PENDING_FULL)
-				&& fpos->fstamp == bpos->fstamp){
+			if (!force && fpos->fstamp == bpos->fstamp){
 				fpos++, bpos++, custom++;
 				continue;
 			}
@@ -649,6 +692,44 @@ static void draw_monospace(struct tui_context* tui,
 /* FIXME: custom draw-call goes here */
 }
 
+/*
+ * Called right before a video signal. Consecutive drawn rows are merged into
+ * one dirty region each so that updates far apart (a prompt at the bottom and
+ * a status line at the top) don't turn into one bounding box. If anything was
+ * drawn outside of rows, the bounding box in acon.dirty is used as is.
+ */
+static void synch_rows(struct tui_context* tui)
+{
+	if (!tui->drawn_rows)
+		return;
+
+	if (!tui->drawn_full){
+		size_t start = 0;
+		bool in_run = false;
+
+		for (size_t row = 0; row <= tui->rows; row++){
+			bool set = row < tui->rows && row_isset(tui, tui->drawn_rows, row);
+			if (set && !in_run){
+				start = row;
+				in_run = true;
+			}
+			else if (!set && in_run){
+				arcan_shmif_dirty(&tui->acon, 0, start * tui->cell_h,
+					tui->acon.w, row * tui->cell_h, 0);
+				in_run = false;
+			}
+		}
+	}
+
+/* what we drew now is what the next buffer lacks, swap instead of copy */
+	uint64_t* tmp = tui->synch_rows;
+	tui->synch_rows = tui->drawn_rows;
+	tui->drawn_rows = tmp;
+	memset(tui->drawn_rows, '\0', tui->row_words * sizeof(uint64_t));
+	tui->synch_full = tui->drawn_full;
+	tui->drawn_full = false;
+}
+
 /*
  * blit the scroll-in and scroll-out buffers into the tui->acon vidp
  */
@@ -749,6 +830,7 @@ static void apply_scroll(struct tui_context* tui)
 			if (tui->blitbuffer_dirty && tui->scroll_px){
 				apply_blitbuffer(tui, 1);
 			}
+			synch_rows(tui);
 			arcan_shmif_signal(&tui->acon, SHMIF_SIGVID);
 
 /* retain correct step-size so we don't get a bias against cell size */
@@ -776,6 +858,7 @@ static void apply_scroll(struct tui_context* tui)
 					tui->in_scroll = 0;
 					tui->draw_function(tui, tui->rows, tui->cols,
 						tui->front, tui->back, tui->custom, 0, 0, true);
+					synch_rows(tui);
 					arcan_shmif_signal(&tui->acon, SHMIF_SIGVID);
 					tui->dirty = 0;
 				}
@@ -812,6 +895,7 @@ static void apply_scroll(struct tui_context* tui)
 				apply_blitbuffer(tui, -1);
 			}
 
+			synch_rows(tui);
 			arcan_shmif_signal(&tui->acon, SHMIF_SIGVID);
 			tui->scroll_px -= step_sz;
 			if (tui->scroll_px <= 0){
@@ -832,6 +916,7 @@ static void apply_scroll(struct tui_context* tui)
 					tui->in_scroll = 0;
 					tui->draw_function(tui, tui->rows, tui->cols,
 						tui->front, tui->back, tui->custom, 0, 0, true);
+					synch_rows(tui);
 					arcan_shmif_signal(&tui->acon, SHMIF_SIGVID);
 					tui->dirty = 0;
 				}
@@ -854,6 +939,11 @@ static void update_screen(struct tui_context* tui, bool ign_inact)
 	if (tui->inactive && !ign_inact)
 		return;
 
+/* when double buffered, a full redraw for the last frame means the buffer we
+ * have now needs one as well */
+	if (tui->dbl_buf && tui->synch_full)
+		tui->dirty |= DIRTY_PENDING_FULL;
+
 /* dirty will be set from screen resize, fix the pad region */
 	if (tui->dirty & DIRTY_PENDING_FULL){
 		tui->acon.dirty.x1 = 0;
@@ -908,11 +998,6 @@ static void update_screen(struct tui_context* tui, bool ign_inact)
 		draw_cbt(tui, tc->draw_ch, x, y, &tc->attr, tc->ch == 0, NULL, false);
 	}
 
-/* This is the wrong way to n' buffer here, but as a temporary workaround
- * due to design issues with this part in shmif */
-	if (tui->dbl_buf)
-		tui->dirty |= DIRTY_PENDING_FULL;
-
 	tui->draw_function(tui, tui->rows, tui->cols,
 		tui->front, tui->back, tui->custom, 0, 0, true);
 
@@ -1621,6 +1706,10 @@ static void resize_cellbuffer(struct tui_context* tui)
 	if (tui->base)
 		free(tui->base);
 
+	free(tui->dirty_rows);
+	tui->dirty_rows = tui->drawn_rows = tui->synch_rows = NULL;
+	tui->row_words = 0;
+
 	if (tui->blitbuffer)
 		free(tui->blitbuffer);
 
@@ -1642,6 +1731,24 @@ static void resize_cellbuffer(struct tui_context* tui)
 /* for back buffer, spare one above, one below */
 	tui->back = &tui->base[(tui->rows + 1) * tui->cols];
 	tui->custom = &tui->back[(tui->rows + 1) * tui->cols];
+
+/* row bitmaps cover the spare rows as well, everything starts out drawn */
+	tui->row_words = (tui->rows + 2 + 63) >> 6;
+	tui->dirty_rows = calloc(3 * tui->row_words, sizeof(uint64_t));
+	if (!tui->dirty_rows){
+		LOG("couldn't allocate row damage tracking\n");
+		free(tui->base);
+		tui->base = tui->front = tui->back = tui->custom = NULL;
+		tui->row_words = 0;
+		return;
+	}
+	tui->drawn_rows = &tui->dirty_rows[tui->row_words];
+	tui->synch_rows = &tui->drawn_rows[tui->row_words];
+	tui->drawn_full = tui->synch_full = true;
+
+/* front was just cleared, so have the next tsm_screen_draw repopulate it */
+	tui->age = 0;
+	tsm_screen_invalidate(tui->screen);
 }
 
 static void update_screensize(struct tui_context* tui, bool clear)
@@ -2498,6 +2605,8 @@ int arcan_tui_refresh(struct tui_context* tui)
 		update_screen(tui, false);
 
 	if (tui->dirty & DIRTY_UPDATED){
+		synch_rows(tui);
+
 /* if we are built with GPU offloading support and nothing has happened
  * to our accelerated connection, synch, otherwise fallback and retry */
 #ifndef SHMIF_TUI_DISABLE_GPU
@@ -2560,6 +2669,7 @@ void arcan_tui_destroy(struct tui_context* tui, const char* message)
 	drop_font_context(tui->font_bitmap);
 
 	free(tui->base);
+	free(tui->dirty_rows);
 
 	for (size_t i = 0; i < 32; i++)
 		if (tui->screens[i])
@@ -2709,6 +2819,9 @@ static void apply_arg(struct tui_settings* cfg,
 	if (arg_lookup(args, "scroll", 0, &val) && val)
 		cfg->smooth_scroll = strtoul(val, NULL, 10);
 
+	if (arg_lookup(args, "scrollback", 0, &val) && val)
+		cfg->scrollback = strtoul(val, NULL, 10);
+
 #ifdef WITH_HARFBUZZ
 	if (arg_lookup(args, "substitute", 0, &val) && !src){
 		enable_harfbuzz = true;
@@ -2794,6 +2907,7 @@ struct tui_settings arcan_tui_defaults(
 		.hint = 0,
 		.mouse_fwd = true,
 		.cursor_period = 12,
+		.scrollback = 1000,
 		.font_sz = 0.0416
 	};
 
@@ -2848,6 +2962,7 @@ bool arcan_tui_switch_screen(struct tui_context* ctx, unsigned ind)
 	ctx->dirty |= DIRTY_PENDING_FULL;
 	ctx->screen = ctx->screens[ind];
 	ctx->age = 0;
+	tsm_screen_invalidate(ctx->screen);
 	ctx->age = tsm_screen_draw(ctx->screen, tsm_draw_callback, ctx);
 
 	return true;
@@ -2978,7 +3093,7 @@ struct tui_context* arcan_tui_setup(struct arcan_shmif_cont* con,
 	res->hint = set->hint;
 	res->mouse_forward = set->mouse_fwd;
 	res->cursor_period = set->cursor_period;
-	res->acon.hints = SHMIF_RHINT_SUBREGION;
+	res->acon.hints = SHMIF_RHINT_SUBREGION | SHMIF_RHINT_SUBREGION_CHAIN;
 	res->cursor = set->cursor;
 	res->render_flags = set->render_flags;
 	res->force_bitmap = (set->render_flags & TUI_RENDER_BITMAP) != 0;
@@ -3025,7 +3140,7 @@ struct tui_context* arcan_tui_setup(struct arcan_shmif_cont* con,
 			.bb = res->colors[TUI_COL_BG].rgb[2]
 		}
 	);
-	tsm_screen_set_max_sb(res->screen, 1000);
+	tsm_screen_set_max_sb(res->screen, set->scrollback);
 
 /* clipboard, timer callbacks, no IDENT */
 	queue_requests(res, true, false);
@@ -3127,6 +3242,20 @@ void arcan_tui_write(struct tui_context* c,
 	flag_cursor(c);
 }
 
+void arcan_tui_writeucs4(struct tui_context* c,
+	const uint32_t* ucs4, size_t n, struct tui_screen_attr* attr)
+{
+	if (!c || !ucs4 || !n)
+		return;
+
+	int ss = tsm_screen_write_run(c->screen, ucs4, n, attr);
+	if (c->smooth_scroll && ss){
+		c->scroll_backlog += ss;
+	}
+
+	flag_cursor(c);
+}
+
 void arcan_tui_ident(struct tui_context* c, const char* ident)
 {
 	arcan_event nev = {
@@ -71,6 +71,19 @@ struct tui_context {
 	int blitbuffer_dirty;
 	uint8_t fstamp;
 
+/* ROW DAMAGE, one bit per row in the cell buffers, DIRTY is the allocation
+ * and the other two alias into it like front/back does with base.
+ * dirty_rows: front has changed on the row since the last draw pass
+ * drawn_rows: pixels on the row have been updated since the last signal
+ * synch_rows: drawn_rows for the last signal, when double buffered these are
+ *             the rows that the buffer we draw into now is missing.
+ * The _full flags are set when something outside of the rows was drawn. */
+	uint64_t* dirty_rows;
+	uint64_t* drawn_rows;
+	uint64_t* synch_rows;
+	size_t row_words;
+	bool drawn_full, synch_full;
+
 	unsigned flags;
 	bool focus, inactive, subseg;
 	int inact_timer;
@@ -118,6 +118,11 @@ static void dump_snapshot(struct arcan_shmif_page* page, int qlim)
 		(size_t) page->dirty.x1, (size_t) page->dirty.y1,
 		(size_t) page->dirty.x2, (size_t) page->dirty.y2
 	);
+	printf("synch: next: %"PRIu64", period: %u ms, cost: %u ms, mode: %s\n\t",
+		(uint64_t) page->vsynch.next, (unsigned) page->vsynch.period,
+		(unsigned) page->vsynch.cost,
+		page->synch_mode == SHMIF_SYNCH_FUTEX ? "futex" : "semaphore"
+	);
 
 	printf("render hints:\n\t\t");
 	if (page->hints & SHMIF_RHINT_ORIGO_LL)
@@ -128,6 +133,9 @@ static void dump_snapshot(struct arcan_shmif_page* page, int qlim)
 	if (page->hints & SHMIF_RHINT_SUBREGION)
 		printf("subregion ");
 
+	if (page->hints & SHMIF_RHINT_SUBREGION_CHAIN)
+		printf("subregion-chain(%d) ", (int) page->dirty_chain.count);
+
 	if (page->hints & SHMIF_RHINT_IGNORE_ALPHA)
 		printf("ignore-alpha ");
 
@@ -0,0 +1,42 @@
+--
+-- Wide pipeline traversal test
+-- Many small objects in a shallow hierarchy, like a dashboard
+-- of labels and icons. The anchors keep moving so that every
+-- object needs its properties resolved each frame, but most
+-- of the draw cost is the traversal rather than the fill.
+--
+
+function flathierarch(arguments)
+	system_load("scripts/benchmark.lua")();
+
+	benchmark_setup( arguments[1] );
+
+	anchors = {};
+	for i=1,16 do
+		local a = null_surface(1, 1);
+		move_image(a, math.random(VRESW * 0.5), math.random(VRESH * 0.5));
+		move_image(a, math.random(VRESW * 0.5), math.random(VRESH * 0.5), 100);
+		image_transform_cycle(a, 1);
+		show_image(a);
+		table.insert(anchors, a);
+	end
+
+	counter = 0;
+	benchmark = benchmark_create(200, 5, 500, fill_step, true);
+end
+
+function fill_step()
+	counter = counter + 1;
+	local new = color_surface(4, 4, math.random(255),
+		math.random(255), math.random(255));
+	link_image(new, anchors[counter % #anchors + 1]);
+	move_image(new, math.random(VRESW * 0.5), math.random(VRESH * 0.5));
+	blend_image(new, 0.5 + 0.5 * math.random());
+	return new;
+end
+
+_G[ _G["APPLID"] .. "_clock_pulse"] = function()
+	if (not benchmark:tick()) then
+		return shutdown();
+	end
+end
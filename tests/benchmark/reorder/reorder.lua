@@ -0,0 +1,34 @@
+--
+-- Z-order churn test
+-- Every frame, all objects get a new random order, similar
+-- to restacking a large number of windows and decorations.
+-- Stresses attach/detach in the rendertarget pipeline more
+-- than the drawing itself.
+--
+
+function reorder(arguments)
+	system_load("scripts/benchmark.lua")();
+
+	benchmark_setup( arguments[1] );
+	objects = {};
+	benchmark = benchmark_create(40, 5, 250, fill_step, true);
+end
+
+function fill_step()
+	local new = color_surface(8, 8, math.random(255),
+		math.random(255), math.random(255));
+	move_image(new, math.random(VRESW - 8), math.random(VRESH - 8));
+	show_image(new);
+	table.insert(objects, new);
+	return new;
+end
+
+_G[ _G["APPLID"] .. "_clock_pulse"] = function()
+	for i,v in ipairs(objects) do
+		order_image(v, math.random(65535));
+	end
+
+	if (not benchmark:tick()) then
+		return shutdown();
+	end
+end
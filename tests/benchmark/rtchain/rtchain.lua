@@ -0,0 +1,57 @@
+--
+-- Rendertarget graph test
+-- Each step adds an offscreen rendertarget with static contents,
+-- and every other one samples from the one before it. Only the
+-- first target has anything moving, so the cost should follow
+-- the length of the chain that actually depends on it rather
+-- than the total number of rendertargets.
+--
+
+function rtchain(arguments)
+	system_load("scripts/benchmark.lua")();
+
+	benchmark_setup( arguments[1] );
+
+	mover = color_surface(16, 16, 255, 0, 0);
+	show_image(mover);
+	move_image(mover, 112, 112, 50);
+	image_transform_cycle(mover, 1);
+
+	targets = {};
+	add_target({mover});
+
+	benchmark = benchmark_create(200, 5, 64, fill_step, true);
+end
+
+function add_target(set)
+	local rt = alloc_surface(128, 128);
+	define_rendertarget(rt, set, RENDERTARGET_DETACH,
+		RENDERTARGET_NOSCALE, -1);
+	show_image(rt);
+	move_image(rt, (#targets % 8) * 32, math.floor(#targets / 8) * 32);
+	table.insert(targets, rt);
+	return rt;
+end
+
+function fill_step()
+	local bg = color_surface(128, 128, math.random(255),
+		math.random(255), math.random(255));
+	show_image(bg);
+
+	local set = {bg};
+	if (#targets % 2 == 1) then
+		local src = null_surface(64, 64);
+		image_sharestorage(targets[#targets], src);
+		show_image(src);
+		order_image(src, 2);
+		table.insert(set, src);
+	end
+
+	return add_target(set);
+end
+
+_G[ _G["APPLID"] .. "_clock_pulse"] = function()
+	if (not benchmark:tick()) then
+		return shutdown();
+	end
+end
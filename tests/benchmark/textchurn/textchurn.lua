@@ -0,0 +1,42 @@
+--
+-- Allocation churn test, short lived text objects
+-- with a transform chain each, similar to a text-heavy
+-- UI that rebuilds its labels every frame. Prints the
+-- engine memory counters on shutdown.
+--
+
+function textchurn(arguments)
+	system_load("scripts/benchmark.lua")();
+
+	benchmark_setup( arguments[1] );
+	benchmark = benchmark_create(40, 5, 20, fill_step);
+	churn = {};
+end
+
+function fill_step()
+	local img = null_surface(1, 1);
+	show_image(img);
+	table.insert(churn, img);
+	return img;
+end
+
+function textchurn_clock_pulse()
+	for i,v in ipairs(churn) do
+		local txt = render_text(string.format(
+			"\\f,12 label %d: %d", i, math.random(1000000)));
+		if (valid_vid(txt)) then
+			link_image(txt, v);
+			move_image(txt, math.random(VRESW), math.random(VRESH), 10);
+			expire_image(txt, 2);
+			show_image(txt);
+		end
+	end
+
+	if (not benchmark:tick()) then
+		for k,v in pairs(memory_stats()) do
+			print(string.format("%s:%d:%d:%d:%d:%d",
+				k, v.allocs, v.frees, v.in_use, v.peak, v.pool));
+		end
+		return shutdown();
+	end
+end
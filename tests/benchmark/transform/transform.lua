@@ -29,6 +29,9 @@ end
 
 function transform_clock_pulse()
 	if (not benchmark:tick()) then
+		local _, _, _, _, _, _, counters = benchmark_data();
+		print(string.format("draw calls: %d, objects: %d, batched: %d",
+			counters.draw_calls, counters.draw_objects, counters.draw_batched));
 		return shutdown();
 	end
 end
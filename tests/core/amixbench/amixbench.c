@@ -0,0 +1,115 @@
+/*
+ * Benchmark for the recording mixer kernels (engine/arcan_amix.c) against
+ * the scalar mixer they replaced in arcan_frameserver.c. N stereo sources
+ * with M frames each are converted to float and mixed into interleaved
+ * signed 16-bit output, the output of both versions is also compared.
+ *
+ * Usage: amixbench [sources (default 8)] [frames (default 1024)]
+ *                  [iterations (default 10000)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "arcan_amix.h"
+
+static unsigned long long now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* interleaved float buffers, conversion one sample at a time, mix and clip
+ * per sample (the slide of leftover samples that followed is not included) */
+static void mix_scalar(int16_t** in, float** inbuf,
+	size_t n_src, size_t n, int16_t* out)
+{
+	for (size_t i = 0; i < n_src; i++)
+		for (size_t j = 0; j < n * 2; j++){
+			float val = in[i][j];
+			inbuf[i][j] = 1.0f * (val / 32767.0f);
+		}
+
+	for (size_t sc = 0; sc < n * 2; sc++){
+		float work_sample = 0;
+		for (size_t i = 0; i < n_src; i++)
+			work_sample += inbuf[i][sc] - (work_sample * inbuf[i][sc]);
+
+		out[sc] = work_sample >= 1.0 ? 32767.0 :
+			(work_sample < -1.0 ? -32768 : work_sample * 32767);
+	}
+}
+
+static void mix_planar(int16_t** in, float** left, float** right,
+	size_t n_src, size_t n, int16_t* out)
+{
+	for (size_t i = 0; i < n_src; i++)
+		arcan_amix_deinterleave(in[i], n, 1.0f, 1.0f, left[i], right[i]);
+
+	arcan_amix_planar(left, right, n_src, n, out);
+}
+
+int main(int argc, char** argv)
+{
+	size_t n_src = argc > 1 ? strtoul(argv[1], NULL, 10) : 8;
+	size_t n = argc > 2 ? strtoul(argv[2], NULL, 10) : 1024;
+	size_t iter = argc > 3 ? strtoul(argv[3], NULL, 10) : 10000;
+
+	if (!n_src || !n || !iter){
+		fprintf(stderr, "usage: amixbench [sources] [frames] [iterations]\n");
+		return EXIT_FAILURE;
+	}
+
+	int16_t* in[n_src];
+	float* inbuf[n_src];
+	float* left[n_src];
+	float* right[n_src];
+	int16_t* out_a = malloc(n * 2 * sizeof(int16_t));
+	int16_t* out_b = malloc(n * 2 * sizeof(int16_t));
+
+/* quiet enough that the sum doesn't just clip everywhere */
+	srand(n_src * n);
+	for (size_t i = 0; i < n_src; i++){
+		in[i] = malloc(n * 2 * sizeof(int16_t));
+		inbuf[i] = malloc(n * 2 * sizeof(float));
+		left[i] = malloc(n * sizeof(float));
+		right[i] = malloc(n * sizeof(float));
+		for (size_t j = 0; j < n * 2; j++)
+			in[i][j] = (rand() % 16384) - 8192;
+	}
+
+	mix_scalar(in, inbuf, n_src, n, out_a);
+	mix_planar(in, left, right, n_src, n, out_b);
+
+	size_t mismatch = 0;
+	for (size_t i = 0; i < n * 2; i++)
+		if (abs(out_a[i] - out_b[i]) > 1)
+			mismatch++;
+
+	unsigned long long ts = now_ns();
+	for (size_t i = 0; i < iter; i++)
+		mix_scalar(in, inbuf, n_src, n, out_a);
+	unsigned long long scalar_ns = now_ns() - ts;
+
+	ts = now_ns();
+	for (size_t i = 0; i < iter; i++)
+		mix_planar(in, left, right, n_src, n, out_b);
+	unsigned long long planar_ns = now_ns() - ts;
+
+	double frames = (double) n * iter;
+	printf("mode:sources:frames:ns_per_frame:mframes_per_s\n");
+	printf("scalar:%zu:%zu:%.3f:%.2f\n", n_src, n,
+		(double) scalar_ns / frames, frames / ((double) scalar_ns / 1000.0));
+	printf("planar:%zu:%zu:%.3f:%.2f\n", n_src, n,
+		(double) planar_ns / frames, frames / ((double) planar_ns / 1000.0));
+
+	if (mismatch){
+		fprintf(stderr, "%zu samples differ by more than 1\n", mismatch);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+/*
+ * Redraw benchmark for the glyph path used by the tui renderer
+ * (engine/arcan_ttf.c through shmif/tui/tui.c:draw_ch). Each frame clears
+ * and draws every cell of a screen the way draw_ch does: set the font style
+ * for the cell, then render the glyph blended against the cell background.
+ *
+ * The screen contents are generated once per screen size and mix styles
+ * (normal, bold, italic, bold-italic) with mostly ASCII, some Latin-1 and
+ * box drawing, and a sprinkle of CJK, so that both style switches and a
+ * large set of distinct glyphs are exercised.
+ *
+ * A checksum of the last frame is printed so the output of two builds of
+ * the glyph cache can be compared.
+ *
+ * Usage: glyphbench font.ttf [size in pt (default 12)] [frames (default 20)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "arcan_shmif.h"
+#include "arcan_ttf.h"
+
+struct cell {
+	uint32_t ch;
+	int style;
+	uint8_t fg[4], bg[4];
+};
+
+static unsigned long long now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static const int styles[] = {
+	TTF_STYLE_NORMAL, TTF_STYLE_BOLD,
+	TTF_STYLE_ITALIC, TTF_STYLE_BOLD | TTF_STYLE_ITALIC
+};
+
+static uint32_t gen_ch()
+{
+	int r = rand() % 100;
+	if (r < 70)
+		return 0x21 + rand() % 94;
+	else if (r < 80)
+		return 0xa1 + rand() % 95;
+	else if (r < 90)
+		return 0x2500 + rand() % 128;
+	return 0x4e00 + rand() % 2048;
+}
+
+static void run(TTF_Font* font, size_t cols, size_t rows, size_t frames)
+{
+	int cell_w = 0, cell_h = TTF_FontHeight(font);
+	TTF_SetFontStyle(font, TTF_STYLE_NORMAL);
+	TTF_SizeUTF8(font, "A", &cell_w, NULL, TTF_STYLE_NORMAL);
+
+	size_t w = cols * cell_w, h = rows * cell_h;
+	shmif_pixel* buf = malloc(w * h * sizeof(shmif_pixel));
+	struct cell* cells = malloc(cols * rows * sizeof(struct cell));
+	if (!buf || !cells){
+		fprintf(stderr, "couldn't allocate %zux%zu screen\n", cols, rows);
+		exit(EXIT_FAILURE);
+	}
+
+	srand(cols * rows);
+	for (size_t i = 0; i < cols * rows; i++){
+		uint8_t c = 128 + rand() % 128;
+		cells[i] = (struct cell){
+			.ch = gen_ch(),
+			.style = styles[rand() % 4],
+			.fg = {c, 255 - c, c, 255},
+			.bg = {0, 0, rand() % 64, 255}
+		};
+	}
+
+	unsigned long long start = now_ns();
+	for (size_t frame = 0; frame < frames; frame++){
+		for (size_t y = 0; y < rows; y++)
+			for (size_t x = 0; x < cols; x++){
+				struct cell* c = &cells[y * cols + x];
+				shmif_pixel* dst = &buf[y * cell_h * w + x * cell_w];
+				shmif_pixel bg = SHMIF_RGBA(c->bg[0], c->bg[1], c->bg[2], c->bg[3]);
+
+				for (int row = 0; row < cell_h; row++)
+					for (int col = 0; col < cell_w; col++)
+						dst[row * w + col] = bg;
+
+				unsigned xs = 0, ind = 0;
+				int adv = 0;
+				TTF_SetFontStyle(font, c->style);
+				TTF_RenderUNICODEglyph(dst, cell_w, cell_h, w, &font, 1, c->ch,
+					&xs, c->fg, c->bg, true, false, c->style, &adv, &ind);
+			}
+	}
+	unsigned long long el = now_ns() - start;
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < w * h; i++){
+		hash ^= buf[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	printf("%4zux%-4zu %3dx%-3d cells: %8.3f ms/frame, %6.1f ns/cell (frame %016llx)\n",
+		cols, rows, cell_w, cell_h, (double)el / 1000000.0 / frames,
+		(double)el / (frames * cols * rows), (unsigned long long) hash);
+
+	free(buf);
+	free(cells);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2){
+		fprintf(stderr, "usage: glyphbench font.ttf [pt] [frames]\n");
+		return EXIT_FAILURE;
+	}
+
+	int pt = argc > 2 ? strtoul(argv[2], NULL, 10) : 12;
+	size_t frames = argc > 3 ? strtoul(argv[3], NULL, 10) : 20;
+
+	if (TTF_Init() != 0){
+		fprintf(stderr, "couldn't initialize freetype\n");
+		return EXIT_FAILURE;
+	}
+
+	TTF_Font* font = TTF_OpenFont(argv[1], pt, 96, 96);
+	if (!font){
+		fprintf(stderr, "couldn't open %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	TTF_SetFontHinting(font, TTF_HINTING_NORMAL);
+
+	run(font, 80, 25, frames);
+	run(font, 300, 100, frames);
+
+	TTF_CloseFont(font);
+	TTF_Quit();
+	return EXIT_SUCCESS;
+}
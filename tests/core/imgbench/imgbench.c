@@ -0,0 +1,205 @@
+/*
+ * Benchmark for the image load path (arcan_img_decode + arcan_img_repack)
+ * as used by arcan_vint_getimage. Every PNG/JPEG in a directory is mapped,
+ * decoded and converted to the native pixel format, first with the
+ * conversion going into a separate buffer (the old behavior) and then with
+ * the in-place conversion that lets the decoder output become the store.
+ *
+ * Each pass runs in a child process so that the peak RSS (from wait4) only
+ * covers that pass. Built with OPENGL defined, the native format is BGRA so
+ * the conversion actually has to swap channels.
+ *
+ * Usage: imgbench /path/to/dir [passes (default 4)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "arcan_math.h"
+#include "arcan_general.h"
+#include "arcan_img.h"
+
+/* the engine allocator drags in the rest of the platform, the decoder only
+ * needs page aligned buffers */
+void* arcan_alloc_mem(size_t nb, enum arcan_memtypes type,
+	enum arcan_memhint hint, enum arcan_memalign align)
+{
+	void* buf = NULL;
+	if (0 != posix_memalign(&buf, 4096, nb))
+		return NULL;
+	if (hint & ARCAN_MEM_BZERO)
+		memset(buf, '\0', nb);
+	return buf;
+}
+
+void arcan_mem_free(void* buf)
+{
+	free(buf);
+}
+
+void* arcan_mem_grow(void* src, size_t nz, size_t nb, enum arcan_memhint hint)
+{
+	return realloc(src, nz + nb);
+}
+
+static unsigned long long now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* what arcan_img_repack used to do for a non-native order */
+static av_pixel* repack_copy(uint32_t* inbuf, size_t inw, size_t inh)
+{
+	av_pixel* out = arcan_alloc_mem(
+		inw * inh * sizeof(av_pixel), ARCAN_MEM_VBUFFER, 0, ARCAN_MEMALIGN_PAGE);
+	if (!out)
+		return NULL;
+
+	for (size_t i = 0; i < inw * inh; i++){
+		uint32_t val = inbuf[i];
+		out[i] = RGBA(
+			((val & 0x000000ff) >> 0),
+			((val & 0x0000ff00) >> 8),
+			((val & 0x00ff0000) >> 16),
+			((val & 0xff000000) >> 24)
+		);
+	}
+
+	arcan_mem_free(inbuf);
+	return out;
+}
+
+static bool load(const char* path, bool inplace, size_t* px)
+{
+	int fd = open(path, O_RDONLY);
+	if (-1 == fd)
+		return false;
+
+	struct stat fs;
+	if (-1 == fstat(fd, &fs) || fs.st_size == 0){
+		close(fd);
+		return false;
+	}
+
+	void* map = mmap(NULL, fs.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	uint32_t* buf = NULL;
+	size_t w, h;
+	struct arcan_img_meta meta = {0};
+	arcan_errc rv = arcan_img_decode(path,
+		map, fs.st_size, &buf, &w, &h, &meta, false);
+	munmap(map, fs.st_size);
+
+	if (rv != ARCAN_OK)
+		return false;
+
+	av_pixel* out = inplace ?
+		arcan_img_repack(buf, w, h) : repack_copy(buf, w, h);
+	if (!out)
+		return false;
+
+	*px += w * h;
+	arcan_mem_free(out);
+	return true;
+}
+
+static bool imgext(const char* name)
+{
+	const char* ext = strrchr(name, '.');
+	return ext && (strcasecmp(ext, ".png") == 0 ||
+		strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0);
+}
+
+static void run_pass(const char* dir, bool inplace, size_t passes, int out)
+{
+	DIR* dh = opendir(dir);
+	if (!dh)
+		_exit(EXIT_FAILURE);
+
+	size_t count = 0, px = 0;
+	char path[PATH_MAX];
+	unsigned long long ts = now_ns();
+
+	for (size_t i = 0; i < passes; i++){
+		struct dirent* ent;
+		rewinddir(dh);
+		while ((ent = readdir(dh))){
+			if (!imgext(ent->d_name))
+				continue;
+			snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+			if (load(path, inplace, &px))
+				count++;
+		}
+	}
+
+	unsigned long long res[3] = {now_ns() - ts, count, px};
+	if (sizeof(res) != write(out, res, sizeof(res)))
+		_exit(EXIT_FAILURE);
+	_exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2){
+		fprintf(stderr, "usage: imgbench /path/to/dir [passes]\n");
+		return EXIT_FAILURE;
+	}
+
+	size_t passes = argc > 2 ? strtoul(argv[2], NULL, 10) : 4;
+	if (!passes)
+		passes = 1;
+
+	printf("mode:images:megapixels:time_ms:mpx_per_s:peak_rss_kb\n");
+
+	for (size_t mode = 0; mode < 2; mode++){
+		int pair[2];
+		if (-1 == pipe(pair))
+			return EXIT_FAILURE;
+
+		pid_t pid = fork();
+		if (pid == -1)
+			return EXIT_FAILURE;
+
+		if (pid == 0){
+			close(pair[0]);
+			run_pass(argv[1], mode == 1, passes, pair[1]);
+		}
+		close(pair[1]);
+
+		unsigned long long res[3] = {0};
+		ssize_t nr = read(pair[0], res, sizeof(res));
+		close(pair[0]);
+
+		int status;
+		struct rusage ru;
+		if (-1 == wait4(pid, &status, 0, &ru) ||
+			!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS ||
+			nr != sizeof(res)){
+			fprintf(stderr, "couldn't run pass over %s\n", argv[1]);
+			return EXIT_FAILURE;
+		}
+
+		double ms = (double)res[0] / 1000000.0;
+		double mpx = (double)res[2] / 1000000.0;
+		printf("%s:%llu:%.2f:%.2f:%.2f:%ld\n",
+			mode == 1 ? "inplace" : "copy", res[1], mpx, ms,
+			ms > 0 ? mpx / (ms / 1000.0) : 0.0, ru.ru_maxrss);
+	}
+
+	return EXIT_SUCCESS;
+}
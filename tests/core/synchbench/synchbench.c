@@ -0,0 +1,169 @@
+/*
+ * Microbenchmark for the signal/ack round-trip between a producer and the
+ * server with the two synchronization modes shmif supports, semaphores and
+ * futexes on the ready- word (see SHMIF_FUTEX_SYNCH).
+ *
+ * This does not set up a real connection, it mimics the relevant part of the
+ * shared page (vready + the matching semaphore) in an anonymous shared mapping
+ * so it can be run without an arcan instance. Each client is a process that
+ * sets vready and waits for it to be released, the server is a single process
+ * polling all clients and releasing them like arcan_frameserver_pollframe.
+ *
+ * Usage: synchbench [max_clients (default 8)] [iterations (default 10000)]
+ */
+#include <arcan_shmif.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+struct slot {
+	volatile atomic_uint vready;
+	volatile atomic_uint done;
+	sem_t vsem;
+
+/* written by the client when finished */
+	unsigned long long sum_ns, min_ns, max_ns;
+};
+
+static unsigned long long now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void run_client(struct slot* s, int mode, size_t iter)
+{
+	s->min_ns = ULLONG_MAX;
+
+	for (size_t i = 0; i < iter; i++){
+		unsigned long long ts = now_ns();
+		atomic_store_explicit(&s->vready, 1, memory_order_release);
+
+		unsigned val;
+		while ((val = atomic_load_explicit(&s->vready, memory_order_acquire))){
+			if (mode == SHMIF_SYNCH_FUTEX)
+				arcan_futex_wait(&s->vready, val, -1);
+			else
+				arcan_sem_wait(&s->vsem);
+		}
+
+		unsigned long long dt = now_ns() - ts;
+		s->sum_ns += dt;
+		s->min_ns = dt < s->min_ns ? dt : s->min_ns;
+		s->max_ns = dt > s->max_ns ? dt : s->max_ns;
+	}
+
+	atomic_store(&s->done, 1);
+}
+
+static void run_server(struct slot* slots, size_t n, int mode)
+{
+	size_t alive = n;
+
+	while (alive){
+		alive = 0;
+		bool work = false;
+
+		for (size_t i = 0; i < n; i++){
+			if (atomic_load(&slots[i].done))
+				continue;
+			alive++;
+
+			if (!atomic_load_explicit(&slots[i].vready, memory_order_acquire))
+				continue;
+
+/* same order as the engine: clear, then wake */
+			atomic_store_explicit(&slots[i].vready, 0, memory_order_release);
+			if (mode == SHMIF_SYNCH_FUTEX)
+				arcan_futex_wake(&slots[i].vready, 1);
+			else
+				arcan_sem_post(&slots[i].vsem);
+			work = true;
+		}
+
+		if (!work)
+			sched_yield();
+	}
+}
+
+static bool bench(int mode, size_t n, size_t iter)
+{
+	size_t sz = sizeof(struct slot) * n;
+	struct slot* slots = mmap(NULL, sz,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if (MAP_FAILED == slots){
+		fprintf(stderr, "couldn't map %zu bytes\n", sz);
+		return false;
+	}
+
+	memset(slots, '\0', sz);
+	for (size_t i = 0; i < n; i++)
+		sem_init(&slots[i].vsem, 1, 0);
+
+/* don't let the children inherit (and flush) pending output */
+	fflush(stdout);
+
+	for (size_t i = 0; i < n; i++){
+		pid_t pid = fork();
+		if (0 == pid){
+			run_client(&slots[i], mode, iter);
+			_exit(EXIT_SUCCESS);
+		}
+		else if (-1 == pid){
+			fprintf(stderr, "fork failed: %s\n", strerror(errno));
+			atomic_store(&slots[i].done, 1);
+		}
+	}
+
+	run_server(slots, n, mode);
+	while (wait(NULL) > 0 || errno == EINTR){}
+
+	unsigned long long sum = 0, min = ULLONG_MAX, max = 0;
+	for (size_t i = 0; i < n; i++){
+		sum += slots[i].sum_ns;
+		min = slots[i].min_ns < min ? slots[i].min_ns : min;
+		max = slots[i].max_ns > max ? slots[i].max_ns : max;
+		sem_destroy(&slots[i].vsem);
+	}
+
+	printf("%-9s %7zu %10zu %10.2f %10.2f %10.2f\n",
+		mode == SHMIF_SYNCH_FUTEX ? "futex" : "semaphore", n, iter,
+		(double)sum / (double)(n * iter) / 1000.0,
+		(double)min / 1000.0, (double)max / 1000.0
+	);
+
+	munmap(slots, sz);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	size_t max_clients = argc > 1 ? strtoul(argv[1], NULL, 10) : 8;
+	size_t iter = argc > 2 ? strtoul(argv[2], NULL, 10) : 10000;
+
+	if (!max_clients || !iter){
+		fprintf(stderr, "usage: synchbench [max_clients] [iterations]\n");
+		return EXIT_FAILURE;
+	}
+
+	bool futex = arcan_futex_wake(&(atomic_uint){0}, 0) >= 0;
+	if (!futex)
+		fprintf(stderr, "futex synch not supported, semaphores only\n");
+
+	printf("%-9s %7s %10s %10s %10s %10s\n",
+		"mode", "clients", "iter", "avg(us)", "min(us)", "max(us)");
+
+	for (size_t n = 1; n <= max_clients; n *= 2){
+		bench(SHMIF_SYNCH_SEMAPHORE, n, iter);
+		if (futex)
+			bench(SHMIF_SYNCH_FUTEX, n, iter);
+	}
+
+	return EXIT_SUCCESS;
+}
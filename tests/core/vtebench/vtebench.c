@@ -0,0 +1,469 @@
+/*
+ * Throughput benchmark for the terminal emulator state machine
+ * (frameserver/terminal/default/tsm/tsm_vte.c). The vte is driven headless,
+ * with the arcan_tui calls it makes forwarded straight into a tsm_screen, so
+ * what is measured is parsing and screen-buffer updates, not rendering.
+ *
+ * Three generated streams are fed in pty- sized chunks:
+ *  plain  - lines of printable text
+ *  color  - short words, each wrapped in an SGR color set/reset
+ *  escape - cursor positioning, erase and attribute sequences with little text
+ *
+ * A checksum of the final screen contents and one of the scrollback as seen
+ * when paging through it are printed for each stream so that the output of
+ * two builds of the parser and screen can be compared, along with the memory
+ * held by the screen and its scrollback.
+ *
+ * Usage: vtebench [megabytes per stream (default 16)] [cols (default 80)]
+ *                 [rows (default 25)] [scrollback lines (default 1000)]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "arcan_shmif.h"
+#include "arcan_tui.h"
+#include "tui/libtsm.h"
+
+/* the vte and the tui screen both ship a libtsm.h, only the screen one is
+ * included so the few vte entry points we need are repeated here */
+struct tsm_vte;
+typedef void (*tsm_vte_write_cb)(struct tsm_vte*, const char*, size_t, void*);
+int tsm_vte_new(struct tsm_vte**, struct tui_context*, tsm_vte_write_cb, void*);
+void tsm_vte_input(struct tsm_vte*, const char*, size_t);
+
+#define CHUNK_SZ 4096
+
+struct tui_context {
+	struct tsm_screen* screen;
+	size_t rows, cols;
+};
+
+static unsigned long long now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * minimal arcan_tui on top of tsm_screen, only what the vte uses
+ */
+void arcan_tui_write(struct tui_context* c,
+	uint32_t ucode, struct tui_screen_attr* attr)
+{
+	tsm_screen_write(c->screen, ucode, attr);
+}
+
+void arcan_tui_writeucs4(struct tui_context* c,
+	const uint32_t* ucs4, size_t n, struct tui_screen_attr* attr)
+{
+	tsm_screen_write_run(c->screen, ucs4, n, attr);
+}
+
+bool arcan_tui_writeu8(struct tui_context* c,
+	const uint8_t* u8, size_t n, struct tui_screen_attr* attr)
+{
+	for (size_t i = 0; i < n; i++)
+		tsm_screen_write(c->screen, u8[i], attr);
+	return true;
+}
+
+void arcan_tui_cursorpos(struct tui_context* c, size_t* x, size_t* y)
+{
+	*x = tsm_screen_get_cursor_x(c->screen);
+	*y = tsm_screen_get_cursor_y(c->screen);
+}
+
+struct tui_screen_attr arcan_tui_defattr(
+	struct tui_context* c, struct tui_screen_attr* attr)
+{
+	struct tui_screen_attr res = tsm_screen_get_def_attr(c->screen);
+	if (attr)
+		tsm_screen_set_def_attr(c->screen, attr);
+	return res;
+}
+
+void arcan_tui_dimensions(struct tui_context* c, size_t* rows, size_t* cols)
+{
+	if (rows)
+		*rows = c->rows;
+	if (cols)
+		*cols = c->cols;
+}
+
+void arcan_tui_delete_chars(struct tui_context* c, size_t n)
+{
+	tsm_screen_delete_chars(c->screen, n);
+}
+
+void arcan_tui_delete_lines(struct tui_context* c, size_t n)
+{
+	tsm_screen_delete_lines(c->screen, n);
+}
+
+void arcan_tui_insert_chars(struct tui_context* c, size_t n)
+{
+	tsm_screen_insert_chars(c->screen, n);
+}
+
+void arcan_tui_insert_lines(struct tui_context* c, size_t n)
+{
+	tsm_screen_insert_lines(c->screen, n);
+}
+
+void arcan_tui_erase_chars(struct tui_context* c, size_t n)
+{
+	tsm_screen_erase_chars(c->screen, n);
+}
+
+void arcan_tui_erase_current_line(struct tui_context* c, bool protect)
+{
+	tsm_screen_erase_current_line(c->screen, protect);
+}
+
+void arcan_tui_erase_cursor_to_end(struct tui_context* c, bool protect)
+{
+	tsm_screen_erase_cursor_to_end(c->screen, protect);
+}
+
+void arcan_tui_erase_cursor_to_screen(struct tui_context* c, bool protect)
+{
+	tsm_screen_erase_cursor_to_screen(c->screen, protect);
+}
+
+void arcan_tui_erase_home_to_cursor(struct tui_context* c, bool protect)
+{
+	tsm_screen_erase_home_to_cursor(c->screen, protect);
+}
+
+void arcan_tui_erase_screen_to_cursor(struct tui_context* c, bool protect)
+{
+	tsm_screen_erase_screen_to_cursor(c->screen, protect);
+}
+
+void arcan_tui_erase_screen(struct tui_context* c, bool protect)
+{
+	tsm_screen_erase_screen(c->screen, protect);
+}
+
+void arcan_tui_erase_sb(struct tui_context* c)
+{
+	tsm_screen_clear_sb(c->screen);
+}
+
+void arcan_tui_move_to(struct tui_context* c, size_t x, size_t y)
+{
+	tsm_screen_move_to(c->screen, x, y);
+}
+
+void arcan_tui_move_up(struct tui_context* c, size_t n, bool scroll)
+{
+	tsm_screen_move_up(c->screen, n, scroll);
+}
+
+void arcan_tui_move_down(struct tui_context* c, size_t n, bool scroll)
+{
+	tsm_screen_move_down(c->screen, n, scroll);
+}
+
+void arcan_tui_move_left(struct tui_context* c, size_t n)
+{
+	tsm_screen_move_left(c->screen, n);
+}
+
+void arcan_tui_move_right(struct tui_context* c, size_t n)
+{
+	tsm_screen_move_right(c->screen, n);
+}
+
+void arcan_tui_move_line_home(struct tui_context* c)
+{
+	tsm_screen_move_line_home(c->screen);
+}
+
+void arcan_tui_newline(struct tui_context* c)
+{
+	tsm_screen_newline(c->screen);
+}
+
+void arcan_tui_scroll_up(struct tui_context* c, size_t n)
+{
+	tsm_screen_scroll_up(c->screen, n);
+}
+
+void arcan_tui_scroll_down(struct tui_context* c, size_t n)
+{
+	tsm_screen_scroll_down(c->screen, n);
+}
+
+int arcan_tui_set_flags(struct tui_context* c, int flags)
+{
+	tsm_screen_set_flags(c->screen, flags);
+	return (int) tsm_screen_get_flags(c->screen);
+}
+
+void arcan_tui_reset_flags(struct tui_context* c, int flags)
+{
+	tsm_screen_reset_flags(c->screen, flags);
+}
+
+int arcan_tui_set_margins(struct tui_context* c, size_t top, size_t bottom)
+{
+	return tsm_screen_set_margins(c->screen, top, bottom);
+}
+
+void arcan_tui_reset(struct tui_context* c)
+{
+	tsm_screen_reset(c->screen);
+}
+
+void arcan_tui_set_tabstop(struct tui_context* c)
+{
+	tsm_screen_set_tabstop(c->screen);
+}
+
+void arcan_tui_reset_tabstop(struct tui_context* c)
+{
+	tsm_screen_reset_tabstop(c->screen);
+}
+
+void arcan_tui_reset_all_tabstops(struct tui_context* c)
+{
+	tsm_screen_reset_all_tabstops(c->screen);
+}
+
+void arcan_tui_tab_left(struct tui_context* c, size_t n)
+{
+	tsm_screen_tab_left(c->screen, n);
+}
+
+void arcan_tui_tab_right(struct tui_context* c, size_t n)
+{
+	tsm_screen_tab_right(c->screen, n);
+}
+
+void arcan_tui_refinc(struct tui_context* c)
+{
+}
+
+void arcan_tui_refdec(struct tui_context* c)
+{
+}
+
+/* only reachable through the debug window, which is never opened here */
+struct tui_settings arcan_tui_defaults(
+	arcan_tui_conn* conn, struct tui_context* ref)
+{
+	return (struct tui_settings){0};
+}
+
+struct tui_context* arcan_tui_setup(arcan_tui_conn* con,
+	const struct tui_settings* set, const struct tui_cbcfg* cfg,
+	size_t cfg_sz, ...)
+{
+	return NULL;
+}
+
+void arcan_tui_destroy(struct tui_context* c, const char* message)
+{
+}
+
+int arcan_tui_refresh(struct tui_context* c)
+{
+	return 0;
+}
+
+struct tui_process_res arcan_tui_process(
+	struct tui_context** contexts, size_t n_contexts,
+	int* fdset, size_t fdset_sz, int timeout)
+{
+	return (struct tui_process_res){0};
+}
+
+char* arcan_tui_statedescr(struct tui_context* c)
+{
+	return NULL;
+}
+
+/*
+ * stream generators
+ */
+static const char* words[] = {
+	"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing",
+	"elit", "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore",
+	"et", "dolore", "magna", "aliqua", "[INFO]", "0x7f3a2c", "/usr/lib/arcan"
+};
+#define N_WORDS (sizeof(words) / sizeof(words[0]))
+
+static size_t gen_plain(char* dst, size_t lim)
+{
+	size_t pos = 0, col = 0;
+
+	while (pos + 32 < lim){
+		const char* w = words[rand() % N_WORDS];
+		pos += sprintf(&dst[pos], "%s ", w);
+		col += strlen(w) + 1;
+		if (col > 72 + rand() % 40){
+			pos += sprintf(&dst[pos], "\r\n");
+			col = 0;
+		}
+	}
+
+	return pos;
+}
+
+static size_t gen_color(char* dst, size_t lim)
+{
+	size_t pos = 0, col = 0;
+
+	while (pos + 48 < lim){
+		const char* w = words[rand() % N_WORDS];
+		pos += sprintf(&dst[pos], "\033[%d;%dm%s\033[0m ",
+			rand() % 2, 30 + rand() % 8, w);
+		col += strlen(w) + 1;
+		if (col > 72 + rand() % 40){
+			pos += sprintf(&dst[pos], "\r\n");
+			col = 0;
+		}
+	}
+
+	return pos;
+}
+
+static size_t gen_escape(char* dst, size_t lim, size_t cols, size_t rows)
+{
+	size_t pos = 0;
+
+	while (pos + 64 < lim){
+		switch (rand() % 6){
+		case 0:
+			pos += sprintf(&dst[pos], "\033[%zu;%zuH",
+				1 + rand() % rows, 1 + rand() % cols);
+		break;
+		case 1:
+			pos += sprintf(&dst[pos], "\033[%dK", rand() % 3);
+		break;
+		case 2:
+			pos += sprintf(&dst[pos], "\033[38;5;%dm\033[48;5;%dm",
+				rand() % 256, rand() % 256);
+		break;
+		case 3:
+			pos += sprintf(&dst[pos], "\033[%dA\033[%dC", 1 + rand() % 4, 1 + rand() % 8);
+		break;
+		case 4:
+			pos += sprintf(&dst[pos], "\033[1;4;7m%s\033[m", words[rand() % N_WORDS]);
+		break;
+		case 5:
+			pos += sprintf(&dst[pos], "%s", words[rand() % N_WORDS]);
+		break;
+		}
+	}
+
+	return pos;
+}
+
+static int hash_cell(struct tsm_screen* con, uint32_t id, const uint32_t* ch,
+	size_t len, unsigned int width, unsigned int posx, unsigned int posy,
+	const struct tui_screen_attr* attr, tsm_age_t age, void* data)
+{
+	uint64_t* hash = data;
+	uint32_t val = len ? ch[0] : 0;
+
+/* FNV-1a over position, codepoint and colors */
+	uint32_t fields[] = {posx, posy, val,
+		attr->fr << 16 | attr->fg << 8 | attr->fb,
+		attr->br << 16 | attr->bg << 8 | attr->bb};
+
+	for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++){
+		*hash ^= fields[i];
+		*hash *= 0x100000001b3ull;
+	}
+
+	return 0;
+}
+
+static void vte_write(struct tsm_vte* vte, const char* u8, size_t len, void* tag)
+{
+}
+
+static void run(const char* name,
+	const char* buf, size_t len, size_t cols, size_t rows, size_t sb)
+{
+	struct tui_context ctx = {.rows = rows, .cols = cols};
+	struct tsm_vte* vte;
+
+	if (0 != tsm_screen_new(&ctx.screen, NULL, NULL) ||
+		0 != tsm_screen_resize(ctx.screen, cols, rows) ||
+		0 != tsm_vte_new(&vte, &ctx, vte_write, NULL)){
+		fprintf(stderr, "%s: couldn't setup screen/vte\n", name);
+		exit(EXIT_FAILURE);
+	}
+	tsm_screen_set_max_sb(ctx.screen, sb);
+
+	unsigned long long start = now_ns();
+	for (size_t ofs = 0; ofs < len; ofs += CHUNK_SZ){
+		size_t ntw = len - ofs > CHUNK_SZ ? CHUNK_SZ : len - ofs;
+		tsm_vte_input(vte, &buf[ofs], ntw);
+	}
+	unsigned long long el = now_ns() - start;
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+	tsm_screen_draw(ctx.screen, hash_cell, &hash);
+
+/* walk the scrollback from the top and back down one page at a time */
+	uint64_t sb_hash = 0xcbf29ce484222325ull;
+	start = now_ns();
+	for (size_t i = 0; i <= sb / rows; i++)
+		tsm_screen_sb_page_up(ctx.screen, 1);
+	do {
+		tsm_screen_draw(ctx.screen, hash_cell, &sb_hash);
+	} while (tsm_screen_sb_page_down(ctx.screen, 1) == rows);
+	unsigned long long sb_el = now_ns() - start;
+
+	size_t sb_mem;
+	unsigned sb_lines;
+	size_t mem = tsm_screen_memory(ctx.screen, &sb_mem, &sb_lines);
+
+	printf("%-8s %8.2f MB in %8.2f ms: %8.2f MB/s (screen %016llx)\n",
+		name, (double)len / (1024.0 * 1024.0), (double)el / 1000000.0,
+		((double)len / (1024.0 * 1024.0)) / ((double)el / 1000000000.0),
+		(unsigned long long) hash);
+	printf("%-8s %8u sb lines in %6zu KiB (total %6zu KiB), "
+		"paged in %8.2f ms (sb %016llx)\n", "", sb_lines, sb_mem / 1024,
+		mem / 1024, (double)sb_el / 1000000.0, (unsigned long long) sb_hash);
+}
+
+int main(int argc, char** argv)
+{
+	size_t mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 16;
+	size_t cols = argc > 2 ? strtoul(argv[2], NULL, 10) : 80;
+	size_t rows = argc > 3 ? strtoul(argv[3], NULL, 10) : 25;
+	size_t sb = argc > 4 ? strtoul(argv[4], NULL, 10) : 1000;
+
+	if (!mb || !cols || !rows){
+		fprintf(stderr, "usage: vtebench [megabytes] [cols] [rows] [sb]\n");
+		return EXIT_FAILURE;
+	}
+
+	size_t lim = mb * 1024 * 1024;
+	char* buf = malloc(lim);
+	if (!buf)
+		return EXIT_FAILURE;
+
+	srand(lim);
+	run("plain", buf, gen_plain(buf, lim), cols, rows, sb);
+
+	srand(lim);
+	run("color", buf, gen_color(buf, lim), cols, rows, sb);
+
+	srand(lim);
+	run("escape", buf, gen_escape(buf, lim, cols, rows), cols, rows, sb);
+
+	free(buf);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+/*
+ * Test client for SHMIF_RHINT_SUBREGION_CHAIN, two small regions in opposite
+ * corners (think cursor and status bar) change every frame. With the chain,
+ * only those two should be synched rather than their bounding box, which
+ * covers pretty much the whole buffer. Every 100 frames the chain is flooded
+ * to test the fallback to the bounding box.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <stdbool.h>
+
+#include <arcan_shmif.h>
+
+static void fill(struct arcan_shmif_cont* cont,
+	size_t x, size_t y, size_t w, size_t h, shmif_pixel col)
+{
+	for (size_t row = y; row < y + h && row < cont->h; row++)
+		for (size_t px = x; px < x + w && px < cont->w; px++)
+			cont->vidp[row * cont->pitch + px] = col;
+}
+
+int main(int argc, char** argv)
+{
+	struct arg_arr* aarr;
+	struct arcan_shmif_cont cont = arcan_shmif_open(
+		SEGID_APPLICATION, SHMIF_ACQUIRE_FATALFAIL, &aarr);
+
+	cont.hints |= SHMIF_RHINT_SUBREGION | SHMIF_RHINT_SUBREGION_CHAIN;
+	arcan_shmif_resize(&cont, 640, 480);
+
+	fill(&cont, 0, 0, cont.w, cont.h, SHMIF_RGBA(32, 32, 32, 0xff));
+	arcan_shmif_signal(&cont, SHMIF_SIGVID);
+
+	arcan_event ev;
+	bool running = true;
+	size_t frame = 0;
+
+	while(running){
+		uint8_t step = frame * 8;
+		shmif_pixel col = SHMIF_RGBA(step, 255 - step, 0, 0xff);
+
+/* cursor in the upper left */
+		fill(&cont, 8, 8, 8, 16, (frame % 2) ? col : SHMIF_RGBA(32, 32, 32, 0xff));
+		arcan_shmif_dirty(&cont, 8, 8, 16, 24, 0);
+
+/* status in the lower right */
+		fill(&cont, cont.w - 64, cont.h - 16, 64, 16, col);
+		arcan_shmif_dirty(&cont, cont.w - 64, cont.h - 16, cont.w, cont.h, 0);
+
+/* overflow the chain */
+		if (frame % 100 == 0){
+			for (size_t i = 0; i < ARCAN_SHMIF_DIRTYCHAIN_LIM; i++){
+				fill(&cont, 32 + i * 24, 240, 16, 16, col);
+				arcan_shmif_dirty(&cont, 32 + i * 24, 240, 48 + i * 24, 256, 0);
+			}
+			printf("frame %zu: overflow chain\n", frame);
+		}
+
+		arcan_shmif_signal(&cont, SHMIF_SIGVID);
+		frame++;
+
+		int rv;
+		while ( (rv = arcan_shmif_poll(&cont, &ev)) == 1){
+			if (ev.category == EVENT_TARGET)
+			switch (ev.tgt.kind){
+			case TARGET_COMMAND_EXIT:
+				running = false;
+			break;
+			default:
+			break;
+			}
+		}
+
+		if (rv == -1)
+			running = false;
+
+		usleep(16000);
+	}
+
+	arcan_shmif_drop(&cont);
+	return EXIT_SUCCESS;
+}
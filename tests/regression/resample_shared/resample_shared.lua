@@ -0,0 +1,33 @@
+local rshader = [[
+	uniform sampler2D map_diffuse;
+	varying vec2 texco;
+
+	void main()
+	{
+		vec3 col = texture2D(map_diffuse, texco).rgb;
+		gl_FragColor = vec4(col.g, col.r, col.b, 1.0);
+	}
+]];
+
+function resample_shared(arguments)
+	local src = fill_surface(64, 64, 255, 0, 0);
+	save_screenshot("resample_shared_src.png", FORMAT_PNG, src);
+	delete_image(src);
+
+-- both loads resolve to the same cached store
+	local a = load_image("resample_shared_src.png");
+	local b = load_image("resample_shared_src.png");
+	local resamp = build_shader(nil, rshader, "scaler");
+
+	resample_image(b, resamp, 128, 128, a);
+
+	local ap = image_storage_properties(a);
+	local bp = image_storage_properties(b);
+	if (ap.width ~= 128 or ap.height ~= 128 or
+		bp.width ~= 64 or bp.height ~= 64) then
+		return shutdown("resample leaked into the shared store", EXIT_FAILURE);
+	end
+
+	save_screenshot(arguments[1], FORMAT_PNG, b);
+	return shutdown();
+end